@@ -12,6 +12,10 @@ endif()
 include(CheckIncludeFiles)
 check_include_files(unistd.h SOLARUS_HAVE_UNISTD_H)
 
+# Define SOLARUS_HAVE_MMAP if quest files can be mapped in memory.
+include(CheckSymbolExists)
+check_symbol_exists(mmap "sys/mman.h" SOLARUS_HAVE_MMAP)
+
 # Define SOLARUS_HAVE_OPENGL to indicate if OpenGL is supported.
 # Otherwise OpenGL ES is used.
 if(OPENGL_FOUND)
@@ -0,0 +1,14 @@
+# Tool that compiles Lua data files of quests to a binary format.
+option(SOLARUS_DATA_COMPILER "Generate the quest data compiler" ON)
+
+if(SOLARUS_DATA_COMPILER)
+  add_executable(solarus-data-compiler "")
+  target_sources(solarus-data-compiler
+    PRIVATE
+      "${CMAKE_CURRENT_SOURCE_DIR}/tools/data_compiler/main.cpp"
+  )
+  target_link_libraries(solarus-data-compiler
+    PUBLIC
+      solarus
+  )
+endif()
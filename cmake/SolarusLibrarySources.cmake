@@ -4,8 +4,10 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/ItDecoder.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/Music.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/OggDecoder.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/PcmRingBuffer.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/Sound.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/audio/SpcDecoder.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/FlatStringMap.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/Grid.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/containers/Quadtree.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Ability.h"
@@ -16,6 +18,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/CommandsEffects.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Common.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/CurrentQuest.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/DataFileBuffer.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Debug.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/DialogBoxSystem.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Dialog.h"
@@ -34,9 +37,9 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/MainLoop.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/MapData.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Map.h"
-    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/PerfCounter.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/PixelBits.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Point.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Profiler.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/QuestDatabase.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/QuestFiles.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/QuestProperties.h"
@@ -57,6 +60,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/TimerPtr.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Transform.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/core/Treasure.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/AnimatedTileMap.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/AnimatedTilePattern.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Arrow.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Block.h"
@@ -68,6 +72,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/CameraPtr.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/CarriedObject.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Chest.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/CollisionBroadPhase.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/CollisionMode.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/CrystalBlock.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Crystal.h"
@@ -94,6 +99,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/HeroPtr.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Hookshot.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Jumper.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/NavigationGrid.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/NonAnimatedRegions.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/Npc.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/entities/ParallaxScrollingTilePattern.h"
@@ -131,10 +137,12 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Hq2xFilter.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Hq3xFilter.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Hq4xFilter.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/PixelBitsCache.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/quest_icon.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Renderer.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/Scale2xFilter.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/SDLPtrs.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/SkylinePacker.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/sdlrenderer/SDLRenderer.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/sdlrenderer/SDLShader.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/graphics/sdlrenderer/SDLSurfaceImpl.h"
@@ -191,6 +199,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/TreasureState.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/UsingItemState.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/hero/VictoryState.h"
+    "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/CompiledLuaData.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/ExportableToLua.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/ExportableToLuaPtr.h"
     "${CMAKE_CURRENT_SOURCE_DIR}/include/solarus/lua/LuaContext.h"
@@ -231,12 +240,14 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/ItDecoder.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/Music.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/OggDecoder.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/PcmRingBuffer.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/Sound.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/audio/SpcDecoder.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/AbilityInfo.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Arguments.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/CommandsEffects.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/CurrentQuest.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/DataFileBuffer.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Debug.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/DialogBoxSystem.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Dialog.cpp"
@@ -253,9 +264,9 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/MainLoop.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Map.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/MapData.cpp"
-    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/PerfCounter.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/PixelBits.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Point.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Profiler.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/QuestDatabase.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/QuestFiles.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/QuestProperties.cpp"
@@ -272,6 +283,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/System.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Timer.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/core/Treasure.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/AnimatedTileMap.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/AnimatedTilePattern.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Arrow.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Block.cpp"
@@ -281,6 +293,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Camera.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/CarriedObject.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Chest.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/CollisionBroadPhase.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/CollisionMode.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/CrystalBlock.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Crystal.cpp"
@@ -302,6 +315,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Hero.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Hookshot.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Jumper.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/NavigationGrid.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/NonAnimatedRegions.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/Npc.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/entities/ParallaxScrollingTilePattern.cpp"
@@ -332,6 +346,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Hq2xFilter.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Hq3xFilter.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Hq4xFilter.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/PixelBitsCache.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Renderer.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Scale2xFilter.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/sdlrenderer/SDLRenderer.cpp"
@@ -339,6 +354,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/sdlrenderer/SDLSurfaceImpl.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/Shader.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/ShaderData.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/SkylinePacker.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/SoftwarePixelFilter.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/SoftwareVideoMode.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/graphics/SpriteAnimation.cpp"
@@ -386,6 +402,7 @@ target_sources(solarus
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/UsingItemState.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/hero/VictoryState.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/AudioApi.cpp"
+    "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/CompiledLuaData.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/DrawableApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/EntityApi.cpp"
     "${CMAKE_CURRENT_SOURCE_DIR}/src/lua/ExportableToLua.cpp"
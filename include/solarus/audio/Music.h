@@ -18,10 +18,15 @@
 #define SOLARUS_MUSIC_H
 
 #include "solarus/core/Common.h"
+#include "solarus/audio/PcmRingBuffer.h"
 #include "solarus/audio/Sound.h"
 #include "solarus/lua/ScopedLuaRef.h"
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace Solarus {
@@ -40,6 +45,11 @@ class SpcDecoder;
  * initialized, by calling Sound::initialize().
  * Sound and Music are the only classes that depends on audio libraries.
  *
+ * Musics are decoded ahead of time by a streaming thread into a ring
+ * buffer of PCM samples. The main thread only queues these samples into
+ * OpenAL buffers and calls the Lua callback when the music ends.
+ * Decoders are shared by both threads and protected by a mutex.
+ *
  * TODO move the non-static parts to an internal private class.
  * TODO make a subclass for each format?
  */
@@ -62,6 +72,8 @@ class SOLARUS_API Music {
     static const std::vector<std::string>
         format_names;                            /**< Name of each format. */
 
+    ~Music();
+
     static void initialize();
     static void quit();
     static bool is_initialized();
@@ -100,15 +112,18 @@ class SOLARUS_API Music {
         const ScopedLuaRef& callback_ref
     );
 
+    static void run_stream_thread();
+
     bool start();
     void stop();
     bool is_paused();
     void set_paused(bool pause);
     void set_callback(const ScopedLuaRef& callback_ref);
 
-    void decode_spc(ALuint destination_buffer, ALsizei nb_samples);
-    void decode_it(ALuint destination_buffer, ALsizei nb_samples);
-    void decode_ogg(ALuint destination_buffer, ALsizei nb_samples);
+    int decode_spc(ALshort* decoded_data, int nb_samples);
+    int decode_it(ALshort* decoded_data, int nb_samples);
+    int decode_ogg(ALshort* decoded_data, int nb_samples);
+    bool stream_samples();
 
     bool update_playing();
 
@@ -119,8 +134,18 @@ class SOLARUS_API Music {
     ScopedLuaRef callback_ref;                   /**< Lua ref to a function to call when the music finishes. */
 
     static constexpr int nb_buffers = 8;
+    static constexpr int buffer_size = 16384;    /**< Number of 16-bit values per buffer. */
     ALuint buffers[nb_buffers];                  /**< multiple buffers used to stream the music */
     ALuint source;                               /**< the OpenAL source streaming the buffers */
+    std::vector<ALuint> free_buffers;            /**< Buffers waiting for decoded samples. */
+    ALenum al_format;                            /**< OpenAL format of decoded samples. */
+    ALsizei sample_rate;                         /**< Sample rate of decoded samples. */
+
+    PcmRingBuffer decoded_samples;               /**< Samples decoded by the streaming thread
+                                                  * and not queued to OpenAL yet. */
+    std::atomic<bool> end_of_stream;             /**< Whether the streaming thread has decoded everything. */
+    std::vector<ALshort> chunk;                  /**< Chunk being pushed by the streaming thread. */
+    size_t chunk_position;                       /**< Samples of the chunk already pushed. */
 
     static std::unique_ptr<SpcDecoder>
         spc_decoder;                             /**< The SPC decoder. */
@@ -130,6 +155,13 @@ class SOLARUS_API Music {
         ogg_decoder;                             /**< The OGG decoder. */
     static float volume;                         /**< volume of musics (0.0 to 1.0) */
 
+    static std::thread stream_thread;            /**< Thread that decodes the current music. */
+    static std::mutex decoder_mutex;             /**< Lock for decoders and streaming_music. */
+    static std::condition_variable
+        stream_condition;                        /**< Wakes up the streaming thread. */
+    static bool stream_stopping;                 /**< Whether the streaming thread has to stop. */
+    static Music* streaming_music;               /**< The music decoded by the streaming thread. */
+
     static std::unique_ptr<Music> current_music; /**< the music currently played (if any) */
 
 };
@@ -35,7 +35,9 @@ class OggDecoder {
 
     bool load(std::string&& ogg_data, bool loop);
     void unload();
-    void decode(ALuint destination_buffer, ALsizei nb_samples);
+    int get_num_channels() const;
+    int get_sample_rate() const;
+    int decode(ALshort* decoded_data, ALsizei nb_samples);
 
   private:
 
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PCM_RING_BUFFER_H
+#define SOLARUS_PCM_RING_BUFFER_H
+
+#include "solarus/core/Common.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Fixed-size queue of decoded PCM samples between two threads.
+ *
+ * One thread (the producer) pushes samples and another one (the consumer)
+ * pops them, without locks.
+ * Each function is documented with the thread allowed to call it.
+ */
+class SOLARUS_API PcmRingBuffer {
+
+  public:
+
+    explicit PcmRingBuffer(size_t capacity);
+
+    PcmRingBuffer(const PcmRingBuffer& other) = delete;
+    PcmRingBuffer& operator=(const PcmRingBuffer& other) = delete;
+
+    size_t get_capacity() const;
+    size_t get_num_samples() const;
+    size_t get_num_free_samples() const;
+
+    size_t push(const int16_t* samples, size_t num_samples);
+    size_t pop(int16_t* samples, size_t num_samples);
+    void clear();
+
+  private:
+
+    std::vector<int16_t> samples;        /**< Storage. Its size is a power of two. */
+    size_t mask;                         /**< Size of the storage minus one. */
+    std::atomic<size_t> read_index;      /**< Number of samples popped so far. */
+    std::atomic<size_t> write_index;     /**< Number of samples pushed so far. */
+
+};
+
+}
+
+#endif
+
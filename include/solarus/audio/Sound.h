@@ -18,9 +18,11 @@
 #define SOLARUS_SOUND_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/DataFileBuffer.h"
+#include <cstdint>
 #include <string>
-#include <list>
 #include <map>
+#include <vector>
 #include <al.h>
 #include <alc.h>
 #include <vorbis/vorbisfile.h>
@@ -37,6 +39,10 @@ class Arguments;
  * rather than calling directly the constructor of Sound.
  * This class is the only one that depends on the sound decoding library (libsndfile).
  * This class and the Music class are the only ones that depend on the audio mixer library (OpenAL).
+ *
+ * Sounds are played on a fixed pool of OpenAL sources (voices).
+ * A sound can only play a few times at once: starting it again restarts
+ * its oldest instance. When all voices are busy, the oldest one is stolen.
  */
 class SOLARUS_API Sound {
 
@@ -48,7 +54,7 @@ class SOLARUS_API Sound {
      * \brief Buffer containing an encoded sound file.
      */
     struct SoundFromMemory {
-      std::string data;         /**< The OGG encded data. */
+      DataFileBufferPtr data;   /**< The OGG encoded data. */
       size_t position;          /**< Current position in the buffer. */
       bool loop;                /**< \c true to restart the sound if it finishes. */
     };
@@ -76,23 +82,49 @@ class SOLARUS_API Sound {
 
   private:
 
-    ALuint decode_file(const std::string& file_name);
-    bool update_playing();
+    /**
+     * \brief Decoded samples of a sound, always in 16-bit stereo.
+     */
+    struct PcmData {
+      ALsizei sample_rate = 0;       /**< Sample rate in Hz. */
+      std::vector<char> samples;     /**< The PCM data. */
+    };
+
+    static std::string get_file_name(const std::string& sound_id);
+    static bool decode_file(const std::string& file_name, PcmData& pcm);
+    static void decode_files(
+        const std::vector<std::string>& file_names,
+        std::vector<PcmData>& pcms
+    );
+    ALuint create_buffer(const char* samples, size_t num_bytes, ALsizei sample_rate);
+
+    /**
+     * \brief An OpenAL source of the pool and the sound it plays.
+     */
+    struct Voice {
+      ALuint source;               /**< The OpenAL source. */
+      Sound* sound;                /**< The sound playing on it, or nullptr if it is free. */
+      uint64_t start_order;        /**< When the sound was started. */
+    };
+
+    static Voice* acquire_voice(Sound& sound);
+    static void release_voice(Voice& voice);
 
     static ALCdevice* device;
     static ALCcontext* context;
 
     std::string id;                              /**< id of this sound */
     ALuint buffer;                               /**< the OpenAL buffer containing the PCM decoded data of this sound */
-    std::list<ALuint> sources;                   /**< the sources currently playing this sound */
-    static std::list<Sound*> current_sounds;     /**< the sounds currently playing */
+    static constexpr int max_voices = 32;        /**< Number of OpenAL sources for sounds. */
+    static constexpr int max_voices_per_sound = 4;   /**< Maximum instances of a sound playing at once. */
+    static std::vector<Voice> voices;            /**< Pool of OpenAL sources created at initialization. */
+    static uint64_t next_start_order;            /**< Order of the next sound started. */
     static std::map<std::string, Sound> all_sounds;   /**< all sounds created before */
 
     static bool initialized;                     /**< indicates that the audio system is initialized */
     static bool sounds_preloaded;                /**< true if load_all() was called */
+    static bool pcm_cache_enabled;               /**< Whether load_all() keeps decoded sounds in a file. */
     static float volume;                         /**< the volume of sound effects (0.0 to 1.0) */
-
-    static bool pc_play;                         /**< Whether playing performance counter is used. */
 };
 
 }
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_FLAT_STRING_MAP_H
+#define SOLARUS_FLAT_STRING_MAP_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief A hash map with string keys stored in a single array.
+ *
+ * Elements are stored in a flat array of slots and found by open addressing
+ * with linear probing, so that a lookup usually reads one or two
+ * consecutive slots instead of following the nodes of a tree.
+ * Each slot keeps the hash of its key: keys are only compared when hashes
+ * are equal, and growing the array does not hash them again.
+ * Erasing shifts the following elements back, so there are no tombstones
+ * and lookups stay short after many insertions and removals.
+ *
+ * The interface follows std::map where it is used in the engine.
+ * Iteration order is arbitrary.
+ * Inserting may move elements and invalidates iterators and references.
+ * Erasing invalidates iterators.
+ *
+ * \param T Type of values. Must be default-constructible.
+ */
+template <typename T>
+class FlatStringMap {
+
+  private:
+
+    /**
+     * \brief A slot of the array.
+     */
+    struct Slot {
+      size_t hash;                          /**< Hash of the key, or 0 if the slot is empty. */
+      std::pair<std::string, T> value;      /**< The key and its value. */
+    };
+
+    /**
+     * \brief Iterator on the non-empty slots.
+     *
+     * The key of an element must not be modified through an iterator.
+     */
+    template <typename SlotType, typename ValueType>
+    class BasicIterator {
+
+      public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string, T>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = ValueType*;
+        using reference = ValueType&;
+
+        BasicIterator();
+        BasicIterator(SlotType* slot, SlotType* end);
+        template <typename OtherSlotType, typename OtherValueType>
+        BasicIterator(const BasicIterator<OtherSlotType, OtherValueType>& other);
+
+        reference operator*() const;
+        pointer operator->() const;
+        BasicIterator& operator++();
+        BasicIterator operator++(int);
+
+        template <typename OtherSlotType, typename OtherValueType>
+        bool operator==(const BasicIterator<OtherSlotType, OtherValueType>& other) const;
+        template <typename OtherSlotType, typename OtherValueType>
+        bool operator!=(const BasicIterator<OtherSlotType, OtherValueType>& other) const;
+
+      private:
+
+        template <typename OtherSlotType, typename OtherValueType>
+        friend class BasicIterator;
+
+        void skip_empty_slots();
+
+        SlotType* slot;                     /**< Current slot. */
+        SlotType* end;                      /**< End of the array. */
+    };
+
+  public:
+
+    using key_type = std::string;
+    using mapped_type = T;
+    using value_type = std::pair<std::string, T>;
+    using iterator = BasicIterator<Slot, value_type>;
+    using const_iterator = BasicIterator<const Slot, const value_type>;
+
+    FlatStringMap();
+
+    size_t size() const;
+    bool empty() const;
+    void clear();
+    void reserve(size_t size);
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    iterator find(const std::string& key);
+    const_iterator find(const std::string& key) const;
+    size_t count(const std::string& key) const;
+    T& operator[](const std::string& key);
+    size_t erase(const std::string& key);
+
+    static size_t hash(const std::string& key);
+
+  private:
+
+    static constexpr size_t min_capacity = 16;  /**< Size of the array when it is first allocated. */
+
+    size_t find_index(const std::string& key, size_t key_hash) const;
+    void rehash(size_t capacity);
+
+    std::vector<Slot> slots;                /**< The array, empty or with a power of two size. */
+    size_t num_elements;                    /**< Number of non-empty slots. */
+
+};
+
+}
+
+#include "solarus/containers/FlatStringMap.inl"
+
+#endif
+
@@ -0,0 +1,427 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <functional>
+
+namespace Solarus {
+
+template<typename T>
+constexpr size_t FlatStringMap<T>::min_capacity;
+
+/**
+ * \brief Creates an iterator that refers to no element.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+FlatStringMap<T>::BasicIterator<SlotType, ValueType>::BasicIterator() :
+  slot(nullptr),
+  end(nullptr) {
+
+}
+
+/**
+ * \brief Creates an iterator on the first non-empty slot from a position.
+ * \param slot The first slot to consider.
+ * \param end End of the array.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+FlatStringMap<T>::BasicIterator<SlotType, ValueType>::BasicIterator(
+    SlotType* slot, SlotType* end) :
+  slot(slot),
+  end(end) {
+
+  skip_empty_slots();
+}
+
+/**
+ * \brief Converts an iterator to a const iterator.
+ * \param other The iterator to copy.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+template<typename OtherSlotType, typename OtherValueType>
+FlatStringMap<T>::BasicIterator<SlotType, ValueType>::BasicIterator(
+    const BasicIterator<OtherSlotType, OtherValueType>& other) :
+  slot(other.slot),
+  end(other.end) {
+
+}
+
+/**
+ * \brief Returns the element referred to by this iterator.
+ * \return The key and the value.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+ValueType& FlatStringMap<T>::BasicIterator<SlotType, ValueType>::operator*() const {
+  return slot->value;
+}
+
+/**
+ * \brief Returns the element referred to by this iterator.
+ * \return The key and the value.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+ValueType* FlatStringMap<T>::BasicIterator<SlotType, ValueType>::operator->() const {
+  return &slot->value;
+}
+
+/**
+ * \brief Moves to the next element.
+ * \return This iterator.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+typename FlatStringMap<T>::template BasicIterator<SlotType, ValueType>&
+FlatStringMap<T>::BasicIterator<SlotType, ValueType>::operator++() {
+
+  ++slot;
+  skip_empty_slots();
+  return *this;
+}
+
+/**
+ * \brief Moves to the next element.
+ * \return A copy of this iterator before moving.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+typename FlatStringMap<T>::template BasicIterator<SlotType, ValueType>
+FlatStringMap<T>::BasicIterator<SlotType, ValueType>::operator++(int) {
+
+  BasicIterator previous = *this;
+  ++*this;
+  return previous;
+}
+
+/**
+ * \brief Returns whether two iterators refer to the same element.
+ * \param other Another iterator.
+ * \return \c true if they are equal.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+template<typename OtherSlotType, typename OtherValueType>
+bool FlatStringMap<T>::BasicIterator<SlotType, ValueType>::operator==(
+    const BasicIterator<OtherSlotType, OtherValueType>& other) const {
+  return slot == other.slot;
+}
+
+/**
+ * \brief Returns whether two iterators refer to different elements.
+ * \param other Another iterator.
+ * \return \c true if they are different.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+template<typename OtherSlotType, typename OtherValueType>
+bool FlatStringMap<T>::BasicIterator<SlotType, ValueType>::operator!=(
+    const BasicIterator<OtherSlotType, OtherValueType>& other) const {
+  return slot != other.slot;
+}
+
+/**
+ * \brief Moves forward until a non-empty slot or the end of the array.
+ */
+template<typename T>
+template<typename SlotType, typename ValueType>
+void FlatStringMap<T>::BasicIterator<SlotType, ValueType>::skip_empty_slots() {
+
+  while (slot != end && slot->hash == 0) {
+    ++slot;
+  }
+}
+
+/**
+ * \brief Creates an empty map.
+ *
+ * No memory is allocated until the first element is inserted.
+ */
+template<typename T>
+FlatStringMap<T>::FlatStringMap() :
+  slots(),
+  num_elements(0) {
+
+}
+
+/**
+ * \brief Returns the number of elements.
+ * \return The number of elements.
+ */
+template<typename T>
+size_t FlatStringMap<T>::size() const {
+  return num_elements;
+}
+
+/**
+ * \brief Returns whether there is no element.
+ * \return \c true if the map is empty.
+ */
+template<typename T>
+bool FlatStringMap<T>::empty() const {
+  return num_elements == 0;
+}
+
+/**
+ * \brief Removes all elements and frees the array.
+ */
+template<typename T>
+void FlatStringMap<T>::clear() {
+
+  slots.clear();
+  slots.shrink_to_fit();
+  num_elements = 0;
+}
+
+/**
+ * \brief Makes room for the given number of elements.
+ *
+ * Inserting up to this number of elements will not move them.
+ *
+ * \param size The number of elements.
+ */
+template<typename T>
+void FlatStringMap<T>::reserve(size_t size) {
+
+  size_t capacity = slots.empty() ? min_capacity : slots.size();
+  while (size * 4 > capacity * 3) {
+    capacity *= 2;
+  }
+  if (capacity != slots.size()) {
+    rehash(capacity);
+  }
+}
+
+/**
+ * \brief Returns an iterator to the first element.
+ * \return The first element, or end() if the map is empty.
+ */
+template<typename T>
+typename FlatStringMap<T>::iterator FlatStringMap<T>::begin() {
+  return iterator(slots.data(), slots.data() + slots.size());
+}
+
+/**
+ * \brief Returns an iterator past the last element.
+ * \return The end iterator.
+ */
+template<typename T>
+typename FlatStringMap<T>::iterator FlatStringMap<T>::end() {
+  return iterator(slots.data() + slots.size(), slots.data() + slots.size());
+}
+
+/**
+ * \brief Returns an iterator to the first element.
+ * \return The first element, or end() if the map is empty.
+ */
+template<typename T>
+typename FlatStringMap<T>::const_iterator FlatStringMap<T>::begin() const {
+  return const_iterator(slots.data(), slots.data() + slots.size());
+}
+
+/**
+ * \brief Returns an iterator past the last element.
+ * \return The end iterator.
+ */
+template<typename T>
+typename FlatStringMap<T>::const_iterator FlatStringMap<T>::end() const {
+  return const_iterator(slots.data() + slots.size(), slots.data() + slots.size());
+}
+
+/**
+ * \brief Finds the element with the given key.
+ * \param key The key to search.
+ * \return The element, or end() if there is no such key.
+ */
+template<typename T>
+typename FlatStringMap<T>::iterator FlatStringMap<T>::find(const std::string& key) {
+
+  const size_t index = find_index(key, hash(key));
+  if (index == slots.size()) {
+    return end();
+  }
+  return iterator(slots.data() + index, slots.data() + slots.size());
+}
+
+/**
+ * \brief Finds the element with the given key.
+ * \param key The key to search.
+ * \return The element, or end() if there is no such key.
+ */
+template<typename T>
+typename FlatStringMap<T>::const_iterator FlatStringMap<T>::find(const std::string& key) const {
+
+  const size_t index = find_index(key, hash(key));
+  if (index == slots.size()) {
+    return end();
+  }
+  return const_iterator(slots.data() + index, slots.data() + slots.size());
+}
+
+/**
+ * \brief Returns the number of elements with the given key.
+ * \param key The key to search.
+ * \return 1 if the key exists, 0 otherwise.
+ */
+template<typename T>
+size_t FlatStringMap<T>::count(const std::string& key) const {
+  return find_index(key, hash(key)) == slots.size() ? 0 : 1;
+}
+
+/**
+ * \brief Returns the value with the given key, inserting a default one
+ * if the key does not exist yet.
+ * \param key The key.
+ * \return The value. The reference is valid until the next insertion.
+ */
+template<typename T>
+T& FlatStringMap<T>::operator[](const std::string& key) {
+
+  const size_t key_hash = hash(key);
+  size_t index = find_index(key, key_hash);
+  if (index != slots.size()) {
+    return slots[index].value.second;
+  }
+
+  if ((num_elements + 1) * 4 > slots.size() * 3) {
+    rehash(slots.empty() ? min_capacity : slots.size() * 2);
+  }
+
+  const size_t mask = slots.size() - 1;
+  index = key_hash & mask;
+  while (slots[index].hash != 0) {
+    index = (index + 1) & mask;
+  }
+
+  Slot& slot = slots[index];
+  slot.hash = key_hash;
+  slot.value.first = key;
+  slot.value.second = T();
+  ++num_elements;
+  return slot.value.second;
+}
+
+/**
+ * \brief Removes the element with the given key if it exists.
+ * \param key The key to remove.
+ * \return The number of elements removed: 1 or 0.
+ */
+template<typename T>
+size_t FlatStringMap<T>::erase(const std::string& key) {
+
+  size_t hole = find_index(key, hash(key));
+  if (hole == slots.size()) {
+    return 0;
+  }
+
+  // Shift back the following elements of the cluster that can move
+  // closer to their ideal slot, so that no probe sequence is broken.
+  const size_t mask = slots.size() - 1;
+  size_t index = hole;
+  while (true) {
+    index = (index + 1) & mask;
+    Slot& slot = slots[index];
+    if (slot.hash == 0) {
+      break;
+    }
+    const size_t ideal_index = slot.hash & mask;
+    if (((index - ideal_index) & mask) >= ((index - hole) & mask)) {
+      slots[hole] = std::move(slot);
+      hole = index;
+    }
+  }
+
+  Slot& slot = slots[hole];
+  slot.hash = 0;
+  slot.value = value_type();
+  --num_elements;
+  return 1;
+}
+
+/**
+ * \brief Computes the hash of a key as stored in slots.
+ *
+ * The highest bit is always set so that 0 can mark empty slots.
+ *
+ * \param key A key.
+ * \return The hash of the key, never 0.
+ */
+template<typename T>
+size_t FlatStringMap<T>::hash(const std::string& key) {
+
+  static constexpr size_t highest_bit = size_t(1) << (sizeof(size_t) * 8 - 1);
+  return std::hash<std::string>()(key) | highest_bit;
+}
+
+/**
+ * \brief Returns the slot of a key.
+ * \param key The key to search.
+ * \param key_hash Hash of the key.
+ * \return Index of its slot, or the size of the array if there is no
+ * such key.
+ */
+template<typename T>
+size_t FlatStringMap<T>::find_index(const std::string& key, size_t key_hash) const {
+
+  if (num_elements == 0) {
+    return slots.size();
+  }
+
+  const size_t mask = slots.size() - 1;
+  size_t index = key_hash & mask;
+  while (true) {
+    const Slot& slot = slots[index];
+    if (slot.hash == 0) {
+      return slots.size();
+    }
+    if (slot.hash == key_hash && slot.value.first == key) {
+      return index;
+    }
+    index = (index + 1) & mask;
+  }
+}
+
+/**
+ * \brief Moves all elements to a new array.
+ *
+ * Stored hashes are reused.
+ *
+ * \param capacity Size of the new array. Must be a power of two big enough
+ * for all elements.
+ */
+template<typename T>
+void FlatStringMap<T>::rehash(size_t capacity) {
+
+  std::vector<Slot> old_slots(capacity);
+  old_slots.swap(slots);
+
+  const size_t mask = capacity - 1;
+  for (Slot& old_slot : old_slots) {
+    if (old_slot.hash == 0) {
+      continue;
+    }
+    size_t index = old_slot.hash & mask;
+    while (slots[index].hash != 0) {
+      index = (index + 1) & mask;
+    }
+    slots[index] = std::move(old_slot);
+  }
+}
+
+}
+
@@ -22,10 +22,10 @@
 #include "solarus/core/Size.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/SurfacePtr.h"
-#include <array>
-#include <map>
-#include <memory>
-#include <set>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace Solarus {
@@ -38,14 +38,25 @@ class Color;
  * The main goal of this container is to get objects in a given rectangle as
  * quickly as possible.
  *
- * \param T Type of objects.
+ * Nodes are stored in a flat array and refer to their children by index.
+ * Elements and their bounding boxes are stored in contiguous arrays too,
+ * and leaves only store element indexes.
+ * Queries write into a buffer provided by the caller, so that no memory is
+ * allocated once the buffer is big enough.
+ *
+ * \param T Type of objects. Must be hashable.
+ * \param Comparator Order of the elements returned by queries.
  */
 template <typename T, typename Comparator = std::less<T>>
 class Quadtree {
 
   public:
 
-    using Set = std::set<T, Comparator>;
+    /**
+     * \brief An element found by a query on several rectangles, with one bit
+     * set for each rectangle it overlaps.
+     */
+    using Match = std::pair<T, uint32_t>;
 
     Quadtree();
     explicit Quadtree(const Rectangle& space);
@@ -62,6 +73,20 @@ class Quadtree {
     std::vector<T> get_elements(
         const Rectangle& where
     ) const;
+    void get_elements(
+        const Rectangle& where,
+        std::vector<T>& result
+    ) const;
+    void get_elements(
+        const Rectangle* regions,
+        int num_regions,
+        std::vector<Match>& result
+    ) const;
+    template<typename Visitor>
+    void visit_elements(
+        const Rectangle& where,
+        Visitor&& visitor
+    ) const;
 
     int get_num_elements() const;
     bool contains(const T& element) const;
@@ -78,85 +103,87 @@ class Quadtree {
     static constexpr int
         min_in_4_cells = 4;  /**< 4 sibling cells are merged if their total
                               * is below this number when removing an element. */
+    static constexpr int
+        max_regions = 32;    /**< Maximum number of rectangles of a batched query. */
 
     static constexpr bool debug_quadtrees = false;
 
   private:
 
-    class Node {
-
-      public:
-
-        explicit Node(const Quadtree& quadtree);
-        Node(const Quadtree& quadtree, const Rectangle& cell);
-
-        void clear();
-        void initialize(const Rectangle& cell);
-
-        Rectangle get_cell() const;
-        Size get_cell_size() const;
-
-        bool add(
-            const T& element,
-            const Rectangle& bounding_box
-        );
-        bool remove(
-            const T& element,
-            const Rectangle& bounding_box
-        );
-
-        void get_elements(
-            const Rectangle& region,
-            Set& result
-        ) const;
-
-        int get_num_elements() const;
-
-        void draw(
-            const SurfacePtr& dst_surface, const Point& dst_position
-        );
-        void draw_rectangle(
-            const Rectangle& rectangle,
-            const Color& line_color,
-            const SurfacePtr& dst_surface,
-            const Point& dst_position
-        );
-
-      private:
-
-        bool is_split() const;
-        void split();
-        void merge();
-        bool is_main_cell(const Rectangle& bounding_box) const;
-
-        const Quadtree& quadtree;
-        std::vector<std::pair<T, Rectangle>> elements;
-        std::array<std::unique_ptr<Node>, 4> children;
-        Rectangle cell;
-        Point center;
-        Color color;
-
+    /**
+     * \brief A cell of the tree.
+     */
+    struct Node {
+      Rectangle cell;                 /**< Area covered by this node. */
+      int first_child;                /**< Index of the first of the 4 consecutive
+                                       * children, or -1 for a leaf. */
+      std::vector<int> elements;      /**< Indexes of the elements overlapping
+                                       * this leaf (empty if the node is split). */
+      Color color;                    /**< Color for debugging. */
     };
 
-    struct ElementInfo {
-        Rectangle bounding_box;
-    };
+    int create_node(const Rectangle& cell);
+    int create_children(const Rectangle& cell);
+    void destroy_children(int node_index);
+
+    bool is_split(int node_index) const;
+    bool is_main_cell(int node_index, const Rectangle& bounding_box) const;
+    int get_num_elements(int node_index) const;
+
+    bool add(int node_index, int element_index);
+    bool remove(int node_index, int element_index);
+    void split(int node_index);
+    void merge(int node_index);
+
+    uint32_t start_query() const;
+    template<typename Visitor>
+    void visit_elements(
+        int node_index,
+        const Rectangle& where,
+        uint32_t stamp,
+        Visitor& visitor
+    ) const;
+    void get_matches(
+        int node_index,
+        const Rectangle& where,
+        uint32_t bit,
+        uint32_t stamp
+    ) const;
 
-    std::map<T, ElementInfo> elements;      /**< Elements in the quadtree and
-                                             * intersecting its space. */
-    Set elements_outside;                   /**< Elements that were added to
-                                             * the quadtree but that are
-                                             * currently outside its space. */
-    Node root;                              /** The root node of the tree. */
+    void draw(int node_index, const SurfacePtr& dst_surface, const Point& dst_position);
+    void draw_rectangle(
+        const Rectangle& rectangle,
+        const Color& line_color,
+        const SurfacePtr& dst_surface,
+        const Point& dst_position
+    );
+
+    // Elements, indexed by element index.
+    std::vector<T> values;                  /**< Each element, or T() for free slots. */
+    std::vector<Rectangle> bounding_boxes;  /**< Bounding box of each element. */
+    std::vector<bool> outside;              /**< Whether each element is
+                                             * currently outside the space. */
+    mutable std::vector<uint32_t> stamps;   /**< Last query that found each element. */
+    mutable std::vector<uint32_t> masks;    /**< Rectangles of the current batched
+                                             * query overlapped by each element. */
+    std::vector<int> free_elements;         /**< Indexes of free element slots. */
+    std::unordered_map<T, int> indexes;     /**< Index of each element in the
+                                             * quadtree, even outside its space. */
+
+    // Nodes.
+    std::vector<Node> nodes;                /**< All nodes. The root is at index 0. */
+    std::vector<int> free_children;         /**< First indexes of unused blocks
+                                             * of 4 nodes. */
+
+    // Queries.
+    mutable uint32_t current_stamp;         /**< Stamp of the last query. */
+    mutable std::vector<int> matches;       /**< Elements found by the current
+                                             * batched query. */
 
 };
 
-template<typename T>
-using QuadtreeNode = typename Quadtree<T>::Node;
-
 }
 
 #include "solarus/containers/Quadtree.inl"
 
 #endif
-
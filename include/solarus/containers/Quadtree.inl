@@ -18,8 +18,6 @@
 #include "solarus/core/Random.h"
 #include "solarus/graphics/Surface.h"
 #include <algorithm>
-#include <iterator>
-#include <set>
 
 namespace Solarus {
 
@@ -40,21 +38,43 @@ Quadtree<T, Comparator>::Quadtree() :
  */
 template<typename T, typename Comparator>
 Quadtree<T, Comparator>::Quadtree(const Rectangle& space) :
-    elements(),
-    root(*this) {
+    values(),
+    bounding_boxes(),
+    outside(),
+    stamps(),
+    masks(),
+    free_elements(),
+    indexes(),
+    nodes(),
+    free_children(),
+    current_stamp(0),
+    matches() {
 
     initialize(space);
 }
 
 /**
  * \brief Removes all elements of the quadtree.
+ *
+ * The space is unchanged.
  */
 template<typename T, typename Comparator>
 void Quadtree<T, Comparator>::clear() {
 
-  elements.clear();
-  elements_outside.clear();
-  root.clear();
+  const Rectangle space = nodes.empty() ? Rectangle(0, 0, 256, 256) : get_space();
+
+  values.clear();
+  bounding_boxes.clear();
+  outside.clear();
+  stamps.clear();
+  masks.clear();
+  free_elements.clear();
+  indexes.clear();
+  nodes.clear();
+  free_children.clear();
+  current_stamp = 0;
+
+  create_node(space);
 }
 
 /**
@@ -64,8 +84,6 @@ void Quadtree<T, Comparator>::clear() {
 template<typename T, typename Comparator>
 void Quadtree<T, Comparator>::initialize(const Rectangle& space) {
 
-  clear();
-
   // Expand the space so that it is square.
   Rectangle square = space;
   if (space.get_width() > space.get_height()) {
@@ -77,7 +95,8 @@ void Quadtree<T, Comparator>::initialize(const Rectangle& space) {
     square.set_width(square.get_height());
   }
 
-  root.initialize(square);
+  clear();
+  nodes[0].cell = square;
 }
 
 /**
@@ -86,7 +105,7 @@ void Quadtree<T, Comparator>::initialize(const Rectangle& space) {
  */
 template<typename T, typename Comparator>
 Rectangle Quadtree<T, Comparator>::get_space() const {
-    return root.get_cell();
+    return nodes[0].cell;
 }
 
 /**
@@ -107,17 +126,33 @@ bool Quadtree<T, Comparator>::add(const T& element, const Rectangle& bounding_bo
     return false;
   }
 
+  // Find a slot for the element.
+  int element_index = 0;
+  if (!free_elements.empty()) {
+    element_index = free_elements.back();
+    free_elements.pop_back();
+    values[element_index] = element;
+    bounding_boxes[element_index] = bounding_box;
+  }
+  else {
+    element_index = static_cast<int>(values.size());
+    values.push_back(element);
+    bounding_boxes.push_back(bounding_box);
+    outside.push_back(false);
+    stamps.push_back(0);
+    masks.push_back(0);
+  }
+
   if (!bounding_box.overlaps(get_space())) {
     // Out of the space of the quadtree.
-    elements_outside.insert(element);
+    outside[element_index] = true;
   }
-  else if (!root.add(element, bounding_box)) {
-    // Add failed.
-    return false;
+  else {
+    outside[element_index] = false;
+    add(0, element_index);
   }
 
-  ElementInfo info = { bounding_box };
-  elements.emplace(element, info);
+  indexes.emplace(element, element_index);
 
   return true;
 }
@@ -130,21 +165,24 @@ bool Quadtree<T, Comparator>::add(const T& element, const Rectangle& bounding_bo
 template<typename T, typename Comparator>
 bool Quadtree<T, Comparator>::remove(const T& element) {
 
-  const auto& it = elements.find(element);
-  if (it == elements.end()) {
+  const auto& it = indexes.find(element);
+  if (it == indexes.end()) {
     // Unknown element.
     return false;
   }
 
-  Rectangle box = it->second.bounding_box;
-  elements.erase(element);
-  if (elements_outside.erase(element) > 0) {
-    // It was outside the quadtree space.
-    return true;
+  const int element_index = it->second;
+  indexes.erase(it);
+
+  bool success = true;
+  if (!outside[element_index]) {
+    // Normal case.
+    success = remove(0, element_index);
   }
 
-  // Normal case.
-  return root.remove(element, box);
+  values[element_index] = T();
+  free_elements.push_back(element_index);
+  return success;
 }
 
 /**
@@ -164,27 +202,33 @@ bool Quadtree<T, Comparator>::remove(const T& element) {
 template<typename T, typename Comparator>
 bool Quadtree<T, Comparator>::move(const T& element, const Rectangle& bounding_box) {
 
-  const auto& it = elements.find(element);
-  if (it == elements.end()) {
+  const auto& it = indexes.find(element);
+  if (it == indexes.end()) {
     // Not in the quadtree: error.
     return false;
   }
-  else {
-    if (it->second.bounding_box == bounding_box) {
-      // Already in the quadtree and no change.
-      return true;
-    }
 
-    if (!remove(element)) {
-      // Failed to remove.
-      return false;
-    }
+  const int element_index = it->second;
+  if (bounding_boxes[element_index] == bounding_box) {
+    // Already in the quadtree and no change.
+    return true;
   }
 
-  if (!add(element, bounding_box)) {
-    // Failed to add.
+  // Keep the same slot: only update the nodes.
+  if (!outside[element_index] &&
+      !remove(0, element_index)) {
+    // Failed to remove.
     return false;
   }
+
+  bounding_boxes[element_index] = bounding_box;
+  if (!bounding_box.overlaps(get_space())) {
+    outside[element_index] = true;
+  }
+  else {
+    outside[element_index] = false;
+    add(0, element_index);
+  }
   return true;
 }
 
@@ -195,7 +239,7 @@ bool Quadtree<T, Comparator>::move(const T& element, const Rectangle& bounding_b
  */
 template<typename T, typename Comparator>
 int Quadtree<T, Comparator>::get_num_elements() const {
-  return root.get_num_elements() + elements_outside.size();
+  return static_cast<int>(indexes.size());
 }
 
 /**
@@ -210,9 +254,93 @@ template<typename T, typename Comparator>
 std::vector<T> Quadtree<T, Comparator>::get_elements(
     const Rectangle& region
 ) const {
-  Set element_set;
-  root.get_elements(region, element_set);
-  return std::vector<T>(element_set.begin(), element_set.end());
+  std::vector<T> result;
+  get_elements(region, result);
+  return result;
+}
+
+/**
+ * \brief Gets the elements intersecting the given rectangle into a buffer.
+ *
+ * Use this version to reuse the memory of the buffer from one query to
+ * another.
+ *
+ * \param[in] region The rectangle to check.
+ * The rectangle should be entirely contained in the quadtree space.
+ * \param[out] result Cleared and filled with elements intersecting the
+ * rectangle, in order of the comparator.
+ * Elements outside the quadtree space are not added there.
+ */
+template<typename T, typename Comparator>
+void Quadtree<T, Comparator>::get_elements(
+    const Rectangle& region,
+    std::vector<T>& result
+) const {
+
+  result.clear();
+  visit_elements(region, [&result](const T& element) {
+    result.push_back(element);
+  });
+  std::sort(result.begin(), result.end(), Comparator());
+}
+
+/**
+ * \brief Gets the elements intersecting any of several rectangles.
+ *
+ * The tree is explored once per rectangle but each element is returned once,
+ * with one bit set for each rectangle it intersects.
+ *
+ * \param[in] regions The rectangles to check.
+ * \param[in] num_regions Number of rectangles (at most max_regions).
+ * \param[out] result Cleared and filled with elements intersecting at least
+ * one rectangle, in order of the comparator.
+ * Bit \c i of the mask of a match is set if it intersects
+ * <tt>regions[i]</tt>.
+ */
+template<typename T, typename Comparator>
+void Quadtree<T, Comparator>::get_elements(
+    const Rectangle* regions,
+    int num_regions,
+    std::vector<Match>& result
+) const {
+
+  Debug::check_assertion(num_regions >= 0 && num_regions <= max_regions,
+      "Too many rectangles in quadtree query");
+
+  const uint32_t stamp = start_query();
+  matches.clear();
+  for (int i = 0; i < num_regions; ++i) {
+    get_matches(0, regions[i], 1u << i, stamp);
+  }
+
+  result.clear();
+  for (int element_index : matches) {
+    result.emplace_back(values[element_index], masks[element_index]);
+  }
+
+  const Comparator comparator;
+  std::sort(result.begin(), result.end(), [&comparator](const Match& first, const Match& second) {
+    return comparator(first.first, second.first);
+  });
+}
+
+/**
+ * \brief Calls a function on each element intersecting the given rectangle.
+ *
+ * Elements are visited once each, in no particular order.
+ * The function must not modify the quadtree or make other queries on it.
+ *
+ * \param region The rectangle to check.
+ * \param visitor Function called with each element.
+ */
+template<typename T, typename Comparator>
+template<typename Visitor>
+void Quadtree<T, Comparator>::visit_elements(
+    const Rectangle& region,
+    Visitor&& visitor
+) const {
+
+  visit_elements(0, region, start_query(), visitor);
 }
 
 /**
@@ -224,8 +352,8 @@ std::vector<T> Quadtree<T, Comparator>::get_elements(
 template<typename T, typename Comparator>
 bool Quadtree<T, Comparator>::contains(const T& element) const {
 
-  const auto& it = elements.find(element);
-  return it != elements.end();
+  const auto& it = indexes.find(element);
+  return it != indexes.end();
 }
 
 /**
@@ -236,363 +364,436 @@ bool Quadtree<T, Comparator>::contains(const T& element) const {
 template<typename T, typename Comparator>
 void Quadtree<T, Comparator>::draw(const SurfacePtr& dst_surface, const Point& dst_position) {
 
-  root.draw(dst_surface, dst_position);
+  draw(0, dst_surface, dst_position);
 }
 
 /**
- * \brief Creates a node with default coordinates.
- *
- * Call initialize later to set coordinates.
- *
- * \param quadtree The quadtree this node belongs to.
+ * \brief Appends a leaf node to the node array.
+ * \param cell Cell coordinates of the node.
+ * \return Index of the new node.
  */
 template<typename T, typename Comparator>
-Quadtree<T, Comparator>::Node::Node(const Quadtree& quadtree) :
-    Node(quadtree, Rectangle(0, 0, 256, 256)) {
+int Quadtree<T, Comparator>::create_node(const Rectangle& cell) {
 
+  Node node;
+  node.cell = cell;
+  node.first_child = -1;
+  node.elements.reserve(max_in_cell);
+  if (debug_quadtrees) {
+    node.color = Color(Random::get_number(256), Random::get_number(256), Random::get_number(256));
+  }
+  nodes.push_back(std::move(node));
+  return static_cast<int>(nodes.size()) - 1;
 }
 
 /**
- * \brief Creates a node with the given coordinates.
- * \param quadtree The quadtree this node belongs to.
- * \param cell Cell coordinates of the node.
+ * \brief Creates the four children of a cell.
+ *
+ * Blocks of nodes freed by previous merges are reused when possible.
+ * Note that this may invalidate references to nodes.
+ *
+ * \param cell The cell to split.
+ * \return Index of the first child. The other ones follow.
  */
 template<typename T, typename Comparator>
-Quadtree<T, Comparator>::Node::Node(const Quadtree& quadtree, const Rectangle& cell) :
-    quadtree(quadtree),
-    elements(),
-    children(),
-    cell(cell),
-    center(cell.get_center()),
-    color() {
+int Quadtree<T, Comparator>::create_children(const Rectangle& cell) {
 
-  initialize(cell);
+  const Point& center = cell.get_center();
+  const Rectangle children_cells[] = {
+      Rectangle(cell.get_top_left(), center),
+      Rectangle(Point(center.x, cell.get_top()), Point(cell.get_right(), center.y)),
+      Rectangle(Point(cell.get_left(), center.y), Point(center.x, cell.get_bottom())),
+      Rectangle(center, cell.get_bottom_right())
+  };
 
-  if (debug_quadtrees) {
-    color = Color(Random::get_number(256), Random::get_number(256), Random::get_number(256));
+  if (!free_children.empty()) {
+    const int first_child = free_children.back();
+    free_children.pop_back();
+    for (int i = 0; i < 4; ++i) {
+      Node& child = nodes[first_child + i];
+      child.cell = children_cells[i];
+      child.first_child = -1;
+      child.elements.clear();
+    }
+    return first_child;
+  }
+
+  const int first_child = create_node(children_cells[0]);
+  for (int i = 1; i < 4; ++i) {
+    create_node(children_cells[i]);
   }
+  return first_child;
 }
 
 /**
- * \brief Clears this node.
+ * \brief Makes the four children of a node available for reuse.
  *
- * Children nodes and their content are destroyed.
+ * The children must be leaves.
+ *
+ * \param node_index Index of a split node. It becomes a leaf.
  */
 template<typename T, typename Comparator>
-void Quadtree<T, Comparator>::Node::clear() {
+void Quadtree<T, Comparator>::destroy_children(int node_index) {
 
-  elements.clear();
-  std::fill(std::begin(children), std::end(children), nullptr);
+  const int first_child = nodes[node_index].first_child;
+  for (int i = 0; i < 4; ++i) {
+    Debug::check_assertion(!is_split(first_child + i), "Quadtree node child is not a leaf");
+    nodes[first_child + i].elements.clear();
+  }
+  free_children.push_back(first_child);
+  nodes[node_index].first_child = -1;
 }
 
 /**
- * \brief Clears this node and initializes it with a new cell rectangle.
- * \param cell The new cell.
+ * \brief Returns whether a node is split or is a leaf cell.
+ * \param node_index Index of a node.
+ * \return \c true if the node is split.
  */
 template<typename T, typename Comparator>
-void Quadtree<T, Comparator>::Node::initialize(const Rectangle& cell) {
+bool Quadtree<T, Comparator>::is_split(int node_index) const {
 
-  clear();
-  this->cell = cell;
-  elements.reserve(max_in_cell);
+  return nodes[node_index].first_child != -1;
 }
 
 /**
- * \brief Returns the cell represented by this node.
- * \return The cell's rectangle.
+ * \brief Returns whether a cell contains a box and is also its main cell.
+ *
+ * The main cell is used to ensure uniqueness, for example when counting
+ * elements.
+ *
+ * \param node_index Index of a node.
+ * \param bounding_box The box to test.
+ * \return \c true if this node is the main cell of the box.
  */
 template<typename T, typename Comparator>
-Rectangle Quadtree<T, Comparator>::Node::get_cell() const {
-  return cell;
+bool Quadtree<T, Comparator>::is_main_cell(int node_index, const Rectangle& bounding_box) const {
+
+  const Rectangle& cell = nodes[node_index].cell;
+  if (!cell.overlaps(bounding_box)) {
+    // Not overlapping this cell.
+    return false;
+  }
+
+  // The bounding box is in this cell. See if this is the main cell.
+  Point center = bounding_box.get_center();
+
+  // Clamp the center to the quadtree space,
+  // in case the center it actually outside.
+  const Rectangle& quadtree_space = nodes[0].cell;
+  center = {
+      std::max(quadtree_space.get_left(), std::min(quadtree_space.get_right() - 1, center.x)),
+      std::max(quadtree_space.get_top(), std::min(quadtree_space.get_bottom() - 1, center.y))
+  };
+
+  return cell.contains(center);
 }
 
 /**
- * \brief Returns the size of the cell represented by this node.
- * \return The cell size.
+ * \brief Returns the number of elements whose center is under a node.
+ * \param node_index Index of a node.
+ * \return The number of elements under this node.
  */
 template<typename T, typename Comparator>
-Size Quadtree<T, Comparator>::Node::get_cell_size() const {
-    return get_cell().get_size();
+int Quadtree<T, Comparator>::get_num_elements(int node_index) const {
+
+  const Node& node = nodes[node_index];
+  int num_elements = 0;
+  if (!is_split(node_index)) {
+    // Some elements can overlap several cells.
+    // To avoid duplicates, we count an element if this cell is its main cell.
+    for (int element_index : node.elements) {
+      if (is_main_cell(node_index, bounding_boxes[element_index])) {
+        ++num_elements;
+      }
+    }
+  }
+  else {
+    // Ask children.
+    for (int i = 0; i < 4; ++i) {
+      num_elements += get_num_elements(node.first_child + i);
+    }
+  }
+  return num_elements;
 }
 
 /**
- * \brief Adds an element to this node if its bounding box intersects it.
+ * \brief Adds an element under a node if its bounding box intersects it.
  *
  * Splits the node if necessary when the threshold is exceeded.
  *
- * \param element The element to add.
- * \param bounding_box Bounding box of the element.
- * \return \c true in case of success.
+ * \param node_index Index of a node.
+ * \param element_index Index of the element to add.
+ * \return \c true if the element was added.
  */
 template<typename T, typename Comparator>
-bool Quadtree<T, Comparator>::Node::add(
-    const T& element,
-    const Rectangle& bounding_box
-) {
-  if (!get_cell().overlaps(bounding_box)) {
+bool Quadtree<T, Comparator>::add(int node_index, int element_index) {
+
+  const Rectangle& bounding_box = bounding_boxes[element_index];
+  const Rectangle cell = nodes[node_index].cell;
+  if (!cell.overlaps(bounding_box)) {
     // Nothing to do.
     return false;
   }
 
-  if (!is_split()) {
+  if (!is_split(node_index)) {
 
     // See if it is time to split.
-    if (is_main_cell(bounding_box)) {
+    if (is_main_cell(node_index, bounding_box)) {
       // We are the main cell of this element: it counts in the total.
-      if (get_num_elements() >= max_in_cell &&
-          get_cell_size().width > min_cell_size &&
-          get_cell_size().height > min_cell_size) {
-        split();
+      if (get_num_elements(node_index) >= max_in_cell &&
+          cell.get_width() > min_cell_size &&
+          cell.get_height() > min_cell_size) {
+        split(node_index);
       }
     }
   }
 
-  if (!is_split()) {
+  if (!is_split(node_index)) {
     // Add it to the current node.
-    elements.emplace_back(element, bounding_box);
+    nodes[node_index].elements.push_back(element_index);
     return true;
   }
 
   // Add it to children cells.
-  for (const std::unique_ptr<Node>& child : children) {
-    child->add(element, bounding_box);
+  const int first_child = nodes[node_index].first_child;
+  for (int i = 0; i < 4; ++i) {
+    add(first_child + i, element_index);
   }
   return true;
 }
 
 /**
- * \brief Removes an element from this node if its bounding box intersects it.
+ * \brief Removes an element under a node if its bounding box intersects it.
  *
  * Merges nodes when necessary.
  *
- * \param element The element to remove.
- * \param bounding_box Bounding box of the element.
+ * \param node_index Index of a node.
+ * \param element_index Index of the element to remove.
  * \return \c true in the element was found and removed.
  */
 template<typename T, typename Comparator>
-bool Quadtree<T, Comparator>::Node::remove(
-    const T& element,
-    const Rectangle& bounding_box
-) {
-  if (!get_cell().overlaps(bounding_box)) {
+bool Quadtree<T, Comparator>::remove(int node_index, int element_index) {
+
+  if (!nodes[node_index].cell.overlaps(bounding_boxes[element_index])) {
     // Nothing to do.
     return false;
   }
 
-  if (!is_split()) {
+  if (!is_split(node_index)) {
     // Remove from this cell.
-    const auto& it = std::find(elements.begin(), elements.end(), std::make_pair(element, bounding_box));
+    std::vector<int>& elements = nodes[node_index].elements;
+    const auto& it = std::find(elements.begin(), elements.end(), element_index);
     if (it == elements.end()) {
       // The element was not here.
       return false;
     }
-    elements.erase(it);
+    *it = elements.back();
+    elements.pop_back();
     return true;
   }
 
   // Remove from children cells.
+  const int first_child = nodes[node_index].first_child;
   bool removed = false;
-  for (const std::unique_ptr<Node>& child : children) {
-    removed |= child->remove(element, bounding_box);
+  bool children_are_leaves = true;
+  for (int i = 0; i < 4; ++i) {
+    removed |= remove(first_child + i, element_index);
+    children_are_leaves &= !is_split(first_child + i);
   }
 
-  if (removed &&
-      !children[0]->is_split()  // We are the parent node of where the element was removed.
-  ) {
+  if (removed && children_are_leaves) {
+    // We are the parent node of where the element was removed.
     // See if it is time to merge.
-    int num_elements_in_children = get_num_elements();
+    int num_elements_in_children = get_num_elements(node_index);
     if (num_elements_in_children < min_in_4_cells) {
-      merge();
+      merge(node_index);
     }
   }
   return removed;
 }
 
 /**
- * \brief Returns whether this node is split or is a leaf cell.
- * \return \c true if the node is split.
- */
-template<typename T, typename Comparator>
-bool Quadtree<T, Comparator>::Node::is_split() const {
-
-  return children[0] != nullptr;
-}
-
-/**
- * \brief Splits this cell in four parts and moves its elements to them.
+ * \brief Splits a cell in four parts and moves its elements to them.
+ * \param node_index Index of a leaf node.
  */
 template<typename T, typename Comparator>
-void Quadtree<T, Comparator>::Node::split() {
+void Quadtree<T, Comparator>::split(int node_index) {
 
-  Debug::check_assertion(!is_split(), "Quadtree node already split");
+  Debug::check_assertion(!is_split(node_index), "Quadtree node already split");
 
   // Create 4 children cells.
-  const Rectangle& cell = get_cell();
-  const Point& center = cell.get_center();
-  children[0] = std::unique_ptr<Node>(
-      new Node(quadtree, Rectangle(cell.get_top_left(), center))
-  );
-  children[1] = std::unique_ptr<Node>(
-      new Node(quadtree, Rectangle(Point(center.x, cell.get_top()), Point(cell.get_right(), center.y)))
-  );
-  children[2] = std::unique_ptr<Node>(
-      new Node(quadtree, Rectangle(Point(cell.get_left(), center.y), Point(center.x, cell.get_bottom())))
-  );
-  children[3] = std::unique_ptr<Node>(
-      new Node(quadtree, Rectangle(center, cell.get_bottom_right()))
-  );
+  const int first_child = create_children(nodes[node_index].cell);
+  nodes[node_index].first_child = first_child;
 
   // Move existing elements into them.
-  for (const std::pair<T, Rectangle>& pair : elements) {
-    for (const std::unique_ptr<Node>& child : children) {
-      child->add(pair.first, pair.second);
+  std::vector<int> elements;
+  elements.swap(nodes[node_index].elements);
+  for (int element_index : elements) {
+    for (int i = 0; i < 4; ++i) {
+      add(first_child + i, element_index);
     }
   }
-  elements.clear();
 
-  Debug::check_assertion(is_split(), "Quadtree node split failed");
+  // Give the buffer back to keep its capacity.
+  elements.clear();
+  nodes[node_index].elements.swap(elements);
 }
 
 /**
- * \brief Merges the four children cell into this one and destroys them.
+ * \brief Merges the four children cells of a node into it.
  *
  * The children must already be leaves.
+ *
+ * \param node_index Index of a split node.
  */
 template<typename T, typename Comparator>
-void Quadtree<T, Comparator>::Node::merge() {
+void Quadtree<T, Comparator>::merge(int node_index) {
 
-  Debug::check_assertion(is_split(), "Quadtree node already merged");
+  Debug::check_assertion(is_split(node_index), "Quadtree node already merged");
 
   // We want to avoid duplicates while preserving a deterministic order.
-  Set merged_elements;
-  for (const std::unique_ptr<Node>& child : children) {
-    Debug::check_assertion(!child->is_split(), "Quadtree node child is not a leaf");
-    for (const std::pair<T, Rectangle>& pair : child->elements) {
-      const T& element = pair.first;
-      if (merged_elements.insert(element).second) {
-        elements.push_back(pair);
+  const uint32_t stamp = start_query();
+  const int first_child = nodes[node_index].first_child;
+  std::vector<int>& elements = nodes[node_index].elements;
+  for (int i = 0; i < 4; ++i) {
+    for (int element_index : nodes[first_child + i].elements) {
+      if (stamps[element_index] != stamp) {
+        stamps[element_index] = stamp;
+        elements.push_back(element_index);
       }
     }
   }
 
-  std::fill(std::begin(children), std::end(children), nullptr);
-
-  Debug::check_assertion(!is_split(), "Quadtree node merge failed");
+  destroy_children(node_index);
 }
 
 /**
- * \brief Returns whether this cell contains a box and is also its main cell.
- *
- * The main cell is used to ensure uniqueness, for example when counting
- * elements.
+ * \brief Starts a new query.
+ * \return A stamp that no element has yet.
  */
 template<typename T, typename Comparator>
-bool Quadtree<T, Comparator>::Node::is_main_cell(const Rectangle& bounding_box) const {
+uint32_t Quadtree<T, Comparator>::start_query() const {
 
-  if (!get_cell().overlaps(bounding_box)) {
-    // Not overlapping this cell.
-    return false;
+  ++current_stamp;
+  if (current_stamp == 0) {
+    // Wrapped around: old stamps would become valid again.
+    std::fill(stamps.begin(), stamps.end(), 0);
+    current_stamp = 1;
   }
-
-  // The bounding box is in this cell. See if this is the main cell.
-  Point center = bounding_box.get_center();
-
-  // Clamp the center to the quadtree space,
-  // in case the center it actually outside.
-  const Rectangle& quadtree_space = quadtree.get_space();
-  center = {
-      std::max(quadtree_space.get_left(), std::min(quadtree_space.get_right() - 1, center.x)),
-      std::max(quadtree_space.get_top(), std::min(quadtree_space.get_bottom() - 1, center.y))
-  };
-
-  Debug::check_assertion(quadtree_space.contains(center), "Wrong center position");
-
-  return get_cell().contains(center);
+  return current_stamp;
 }
 
 /**
- * \brief Returns the number of elements whose center is under this node.
- * \return The number of elements under this node.
+ * \brief Calls a function on each element under a node
+ * that intersects a rectangle and was not visited yet by this query.
+ * \param node_index Index of a node.
+ * \param region The rectangle to check.
+ * \param stamp Stamp of the current query.
+ * \param visitor Function to call.
  */
 template<typename T, typename Comparator>
-int Quadtree<T, Comparator>::Node::get_num_elements() const {
+template<typename Visitor>
+void Quadtree<T, Comparator>::visit_elements(
+    int node_index,
+    const Rectangle& region,
+    uint32_t stamp,
+    Visitor& visitor
+) const {
 
-  int num_elements = 0;
-  if (!is_split()) {
-    // Some elements can overlap several cells.
-    // To avoid duplicates, we count an element if this cell is its main cell.
-    // TODO This information could be stored for better performance.
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      const Rectangle& box = pair.second;
-      if (is_main_cell(box)) {
-        ++num_elements;
+  const Node& node = nodes[node_index];
+  if (!node.cell.overlaps(region)) {
+    // Nothing here.
+    return;
+  }
+
+  if (!is_split(node_index)) {
+    for (int element_index : node.elements) {
+      if (stamps[element_index] != stamp &&
+          bounding_boxes[element_index].overlaps(region)) {
+        stamps[element_index] = stamp;
+        visitor(values[element_index]);
       }
     }
   }
   else {
-    // Ask children.
-    for (const std::unique_ptr<Node>& child : children) {
-      num_elements += child->get_num_elements();
+    // Get from from children cells.
+    for (int i = 0; i < 4; ++i) {
+      visit_elements(node.first_child + i, region, stamp, visitor);
     }
   }
-  return num_elements;
 }
 
 /**
- * \brief Gets the elements intersecting the given rectangle under this node.
- * \param[in] region The rectangle to check.
- * \param[in/out] result A set that will be filled with elements.
+ * \brief Collects elements under a node that intersect a rectangle
+ * of a batched query.
+ * \param node_index Index of a node.
+ * \param region The rectangle to check.
+ * \param bit Bit representing this rectangle in the masks.
+ * \param stamp Stamp of the current query.
  */
 template<typename T, typename Comparator>
-void Quadtree<T, Comparator>::Node::get_elements(
+void Quadtree<T, Comparator>::get_matches(
+    int node_index,
     const Rectangle& region,
-    Set& result
+    uint32_t bit,
+    uint32_t stamp
 ) const {
 
-  if (!get_cell().overlaps(region)) {
+  const Node& node = nodes[node_index];
+  if (!node.cell.overlaps(region)) {
     // Nothing here.
     return;
   }
 
-  if (!is_split()) {
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      if (pair.second.overlaps(region)) {
-        result.emplace(pair.first);
+  if (!is_split(node_index)) {
+    for (int element_index : node.elements) {
+      if (!bounding_boxes[element_index].overlaps(region)) {
+        continue;
+      }
+      if (stamps[element_index] != stamp) {
+        // First time this element is found by the query.
+        stamps[element_index] = stamp;
+        masks[element_index] = bit;
+        matches.push_back(element_index);
+      }
+      else {
+        masks[element_index] |= bit;
       }
     }
   }
   else {
-    // Get from from children cells.
-    for (const std::unique_ptr<Node>& child : children) {
-      child->get_elements(region, result);
+    for (int i = 0; i < 4; ++i) {
+      get_matches(node.first_child + i, region, bit, stamp);
     }
   }
 }
 
 /**
- * \brief Draws the node on a surface for debugging purposes.
+ * \brief Draws a node on a surface for debugging purposes.
+ * \param node_index Index of the node to draw.
  * \param dst_surface The destination surface.
  * \param dst_position Where to draw on that surface.
  */
 template<typename T, typename Comparator>
-void Quadtree<T, Comparator>::Node::draw(const SurfacePtr& dst_surface, const Point& dst_position) {
+void Quadtree<T, Comparator>::draw(int node_index, const SurfacePtr& dst_surface, const Point& dst_position) {
 
-  if (!is_split()) {
+  const Node& node = nodes[node_index];
+  if (!is_split(node_index)) {
     // Draw the rectangle of the node.
-    draw_rectangle(get_cell(), color, dst_surface, dst_position);
+    draw_rectangle(node.cell, node.color, dst_surface, dst_position);
 
     // Draw bounding boxes of elements.
-    for (const std::pair<T, Rectangle>& pair : elements) {
-      const Rectangle& bounding_box = pair.second;
-      if (is_main_cell(bounding_box)) {
-        draw_rectangle(bounding_box, color, dst_surface, dst_position);
+    for (int element_index : node.elements) {
+      const Rectangle& bounding_box = bounding_boxes[element_index];
+      if (is_main_cell(node_index, bounding_box)) {
+        draw_rectangle(bounding_box, node.color, dst_surface, dst_position);
       }
     }
   }
   else {
     // Draw children nodes.
-    for (const std::unique_ptr<Node>& child : children) {
-      child->draw(dst_surface, dst_position);
+    for (int i = 0; i < 4; ++i) {
+      draw(node.first_child + i, dst_surface, dst_position);
     }
   }
 }
@@ -605,7 +806,7 @@ void Quadtree<T, Comparator>::Node::draw(const SurfacePtr& dst_surface, const Po
  * \param dst_position Where to draw on that surface.
  */
 template<typename T, typename Comparator>
-void Quadtree<T, Comparator>::Node::draw_rectangle(
+void Quadtree<T, Comparator>::draw_rectangle(
     const Rectangle& rectangle,
     const Color& line_color,
     const SurfacePtr& dst_surface,
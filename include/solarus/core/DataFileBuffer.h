@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_DATA_FILE_BUFFER_H
+#define SOLARUS_DATA_FILE_BUFFER_H
+
+#include "solarus/core/Common.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Solarus {
+
+class DataFileBuffer;
+
+/**
+ * \brief Alias for shared_ptr of an immutable DataFileBuffer.
+ */
+using DataFileBufferPtr = std::shared_ptr<const DataFileBuffer>;
+
+/**
+ * \brief Read-only content of a data file, shared by its readers.
+ *
+ * Depending on where the file is, the memory can be a mapping of the file
+ * or a buffer that returns to a pool when released
+ * (see QuestFiles::data_file_read_buffer()).
+ * The content is never copied when the buffer is passed around.
+ */
+class SOLARUS_API DataFileBuffer {
+
+  public:
+
+    virtual ~DataFileBuffer();
+
+    DataFileBuffer(const DataFileBuffer& other) = delete;
+    DataFileBuffer& operator=(const DataFileBuffer& other) = delete;
+
+    static DataFileBufferPtr create(std::string&& content);
+
+    const char* data() const;
+    size_t size() const;
+    bool empty() const;
+    std::string to_string() const;
+
+  protected:
+
+    DataFileBuffer();
+    void set_content(const char* data, size_t size);
+
+  private:
+
+    const char* content_data;   /**< First byte of the content. */
+    size_t content_size;        /**< Size of the content in bytes. */
+
+};
+
+}
+
+#endif
+
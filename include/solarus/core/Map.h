@@ -22,6 +22,7 @@
 #include "solarus/core/MapData.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/entities/CameraPtr.h"
+#include "solarus/entities/CollisionBroadPhase.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/entities/TilePattern.h"
@@ -187,6 +188,8 @@ class SOLARUS_API Map: public ExportableToLua {
     void build_foreground_surface();
     void draw_background(const SurfacePtr& dst_surface);
     void draw_foreground(const SurfacePtr& dst_surface);
+    void check_collision_with_detectors(Entity& entity, const EntityMatchVector& entities_nearby);
+    void check_deferred_collisions();
 
     // map properties
 
@@ -234,6 +237,8 @@ class SOLARUS_API Map: public ExportableToLua {
     std::unique_ptr<Entities>
         entities;                 /**< The entities on the map. */
     bool suspended;               /**< Whether the game is suspended. */
+    CollisionBroadPhase
+        collision_broad_phase;    /**< Checks of detectors postponed during entity updates. */
 };
 
 /**
@@ -18,10 +18,13 @@
 #define SOLARUS_PIXEL_BITS_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
 #include "solarus/core/Transform.h"
 #include <cstdint>
 #include <vector>
 
+struct SDL_Surface;
+
 namespace Solarus {
 
 class Point;
@@ -34,12 +37,19 @@ class Surface;
  * This class stores efficiently the location of the non-transparent pixels of a surface.
  * For each pixel of the image, a bit indicates whether this pixel is transparent.
  * This class perform fast pixel-perfect collision checks.
+ *
+ * Rows are stored as 64-bit words in a single array, and each row starts
+ * on a 128-bit boundary of this array so that aligned collision tests
+ * can compare two words at once with SSE2 or NEON when available.
+ * The area of opaque pixels of the image and of each row is also kept
+ * to reject most non-overlapping pairs without looking at the bits.
  */
 class PixelBits {
 
   public:
 
     PixelBits(const Surface& surface, const Rectangle& image_position);
+    PixelBits(const SDL_Surface& surface, const Rectangle& image_position);
 
     bool test_aligned_collision(const PixelBits& other,
         const Point& location1, const Point& location2) const;
@@ -50,18 +60,36 @@ class PixelBits {
     bool test_oriented_collision(const PixelBits &other,
                                  const Transform& transform1, const Transform& transform2) const;
   private:
+
+    /**
+     * \brief Opaque pixels of a row.
+     */
+    struct RowSpan {
+      int first;             /**< X of the first opaque pixel. */
+      int end;               /**< X after the last opaque pixel (equal to first if none). */
+    };
+
+    template<typename IsTransparent>
+    void build(const Size& surface_size, const Rectangle& image_position,
+        IsTransparent is_pixel_transparent);
+
     bool at(int x, int y) const;
     void print() const;
-    void print_mask(uint32_t mask) const;
+    void print_mask(uint64_t mask) const;
 
     int width;               /**< width of the image in pixels */
     int height;              /**< height of the image in pixels */
-    int nb_integers_per_row; /**< number of uint32_t necessary to store
+    int nb_words_per_row;    /**< number of uint64_t necessary to store
                               * the bits of a row of the image */
+    int row_stride;          /**< number of uint64_t between two rows: at least
+                              * one more than nb_words_per_row, rounded to an even number */
 
-    std::vector<std::vector<uint32_t>>
-        bits;                /**< A two-dimensional array representing the
-                              * transparency bit of each pixel in the image. */
+    std::vector<uint64_t>
+        bits;                /**< Transparency bit of each pixel in the image,
+                              * row by row, most significant bit first. */
+    std::vector<RowSpan>
+        row_spans;           /**< Opaque pixels of each row. */
+    Rectangle opaque_box;    /**< Smallest rectangle containing all opaque pixels. */
 
 };
 
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PROFILER_H
+#define SOLARUS_PROFILER_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <string>
+
+namespace Solarus {
+
+class Arguments;
+
+/**
+ * \brief Hierarchical frame profiler.
+ *
+ * Code regions are measured with nested zones that are opened and closed
+ * on the main thread, usually through the SOLARUS_PROFILE_ZONE macro.
+ * Zones are timed with nanosecond resolution and recorded per frame
+ * into a ring buffer that keeps the last frames only.
+ *
+ * When the profiler is disabled, opening a zone only costs the test of a
+ * boolean.
+ *
+ * The recorded frames can be dumped as a Chrome trace JSON file,
+ * that can be opened in chrome://tracing or in Perfetto.
+ */
+class SOLARUS_API Profiler {
+
+  public:
+
+    /**
+     * \brief Profiles the enclosing scope as a zone.
+     */
+    class ScopedZone {
+
+      public:
+
+        /**
+         * \brief Opens a zone if the profiler is enabled.
+         * \param name Name of the zone. It must be a string literal
+         * or at least remain valid until the profiler is closed.
+         */
+        explicit ScopedZone(const char* name):
+          active(is_enabled()) {
+          if (active) {
+            begin_zone(name);
+          }
+        }
+
+        /**
+         * \brief Closes the zone if it was opened.
+         */
+        ~ScopedZone() {
+          if (active) {
+            end_zone();
+          }
+        }
+
+        ScopedZone(const ScopedZone& other) = delete;
+        ScopedZone& operator=(const ScopedZone& other) = delete;
+
+      private:
+
+        const bool active;  /**< Whether the zone was opened. */
+    };
+
+    static void initialize(const Arguments& args);
+    static void quit();
+
+    static bool is_enabled();
+    static void set_enabled(bool enabled);
+
+    static void begin_frame();
+    static void end_frame();
+    static void begin_zone(const char* name);
+    static void end_zone();
+
+    static bool dump_chrome_trace(const std::string& file_name);
+
+    static constexpr int default_num_frames = 300;      /**< Default size of the ring buffer. */
+    static constexpr int max_depth = 32;                /**< Deepest zone nesting recorded. */
+    static constexpr int max_zones_per_frame = 4096;    /**< Zones recorded per frame at most. */
+    static constexpr uint32_t report_interval = 1000;   /**< Time interval for reporting in milliseconds. */
+
+  private:
+
+    static bool enabled;    /**< Whether zones are currently recorded. */
+
+};
+
+/**
+ * \brief Returns whether the profiler is currently recording zones.
+ * \return \c true if zones are recorded.
+ */
+inline bool Profiler::is_enabled() {
+  return enabled;
+}
+
+}
+
+/**
+ * \cond doxygen_ignore
+ */
+#define SOLARUS_PROFILE_CONCAT2(a, b) a##b
+#define SOLARUS_PROFILE_CONCAT(a, b) SOLARUS_PROFILE_CONCAT2(a, b)
+/**
+ * \endcond
+ */
+
+/**
+ * \def SOLARUS_PROFILE_ZONE
+ * \brief Profiles the rest of the current scope as a zone with the given name.
+ */
+#define SOLARUS_PROFILE_ZONE(name) \
+  ::Solarus::Profiler::ScopedZone SOLARUS_PROFILE_CONCAT(solarus_profile_zone_, __LINE__)(name)
+
+#endif
@@ -18,6 +18,9 @@
 #define SOLARUS_QUEST_FILES_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/DataFileBuffer.h"
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -78,15 +81,42 @@ SOLARUS_API std::string data_file_read(
     const std::string& file_name,
     bool language_specific
 );
+SOLARUS_API DataFileBufferPtr data_file_read_buffer(
+    const std::string& file_name
+);
+SOLARUS_API DataFileBufferPtr data_file_read_buffer(
+    const std::string& file_name,
+    bool language_specific
+);
+SOLARUS_API void data_file_preload(
+    const std::string& file_name
+);
+SOLARUS_API void data_file_preload(
+    const std::string& file_name,
+    const std::string& buffer
+);
 SOLARUS_API void data_file_save(
     const std::string& file_name,
     const std::string& buffer
 );
+SOLARUS_API void data_file_save_async(
+    const std::string& file_name,
+    const std::function<std::string()>& make_content,
+    const std::function<void(bool)>& callback
+);
+SOLARUS_API void update_async_saves();
+SOLARUS_API void finish_async_saves();
+SOLARUS_API void wait_async_save(const std::string& file_name);
 SOLARUS_API bool data_file_delete(const std::string& file_name);
 SOLARUS_API bool data_file_mkdir(const std::string& dir_name);
 SOLARUS_API bool data_file_is_dir(
     const std::string& file_name
 );
+SOLARUS_API bool data_file_get_info(
+    const std::string& file_name,
+    int64_t& size,
+    int64_t& modification_time
+);
 SOLARUS_API std::vector<std::string> data_file_list_dir(
     const std::string& dir_path
 );
@@ -21,44 +21,126 @@
 #include "solarus/core/ResourceType.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/entities/TilePattern.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <queue>
 #include <thread>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace Solarus {
 
+class MapData;
+class SpriteData;
+
 /**
  * \brief Provides fast access to quest resources.
  *
  * Maintains a cache of already loaded quest resources
  * so that next accesses are faster.
+ *
+ * Resources are loaded in background by a small pool of worker threads,
+ * most urgent ones first. The main thread can request a resource at any
+ * time: it then waits for the worker loading it, or loads it itself if
+ * no worker has started it yet.
+ *
+ * Tilesets and map data are fully loaded in background.
+ * For sprites, images, sounds, musics, fonts and dialogs, only the files
+ * are read in advance (see QuestFiles::data_file_preload() and
+ * Surface::preload_file()), because creating them requires the main thread.
+ * Such requests are forgotten once done, so that a later request reads
+ * the files again if they were used or dropped in the meantime.
  */
 class SOLARUS_API ResourceProvider {
 
   public:
 
+    /**
+     * \brief Urgency of a background loading request.
+     */
+    enum class Priority {
+      LOW,      /**< Resources that might be needed some day. */
+      NORMAL,   /**< Resources that will probably be needed soon. */
+      HIGH      /**< Resources needed by the next map. */
+    };
+
     ResourceProvider();
+    ~ResourceProvider();
+
     void clear();
 
     Tileset& get_tileset(const std::string& tileset_id);
     const std::map<std::string, std::shared_ptr<Tileset>>& get_loaded_tilesets();
+    std::shared_ptr<const MapData> get_map_data(const std::string& map_id);
+
+    std::shared_future<void> preload(
+        ResourceType resource_type,
+        const std::string& element_id,
+        Priority priority = Priority::NORMAL
+    );
+    void preload_map_destinations(const MapData& map_data);
 
-    // TODO other types of resources
     // TODO clear/update when the resource list changes dynamically
 
     void invalidate_resource_element(ResourceType resource_type, const std::string& element_id);
 
     void start_preloading_resources();
 
+    static constexpr int max_workers = 3;   /**< Maximum number of worker threads. */
+
   private:
 
-    std::thread preloader_thread;  /**< Thread that loads resources in background. */
+    using ResourceKey = std::pair<ResourceType, std::string>;
+
+    /**
+     * \brief Loading state of a resource element.
+     */
+    struct Entry {
+      bool started = false;                 /**< Whether a thread has started loading it. */
+      std::promise<void> promise;           /**< Fulfilled when the loading is done. */
+      std::shared_future<void> future;      /**< Future of the promise. */
+      std::shared_ptr<MapData> map_data;    /**< Map data loaded, for maps. */
+    };
+
+    /**
+     * \brief A request of loading a resource element in background.
+     */
+    struct Job {
+      Priority priority;                    /**< Urgency of the request. */
+      uint64_t sequence;                    /**< Order of the request. */
+      ResourceKey key;                      /**< The resource element to load. */
+
+      bool operator<(const Job& other) const;
+    };
+
+    void start_workers();
+    void stop_workers();
+    void run_worker();
+    std::shared_ptr<Entry> get_entry(const ResourceKey& key);
+    void load_now(const ResourceKey& key);
+    void load(const ResourceKey& key, Entry& entry, Priority priority);
+    void load_sprite(const std::string& sprite_id, Priority priority);
+    void preload_sprite_pixel_bits(const SpriteData& data);
+
+    std::vector<std::thread> workers;  /**< Threads that load resources in background. */
+    std::mutex mutex;                  /**< Lock for the fields below. */
+    std::condition_variable
+        jobs_available;                /**< Signaled when a job is queued or workers have to stop. */
+    bool stopping;                     /**< Whether workers have to stop. */
+    std::priority_queue<Job> jobs;     /**< Pending requests, most urgent first. */
+    uint64_t next_sequence;            /**< Sequence number of the next request. */
+    std::map<ResourceKey, std::shared_ptr<Entry>>
+        entries;                       /**< Resources requested so far. */
     std::map<std::string, std::shared_ptr<Tileset>>
-        tileset_cache;             /**< Cache of loaded tilesets. */
+        tileset_cache;                 /**< Cache of loaded tilesets. */
 };
 
 }
 
 #endif
-
@@ -18,10 +18,11 @@
 #define SOLARUS_SAVEGAME_H
 
 #include "solarus/core/Common.h"
+#include "solarus/containers/FlatStringMap.h"
 #include "solarus/core/Equipment.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/lua/ExportableToLua.h"
-#include <map>
+#include <functional>
 #include <string>
 
 struct lua_State;
@@ -92,7 +93,7 @@ class SOLARUS_API Savegame: public ExportableToLua {
     // file state
     bool is_empty() const;
     void initialize();
-    void save();
+    void save(const std::function<void(bool)>& callback = std::function<void(bool)>());
     const std::string& get_file_name() const;
 
     // data
@@ -142,7 +143,9 @@ class SOLARUS_API Savegame: public ExportableToLua {
       int int_data;  // Also used for boolean
     };
 
-    std::map<std::string, SavedValue> saved_values;
+    using SavedValues = FlatStringMap<SavedValue>;
+
+    SavedValues saved_values;      /**< Values of the savegame by key. */
 
     bool empty;
     std::string file_name;         /**< Savegame file name relative to the quest write directory. */
@@ -153,6 +156,7 @@ class SOLARUS_API Savegame: public ExportableToLua {
         default_transition_style;  /**< Transition style to use by default. */
 
     void import_from_file();
+    static std::string export_values(const SavedValues& values);
     static int l_newindex(lua_State* l);
 
 };
@@ -45,6 +45,7 @@ class Timer: public ExportableToLua {
     void set_duration(uint32_t duration);
     uint32_t get_expiration_date() const;
     void set_expiration_date(uint32_t expiration_date);
+    uint32_t get_next_update_date() const;
 
     void update();
 
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_ANIMATED_TILE_MAP_H
+#define SOLARUS_ANIMATED_TILE_MAP_H
+
+#include "solarus/core/Common.h"
+#include "solarus/entities/TilePtr.h"
+#include "solarus/graphics/ShaderPtr.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+class Map;
+class Tile;
+class TilePattern;
+
+/**
+ * \brief Draws the tiles in animated regions of a map with a shader.
+ *
+ * Instead of drawing each tile separately, each layer has an index texture
+ * that tells for each 8x8 square of the map which pixels of the tileset
+ * to show there. A fragment shader reads it and fetches the tileset pixels,
+ * so that a whole layer is drawn with a single quad.
+ *
+ * Animated tile patterns get an id. A small texture, updated when
+ * frames change, gives the position of their current frame in the tileset.
+ *
+ * Tiles that cannot be represented this way (scrolling patterns,
+ * other tilesets, several tiles on the same square) are left to the caller.
+ */
+class AnimatedTileMap {
+
+  public:
+
+    explicit AnimatedTileMap(Map& map);
+
+    bool is_valid() const;
+    void build_layer(
+        int layer,
+        const std::vector<TilePtr>& tiles,
+        std::vector<TilePtr>& rejected_tiles
+    );
+    void update_frames();
+    void draw_on_map(int layer);
+
+  private:
+
+    bool add_tile(
+        const Tile& tile,
+        const std::vector<uint8_t>& tiles_per_square,
+        std::string& index_pixels
+    );
+    int get_pattern_id(const TilePattern& pattern);
+
+    Map& map;                                 /**< The map. */
+    ShaderPtr shader;                         /**< The tile map shader. */
+    std::map<int, SurfacePtr> index_surfaces; /**< Index texture of each layer with tiles drawn here. */
+    std::vector<const TilePattern*>
+        patterns;                             /**< Tile patterns drawn through the frames texture. */
+    std::unordered_map<const TilePattern*, int>
+        pattern_ids;                          /**< Index of each pattern in the frames texture. */
+    std::string frames_pixels;                /**< Tileset position of the current frame of each pattern. */
+    SurfacePtr frames_surface;                /**< Frames texture, created when the map is built. */
+
+};
+
+}
+
+#endif
+
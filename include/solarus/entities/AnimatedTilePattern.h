@@ -52,9 +52,12 @@ class AnimatedTilePattern: public TilePattern {
         const Point& viewport
     ) const override;
     bool is_drawn_at_its_position() const override;
+    bool get_position_in_tileset(Point& position) const override;
 
   private:
 
+    int get_current_frame() const;
+
     std::vector<Rectangle> frames;    /**< List of rectangles representing the animation frames
                                        * of this tile pattern in the tileset image.
                                        * The frames should have the same width and height. */
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_COLLISION_BROAD_PHASE_H
+#define SOLARUS_COLLISION_BROAD_PHASE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/Entities.h"
+#include <unordered_set>
+#include <vector>
+
+namespace Solarus {
+
+class Entity;
+
+/**
+ * \brief Finds all candidate entity/detector pairs of a frame in one pass.
+ *
+ * Without the broad phase, each entity that moves immediately queries the
+ * quadtree for detectors around it, possibly several times per frame.
+ *
+ * When the broad phase is enabled, collision checks requested while
+ * entities are being updated are only recorded. Once all entities are
+ * updated, a sort-and-sweep on the x axis finds detectors overlapping
+ * each recorded entity, and the map then runs the precise collision tests
+ * with these candidates, once per entity.
+ *
+ * Collisions are then detected with the positions of the end of the frame,
+ * which is why this is optional.
+ */
+class CollisionBroadPhase {
+
+  public:
+
+    static constexpr uint32_t simple_mask = 1 << 0;   /**< Candidate for simple collisions. */
+    static constexpr uint32_t sprites_mask = 1 << 1;  /**< Candidate for pixel-precise collisions. */
+
+    static bool is_enabled();
+    static void set_enabled(bool enabled);
+
+    static Rectangle get_simple_box(const Entity& entity);
+    static Rectangle get_sprites_box(const Entity& entity);
+
+    CollisionBroadPhase();
+
+    void begin_frame();
+    bool defer(Entity& entity);
+    void end_frame(const EntityVector& entities);
+    void clear();
+
+    int get_num_entities() const;
+    const EntityPtr& get_entity(int index) const;
+    const EntityMatchVector& get_candidates(int index) const;
+
+  private:
+
+    /**
+     * \brief Extent of an entity on the x axis.
+     */
+    struct Interval {
+      int left;                         /**< Left x coordinate. */
+      int right;                        /**< Right x coordinate (excluded). */
+      int index;                        /**< Index of the entity. */
+      bool detector;                    /**< Whether it is a detector or an entity that moved. */
+    };
+
+    void add_candidate(int entity_index, int detector_index);
+
+    static bool enabled;                /**< Whether collision checks are deferred to the end of updates. */
+
+    bool deferring;                     /**< Whether checks are currently recorded. */
+    EntityVector movers;                /**< Entities that requested a check this frame. */
+    std::unordered_set<const Entity*>
+        movers_set;                     /**< The same entities, to record each one once. */
+    std::vector<Rectangle> mover_boxes; /**< Simple and sprites box of each entity. */
+    EntityVector detectors;             /**< Detectors that may collide. */
+    std::vector<Rectangle>
+        detector_boxes;                 /**< Bounding box of each detector. */
+    std::vector<Interval> intervals;    /**< Extents sorted by left coordinate. */
+    std::vector<int> active_movers;     /**< Entities currently crossed by the sweep. */
+    std::vector<int> active_detectors;  /**< Detectors currently crossed by the sweep. */
+    std::vector<EntityMatchVector>
+        candidates;                     /**< Detectors found for each entity. */
+
+};
+
+/**
+ * \brief Returns whether collision checks are deferred to a broad phase.
+ * \return \c true if the broad phase is enabled.
+ */
+inline bool CollisionBroadPhase::is_enabled() {
+  return enabled;
+}
+
+}
+
+#endif
+
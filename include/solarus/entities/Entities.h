@@ -18,6 +18,8 @@
 #define SOLARUS_ENTITIES_H
 
 #include "solarus/core/Common.h"
+#include "solarus/containers/FlatStringMap.h"
+#include "solarus/core/Rectangle.h"
 #include "solarus/graphics/Transition.h"
 #include "solarus/entities/CameraPtr.h"
 #include "solarus/entities/Entity.h"
@@ -32,15 +34,18 @@
 #include <set>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace Solarus {
 
+class AnimatedTileMap;
 class Camera;
 class Destination;
 class Hero;
 class Map;
 class MapData;
+class NavigationGrid;
 class NonAnimatedRegions;
 class Rectangle;
 class Tileset;
@@ -51,6 +56,7 @@ using EntityList = std::list<EntityPtr>;
 using EntitySet = std::set<EntityPtr>;
 using EntityVector = std::vector<EntityPtr>;
 using ConstEntityVector = std::vector<ConstEntityPtr>;
+using EntityMatchVector = std::vector<std::pair<EntityPtr, uint32_t>>;
 
 template <typename T, typename Comparator>
 class Quadtree;
@@ -143,6 +149,7 @@ class SOLARUS_API Entities {
     // By coordinates.
     void get_entities_in_rectangle_z_sorted(const Rectangle& rectangle, ConstEntityVector& result) const;
     void get_entities_in_rectangle_z_sorted(const Rectangle& rectangle, EntityVector& result);
+    void get_entities_in_rectangles_z_sorted(const Rectangle* rectangles, int num_rectangles, EntityMatchVector& result);
 
     // By separator region.
     void get_entities_in_region_z_sorted(const Point& xy, EntityVector& result);
@@ -160,6 +167,9 @@ class SOLARUS_API Entities {
     void bring_to_back(Entity& entity);
     void set_entity_layer(Entity& entity, int layer);
     void notify_entity_bounding_box_changed(Entity& entity);
+    void notify_entity_ground_changed(Entity& entity);
+    void notify_entity_drawing_order_changed(Entity& entity);
+    NavigationGrid& get_navigation_grid();
 
     // Specific to some entity types.
     bool overlaps_raised_blocks(int layer, const Rectangle& rectangle) ;
@@ -177,6 +187,11 @@ class SOLARUS_API Entities {
     void update();
     void draw();
 
+    // Simulation level of detail.
+    int get_num_sleeping_entities() const;
+    static bool is_stats_report_enabled();
+    static void set_stats_report_enabled(bool enabled);
+
   private:
 
     /**
@@ -211,10 +226,19 @@ class SOLARUS_API Entities {
     };
 
     void initialize_layers();
+    void build_animated_tile_map();
     void set_tile_ground(int layer, int x8, int y8, Ground ground);
     void remove_marked_entities();
     void notify_entity_removed(Entity& entity);
     void update_crystal_blocks();
+    bool is_in_drawn_area(const Entity& entity) const;
+    void add_entity_to_draw(const EntityPtr& entity);
+    void remove_entity_to_draw(const EntityPtr& entity, int layer);
+    void set_drawn_area(const Rectangle& area);
+    void sort_entities_to_draw(int layer);
+    void wake_up_entities_near_camera();
+    bool is_beyond_optimization_distance(const Entity& entity, int margin) const;
+    void report_stats();
 
     // map
     Game& game;                                     /**< The game running this map */
@@ -233,14 +257,25 @@ class SOLARUS_API Entities {
                                                      * here for performance. */
     ByLayer<std::vector<TilePtr>>
         tiles_in_animated_regions;                  /**< For each layer, animated tiles and tiles overlapping them. */
+    ByLayer<std::vector<TilePtr>>
+        tiles_drawn_separately;                     /**< For each layer, tiles in animated regions
+                                                     * that are not drawn by the animated tile map. */
+    std::unique_ptr<AnimatedTileMap>
+        animated_tile_map;                          /**< Draws most tiles in animated regions
+                                                     * with a shader, or nullptr. */
+    std::unique_ptr<NavigationGrid>
+        navigation_grid;                            /**< Cached ground of each 8x8 square, including
+                                                     * ground modifier entities. */
 
     // dynamic entities
     HeroPtr hero;                                   /**< The hero, also stored in Game because
                                                      * it is kept when changing maps. */
     CameraPtr camera;                               /**< The visible area of the map. */
 
-    std::map<std::string, EntityPtr>
+    FlatStringMap<EntityPtr>
         named_entities;                             /**< Entities identified by a name. */
+    std::set<std::string> entity_names;             /**< Names of named_entities in alphabetical
+                                                     * order, to find them by prefix. */
     EntityList all_entities;                        /**< All map entities except tiles and the hero. */
     std::map<EntityType, ByLayer<EntitySet>>
         entities_by_type;                           /**< All map entities except tiles, by type and then layer. */
@@ -248,16 +283,29 @@ class SOLARUS_API Entities {
     std::unique_ptr<EntityTree> quadtree;           /**< All map entities except tiles.
                                                      * Optimized for fast spatial search. */
     ByLayer<ZOrderInfo> z_orders;                   /**< For each layer, tracks the relative Z order of entities. */
-    ByLayer<EntityVector>
-        entities_drawn_not_at_their_position;       /**< For each layer, entities to draw even if there position
-                                                     * is outside the camera. */
-    ByLayer<EntitiesToDraw> entities_to_draw;       /**< For each layer, entities to be drawn at this cycle. */
+    ByLayer<EntitiesToDraw> entities_to_draw;       /**< For each layer, entities except tiles that are
+                                                     * in the drawn area or not drawn at their position,
+                                                     * in drawing order. Kept from one cycle to the next. */
+    std::unordered_set<const Entity*>
+        entities_in_draw_lists;                     /**< Entities currently in entities_to_draw. */
+    Rectangle drawn_area;                           /**< Area around the camera where entities are drawn. */
+    ByLayer<bool> drawing_order_changed;            /**< For each layer, whether entities_to_draw
+                                                     * may be unsorted. */
 
     EntityList entities_to_remove;                  /**< List of entities that need to be removed right now. */
 
     std::shared_ptr<Destination>
         default_destination;                        /**< Default destination of this map or nullptr. */
 
+    // simulation level of detail
+    int num_sleeping_entities;                      /**< Entities found sleeping during the last update. */
+    int max_sleeping_distance;                      /**< Greatest optimization distance of
+                                                     * these sleeping entities. */
+    int report_num_frames;                          /**< Updates since the last stats report. */
+    int report_num_sleeping_entities;               /**< Sum of sleeping entities since the last stats report. */
+    uint32_t last_report_time;                      /**< Date of the last stats report. */
+    static bool stats_report_enabled;               /**< Whether to log sleeping entities every second. */
+
 };
 
 /**
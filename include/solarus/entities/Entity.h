@@ -184,6 +184,9 @@ class SOLARUS_API Entity: public ExportableToLua {
     int get_optimization_distance() const;
     int get_optimization_distance2() const;
     void set_optimization_distance(int distance);
+    static int get_default_optimization_distance(EntityType type);
+    bool is_sleeping() const;
+    void set_sleeping(bool sleeping);
 
     int get_z() const;
     void set_z(int z);
@@ -538,10 +541,11 @@ class SOLARUS_API Entity: public ExportableToLua {
     uint32_t when_suspended;                    /**< indicates when this entity was suspended */
 
     int optimization_distance;                  /**< Above this distance from the visible area,
-                                                 * the engine may skip updates (0 means infinite). */
+                                                 * the engine may skip updates (0 means infinite,
+                                                 * -1 means the default of the type). */
     int optimization_distance2;                 /**< Square of optimization_distance. */
-    static constexpr int
-        default_optimization_distance = 0;      /**< Default value. */
+    bool sleeping;                              /**< Whether updates are skipped because the entity
+                                                 * is beyond its optimization distance. */
 
 };
 
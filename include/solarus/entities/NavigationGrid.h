@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_NAVIGATION_GRID_H
+#define SOLARUS_NAVIGATION_GRID_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/entities/EntityPtr.h"
+#include "solarus/entities/EntityType.h"
+#include "solarus/entities/Ground.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Solarus {
+
+class Entities;
+class Entity;
+class Map;
+
+/**
+ * \brief Cache of the ground of each 8x8 square of a map.
+ *
+ * The ground of a point is normally the one of the topmost ground modifier
+ * entity (dynamic tile, destructible, custom entity) that overlaps it, or
+ * the ground of static tiles. Finding ground modifiers requires a quadtree
+ * query for each point, which is what makes collision tests of moving
+ * entities expensive.
+ *
+ * This grid resolves the ground of each square once and keeps it until a
+ * ground modifier covering the square changes. Squares that are only partly
+ * covered by a ground modifier, or covered by several ones, are marked as
+ * mixed: the caller has to fall back to a precise query for them.
+ *
+ * The grid also counts the entities overlapping each square, whatever their
+ * layer. Squares with a uniform ground and no entity can be known to be free
+ * or blocked for a moving entity without any collision test: this is what
+ * path finding uses to explore most squares quickly.
+ *
+ * Each change of ground increments a version number. The grid also keeps
+ * a small LRU cache of recent path finding results, that are only reused
+ * while the version is unchanged.
+ */
+class NavigationGrid {
+
+  public:
+
+    /**
+     * \brief Parameters identifying a path finding computation.
+     */
+    struct PathQuery {
+
+      int layer;                  /**< Layer of the source and the target. */
+      int source_index;           /**< Index of the 8x8 square of the source. */
+      int target_index;           /**< Index of the 8x8 square of the target. */
+      EntityType type;            /**< Type of the entity to move. */
+      const Entity* entity;       /**< The entity to move if it has its own traversal
+                                   * rules (custom entities), nullptr otherwise. */
+      uint32_t ground_obstacles;  /**< Grounds that are obstacles for this entity (one bit per ground). */
+      int max_nodes;              /**< Node budget of the search. */
+
+      bool operator==(const PathQuery& other) const;
+    };
+
+    /**
+     * \brief What the grid knows about obstacles on an 8x8 square.
+     */
+    enum class Walkability {
+      FREE,       /**< No obstacle on the square. */
+      BLOCKED,    /**< The ground of the whole square is an obstacle. */
+      UNKNOWN     /**< A precise collision test is needed. */
+    };
+
+    NavigationGrid(Map& map, Entities& entities);
+
+    void build();
+    bool is_built() const;
+    uint32_t get_version() const;
+
+    bool get_ground(int layer, int x, int y, Ground& ground);
+    Walkability get_walkability(
+        int layer, int x8, int y8, uint32_t ground_obstacles, bool check_ground);
+
+    void notify_ground_modifier_changed(const Entity& entity);
+    void notify_entity_added(const Entity& entity);
+    void notify_entity_moved(const Entity& entity);
+    void notify_entity_removed(const Entity& entity);
+    void notify_tile_ground_changed(int layer, int x8, int y8);
+
+    bool get_cached_path(const PathQuery& query, std::string& path);
+    void set_cached_path(const PathQuery& query, const std::string& path);
+
+    static uint32_t get_ground_obstacles(const Entity& entity);
+
+    static constexpr int path_cache_size = 32;          /**< Number of paths remembered. */
+    static constexpr uint32_t path_cache_delay = 500;   /**< Lifetime of a cached path in milliseconds. */
+
+  private:
+
+    /**
+     * \brief Resolution state of an 8x8 square.
+     */
+    enum class CellState : uint8_t {
+      CLEAN,    /**< The cached ground is up-to-date. */
+      DIRTY,    /**< The ground has to be resolved again. */
+      MIXED     /**< The ground is not uniform on the square. */
+    };
+
+    /**
+     * \brief Cached grounds of one layer.
+     */
+    struct Layer {
+      std::vector<Ground> grounds;        /**< Ground of each square (valid if clean). */
+      std::vector<CellState> states;      /**< State of each square. */
+    };
+
+    /**
+     * \brief Area where a ground modifier was when it was last seen.
+     */
+    struct Footprint {
+      int layer;                          /**< Layer of the entity. */
+      Rectangle box;                      /**< Bounding box of the entity. */
+    };
+
+    /**
+     * \brief A path finding result.
+     */
+    struct CachedPath {
+      PathQuery query;                    /**< Parameters of the computation. */
+      std::string path;                   /**< The path found, possibly empty. */
+      uint32_t version;                   /**< Version of the grid when the path was computed. */
+      uint32_t date;                      /**< Date when the path was computed. */
+      uint64_t last_use;                  /**< Value of the use counter when the path was last used. */
+    };
+
+    Rectangle get_cells(const Rectangle& box) const;
+    void invalidate(int layer, const Rectangle& box);
+    void resolve_cell(int layer, int index);
+    void add_occupancy(const Rectangle& cells, int delta);
+
+    Map& map;                             /**< The map. */
+    Entities& entities;                   /**< Entities of the map. */
+    bool built;                           /**< Whether build() was called. */
+    uint32_t version;                     /**< Incremented whenever a square is invalidated. */
+    int min_layer;                        /**< Lowest layer of the map. */
+    int width8;                           /**< Number of squares on a row. */
+    int height8;                          /**< Number of squares on a column. */
+    std::vector<Layer> layers;            /**< Grounds of each layer, starting at min_layer. */
+    std::unordered_map<const Entity*, Footprint>
+        footprints;                       /**< Last known area of each ground modifier. */
+    std::vector<uint16_t> occupancy;      /**< Number of entities overlapping each square. */
+    std::unordered_map<const Entity*, Rectangle>
+        occupied_cells;                   /**< Squares counted in occupancy for each entity. */
+    std::vector<ConstEntityPtr>
+        entities_nearby;                  /**< Buffer reused when resolving squares. */
+    std::vector<CachedPath> path_cache;   /**< Recent path finding results. */
+    uint64_t path_cache_uses;             /**< Counter of cache accesses, used to find the LRU path. */
+
+};
+
+/**
+ * \brief Returns whether the grid was built.
+ * \return \c true if grounds can be queried.
+ */
+inline bool NavigationGrid::is_built() const {
+  return built;
+}
+
+/**
+ * \brief Returns the version of the grid.
+ *
+ * The version changes each time the ground of a square may have changed.
+ *
+ * \return The current version.
+ */
+inline uint32_t NavigationGrid::get_version() const {
+  return version;
+}
+
+}
+
+#endif
+
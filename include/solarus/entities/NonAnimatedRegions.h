@@ -19,6 +19,7 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/containers/Grid.h"
+#include "solarus/core/Point.h"
 #include "solarus/entities/TileInfo.h"
 #include "solarus/graphics/SurfacePtr.h"
 #include <unordered_map>
@@ -35,6 +36,11 @@ class Map;
  * tile. The tiles in such rectangles of the map can be pre-drawn once for all
  * on an intermediate surface for performance. Furthermore, this intermediate
  * surface is drawn lazily when the camera moves.
+ *
+ * Cells the camera is moving toward are drawn in advance, a limited number
+ * per frame, so that fast scrolling does not build many cells in one frame.
+ * Cells far from the camera are forgotten when the cache exceeds
+ * a memory budget.
  */
 class NonAnimatedRegions {
 
@@ -50,7 +56,20 @@ class NonAnimatedRegions {
 
   private:
 
+    /**
+     * \brief A drawn cell kept in cache.
+     */
+    struct CachedCell {
+      SurfacePtr surface;                   /**< Non-animated tiles of the cell,
+                                             * or nullptr if the cell has none. */
+      int last_used;                        /**< Last frame when the cell was drawn or built. */
+    };
+
     bool overlaps_animated_tile(const TileInfo& tile) const;
+    Rectangle get_cells_in(const Rectangle& area) const;
+    Rectangle get_predicted_camera_box(const Rectangle& camera_box) const;
+    void build_cells_ahead(const Rectangle& cells, const Point& camera_center);
+    void evict_cells(const Rectangle& cells_to_keep);
     void build_cell(int cell_index);
 
     Map& map;                               /**< The map. */
@@ -63,8 +82,14 @@ class NonAnimatedRegions {
     Grid<TileInfo> non_animated_tiles;      /**< All non-animated tiles. Stored in a grid so that
                                              * we can quickly find the ones to draw lazily later when the
                                              * camera moves. */
-    std::unordered_map<int, SurfacePtr>
+    std::unordered_map<int, CachedCell>
         optimized_tiles_surfaces;           /**< Cache of drawn non-animated tiles for each cell. */
+    size_t cache_bytes;                     /**< Memory used by the surfaces of the cache. */
+    int frame;                              /**< Number of updates so far. */
+    int num_cells_built;                    /**< Cells built since the last update. */
+    Point camera_velocity;                  /**< Camera movement during the last update. */
+    Point previous_camera_xy;               /**< Camera position at the last update. */
+    bool has_previous_camera_xy;            /**< Whether previous_camera_xy is known. */
 
 };
 
@@ -50,6 +50,7 @@ class ParallaxScrollingTilePattern: public SimpleTilePattern {
     ) const override;
 
     virtual bool is_animated() const override;
+    virtual bool get_position_in_tileset(Point& position) const override;
     virtual bool is_drawn_at_its_position() const override;
 
     static constexpr int ratio = 2;  /**< Distance made by the viewport to move the tile pattern of 1 pixel. */
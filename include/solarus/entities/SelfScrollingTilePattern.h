@@ -48,6 +48,7 @@ class SelfScrollingTilePattern: public SimpleTilePattern {
     ) const override;
 
     virtual bool is_animated() const override;
+    virtual bool get_position_in_tileset(Point& position) const override;
 
 };
 
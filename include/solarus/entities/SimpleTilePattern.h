@@ -43,6 +43,7 @@ class SimpleTilePattern: public TilePattern {
     ) const override;
 
     virtual bool is_animated() const override;
+    virtual bool get_position_in_tileset(Point& position) const override;
 
   protected:
 
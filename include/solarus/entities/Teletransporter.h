@@ -18,6 +18,7 @@
 #define SOLARUS_TELETRANSPORTER_H
 
 #include "solarus/core/Common.h"
+#include "solarus/core/ResourceProvider.h"
 #include "solarus/entities/Entity.h"
 #include "solarus/graphics/Transition.h"
 #include <string>
@@ -51,6 +52,7 @@ class Teletransporter: public Entity {
 
     virtual EntityType get_type() const override;
     virtual void notify_creating() override;
+    virtual void update() override;
 
     const std::string& get_sound_id() const;
     void set_sound_id(const std::string& sound_id);
@@ -72,6 +74,8 @@ class Teletransporter: public Entity {
 
   private:
 
+    void preload_destination_map(ResourceProvider::Priority priority);
+
     std::string sound_id;                 /**< Sound played when this teletransporter is used
                                            * (an empty string means no sound). */
     Transition::Style transition_style;   /**< Style of transition between the two maps. */
@@ -88,6 +92,8 @@ class Teletransporter: public Entity {
                                            * direction of destination_side). */
     bool transporting_hero;               /**< Whether the hero is currently being transported
                                            * by this teletransporter. */
+    bool hero_close;                      /**< Whether the hero was close to this teletransporter
+                                           * at the last update. */
 
 };
 
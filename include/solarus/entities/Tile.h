@@ -56,8 +56,10 @@ class Tile: public Entity {
     void built_in_draw(Camera& camera) override;
     void draw_on_surface(const SurfacePtr& dst_surface, const Point& viewport);
     void notify_tileset_changed() override;
+    bool has_tile_pattern() const;
     const TilePattern& get_tile_pattern() const;
     const std::string& get_tile_pattern_id() const;
+    const Tileset* get_tileset() const;
     bool is_animated() const;
 
   private:
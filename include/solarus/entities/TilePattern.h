@@ -72,6 +72,7 @@ class TilePattern {
     ) const = 0;
     virtual bool is_animated() const;
     virtual bool is_drawn_at_its_position() const;
+    virtual bool get_position_in_tileset(Point& position) const;
 
   protected:
 
@@ -33,10 +33,12 @@ class Hq2xFilter: public SoftwarePixelFilter {
     Hq2xFilter();
 
     virtual int get_scaling_factor() const override;
-    virtual void filter(
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
+        int first_row,
+        int last_row,
         uint32_t* dst
     ) const override;
 
@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_PIXEL_BITS_CACHE_H
+#define SOLARUS_PIXEL_BITS_CACHE_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/PixelBits.h"
+#include "solarus/core/Rectangle.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Solarus {
+
+class Surface;
+
+/**
+ * \brief Pixel bits of sprite frames shared by all sprites.
+ *
+ * Pixel bits are identified by the image file they come from and by
+ * the position of the frame in this image, so that animations and sprites
+ * using the same frames share them.
+ * They are created on demand the first time they are needed,
+ * or in advance from the resource preloading thread.
+ *
+ * All functions are thread-safe.
+ */
+class PixelBitsCache {
+
+  public:
+
+    static std::shared_ptr<const PixelBits> get_pixel_bits(
+        const std::string& image_file_name,
+        const Surface& image,
+        const Rectangle& frame
+    );
+    static void preload_pixel_bits(
+        const std::string& image_file_name,
+        const std::vector<Rectangle>& frames
+    );
+    static int get_num_pixel_bits();
+    static void clear();
+
+    static bool is_preloading_enabled();
+    static void set_preloading_enabled(bool preloading_enabled);
+
+};
+
+}
+
+#endif
+
@@ -33,6 +33,19 @@ public:
    */
   virtual SurfaceImplPtr create_texture(SDL_Surface_UniquePtr&& surface) = 0;
 
+  /**
+   * @brief Create a static texture for an image file
+   *
+   * Image files are shared and rarely modified, so renderers may pack
+   * them together into bigger textures to draw them in fewer batches.
+   *
+   * @param surface a SDL surface containing the pixels data, ownership is taken
+   * @return the surface impl
+   */
+  virtual SurfaceImplPtr create_image_texture(SDL_Surface_UniquePtr&& surface) {
+    return create_texture(std::move(surface));
+  }
+
   /**
    * @brief Create a special surface impl that represent the screen
    * @param window the window
@@ -88,6 +101,17 @@ public:
    */
   virtual std::string get_name() const = 0;
 
+  /**
+   * @brief tells whether custom shaders can be used to draw on any surface
+   *
+   * Some renderers only emulate shaders for the final rendering to the window.
+   *
+   * @return true if shaders work for every draw
+   */
+  virtual bool has_surface_shaders() const {
+    return false;
+  }
+
   /**
    * @brief get the default terminal of this renderer, meaning default DrawProxy, plain draw
    * @return  the terminal
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_SKYLINE_PACKER_H
+#define SOLARUS_SKYLINE_PACKER_H
+
+#include "solarus/core/Common.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Size.h"
+#include <vector>
+
+namespace Solarus {
+
+/**
+ * \brief Packs rectangles into a fixed-size area.
+ *
+ * The free space is represented by its skyline: the top edge of the
+ * rectangles already placed, from left to right.
+ * Each new rectangle goes at the bottom-left-most position where it fits.
+ * Space below the skyline is lost, which is fine when rectangles are
+ * never removed, like images of a texture atlas.
+ */
+class SOLARUS_API SkylinePacker {
+
+  public:
+
+    explicit SkylinePacker(const Size& size);
+
+    const Size& get_size() const;
+    int get_used_area() const;
+
+    bool insert(const Size& rectangle_size, Point& position);
+
+  private:
+
+    /**
+     * \brief A horizontal segment of the skyline.
+     */
+    struct Segment {
+      int x;          /**< X coordinate of the left of the segment. */
+      int y;          /**< Height of the skyline on this segment. */
+      int width;      /**< Width of the segment. */
+    };
+
+    int get_fit_y(size_t index, const Size& rectangle_size) const;
+    void add_segment(size_t index, const Point& position, const Size& rectangle_size);
+
+    Size size;                        /**< Size of the area. */
+    int used_area;                    /**< Sum of the areas of rectangles inserted. */
+    std::vector<Segment> skyline;     /**< Segments of the skyline, sorted by x. */
+
+};
+
+}
+
+#endif
+
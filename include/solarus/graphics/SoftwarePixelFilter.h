@@ -25,6 +25,11 @@ namespace Solarus {
 /**
  * \brief Abstract class for software pixel filtering algorithms.
  *
+ * Images are split into horizontal bands filtered in parallel by a pool
+ * of threads shared by all filters.
+ * Filtering can also run in background while the main thread does
+ * something else, see start_filter() and finish_filter().
+ *
  * \deprecated Software pixel filters are deprecated since Solarus 1.6.
  * The new recommended way is to use shaders instead.
  */
@@ -42,22 +47,47 @@ class SoftwarePixelFilter {
     virtual int get_scaling_factor() const = 0;
 
     /**
-     * \brief Applies the algorithm on a rectangle of pixels.
+     * \brief Applies the algorithm on some rows of a rectangle of pixels.
+     *
+     * This function is called from several threads at the same time
+     * on different rows.
+     *
      * \param src The rectangle of pixels in RGBA format.
-     * Must be a buffer of size src_width * dst_width.
+     * Must be a buffer of size src_width * src_height.
+     * Rows outside the range may be read as neighbors.
      * \param src_width Width of the rectangle.
      * \param src_height Height of the rectangle.
+     * \param first_row First row to filter.
+     * \param last_row Row after the last one to filter.
      * \param dst The destination rectangle to write.
      * Must be a buffer of size
-     * src_width * dst_width * get_scaling_factor().
+     * src_width * src_height * get_scaling_factor()^2.
+     * Only the rows corresponding to the range are written.
      */
-    virtual void filter(
+    virtual void filter_rows(
         const uint32_t* src,
         int src_width,
         int src_height,
+        int first_row,
+        int last_row,
         uint32_t* dst
     ) const = 0;
 
+    void filter(
+        const uint32_t* src,
+        int src_width,
+        int src_height,
+        uint32_t* dst
+    ) const;
+    void start_filter(
+        const uint32_t* src,
+        int src_width,
+        int src_height,
+        uint32_t* dst
+    ) const;
+    static void finish_filter();
+    static void quit();
+
 };
 
 }
@@ -69,6 +69,7 @@ class SpriteAnimation {
                                    * or nullptr if missing or not loaded yet.
                                    * This image is the same for
                                    * all directions of the sprite's animation. */
+    std::string src_image_file_name; /**< File of the image relative to the data directory. */
     const bool
         src_image_is_tileset;     /**< Whether the image comes from the tileset. */
     std::vector<SpriteAnimationDirection>
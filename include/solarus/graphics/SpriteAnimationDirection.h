@@ -22,12 +22,13 @@
 #include "solarus/core/PixelBits.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/graphics/Drawable.h"
+#include "solarus/graphics/SurfacePtr.h"
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace Solarus {
 
-class Surface;
-
 /**
  * \brief A sequence of frames representing a sprite animated in a particular direction.
  *
@@ -55,7 +56,7 @@ class SpriteAnimationDirection {
         int current_frame, Surface& src_image, const DrawInfos &infos) const;
 
     // pixel collisions
-    void enable_pixel_collisions(Surface& src_image);
+    void enable_pixel_collisions(const SurfacePtr& src_image, const std::string& src_image_file_name);
     void disable_pixel_collisions();
     bool are_pixel_collisions_enabled() const;
     const PixelBits& get_pixel_bits(int frame) const;
@@ -66,9 +67,12 @@ class SpriteAnimationDirection {
     Point origin;                       /**< coordinates of the sprite's origin from the
                                          * upper-left corner of its image. */
 
-    std::vector<PixelBits>
-        pixel_bits;                    /**< bit masks representing the non-transparent pixels of each frame,
-                                         * computed only if enable_pixel_collisions() is called */
+    SurfacePtr src_image;               /**< image of the frames, when pixel collisions are enabled */
+    std::string src_image_file_name;    /**< file of this image, identifying frames in PixelBitsCache */
+    mutable std::vector<std::shared_ptr<const PixelBits>>
+        pixel_bits;                     /**< bit masks representing the non-transparent pixels of each frame,
+                                         * only created when a collision test needs them;
+                                         * empty if enable_pixel_collisions() was not called */
 };
 
 /**
@@ -79,25 +83,6 @@ inline const Point& SpriteAnimationDirection::get_origin() const {
   return origin;
 }
 
-/**
- * \brief Returns the pixel bits object of a frame.
- *
- * It represents the transparent bits of the frame and permits to detect
- * pixel-precise collisions.
- * The pixel collisions must be enabled.
- *
- * \param frame A frame of the animation.
- * \return The pixel bits object of a frame.
- */
-inline const PixelBits& SpriteAnimationDirection::get_pixel_bits(int frame) const {
-
-  SOLARUS_ASSERT(are_pixel_collisions_enabled(),
-      "Pixel-precise collisions are not enabled for this sprite");
-  SOLARUS_ASSERT(frame >= 0 && frame < get_nb_frames(), "Invalid frame number");
-
-  return pixel_bits[frame];
-}
-
 }
 
 #endif
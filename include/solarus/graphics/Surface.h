@@ -80,6 +80,11 @@ class Surface: public Drawable {
         size_t data_len
     );
 
+    static void preload_file(
+        const std::string& file_name,
+        ImageDirectory base_directory = DIR_SPRITES
+    );
+
     int get_width() const;
     int get_height() const;
     virtual Size get_size() const override;
@@ -95,6 +100,7 @@ class Surface: public Drawable {
     bool is_pixel_transparent(int index) const;
 
     std::string get_pixels() const;
+    std::string get_pixels(const Rectangle& region) const;
     void set_pixels(const std::string& buffer);
 
     // Implementation from Drawable.
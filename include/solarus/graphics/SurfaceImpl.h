@@ -30,11 +30,28 @@ public:
      */
   virtual SDL_Surface* get_surface() const = 0;
 
+  /**
+   * @brief get the SDL_Surface, synchronised at least in the given region
+   *
+   * Implementations that know which pixels changed can avoid
+   * reading back the rest of the texture.
+   *
+   * @param region the region of interest
+   * @return a valid SDL_Surface
+   */
+  virtual SDL_Surface* get_surface(const Rectangle& region) const;
+
   /**
    * @brief upload_surface back to the accelerated storage
    */
   virtual void upload_surface() = 0;
 
+  /**
+   * @brief upload a region of the surface back to the accelerated storage
+   * @param region the modified region
+   */
+  virtual void upload_surface(const Rectangle& region);
+
   /**
      * @brief get texture width
      * @return width
@@ -54,6 +71,13 @@ public:
    */
   std::string get_pixels() const;
 
+  /**
+   * @brief get the pixel buffer of a region of this surface
+   * @param region the region, must be inside the surface
+   * @return the pixels of the region, row by row
+   */
+  std::string get_pixels(const Rectangle& region) const;
+
   /**
    * @brief set the pixels of this surface from a buffer
    * @param buffer
@@ -60,6 +60,7 @@ namespace Video {
 
     SDL_Window* get_window();
     Renderer& get_renderer();
+    bool is_tile_map_shader_enabled();
 
     SDL_PixelFormat* get_pixel_format();
 
@@ -8,6 +8,7 @@ namespace Solarus {
 
 class GlShader;
 class GlTexture;
+class SkylinePacker;
 
 /**
  * @brief Opengl Renderer
@@ -41,6 +42,7 @@ public:
   static RendererPtr create(SDL_Window* window, bool force_software);
   SurfaceImplPtr create_texture(int width, int height) override;
   SurfaceImplPtr create_texture(SDL_Surface_UniquePtr &&surface) override;
+  SurfaceImplPtr create_image_texture(SDL_Surface_UniquePtr &&surface) override;
   SurfaceImplPtr create_window_surface(SDL_Window* w, int width, int height) override;
   ShaderPtr create_shader(const std::string& shader_id) override;
   ShaderPtr create_shader(const std::string& vertex_source, const std::string& fragment_source, double scaling_factor) override;
@@ -53,16 +55,22 @@ public:
   void fill(SurfaceImpl& dst, const Color& color, const Rectangle& where, BlendMode mode = BlendMode::BLEND) override;
   void invalidate(const SurfaceImpl& surf) override;
   std::string get_name() const override;
+  bool has_surface_shaders() const override;
   void present(SDL_Window* window) override;
   void on_window_size_changed(const Rectangle& viewport) override;
   static GlRenderer& get(){
     return *instance;
   }
+  static void set_atlas_enabled(bool enabled);
+  static void set_stats_report_enabled(bool enabled);
 
   const DrawProxy& default_terminal() const override;
   ~GlRenderer() override;
 private:
   static constexpr const char* VCOLOR_ONLY_NAME = "sol_vcolor_only";
+  static constexpr int ATLAS_PAGE_SIZE = 1024;      /**< Width and height of atlas textures. */
+  static constexpr int ATLAS_MAX_IMAGE_SIZE = 256;  /**< Bigger images get their own texture. */
+  static constexpr uint32_t STATS_REPORT_INTERVAL = 1000;  /**< Time between two stats reports in ms. */
   void draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos& infos, GlShader& shader);
 
   /**
@@ -73,8 +81,8 @@ private:
 
   bool use_vao() const;
 
-  void read_pixels(GlTexture* from, void* to);
-  void put_pixels(GlTexture* to, void* data);
+  void read_pixels(GlTexture* from, const Rectangle& region, void* to);
+  void put_pixels(GlTexture* to, const Rectangle& region, void* data);
 
   void restart_batch();
   void set_shader(GlShader* shader);
@@ -92,8 +100,11 @@ private:
   Fbo* get_fbo(int width, int height, bool screen = false);
 
   void shader_about_to_change(GlShader* shader);
+  void update_stats();
 
   static GlRenderer* instance;
+  static bool atlas_enabled;
+  static bool stats_report_enabled;
   SDL_GLContext sdl_gl_context;
   GlShader* current_shader = nullptr;
   const GlTexture* current_texture = nullptr;
@@ -113,11 +124,23 @@ private:
   size_t buffer_size = 0;
 
   std::vector<Vertex> vertex_buffer;
+  std::vector<uint32_t> transfer_buffer;  /**< Pixels of partial rows read or uploaded. */
 
   Fbo screen_fbo = {0,glm::mat4(1.f)};
   std::unordered_map<uint_fast64_t,Fbo> fbos;
   Rectangle window_viewport;
 
+  SurfaceImplPtr atlas_page;                      /**< Atlas texture where new images go. */
+  std::unique_ptr<SkylinePacker> atlas_packer;    /**< Free space of the atlas texture. */
+
+  int num_draw_calls = 0;           /**< Batches drawn during the current frame. */
+  int num_batch_breaks = 0;         /**< Batches ended by a state change during the current frame. */
+  int report_num_frames = 0;        /**< Frames since the last stats report. */
+  int report_num_draw_calls = 0;    /**< Batches drawn since the last stats report. */
+  int report_num_batch_breaks = 0;  /**< State changes since the last stats report. */
+  int report_max_draw_calls = 0;    /**< Most batches drawn in a frame since the last stats report. */
+  uint32_t last_report_time = 0;    /**< Time of the last stats report. */
+
   bool is_es_context;
 };
 }
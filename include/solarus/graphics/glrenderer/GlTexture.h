@@ -19,9 +19,11 @@ class GlTexture : public SurfaceImpl
 public:
   GlTexture(int width, int height, bool screen_tex = false);
   GlTexture(SDL_Surface_UniquePtr surface);
+  GlTexture(SDL_Surface_UniquePtr surface, const SurfaceImplPtr& atlas_page, const Point& atlas_position);
 
   GLuint get_texture() const;
   SDL_Surface* get_surface() const override;
+  SDL_Surface* get_surface(const Rectangle& region) const override;
 
   GlTexture& targetable();
 
@@ -35,15 +37,22 @@ public:
    * to upload it to the texture for changes to be reflected
    */
   void upload_surface() override;
+  void upload_surface(const Rectangle& region) override;
+
+  bool is_in_atlas() const;
+  void detach_from_atlas() const;
 private:
   bool target = false;
   void release() const;
-  void set_texture_params();
+  void set_texture_params() const;
+  void add_dirty_region(const Rectangle& region);
   glm::mat3 uv_transform;
-  mutable bool surface_dirty = true;
-  GLuint tex_id = 0;
+  mutable Rectangle dirty_region;  /**< Region drawn on the GPU and not read back yet. */
+  mutable GLuint tex_id = 0;
   GlRenderer::Fbo* fbo = nullptr;
   mutable SDL_Surface_UniquePtr surface = nullptr;
+  mutable SurfaceImplPtr atlas_page = nullptr; /**< Atlas texture holding the pixels, if any. */
+  Point atlas_position;                        /**< Position of the pixels in the atlas. */
 };
 
 }
@@ -36,6 +36,7 @@ public:
    * to upload it to the texture for changes to be reflected
    */
   void upload_surface() override;
+  void upload_surface(const Rectangle& region) override;
 private:
   bool target = false;
   mutable bool surface_dirty = true;
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SOLARUS_COMPILED_LUA_DATA_H
+#define SOLARUS_COMPILED_LUA_DATA_H
+
+#include "solarus/core/Common.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct lua_State;
+
+namespace Solarus {
+
+/**
+ * \brief Binary form of a Lua data file.
+ *
+ * Data files like maps, tilesets and sprites are Lua chunks made of calls
+ * like <tt>tile{ layer = 0, x = 16, ... }</tt>.
+ * Compiling a data file runs it once and records these calls and their
+ * arguments in a string table and flat arrays.
+ * Loading the compiled form replays the calls with the Lua C API, so the
+ * usual LuaData::import_from_lua() code reads them without parsing or
+ * interpreting Lua.
+ *
+ * The compiled file stores a hash of the source. It is only used while it
+ * matches, so a stale compiled file is ignored.
+ *
+ * Data files are expected to only make such calls: other Lua code is
+ * evaluated at compilation time and only its calls are kept.
+ */
+class SOLARUS_API CompiledLuaData {
+
+  public:
+
+    static constexpr uint32_t format_version = 1;   /**< Version of the binary format. */
+
+    CompiledLuaData();
+
+    bool compile(const std::string& source, const std::string& file_name);
+    bool import_from_buffer(const std::string& buffer, const std::string& file_name);
+    bool import_from_buffer(const char* buffer, size_t size, const std::string& file_name);
+    bool export_to_buffer(std::string& buffer) const;
+
+    uint64_t get_source_hash() const;
+    int get_num_calls() const;
+    void push_chunk(lua_State* l) const;
+
+    static std::string get_compiled_file_name(const std::string& file_name);
+    static uint64_t compute_source_hash(const std::string& source);
+    static uint64_t compute_source_hash(const char* source, size_t size);
+    static bool is_up_to_date(const std::string& buffer, const std::string& source);
+    static bool is_up_to_date(const char* buffer, size_t size, uint64_t source_hash);
+
+  private:
+
+    /**
+     * \brief A function call of the data file.
+     */
+    struct Call {
+      uint32_t name;        /**< Index of the function name in the string table. */
+      uint32_t first_arg;   /**< Index of the first argument in args. */
+      uint32_t num_args;    /**< Number of arguments. */
+    };
+
+    /**
+     * \brief A table argument.
+     */
+    struct Table {
+      uint32_t first_field; /**< Index of the first key in fields. */
+      uint32_t num_fields;  /**< Number of key-value pairs. */
+    };
+
+    bool record_call(lua_State* l);
+    uint32_t add_value(lua_State* l, int index, int depth);
+    uint32_t add_string(const std::string& value);
+    void push_value(lua_State* l, uint32_t value) const;
+    bool check_value(uint32_t value, uint32_t max_table) const;
+
+    static int l_record_call(lua_State* l);
+    static int l_get_recorder(lua_State* l);
+    static int l_replay(lua_State* l);
+
+    uint64_t source_hash;               /**< Hash of the source data file. */
+    std::vector<std::string> strings;   /**< String table. */
+    std::vector<double> numbers;        /**< Number values. */
+    std::vector<Table> tables;          /**< Table values, children before parents. */
+    std::vector<uint32_t> fields;       /**< Keys and values of tables, by pairs. */
+    std::vector<Call> calls;            /**< Calls in execution order. */
+    std::vector<uint32_t> args;         /**< Arguments of calls. */
+
+    std::unordered_map<std::string, uint32_t>
+        string_indexes;                 /**< Index of each string, while compiling. */
+    std::unordered_map<uint64_t, uint32_t>
+        number_indexes;                 /**< Index of each number by bits, while compiling. */
+
+};
+
+}
+
+#endif
+
@@ -18,6 +18,7 @@
 #define SOLARUS_EXPORTABLE_TO_LUA_H
 
 #include "solarus/core/Common.h"
+#include <bitset>
 #include <memory>
 #include <string>
 
@@ -25,6 +26,27 @@ namespace Solarus {
 
 class LuaContext;
 
+/**
+ * \brief Engine callbacks called so often that their presence on each
+ * userdata is cached.
+ */
+enum class LuaEvent {
+  ON_UPDATE,
+  ON_DRAW,
+  ON_PRE_DRAW,
+  ON_POST_DRAW,
+  ON_POSITION_CHANGED,
+  ON_MOVEMENT_CHANGED,
+  ON_FRAME_CHANGED,
+  ON_MOVING,
+  NB_EVENTS           /**< Number of cached events. */
+};
+
+/**
+ * \brief A set of cached events, indexed by LuaEvent.
+ */
+using LuaEventSet = std::bitset<static_cast<size_t>(LuaEvent::NB_EVENTS)>;
+
 /**
  * \brief Interface of a C++ type that can also exist as a Lua userdata.
  *
@@ -45,6 +67,9 @@ class ExportableToLua:
     void set_known_to_lua(bool known_to_lua);
     bool is_with_lua_table() const;
     void set_with_lua_table(bool with_lua_table);
+    bool has_lua_event(LuaEvent event) const;
+    void set_lua_event(LuaEvent event, bool defined);
+    void clear_lua_events();
     virtual const std::string& get_lua_type_name() const;
 
   private:
@@ -56,6 +81,8 @@ class ExportableToLua:
                                   * at least once. */
     bool with_lua_table;         /**< Whether a Lua table was created to make
                                   * this userdata indexable like a table. */
+    LuaEventSet lua_events;      /**< Cached events defined as fields of the
+                                  * userdata table. */
 
 };
 
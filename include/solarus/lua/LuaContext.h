@@ -34,10 +34,12 @@
 #include "solarus/graphics/ShaderPtr.h"
 #include "solarus/graphics/SpritePtr.h"
 #include "solarus/graphics/SurfacePtr.h"
+#include "solarus/lua/ExportableToLua.h"
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/ScopedLuaRef.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
@@ -250,6 +252,12 @@ class LuaContext {
         const ExportableToLua& userdata,
         const std::string& key
     ) const;
+    bool userdata_has_event(
+        const ExportableToLua& userdata,
+        LuaEvent event
+    );
+    static const char* get_lua_event_name(LuaEvent event);
+    static bool get_lua_event_by_name(const char* name, LuaEvent& event);
     void notify_userdata_destroyed(ExportableToLua& userdata);
     void userdata_close_lua();
 
@@ -266,6 +274,7 @@ class LuaContext {
     void notify_timers_map_suspended(bool suspended);
     void set_entity_timers_suspended_as_map(Entity& entity, bool suspended);
     void do_timer_callback(const TimerPtr& timer);
+    void schedule_timer(const TimerPtr& timer);
 
     // Menus.
     void add_menu(
@@ -813,6 +822,8 @@ class LuaContext {
       path_finding_movement_api_get_speed,
       path_finding_movement_api_set_speed,
       path_finding_movement_api_get_angle,
+      path_finding_movement_api_get_max_nodes,
+      path_finding_movement_api_set_max_nodes,
       circle_movement_api_get_center,
       circle_movement_api_set_center,
       circle_movement_api_get_radius,
@@ -1291,6 +1302,9 @@ class LuaContext {
       userdata_meta_newindex_as_table,
       userdata_meta_index_as_table,
 
+      // available to the metatables of all userdata types
+      metatable_meta_newindex,
+
       // Lua backtrace error function
       l_backtrace;
 
@@ -1318,6 +1332,25 @@ class LuaContext {
     struct LuaTimerData {
       ScopedLuaRef callback_ref;  /**< Lua ref of the function to call after the timer. */
       ScopedLuaRef context;       /**< Lua table or userdata the timer is attached to. */
+      bool scheduled = false;     /**< Whether the timer has a valid entry in the timer queue. */
+      uint32_t scheduled_date = 0;  /**< Date of this entry in the timer queue. */
+      uint64_t creation_order = 0;  /**< Order of creation among timers. */
+    };
+
+    /**
+     * \brief Entry of the timer queue.
+     *
+     * Entries are not removed when their timer changes:
+     * they are ignored when their date no longer matches the timer data.
+     */
+    struct TimerQueueEntry {
+      uint32_t date;              /**< Date when the timer needs to be updated. */
+      uint64_t order;             /**< Creation order of the timer, to keep it between equal dates. */
+      TimerPtr timer;             /**< The timer. */
+
+      bool operator>(const TimerQueueEntry& other) const {
+        return date > other.date || (date == other.date && order > other.order);
+      }
     };
 
     // Executing Lua code.
@@ -1326,6 +1359,7 @@ class LuaContext {
     bool find_method(int index, const char* function_name);
     bool find_method(const char* function_name);
     void print_lua_version();
+    void update_callback_stats();
 
     // Initialization of modules.
     void register_functions(
@@ -1615,6 +1649,8 @@ private:
     static FunctionExportedToLua
       l_panic,
       l_loader,
+      l_setmetatable,
+      l_getmetatable,
       l_get_map_entity_or_global,
       l_easy_index,
       l_hero_teleport,
@@ -1661,6 +1697,11 @@ private:
                                         * their context and callback. */
     std::list<TimerPtr>
         timers_to_remove;              /**< Timers to be removed at the next cycle. */
+    std::vector<TimerQueueEntry>
+        timer_queue;                   /**< Min-heap of the dates when running
+                                        * timers need to be updated. Suspended
+                                        * timers are not in it. */
+    uint64_t timer_creation_order;     /**< Creation order of the next timer. */
 
     std::set<DrawablePtr>
         drawables;                     /**< All drawable objects created by
@@ -1673,6 +1714,15 @@ private:
                                         * userdata with our __newindex. This is
                                         * only for performance, to avoid Lua
                                         * lookups for callbacks like on_update. */
+    LuaEventSet metatable_events;      /**< Cached events that were defined in
+                                        * the metatable of at least one type.
+                                        * Removing them does not clear them. */
+    bool callback_stats_enabled;       /**< Whether to log the number of
+                                        * skipped callbacks every second. */
+    int num_callbacks_skipped;         /**< Callbacks skipped since the last
+                                        * stats report. */
+    int report_num_frames;             /**< Frames since the last stats report. */
+    uint32_t last_report_time;         /**< Date of the last stats report. */
     std::set<std::string>
         warning_deprecated_functions;  /**< Names of deprecated functions of
                                         * the API for which a warning was emitted. */
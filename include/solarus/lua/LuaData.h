@@ -18,6 +18,7 @@
 #define SOLARUS_LUA_DATA_FILE_H
 
 #include "solarus/core/Common.h"
+#include <cstddef>
 #include <iosfwd>
 #include <string>
 
@@ -25,6 +26,8 @@ struct lua_State;
 
 namespace Solarus {
 
+class CompiledLuaData;
+
 /**
  * \brief Abstract class for data the can be loaded and optionally saved as Lua.
  */
@@ -39,11 +42,24 @@ class SOLARUS_API LuaData {
     virtual bool export_to_lua(std::ostream& out) const;  // Optional.
 
     bool import_from_buffer(const std::string& buffer, const std::string& file_name);
+    bool import_from_buffer(const char* buffer, size_t size, const std::string& file_name);
     bool import_from_file(const std::string& file_name);
     bool import_from_quest_file(
         const std::string& quest_file_name,
         bool language_specific = false
     );
+    bool import_from_quest_buffer(
+        const std::string& buffer,
+        const std::string& quest_file_name,
+        bool language_specific = false
+    );
+    bool import_from_quest_buffer(
+        const char* buffer,
+        size_t size,
+        const std::string& quest_file_name,
+        bool language_specific = false
+    );
+    bool import_from_compiled(const CompiledLuaData& compiled);
 
     bool export_to_buffer(std::string& buffer) const;
     bool export_to_file(const std::string& file_name) const;
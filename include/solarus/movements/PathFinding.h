@@ -19,14 +19,15 @@
 
 #include "solarus/core/Common.h"
 #include "solarus/core/Point.h"
-#include <list>
-#include <map>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 namespace Solarus {
 
 class Map;
 class Entity;
+class NavigationGrid;
 class Rectangle;
 
 /**
@@ -35,6 +36,18 @@ class Rectangle;
  * In the current implementation, the computed path always corresponds to a
  * shape of 16*16. If the entity to move is bigger, some obstacles may prevent
  * it from following the computed path.
+ *
+ * The open list is an indexed binary heap and nodes are stored in a dense
+ * array with one element per 8*8 square of the map. This array is shared by
+ * all path computations and is never cleared: each node is stamped with the
+ * search that last touched it.
+ * The search gives up when more than a given number of nodes were explored.
+ *
+ * Obstacles are taken from the navigation grid of the map when it knows them,
+ * which avoids most collision tests.
+ * Results are also remembered for a short time by the navigation grid,
+ * so that entities with the same traversal rules going from the same square
+ * to the same target square do not repeat the search.
  */
 class SOLARUS_API PathFinding {
 
@@ -45,9 +58,14 @@ class SOLARUS_API PathFinding {
         Entity& source_entity,
         Entity& target_entity);
 
+    int get_max_nodes() const;
+    void set_max_nodes(int max_nodes);
+
     std::string compute_path();
     std::string compute_path(const Point& offset);
 
+    static constexpr int default_max_nodes = 1250;  /**< Default number of nodes explored at most. */
+
   private:
 
     /**
@@ -55,29 +73,48 @@ class SOLARUS_API PathFinding {
      *
      * A node is the location of a 16*16 square of the map.
      * The algorithm tries to find the best sequence of nodes leading to the target.
+     * The location of a node is given by its index in the node array.
      */
-    class Node {
+    struct Node {
 
-     public:
-
-      Point location;     /**< location of this node on the map */
-      int index;          /**< index of this node's square on the map (depends on the location) */
+      uint32_t generation;  /**< search that last touched this node (other fields are garbage otherwise) */
+      uint32_t sequence;    /**< order of the last insertion or improvement in the open list */
 
       // total_cost = previous_cost + heuristic
-      int previous_cost;  /**< cost of the best path that leads to this node */
-      int heuristic;      /**< estimation of the remaining cost to the target */
-      int total_cost;     /**< total cost of this node */
+      int previous_cost;    /**< cost of the best path that leads to this node */
+      int heuristic;        /**< estimation of the remaining cost to the target */
+      int total_cost;       /**< total cost of this node */
 
-      int parent_index;   /**< index of the square containing the best node leading to this node */
-      char direction;     /**< direction from the parent node to this node (0 to 7) */
+      int parent_index;     /**< index of the square containing the best node leading to this node */
+      int heap_position;    /**< position in the open list heap, or -1 if the node is in the closed list */
+      char direction;       /**< direction from the parent node to this node (0 to 7) */
+    };
 
-      bool operator<(const Node& other) const;
+    /**
+     * \brief Nodes and open list reused by all path computations.
+     */
+    struct NodePool {
+
+      std::vector<Node> nodes;      /**< one node per 8*8 square of the current map */
+      std::vector<int> open_heap;   /**< binary heap of the indices of open nodes */
+      uint32_t generation = 0;      /**< stamp of the current search */
+      uint32_t sequence = 0;        /**< counter of open list insertions during the current search */
     };
 
+    static NodePool& get_node_pool();
+
+    std::string search_path(const Point& source, const Point& target);
+
     int get_square_index(const Point& location) const;
-    bool is_node_transition_valid(const Node& node, int direction) const;
-    void add_index_sorted(Node* node);
-    std::string rebuild_path(const Node* final_node);
+    Point get_square_location(int index) const;
+    bool is_node_transition_valid(const Point& location, int direction) const;
+    std::string rebuild_path(int final_index) const;
+
+    bool is_better(int first_index, int second_index) const;
+    void open_list_push(int index);
+    int open_list_pop();
+    void open_list_sift_up(int position);
+    void open_list_sift_down(int position);
 
     static const Point neighbours_locations[];
     static const Rectangle transition_collision_boxes[];
@@ -85,10 +122,10 @@ class SOLARUS_API PathFinding {
     Map& map;                          /**< the map */
     Entity& source_entity;             /**< the entity to move */
     Entity& target_entity;             /**< the target point */
-
-    std::map<int, Node> closed_list;   /**< the closed list, indexed by the node locations on the map */
-    std::map<int, Node> open_list;     /**< the open list, indexed by the node locations on the map */
-    std::list<int> open_list_indices;  /**< indices of the open list elements, sorted by priority */
+    int max_nodes;                     /**< nodes explored at most before giving up */
+    NodePool& pool;                    /**< the shared node storage */
+    NavigationGrid& grid;              /**< known grounds and entities of the map */
+    uint32_t ground_obstacles;         /**< grounds that are obstacles for the source entity */
 
 };
 
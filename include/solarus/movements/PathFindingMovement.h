@@ -40,6 +40,8 @@ class SOLARUS_API PathFindingMovement: public PathMovement {
     explicit PathFindingMovement(int speed);
 
     void set_target(const EntityPtr& target);
+    int get_max_nodes() const;
+    void set_max_nodes(int max_nodes);
     virtual bool is_finished() const override;
 
     virtual const std::string& get_lua_type_name() const override;
@@ -53,6 +55,7 @@ class SOLARUS_API PathFindingMovement: public PathMovement {
 
     EntityPtr target;               /**< the entity targeted by this movement (usually the hero) */
     uint32_t next_recomputation_date;
+    int max_nodes;                  /**< nodes explored at most by the path finding algorithm */
 
 };
 
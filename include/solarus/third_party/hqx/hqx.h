@@ -47,6 +47,15 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * src, uint32_t src_rowBytes, uin
 HQX_API void HQX_CALLCONV hq3x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
 HQX_API void HQX_CALLCONV hq4x_32_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height );
 
+/* Filter rows first_row to last_row - 1 only, for example to split the work between threads. */
+HQX_API void HQX_CALLCONV hq2x_32_rows( uint32_t * src, uint32_t * dest, int width, int height, int first_row, int last_row );
+HQX_API void HQX_CALLCONV hq3x_32_rows( uint32_t * src, uint32_t * dest, int width, int height, int first_row, int last_row );
+HQX_API void HQX_CALLCONV hq4x_32_rows( uint32_t * src, uint32_t * dest, int width, int height, int first_row, int last_row );
+
+HQX_API void HQX_CALLCONV hq2x_32_rows_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height, int first_row, int last_row );
+HQX_API void HQX_CALLCONV hq3x_32_rows_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height, int first_row, int last_row );
+HQX_API void HQX_CALLCONV hq4x_32_rows_rb( uint32_t * src, uint32_t src_rowBytes, uint32_t * dest, uint32_t dest_rowBytes, int width, int height, int first_row, int last_row );
+
 #endif
 
 #ifdef __cplusplus
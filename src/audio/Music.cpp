@@ -19,21 +19,29 @@
 #include "solarus/audio/OggDecoder.h"
 #include "solarus/audio/SpcDecoder.h"
 #include "solarus/core/Debug.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/String.h"
 #include "solarus/lua/LuaContext.h"
 #include <lua.hpp>
 #include <algorithm>
+#include <chrono>
 #include <sstream>
 
 namespace Solarus {
 
 constexpr int Music::nb_buffers;
+constexpr int Music::buffer_size;
 std::unique_ptr<SpcDecoder> Music::spc_decoder = nullptr;
 std::unique_ptr<ItDecoder> Music::it_decoder = nullptr;
 std::unique_ptr<OggDecoder> Music::ogg_decoder = nullptr;
 float Music::volume = 1.0;
 std::unique_ptr<Music> Music::current_music = nullptr;
+std::thread Music::stream_thread;
+std::mutex Music::decoder_mutex;
+std::condition_variable Music::stream_condition;
+bool Music::stream_stopping = false;
+Music* Music::streaming_music = nullptr;
 
 const std::string Music::none = "none";
 const std::string Music::unchanged = "same";
@@ -56,7 +64,14 @@ Music::Music():
   format(NO_FORMAT),
   loop(false),
   callback_ref(),
-  source(AL_NONE) {
+  source(AL_NONE),
+  free_buffers(),
+  al_format(AL_FORMAT_STEREO16),
+  sample_rate(44100),
+  decoded_samples(nb_buffers * buffer_size * 2),
+  end_of_stream(false),
+  chunk(),
+  chunk_position(0) {
 
   for (int i = 0; i < nb_buffers; i++) {
     buffers[i] = AL_NONE;
@@ -79,7 +94,14 @@ Music::Music(
   format(OGG),
   loop(loop),
   callback_ref(callback_ref),
-  source(AL_NONE) {
+  source(AL_NONE),
+  free_buffers(),
+  al_format(AL_FORMAT_STEREO16),
+  sample_rate(44100),
+  decoded_samples(nb_buffers * buffer_size * 2),
+  end_of_stream(false),
+  chunk(),
+  chunk_position(0) {
 
   Debug::check_assertion(!loop || callback_ref.is_empty(),
       "Attempt to set both a loop and a callback to music"
@@ -90,6 +112,17 @@ Music::Music(
   }
 }
 
+/**
+ * \brief Destroys a music.
+ */
+Music::~Music() {
+
+  std::lock_guard<std::mutex> lock(decoder_mutex);
+  if (streaming_music == this) {
+    streaming_music = nullptr;
+  }
+}
+
 /**
  * \brief Initializes the music system.
  */
@@ -100,6 +133,9 @@ void Music::initialize() {
   it_decoder = std::unique_ptr<ItDecoder>(new ItDecoder());
   ogg_decoder = std::unique_ptr<OggDecoder>(new OggDecoder());
 
+  stream_stopping = false;
+  stream_thread = std::thread(&Music::run_stream_thread);
+
   set_volume(100);
 }
 
@@ -109,6 +145,13 @@ void Music::initialize() {
 void Music::quit() {
 
   if (is_initialized()) {
+    {
+      std::lock_guard<std::mutex> lock(decoder_mutex);
+      stream_stopping = true;
+    }
+    stream_condition.notify_all();
+    stream_thread.join();
+
     current_music = nullptr;
     spc_decoder = nullptr;
     it_decoder = nullptr;
@@ -172,6 +215,7 @@ int Music::get_num_channels() {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   return it_decoder->get_num_channels();
 }
 
@@ -188,6 +232,7 @@ int Music::get_channel_volume(int channel) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   return it_decoder->get_channel_volume(channel);
 }
 
@@ -204,6 +249,7 @@ void Music::set_channel_volume(int channel, int volume) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   it_decoder->set_channel_volume(channel, volume);
 }
 
@@ -219,6 +265,7 @@ int Music::get_tempo() {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   return it_decoder->get_tempo();
 }
 
@@ -234,6 +281,7 @@ void Music::set_tempo(int tempo) {
   Debug::check_assertion(get_format() == IT,
       "This function is only supported for .it musics");
 
+  std::lock_guard<std::mutex> lock(decoder_mutex);
   it_decoder->set_tempo(tempo);
 }
 
@@ -362,6 +410,8 @@ void Music::stop_playing() {
  */
 void Music::update() {
 
+  SOLARUS_PROFILE_ZONE("Music::update");
+
   if (!is_initialized()) {
     return;
   }
@@ -379,117 +429,185 @@ void Music::update() {
 }
 
 /**
- * \brief Updates this music when it is playing.
- *
- * This function handles the double buffering.
+ * \brief Main function of the streaming thread.
  *
- * \return \c true if the music keeps playing, \c false if the end is reached.
+ * Decodes the current music ahead of time while there is room
+ * in its ring buffer.
  */
-bool Music::update_playing() {
+void Music::run_stream_thread() {
+
+  std::unique_lock<std::mutex> lock(decoder_mutex);
+  while (!stream_stopping) {
+    if (streaming_music != nullptr && streaming_music->stream_samples()) {
+      // Let the main thread access decoders between chunks.
+      lock.unlock();
+      std::this_thread::yield();
+      lock.lock();
+      continue;
+    }
+    stream_condition.wait_for(lock, std::chrono::milliseconds(50));
+  }
+}
 
-  // Get the empty buffers.
-  ALint nb_empty;
-  alGetSourcei(source, AL_BUFFERS_PROCESSED, &nb_empty);
+/**
+ * \brief Decodes a chunk of this music if needed and pushes it to the
+ * ring buffer.
+ *
+ * This function is called from the streaming thread, with the decoder
+ * mutex locked.
+ *
+ * \return \c true if samples were pushed, \c false if there is nothing to
+ * do until the main thread consumes samples.
+ */
+bool Music::stream_samples() {
 
-  // Refill them.
-  for (int i = 0; i < nb_empty; i++) {
-    ALuint buffer;
-    alSourceUnqueueBuffers(source, 1, &buffer);  // Unqueue the buffer.
+  if (chunk_position == chunk.size()) {
+    // Decode a new chunk if there is room for it.
+    if (end_of_stream || decoded_samples.get_num_free_samples() < buffer_size) {
+      return false;
+    }
 
-    // Fill it by decoding more data.
+    chunk.resize(buffer_size);
+    int nb_decoded = 0;
     switch (format) {
 
       case SPC:
-        decode_spc(buffer, 16384);
+        nb_decoded = decode_spc(chunk.data(), buffer_size);
         break;
 
       case IT:
-        decode_it(buffer, 16384);
+        nb_decoded = decode_it(chunk.data(), buffer_size);
         break;
 
       case OGG:
-        decode_ogg(buffer, 16384);
+        nb_decoded = decode_ogg(chunk.data(), buffer_size);
         break;
 
       case NO_FORMAT:
-        Debug::die("Invalid music format");
         break;
     }
+    chunk.resize(nb_decoded);
+    chunk_position = 0;
 
-    alSourceQueueBuffers(source, 1, &buffer);  // Queue it again.
+    if (nb_decoded == 0) {
+      end_of_stream = true;
+      return false;
+    }
+  }
+
+  const size_t nb_pushed = decoded_samples.push(
+      chunk.data() + chunk_position, chunk.size() - chunk_position);
+  chunk_position += nb_pushed;
+  return nb_pushed > 0;
+}
+
+/**
+ * \brief Updates this music when it is playing.
+ *
+ * Queues samples decoded by the streaming thread into the OpenAL buffers
+ * already played.
+ *
+ * \return \c true if the music keeps playing, \c false if the end is reached.
+ */
+bool Music::update_playing() {
+
+  // Get the empty buffers.
+  ALint nb_empty;
+  alGetSourcei(source, AL_BUFFERS_PROCESSED, &nb_empty);
+  for (int i = 0; i < nb_empty; i++) {
+    ALuint buffer;
+    alSourceUnqueueBuffers(source, 1, &buffer);
+    free_buffers.push_back(buffer);
+  }
+
+  // Refill them with decoded data.
+  bool consumed = false;
+  if (!free_buffers.empty()) {
+    std::vector<ALshort> data(buffer_size);
+    while (!free_buffers.empty()) {
+      // Read the end flag first: samples pushed before it are visible.
+      const bool finished = end_of_stream;
+      if (!finished && decoded_samples.get_num_samples() < static_cast<size_t>(buffer_size)) {
+        // Wait for a full buffer.
+        break;
+      }
+      const size_t nb_samples = decoded_samples.pop(data.data(), buffer_size);
+      if (nb_samples == 0) {
+        break;
+      }
+
+      const ALuint buffer = free_buffers.back();
+      free_buffers.pop_back();
+      alBufferData(buffer, al_format, data.data(), ALsizei(nb_samples * sizeof(ALshort)), sample_rate);
+      int error = alGetError();
+      if (error != AL_NO_ERROR) {
+        std::ostringstream oss;
+        oss << "Failed to fill the audio buffer with decoded data for music file '"
+            << file_name << "': error " << error;
+        Debug::error(oss.str());
+      }
+      alSourceQueueBuffers(source, 1, &buffer);
+      consumed = true;
+    }
+  }
+
+  if (consumed) {
+    stream_condition.notify_one();
   }
 
   // Check whether there is still something playing.
   ALint status;
   alGetSourcei(source, AL_SOURCE_STATE, &status);
   if (status != AL_PLAYING) {
-    // The end of the file is reached, or we need to decode more data.
-    alSourcePlay(source);
+    ALint nb_queued;
+    alGetSourcei(source, AL_BUFFERS_QUEUED, &nb_queued);
+    if (nb_queued > 0) {
+      // Starting, or the streaming thread could not keep up.
+      alSourcePlay(source);
+    }
+    else if (end_of_stream && decoded_samples.get_num_samples() == 0) {
+      // The end of the file is reached.
+      return false;
+    }
   }
 
-  alGetSourcei(source, AL_SOURCE_STATE, &status);
-  return status == AL_PLAYING;
+  return true;
 }
 
 /**
  * \brief Decodes a chunk of SPC data into PCM data for the current music.
- * \param destination_buffer the destination buffer to write
- * \param nb_samples number of samples to write
+ * \param decoded_data Where to write the decoded data.
+ * \param nb_samples Number of 16-bit values to write.
+ * \return The number of 16-bit values written.
  */
-void Music::decode_spc(ALuint destination_buffer, ALsizei nb_samples) {
-
-  // decode the SPC data
-  std::vector<ALushort> raw_data(nb_samples);
-  spc_decoder->decode((int16_t*) raw_data.data(), nb_samples);
-
-  // put this decoded data into the buffer
-  alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), nb_samples * 2, 32000);
+int Music::decode_spc(ALshort* decoded_data, int nb_samples) {
 
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded SPC data for music file '"
-      << file_name << ": error " << error;
-    Debug::error(oss.str());
-  }
+  spc_decoder->decode((int16_t*) decoded_data, nb_samples);
+  return nb_samples;
 }
 
 /**
  * \brief Decodes a chunk of IT data into PCM data for the current music.
- * \param destination_buffer the destination buffer to write
- * \param nb_samples number of samples to write
+ * \param decoded_data Where to write the decoded data.
+ * \param nb_samples Maximum number of 16-bit values to write.
+ * \return The number of 16-bit values written, 0 at the end of the music.
  */
-void Music::decode_it(ALuint destination_buffer, ALsizei nb_samples) {
-
-  // Decode the IT data.
-  std::vector<ALushort> raw_data(nb_samples);
-  int bytes_read = it_decoder->decode(raw_data.data(), nb_samples);
+int Music::decode_it(ALshort* decoded_data, int nb_samples) {
 
-  if (bytes_read == 0) {
-    // End of file.
-    alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), 0, 44100);
-  }
-  else {
-    // Put this decoded data into the buffer.
-    alBufferData(destination_buffer, AL_FORMAT_STEREO16, raw_data.data(), nb_samples, 44100);
-  }
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded IT data for music file '"
-        << file_name << ": error " << error;
-    Debug::error(oss.str());
-  }
+  const int bytes_read = it_decoder->decode(decoded_data, nb_samples * sizeof(ALshort));
+  return bytes_read / sizeof(ALshort);
 }
 
 /**
  * \brief Decodes a chunk of OGG data into PCM data for the current music.
- * \param destination_buffer The destination buffer to write.
- * \param nb_samples Number of samples to write.
+ * \param decoded_data Where to write the decoded data.
+ * \param nb_samples Maximum number of 16-bit values to write.
+ * \return The number of 16-bit values written, 0 at the end of the music.
  */
-void Music::decode_ogg(ALuint destination_buffer, ALsizei nb_samples) {
+int Music::decode_ogg(ALshort* decoded_data, int nb_samples) {
 
-  ogg_decoder->decode(destination_buffer, nb_samples);
+  const int num_channels = std::max(1, ogg_decoder->get_num_channels());
+  return ogg_decoder->decode(decoded_data, nb_samples / num_channels);
 }
 
 /**
@@ -523,73 +641,63 @@ bool Music::start() {
   alGenBuffers(nb_buffers, buffers);
   alGenSources(1, &source);
   alSourcef(source, AL_GAIN, volume);
+  free_buffers.assign(buffers, buffers + nb_buffers);
 
   // load the music into memory
-  std::string sound_buffer;
-  switch (format) {
-
-    case SPC:
-
-      sound_buffer = QuestFiles::data_file_read(file_name);
-
-      // Give the SPC data into the SPC decoder.
-      spc_decoder->load((int16_t*) sound_buffer.data(), sound_buffer.size());
-
-      for (int i = 0; i < nb_buffers; i++) {
-        decode_spc(buffers[i], 16384);
-      }
-      break;
-
-    case IT:
-
-      sound_buffer = QuestFiles::data_file_read(file_name);
-
-      // Give the IT data to the IT decoder
-      it_decoder->load(sound_buffer);
-
-      for (int i = 0; i < nb_buffers; i++) {
-        decode_it(buffers[i], 16384);
-      }
-      break;
+  std::string sound_buffer = QuestFiles::data_file_read(file_name);
+  {
+    std::lock_guard<std::mutex> lock(decoder_mutex);
+    switch (format) {
 
-    case OGG:
+      case SPC:
+        // Give the SPC data into the SPC decoder.
+        spc_decoder->load((int16_t*) sound_buffer.data(), sound_buffer.size());
+        al_format = AL_FORMAT_STEREO16;
+        sample_rate = 32000;
+        break;
 
-      sound_buffer = QuestFiles::data_file_read(file_name);
+      case IT:
+        // Give the IT data to the IT decoder
+        it_decoder->load(sound_buffer);
+        al_format = AL_FORMAT_STEREO16;
+        sample_rate = 44100;
+        break;
 
-      // Give the OGG data to the OGG decoder.
-      success = ogg_decoder->load(std::move(sound_buffer), this->loop);
-      if (success) {
-        for (int i = 0; i < nb_buffers; i++) {
-          decode_ogg(buffers[i], 16384);
+      case OGG:
+        // Give the OGG data to the OGG decoder.
+        success = ogg_decoder->load(std::move(sound_buffer), this->loop);
+        if (success) {
+          al_format = ogg_decoder->get_num_channels() == 1 ?
+              AL_FORMAT_MONO16 : AL_FORMAT_STEREO16;
+          sample_rate = ogg_decoder->get_sample_rate();
         }
-      }
-      break;
+        break;
+
+      case NO_FORMAT:
+        Debug::die("Invalid music format");
+        break;
+    }
 
-    case NO_FORMAT:
-      Debug::die("Invalid music format");
-      break;
+    if (success) {
+      // The streaming thread will take care of decoding.
+      decoded_samples.clear();
+      end_of_stream = false;
+      chunk.clear();
+      chunk_position = 0;
+      streaming_music = this;
+    }
   }
 
   if (!success) {
     Debug::error("Cannot load music file '" + file_name + "'");
+    return false;
   }
 
-  // start the streaming
-  alSourceQueueBuffers(source, nb_buffers, buffers);
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Cannot initialize buffers for music '"
-        << file_name << "': error " << error;
-    Debug::error(oss.str());
-    success = false;
-  }
-
-  alSourcePlay(source);
+  stream_condition.notify_one();
 
   // The update() function will then take care of filling the buffers
 
-  return success;
+  return true;
 }
 
 /**
@@ -606,6 +714,32 @@ void Music::stop() {
   // Release the callback if any.
   callback_ref.clear();
 
+  // Stop decoding.
+  {
+    std::lock_guard<std::mutex> lock(decoder_mutex);
+    if (streaming_music == this) {
+      streaming_music = nullptr;
+    }
+
+    switch (format) {
+
+      case SPC:
+        break;
+
+      case IT:
+        it_decoder->unload();
+        break;
+
+      case OGG:
+        ogg_decoder->unload();
+        break;
+
+      case NO_FORMAT:
+        Debug::die("Invalid music format");
+        break;
+    }
+  }
+
   // empty the source
   alSourceStop(source);
 
@@ -622,24 +756,7 @@ void Music::stop() {
 
   // delete the buffers
   alDeleteBuffers(nb_buffers, buffers);
-
-  switch (format) {
-
-    case SPC:
-      break;
-
-    case IT:
-      it_decoder->unload();
-      break;
-
-    case OGG:
-      ogg_decoder->unload();
-      break;
-
-    case NO_FORMAT:
-      Debug::die("Invalid music format");
-      break;
-  }
+  free_buffers.clear();
 }
 
 /**
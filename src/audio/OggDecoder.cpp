@@ -47,7 +47,7 @@ bool OggDecoder::load(std::string&& ogg_data, bool loop) {
 
   ogg_mem.position = 0;
   ogg_mem.loop = loop;
-  ogg_mem.data = ogg_data;
+  ogg_mem.data = DataFileBuffer::create(std::move(ogg_data));
   // Now, ogg_mem contains the encoded data.
 
   int error = ov_open_callbacks(&ogg_mem, ogg_file.get(), nullptr, 0, Sound::ogg_callbacks);
@@ -103,39 +103,54 @@ bool OggDecoder::load(std::string&& ogg_data, bool loop) {
  */
 void OggDecoder::unload() {
   ogg_file = nullptr;
-  ogg_mem.data.clear();
+  ogg_mem.data = nullptr;
   ogg_info = nullptr;
   loop_start_pcm = -1;
   loop_end_pcm = -1;
 }
 
 /**
- * \brief Decodes a chunk of the previously loaded OGG data into PCM data
- * and plays it.
- * \param decoded_data Pointer to where you want the decoded data to be written.
- * \param nb_samples Number of samples to write.
+ * \brief Returns the number of channels of the loaded OGG data.
+ * \return The number of channels, or 0 if nothing is loaded.
  */
-void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
+int OggDecoder::get_num_channels() const {
 
   if (ogg_info == nullptr) {
-    return;
+    return 0;
   }
+  return ogg_info->channels;
+}
 
-  // Read the encoded music properties.
-  const int num_channels = ogg_info->channels;
-  ALsizei sample_rate = ALsizei(ogg_info->rate);
-  ALenum al_format = AL_NONE;
-  if (num_channels == 1) {
-    al_format = AL_FORMAT_MONO16;
+/**
+ * \brief Returns the sample rate of the loaded OGG data.
+ * \return The sample rate in Hz, or 0 if nothing is loaded.
+ */
+int OggDecoder::get_sample_rate() const {
+
+  if (ogg_info == nullptr) {
+    return 0;
   }
-  else if (num_channels == 2) {
-    al_format = AL_FORMAT_STEREO16;
+  return static_cast<int>(ogg_info->rate);
+}
+
+/**
+ * \brief Decodes a chunk of the previously loaded OGG data into PCM data.
+ * \param decoded_data Where to write the decoded data. It must have room for
+ * \c nb_samples samples of each channel.
+ * \param nb_samples Number of samples to write for each channel.
+ * \return The number of 16-bit values written, 0 at the end of the data.
+ */
+int OggDecoder::decode(ALshort* decoded_data, ALsizei nb_samples) {
+
+  if (ogg_info == nullptr) {
+    return 0;
   }
 
+  // Read the encoded music properties.
+  const int num_channels = ogg_info->channels;
   const ogg_int64_t loop_end_byte = loop_end_pcm * num_channels * sizeof(ALshort);
 
   // Decode the OGG data.
-  std::vector<ALshort> raw_data(nb_samples * num_channels);
   int bitstream = 0;
   long bytes_read = 0;
   long total_bytes_read = 0;
@@ -154,7 +169,7 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
 
     bytes_read = ov_read(
         ogg_file.get(),
-        ((char*) raw_data.data()) + total_bytes_read,
+        ((char*) decoded_data) + total_bytes_read,
         max_bytes_to_read,
         0,
         2,
@@ -167,7 +182,7 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
         std::ostringstream oss;
         oss << "Error while decoding ogg chunk: " << bytes_read;
         Debug::error(oss.str());
-        return;
+        break;
       }
     }
     else {
@@ -191,15 +206,7 @@ void OggDecoder::decode(ALuint destination_buffer, ALsizei nb_samples) {
   }
   while (remaining_bytes > 0 && bytes_read > 0);
 
-  // Put this decoded data into the buffer.
-  alBufferData(destination_buffer, al_format, raw_data.data(), ALsizei(total_bytes_read), sample_rate);
-
-  int error = alGetError();
-  if (error != AL_NO_ERROR) {
-    std::ostringstream oss;
-    oss << "Failed to fill the audio buffer with decoded OGG data: error " << error;
-    Debug::error(oss.str());
-  }
+  return static_cast<int>(total_bytes_read / sizeof(ALshort));
 }
 
 }
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/PcmRingBuffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty ring buffer.
+ * \param capacity Minimum number of samples it can hold.
+ * It is rounded up to a power of two.
+ */
+PcmRingBuffer::PcmRingBuffer(size_t capacity):
+  samples(),
+  mask(0),
+  read_index(0),
+  write_index(0) {
+
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  samples.resize(size);
+  mask = size - 1;
+}
+
+/**
+ * \brief Returns the number of samples the buffer can hold.
+ * \return The capacity.
+ */
+size_t PcmRingBuffer::get_capacity() const {
+  return samples.size();
+}
+
+/**
+ * \brief Returns the number of samples that can be popped.
+ *
+ * Exact when called from the consumer, a lower bound otherwise.
+ *
+ * \return The number of samples in the buffer.
+ */
+size_t PcmRingBuffer::get_num_samples() const {
+  return write_index.load(std::memory_order_acquire) -
+      read_index.load(std::memory_order_acquire);
+}
+
+/**
+ * \brief Returns the number of samples that can be pushed.
+ *
+ * Exact when called from the producer, a lower bound otherwise.
+ *
+ * \return The free space in the buffer.
+ */
+size_t PcmRingBuffer::get_num_free_samples() const {
+  return get_capacity() - get_num_samples();
+}
+
+/**
+ * \brief Appends samples to the buffer.
+ *
+ * Only the producer thread can call this function.
+ *
+ * \param samples The samples to push.
+ * \param num_samples Number of samples to push.
+ * \return The number of samples actually pushed, less than requested
+ * if the buffer is full.
+ */
+size_t PcmRingBuffer::push(const int16_t* samples, size_t num_samples) {
+
+  const size_t write = write_index.load(std::memory_order_relaxed);
+  const size_t read = read_index.load(std::memory_order_acquire);
+  const size_t count = std::min(num_samples, get_capacity() - (write - read));
+
+  // Copy in at most two parts because of the wrap-around.
+  const size_t start = write & mask;
+  const size_t first_part = std::min(count, get_capacity() - start);
+  std::memcpy(&this->samples[start], samples, first_part * sizeof(int16_t));
+  std::memcpy(&this->samples[0], samples + first_part, (count - first_part) * sizeof(int16_t));
+
+  write_index.store(write + count, std::memory_order_release);
+  return count;
+}
+
+/**
+ * \brief Removes samples from the buffer.
+ *
+ * Only the consumer thread can call this function.
+ *
+ * \param samples Where to write the samples popped.
+ * \param num_samples Maximum number of samples to pop.
+ * \return The number of samples actually popped, less than requested
+ * if the buffer does not contain enough samples.
+ */
+size_t PcmRingBuffer::pop(int16_t* samples, size_t num_samples) {
+
+  const size_t read = read_index.load(std::memory_order_relaxed);
+  const size_t write = write_index.load(std::memory_order_acquire);
+  const size_t count = std::min(num_samples, write - read);
+
+  const size_t start = read & mask;
+  const size_t first_part = std::min(count, get_capacity() - start);
+  std::memcpy(samples, &this->samples[start], first_part * sizeof(int16_t));
+  std::memcpy(samples + first_part, &this->samples[0], (count - first_part) * sizeof(int16_t));
+
+  read_index.store(read + count, std::memory_order_release);
+  return count;
+}
+
+/**
+ * \brief Removes all samples.
+ *
+ * Neither the producer nor the consumer may be using the buffer.
+ */
+void PcmRingBuffer::clear() {
+
+  read_index.store(0);
+  write_index.store(0);
+}
+
+}
+
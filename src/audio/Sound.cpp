@@ -15,12 +15,14 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include <algorithm>
+#include <atomic>
 #include <cstring>  // memcpy
 #include <sstream>
+#include <thread>
 #include "solarus/core/Arguments.h"
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
-#include "solarus/core/PerfCounter.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/String.h"
 #include "solarus/audio/Music.h"
@@ -33,9 +35,12 @@ ALCdevice* Sound::device = nullptr;
 ALCcontext* Sound::context = nullptr;
 bool Sound::initialized = false;
 bool Sound::sounds_preloaded = false;
+bool Sound::pcm_cache_enabled = false;
 float Sound::volume = 1.0;
-bool Sound::pc_play = false;
-std::list<Sound*> Sound::current_sounds;
+constexpr int Sound::max_voices;
+constexpr int Sound::max_voices_per_sound;
+std::vector<Sound::Voice> Sound::voices;
+uint64_t Sound::next_start_order = 0;
 std::map<std::string, Sound> Sound::all_sounds;
 
 namespace {
@@ -55,7 +60,7 @@ size_t cb_read(void* ptr, size_t /* size */, size_t nb_bytes, void* datasource)
 
   Sound::SoundFromMemory* mem = static_cast<Sound::SoundFromMemory*>(datasource);
 
-  const size_t total_size = mem->data.size();
+  const size_t total_size = mem->data->size();
   if (mem->position >= total_size) {
     if (mem->loop) {
       mem->position = 0;
@@ -68,7 +73,7 @@ size_t cb_read(void* ptr, size_t /* size */, size_t nb_bytes, void* datasource)
     nb_bytes = total_size - mem->position;
   }
 
-  std::memcpy(ptr, mem->data.data() + mem->position, nb_bytes);
+  std::memcpy(ptr, mem->data->data() + mem->position, nb_bytes);
   mem->position += nb_bytes;
 
   return nb_bytes;
@@ -99,12 +104,12 @@ int cb_seek(void* datasource, ogg_int64_t offset, int whence) {
     break;
 
   case SEEK_END:
-    mem->position = mem->data.size() - offset;
+    mem->position = mem->data->size() - offset;
     break;
   }
 
-  if (mem->position >= mem->data.size()) {
-    mem->position = mem->data.size();
+  if (mem->position >= mem->data->size()) {
+    mem->position = mem->data->size();
   }
 
   return 0;
@@ -124,6 +129,144 @@ long cb_tell(void* datasource) {
   return mem->position;
 }
 
+/**
+ * \brief File of the quest write directory where load_all() keeps
+ * decoded sounds.
+ */
+const std::string pcm_cache_file_name = "sounds.pcm";
+
+/**
+ * \brief Header of the PCM cache file.
+ */
+const std::string pcm_cache_magic = "SOLARUS PCM CACHE";
+
+/**
+ * \brief Version of the PCM cache file format.
+ *
+ * Increment it when the format or the decoding changes.
+ */
+constexpr uint32_t pcm_cache_version = 1;
+
+/**
+ * \brief A decoded sound in the PCM cache file.
+ */
+struct CachedSound {
+  int64_t file_size;           /**< Size of the encoded file when it was decoded. */
+  int64_t modification_time;   /**< Modification time of the encoded file when it was decoded. */
+  uint32_t sample_rate;        /**< Sample rate in Hz. */
+  const char* samples;         /**< 16-bit stereo samples. */
+  uint32_t num_bytes;          /**< Size of the samples in bytes. */
+};
+
+/**
+ * \brief Reads a value from the PCM cache file.
+ * \param buffer Content of the file.
+ * \param position Current position, incremented by the size of the value.
+ * \param value The value read.
+ * \return \c false if the end of the file is reached.
+ */
+template<typename T>
+bool read_cache_value(const std::string& buffer, size_t& position, T& value) {
+
+  if (buffer.size() - position < sizeof(T)) {
+    return false;
+  }
+  std::memcpy(&value, buffer.data() + position, sizeof(T));
+  position += sizeof(T);
+  return true;
+}
+
+/**
+ * \brief Appends a value to the PCM cache file.
+ * \param buffer Content of the file.
+ * \param value The value to write.
+ */
+template<typename T>
+void write_cache_value(std::string& buffer, const T& value) {
+
+  buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/**
+ * \brief Parses the PCM cache file.
+ *
+ * The file is made for the machine that wrote it and is not portable.
+ * Samples are not copied: they point to the buffer.
+ *
+ * \param buffer Content of the file.
+ * \param sounds The sounds found, by sound id.
+ * \return \c false if the file is invalid or has another version.
+ */
+bool parse_pcm_cache(const std::string& buffer, std::map<std::string, CachedSound>& sounds) {
+
+  if (buffer.compare(0, pcm_cache_magic.size(), pcm_cache_magic) != 0) {
+    return false;
+  }
+  size_t position = pcm_cache_magic.size();
+
+  uint32_t version = 0;
+  uint32_t num_sounds = 0;
+  if (!read_cache_value(buffer, position, version) ||
+      version != pcm_cache_version ||
+      !read_cache_value(buffer, position, num_sounds)) {
+    return false;
+  }
+
+  for (uint32_t i = 0; i < num_sounds; ++i) {
+    uint32_t id_size = 0;
+    if (!read_cache_value(buffer, position, id_size) ||
+        buffer.size() - position < id_size) {
+      return false;
+    }
+    const std::string sound_id = buffer.substr(position, id_size);
+    position += id_size;
+
+    CachedSound sound;
+    if (!read_cache_value(buffer, position, sound.file_size) ||
+        !read_cache_value(buffer, position, sound.modification_time) ||
+        !read_cache_value(buffer, position, sound.sample_rate) ||
+        !read_cache_value(buffer, position, sound.num_bytes) ||
+        buffer.size() - position < sound.num_bytes) {
+      return false;
+    }
+    sound.samples = buffer.data() + position;
+    position += sound.num_bytes;
+    sounds[sound_id] = sound;
+  }
+  return true;
+}
+
+/**
+ * \brief Creates the content of the PCM cache file.
+ * \param sounds The sounds to store, by sound id.
+ * \return Content of the file.
+ */
+std::string make_pcm_cache(const std::map<std::string, CachedSound>& sounds) {
+
+  size_t size = pcm_cache_magic.size() + 2 * sizeof(uint32_t);
+  for (const auto& kvp : sounds) {
+    size += sizeof(uint32_t) + kvp.first.size() + sizeof(CachedSound) + kvp.second.num_bytes;
+  }
+
+  std::string buffer;
+  buffer.reserve(size);
+  buffer.append(pcm_cache_magic);
+  write_cache_value(buffer, pcm_cache_version);
+  write_cache_value(buffer, static_cast<uint32_t>(sounds.size()));
+  for (const auto& kvp : sounds) {
+    const std::string& sound_id = kvp.first;
+    const CachedSound& sound = kvp.second;
+    write_cache_value(buffer, static_cast<uint32_t>(sound_id.size()));
+    buffer.append(sound_id);
+    write_cache_value(buffer, sound.file_size);
+    write_cache_value(buffer, sound.modification_time);
+    write_cache_value(buffer, sound.sample_rate);
+    write_cache_value(buffer, sound.num_bytes);
+    buffer.append(sound.samples, sound.num_bytes);
+  }
+  return buffer;
+}
+
 }  // Anonymous namespace.
 
 ov_callbacks Sound::ogg_callbacks = {
@@ -160,13 +303,12 @@ Sound::~Sound() {
   if (is_initialized() && buffer != AL_NONE) {
 
     // stop the sources where this buffer is attached
-    for (ALuint source: sources) {
-      alSourceStop(source);
-      alSourcei(source, AL_BUFFER, 0);
-      alDeleteSources(1, &source);
+    for (Voice& voice : voices) {
+      if (voice.sound == this) {
+        release_voice(voice);
+      }
     }
     alDeleteBuffers(1, &buffer);
-    current_sounds.remove(this);
   }
 }
 
@@ -176,8 +318,6 @@ Sound::~Sound() {
  * This method should be called when the application starts.
  * If the argument -no-audio is provided, this function has no effect and
  * there will be no sound.
- * If the argument -perf-sound-play is provided and is "yes", sound
- * playing will be accounted using a performance counter.
  *
  * \param args Command-line arguments.
  */
@@ -190,10 +330,6 @@ void Sound::initialize(const Arguments& args) {
     return;
   }
 
-  // Check the -perf-sound-play option.
-  pc_play = args.get_argument_value("-perf-sound-play") == "yes";
-  printf("perf sound play: %d\n", pc_play);
-
   // Initialize OpenAL.
 
   printf("alOpendevice\n");
@@ -221,9 +357,40 @@ void Sound::initialize(const Arguments& args) {
   printf("alGenBuffers\n");
   alGenBuffers(0, nullptr);  // Necessary on some systems to avoid errors with the first sound loaded.
 
+  // Forget errors of the calls above.
+  alGetError();
+
+  // Keep a source for the music: some implementations have no more
+  // sources than the sound pool.
+  ALuint music_source = AL_NONE;
+  alGenSources(1, &music_source);
+  const bool music_source_reserved = alGetError() == AL_NO_ERROR;
+
+  // Create all sources for sounds now.
+  voices.clear();
+  for (int i = 0; i < max_voices; ++i) {
+    ALuint source;
+    alGenSources(1, &source);
+    if (alGetError() != AL_NO_ERROR) {
+      // The device supports less sources.
+      break;
+    }
+    voices.push_back({ source, nullptr, 0 });
+  }
+  if (voices.empty()) {
+    Debug::error("Cannot create audio sources for sounds");
+  }
+
+  if (music_source_reserved) {
+    alDeleteSources(1, &music_source);
+  }
+
   initialized = true;
   set_volume(100);
 
+  // Check the -sound-cache option.
+  pcm_cache_enabled = args.get_argument_value("-sound-cache") == "yes";
+
   // initialize the music system
   printf("music::init\n");
   Music::initialize();
@@ -243,6 +410,10 @@ void Sound::quit() {
 
     // clear the sounds
     all_sounds.clear();
+    for (Voice& voice : voices) {
+      alDeleteSources(1, &voice.source);
+    }
+    voices.clear();
 
     // uninitialize OpenAL
 
@@ -267,22 +438,90 @@ bool Sound::is_initialized() {
 
 /**
  * \brief Loads and decodes all sounds listed in the game database.
+ *
+ * Sounds are decoded in parallel.
+ * If the PCM cache is enabled, sounds decoded by a previous run are
+ * reused when their file did not change, and newly decoded sounds are
+ * saved for next runs.
  */
 void Sound::load_all() {
 
-  if (is_initialized() && !sounds_preloaded) {
+  if (!is_initialized() || sounds_preloaded) {
+    return;
+  }
 
-    const std::map<std::string, std::string>& sound_elements =
-        CurrentQuest::get_resources(ResourceType::SOUND);
-    for (const auto& kvp: sound_elements) {
-      const std::string& sound_id = kvp.first;
+  const std::map<std::string, std::string>& sound_elements =
+      CurrentQuest::get_resources(ResourceType::SOUND);
+
+  // Read sounds decoded by a previous run.
+  std::string cache_buffer;
+  std::map<std::string, CachedSound> cached_sounds;
+  if (pcm_cache_enabled && QuestFiles::data_file_exists(pcm_cache_file_name)) {
+    cache_buffer = QuestFiles::data_file_read(pcm_cache_file_name);
+    if (!parse_pcm_cache(cache_buffer, cached_sounds)) {
+      Debug::warning("Ignoring invalid sound cache file '" + pcm_cache_file_name + "'");
+      cached_sounds.clear();
+    }
+  }
 
-      all_sounds[sound_id] = Sound(sound_id);
-      all_sounds[sound_id].load();
+  // Create the sounds that are still valid in the cache.
+  std::map<std::string, CachedSound> sounds_to_cache;
+  std::vector<std::string> sound_ids_to_decode;
+  std::vector<std::string> file_names_to_decode;
+  for (const auto& kvp: sound_elements) {
+    const std::string& sound_id = kvp.first;
+    Sound& sound = all_sounds[sound_id];
+    sound = Sound(sound_id);
+
+    const std::string& file_name = get_file_name(sound_id);
+    CachedSound file_info = CachedSound();
+    file_info.modification_time = -1;
+    if (pcm_cache_enabled) {
+      QuestFiles::data_file_get_info(file_name, file_info.file_size, file_info.modification_time);
     }
 
-    sounds_preloaded = true;
+    const auto it = cached_sounds.find(sound_id);
+    if (it != cached_sounds.end() &&
+        file_info.modification_time != -1 &&
+        it->second.file_size == file_info.file_size &&
+        it->second.modification_time == file_info.modification_time) {
+      const CachedSound& cached_sound = it->second;
+      sound.buffer = sound.create_buffer(
+          cached_sound.samples, cached_sound.num_bytes, cached_sound.sample_rate);
+      sounds_to_cache[sound_id] = cached_sound;
+    }
+    else {
+      sound_ids_to_decode.push_back(sound_id);
+      file_names_to_decode.push_back(file_name);
+      sounds_to_cache[sound_id] = file_info;
+    }
   }
+
+  // Decode the other ones.
+  std::vector<PcmData> pcms;
+  decode_files(file_names_to_decode, pcms);
+  for (size_t i = 0; i < sound_ids_to_decode.size(); ++i) {
+    const std::string& sound_id = sound_ids_to_decode[i];
+    const PcmData& pcm = pcms[i];
+    if (pcm.sample_rate == 0) {
+      // Decoding failed.
+      sounds_to_cache.erase(sound_id);
+      continue;
+    }
+    all_sounds[sound_id].buffer = all_sounds[sound_id].create_buffer(
+        pcm.samples.data(), pcm.samples.size(), pcm.sample_rate);
+    CachedSound& cached_sound = sounds_to_cache[sound_id];
+    cached_sound.sample_rate = pcm.sample_rate;
+    cached_sound.samples = pcm.samples.data();
+    cached_sound.num_bytes = pcm.samples.size();
+  }
+
+  // Save them for next runs.
+  if (pcm_cache_enabled && !sound_ids_to_decode.empty()) {
+    QuestFiles::data_file_save(pcm_cache_file_name, make_pcm_cache(sounds_to_cache));
+  }
+
+  sounds_preloaded = true;
 }
 
 /**
@@ -302,9 +541,8 @@ bool Sound::exists(const std::string& sound_id) {
  * \param sound_id id of the sound to play
  */
 void Sound::play(const std::string& sound_id) {
-  if (pc_play) {
-    PerfCounter::update("sound-play");
-  }
+
+  SOLARUS_PROFILE_ZONE("Sound::play");
 
   if (all_sounds.find(sound_id) == all_sounds.end()) {
     all_sounds[sound_id] = Sound(sound_id);
@@ -339,16 +577,19 @@ void Sound::set_volume(int volume) {
  */
 void Sound::update() {
 
-  // update the playing sounds
-  std::list<Sound*> sounds_to_remove;
-  for (Sound* sound: current_sounds) {
-    if (!sound->update_playing()) {
-      sounds_to_remove.push_back(sound);
-    }
-  }
+  SOLARUS_PROFILE_ZONE("Sound::update");
 
-  for (Sound* sound: sounds_to_remove) {
-    current_sounds.remove(sound);
+  // Release the voices of sounds that are finished.
+  for (Voice& voice : voices) {
+    if (voice.sound == nullptr) {
+      continue;
+    }
+    ALint status;
+    alGetSourcei(voice.source, AL_SOURCE_STATE, &status);
+    if (status != AL_PLAYING) {
+      alSourcei(voice.source, AL_BUFFER, 0);
+      voice.sound = nullptr;
+    }
   }
 
   // also update the music
@@ -356,27 +597,85 @@ void Sound::update() {
 }
 
 /**
- * \brief Updates this sound when it is playing.
- * \return true if the sound is still playing, false if it is finished.
+ * \brief Finds a voice to play a sound.
+ *
+ * If the sound already plays on too many voices, its oldest one is reused.
+ * Otherwise, a free voice is taken, or the oldest voice if none is free.
+ *
+ * \param sound The sound to play.
+ * \return A voice now reserved for the sound, or nullptr if there are no voices.
  */
-bool Sound::update_playing() {
+Sound::Voice* Sound::acquire_voice(Sound& sound) {
+
+  Voice* free_voice = nullptr;
+  Voice* oldest_voice = nullptr;
+  Voice* oldest_voice_of_sound = nullptr;
+  int num_voices_of_sound = 0;
+  for (Voice& voice : voices) {
+    if (voice.sound == nullptr) {
+      if (free_voice == nullptr) {
+        free_voice = &voice;
+      }
+      continue;
+    }
+    if (oldest_voice == nullptr || voice.start_order < oldest_voice->start_order) {
+      oldest_voice = &voice;
+    }
+    if (voice.sound == &sound) {
+      ++num_voices_of_sound;
+      if (oldest_voice_of_sound == nullptr ||
+          voice.start_order < oldest_voice_of_sound->start_order) {
+        oldest_voice_of_sound = &voice;
+      }
+    }
+  }
 
-  // See if this sound is still playing.
-  if (sources.empty()) {
-    return false;
+  Voice* voice = nullptr;
+  if (num_voices_of_sound >= max_voices_per_sound) {
+    voice = oldest_voice_of_sound;
+  }
+  else if (free_voice != nullptr) {
+    voice = free_voice;
+  }
+  else {
+    voice = oldest_voice;
   }
 
-  ALuint source = *sources.begin();
-  ALint status;
-  alGetSourcei(source, AL_SOURCE_STATE, &status);
+  if (voice == nullptr) {
+    return nullptr;
+  }
 
-  if (status != AL_PLAYING) {
-    sources.pop_front();
-    alSourcei(source, AL_BUFFER, 0);
-    alDeleteSources(1, &source);
+  if (voice->sound != nullptr) {
+    release_voice(*voice);
   }
+  voice->sound = &sound;
+  voice->start_order = next_start_order++;
+  return voice;
+}
 
-  return !sources.empty();
+/**
+ * \brief Stops the sound playing on a voice and makes it free.
+ * \param voice The voice to release.
+ */
+void Sound::release_voice(Voice& voice) {
+
+  alSourceStop(voice.source);
+  alSourcei(voice.source, AL_BUFFER, 0);
+  voice.sound = nullptr;
+}
+
+/**
+ * \brief Returns the name of the file of a sound.
+ * \param sound_id Id of a sound.
+ * \return The sound file name, relative to the quest data directory.
+ */
+std::string Sound::get_file_name(const std::string& sound_id) {
+
+  std::string file_name = std::string("sounds/" + sound_id);
+  if (sound_id.find(".") == std::string::npos) {
+    file_name += ".ogg";
+  }
+  return file_name;
 }
 
 /**
@@ -388,13 +687,11 @@ void Sound::load() {
     Debug::error("Previous audio error not cleaned");
   }
 
-  std::string file_name = std::string("sounds/" + id);
-  if (id.find(".") == std::string::npos) {
-    file_name += ".ogg";
-  }
-
   // Create an OpenAL buffer with the sound decoded by the library.
-  buffer = decode_file(file_name);
+  PcmData pcm;
+  if (decode_file(get_file_name(id), pcm)) {
+    buffer = create_buffer(pcm.samples.data(), pcm.samples.size(), pcm.sample_rate);
+  }
 
   // buffer is now AL_NONE if there was an error.
 }
@@ -415,9 +712,12 @@ bool Sound::start() {
 
     if (buffer != AL_NONE) {
 
-      // create a source
-      ALuint source;
-      alGenSources(1, &source);
+      // take a source from the pool
+      Voice* voice = acquire_voice(*this);
+      if (voice == nullptr) {
+        return false;
+      }
+      const ALuint source = voice->source;
       alSourcei(source, AL_BUFFER, buffer);
       alSourcef(source, AL_GAIN, volume);
 
@@ -428,12 +728,9 @@ bool Sound::start() {
         oss << "Cannot attach buffer " << buffer
             << " to the source to play sound '" << id << "': error " << error;
         Debug::error(oss.str());
-        alDeleteSources(1, &source);
+        release_voice(*voice);
       }
       else {
-        sources.push_back(source);
-        current_sounds.remove(this); // to avoid duplicates
-        current_sounds.push_back(this);
         alSourcePlay(source);
         error = alGetError();
         if (error != AL_NO_ERROR) {
@@ -451,24 +748,29 @@ bool Sound::start() {
 }
 
 /**
- * \brief Loads the specified sound file and decodes its content into an OpenAL buffer.
- * \param file_name name of the file to open
- * \return the buffer created, or AL_NONE if the sound could not be loaded
+ * \brief Loads the specified sound file and decodes its content.
+ *
+ * This function does not use OpenAL and can be called from any thread.
+ *
+ * \param[in] file_name name of the file to open
+ * \param[out] pcm The decoded sound.
+ * \return \c true in case of success.
  */
-ALuint Sound::decode_file(const std::string& file_name) {
+bool Sound::decode_file(const std::string& file_name, PcmData& pcm) {
 
-  ALuint buffer = AL_NONE;
+  pcm.sample_rate = 0;
+  pcm.samples.clear();
 
   if (!QuestFiles::data_file_exists(file_name)) {
     Debug::error(std::string("Cannot find sound file '") + file_name + "'");
-    return AL_NONE;
+    return false;
   }
 
   // load the sound file
   SoundFromMemory mem;
   mem.loop = false;
   mem.position = 0;
-  mem.data = QuestFiles::data_file_read(file_name);
+  mem.data = QuestFiles::data_file_read_buffer(file_name);
 
   OggVorbis_File file;
   int error = ov_open_callbacks(&mem, &file, nullptr, 0, ogg_callbacks);
@@ -478,87 +780,125 @@ ALuint Sound::decode_file(const std::string& file_name) {
     oss << "Cannot load sound file '" << file_name
         << "' from memory: error " << error;
     Debug::error(oss.str());
+    return false;
   }
-  else {
 
-    // read the encoded sound properties
-    vorbis_info* info = ov_info(&file, -1);
-    ALsizei sample_rate = ALsizei(info->rate);
+  // read the encoded sound properties
+  vorbis_info* info = ov_info(&file, -1);
+  const ALsizei sample_rate = ALsizei(info->rate);
+  const int num_channels = info->channels;
 
-    ALenum format = AL_NONE;
-    if (info->channels == 1) {
-      format = AL_FORMAT_MONO16;
-    }
-    else if (info->channels == 2) {
-      format = AL_FORMAT_STEREO16;
-    }
+  if (num_channels != 1 && num_channels != 2) {
+    Debug::error(std::string("Invalid audio format for sound file '")
+        + file_name + "'");
+    ov_clear(&file);
+    return false;
+  }
+
+  // Allocate the decoded data at once.
+  const ogg_int64_t num_samples = ov_pcm_total(&file, -1);
+  if (num_samples > 0) {
+    pcm.samples.reserve(static_cast<size_t>(num_samples) * 2 * sizeof(ALshort));
+  }
 
-    if (format == AL_NONE) {
-      Debug::error(std::string("Invalid audio format for sound file '")
-          + file_name + "'");
+  // decode the sound with vorbisfile
+  int bitstream;
+  long bytes_read;
+  const int buffer_size = 16384;
+  char samples_buffer[buffer_size];
+  do {
+    bytes_read = ov_read(&file, samples_buffer, buffer_size, 0, 2, 1, &bitstream);
+    if (bytes_read < 0) {
+      std::ostringstream oss;
+      oss << "Error while decoding ogg chunk in sound file '"
+          << file_name << "': " << bytes_read;
+      Debug::error(oss.str());
+    }
+    else if (num_channels == 2) {
+      pcm.samples.insert(pcm.samples.end(), samples_buffer, samples_buffer + bytes_read);
     }
     else {
-      // decode the sound with vorbisfile
-      std::vector<char> samples;
-      int bitstream;
-      long bytes_read;
-      long total_bytes_read = 0;
-      const int buffer_size = 16384;
-      char samples_buffer[buffer_size];
-      do {
-        bytes_read = ov_read(&file, samples_buffer, buffer_size, 0, 2, 1, &bitstream);
-        if (bytes_read < 0) {
-          std::ostringstream oss;
-          oss << "Error while decoding ogg chunk in sound file '"
-              << file_name << "': " << bytes_read;
-          Debug::error(oss.str());
-        }
-        else {
-          total_bytes_read += bytes_read;
-          if (format == AL_FORMAT_STEREO16) {
-            samples.insert(samples.end(), samples_buffer, samples_buffer + bytes_read);
-          }
-          else {
-            // mono sound files make no sound on some machines
-            // workaround: convert them on-the-fly into stereo sounds
-            // TODO find a better solution
-            for (int i = 0; i < bytes_read; i += 2) {
-              samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
-              samples.insert(samples.end(), samples_buffer + i, samples_buffer + i + 2);
-            }
-            total_bytes_read += bytes_read;
-          }
-        }
+      // mono sound files make no sound on some machines
+      // workaround: convert them on-the-fly into stereo sounds
+      // TODO find a better solution
+      for (int i = 0; i < bytes_read; i += 2) {
+        pcm.samples.insert(pcm.samples.end(), samples_buffer + i, samples_buffer + i + 2);
+        pcm.samples.insert(pcm.samples.end(), samples_buffer + i, samples_buffer + i + 2);
       }
-      while (bytes_read > 0);
+    }
+  }
+  while (bytes_read > 0);
 
-      // copy the samples into an OpenAL buffer
-      alGenBuffers(1, &buffer);
-      if (alGetError() != AL_NO_ERROR) {
-          Debug::error("Failed to generate audio buffer");
-      }
-      alBufferData(buffer,
-          AL_FORMAT_STEREO16,
-          reinterpret_cast<ALshort*>(samples.data()),
-          ALsizei(total_bytes_read),
-          sample_rate);
-      ALenum error = alGetError();
-      if (error != AL_NO_ERROR) {
-        std::ostringstream oss;
-        oss << "Cannot copy the sound samples of '"
-            << file_name << "' into buffer " << buffer
-            << ": error " << error;
-        Debug::error(oss.str());
-        buffer = AL_NONE;
-      }
+  ov_clear(&file);
+
+  pcm.sample_rate = sample_rate;
+  return true;
+}
+
+/**
+ * \brief Decodes sound files in parallel.
+ *
+ * The calling thread takes part in the work.
+ *
+ * \param[in] file_names Names of the files to decode.
+ * \param[out] pcms The decoded sounds, in the same order.
+ * Sounds that could not be decoded have a sample rate of zero.
+ */
+void Sound::decode_files(
+    const std::vector<std::string>& file_names,
+    std::vector<PcmData>& pcms) {
+
+  pcms.clear();
+  pcms.resize(file_names.size());
+
+  std::atomic<size_t> next_index(0);
+  const auto decode_next_files = [&file_names, &pcms, &next_index]() {
+    for (size_t i = next_index++; i < file_names.size(); i = next_index++) {
+      decode_file(file_names[i], pcms[i]);
     }
-    ov_clear(&file);
+  };
+
+  const size_t num_cores = std::max(1u, std::thread::hardware_concurrency());
+  const size_t num_threads = std::min(num_cores, file_names.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(decode_next_files);
+  }
+  decode_next_files();
+  for (std::thread& thread : threads) {
+    thread.join();
   }
+}
 
-  mem.data.clear();
+/**
+ * \brief Copies decoded samples of this sound into a new OpenAL buffer.
+ * \param samples 16-bit stereo samples.
+ * \param num_bytes Size of the samples in bytes.
+ * \param sample_rate Sample rate in Hz.
+ * \return The buffer created, or AL_NONE in case of error.
+ */
+ALuint Sound::create_buffer(const char* samples, size_t num_bytes, ALsizei sample_rate) {
 
+  ALuint buffer = AL_NONE;
+  alGenBuffers(1, &buffer);
+  if (alGetError() != AL_NO_ERROR) {
+      Debug::error("Failed to generate audio buffer");
+  }
+  alBufferData(buffer,
+      AL_FORMAT_STEREO16,
+      reinterpret_cast<const ALshort*>(samples),
+      ALsizei(num_bytes),
+      sample_rate);
+  ALenum error = alGetError();
+  if (error != AL_NO_ERROR) {
+    std::ostringstream oss;
+    oss << "Cannot copy the sound samples of '"
+        << get_file_name(id) << "' into buffer " << buffer
+        << ": error " << error;
+    Debug::error(oss.str());
+    buffer = AL_NONE;
+  }
   return buffer;
 }
 
 }
-
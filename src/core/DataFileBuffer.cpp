@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/DataFileBuffer.h"
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Data file buffer that owns its content as a string.
+ */
+class StringDataFileBuffer : public DataFileBuffer {
+
+  public:
+
+    explicit StringDataFileBuffer(std::string&& content):
+      content(std::move(content)) {
+      set_content(this->content.data(), this->content.size());
+    }
+
+  private:
+
+    const std::string content;    /**< The content. */
+
+};
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates an empty buffer.
+ *
+ * Subclasses set the actual content with set_content().
+ */
+DataFileBuffer::DataFileBuffer():
+  content_data(""),
+  content_size(0) {
+}
+
+/**
+ * \brief Destructor.
+ */
+DataFileBuffer::~DataFileBuffer() {
+}
+
+/**
+ * \brief Creates a buffer that takes ownership of a string.
+ * \param content The content. It is moved, not copied.
+ * \return The buffer.
+ */
+DataFileBufferPtr DataFileBuffer::create(std::string&& content) {
+  return std::make_shared<StringDataFileBuffer>(std::move(content));
+}
+
+/**
+ * \brief Sets the memory area of the content.
+ * \param data First byte of the content.
+ * It must remain valid as long as this object exists.
+ * \param size Size of the content in bytes.
+ */
+void DataFileBuffer::set_content(const char* data, size_t size) {
+  content_data = data;
+  content_size = size;
+}
+
+/**
+ * \brief Returns the content of the file.
+ * \return The first byte of the content.
+ * The content is not null-terminated.
+ */
+const char* DataFileBuffer::data() const {
+  return content_data;
+}
+
+/**
+ * \brief Returns the size of the file.
+ * \return The size in bytes.
+ */
+size_t DataFileBuffer::size() const {
+  return content_size;
+}
+
+/**
+ * \brief Returns whether the file is empty.
+ * \return \c true if the size is zero.
+ */
+bool DataFileBuffer::empty() const {
+  return content_size == 0;
+}
+
+/**
+ * \brief Returns a copy of the content as a string.
+ * \return The content.
+ */
+std::string DataFileBuffer::to_string() const {
+  return std::string(content_data, content_size);
+}
+
+}
+
@@ -22,6 +22,7 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/MainLoop.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/core/Treasure.h"
 #include "solarus/entities/Destination.h"
@@ -356,6 +357,8 @@ void Game::notify_command_released(GameCommand command) {
  */
 void Game::update() {
 
+  SOLARUS_PROFILE_ZONE("Game::update");
+
   // Update the transitions between maps.
   update_transitions();
 
@@ -592,6 +595,8 @@ void Game::update_commands_effects() {
  */
 void Game::draw(const SurfacePtr& dst_surface) {
 
+  SOLARUS_PROFILE_ZONE("Game::draw");
+
   if (current_map == nullptr) {
     // Nothing to do. The game is not fully initialized yet.
     return;
@@ -21,12 +21,16 @@
 #include "solarus/core/Game.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/MainLoop.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
 #include "solarus/core/Savegame.h"
 #include "solarus/core/Settings.h"
 #include "solarus/core/String.h"
 #include "solarus/core/System.h"
+#include "solarus/entities/CollisionBroadPhase.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/graphics/PixelBitsCache.h"
 #include "solarus/entities/TilePattern.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/Surface.h"
@@ -228,6 +232,18 @@ MainLoop::MainLoop(const Arguments& args):
     Logger::info("Turbo mode: no");
   }
 
+  const std::string& collision_broad_phase_arg = args.get_argument_value("-collision-broad-phase");
+  CollisionBroadPhase::set_enabled(collision_broad_phase_arg == "yes");
+  if (CollisionBroadPhase::is_enabled()) {
+    Logger::info("Collision broad phase: yes");
+  }
+
+  const std::string& simulation_stats_arg = args.get_argument_value("-simulation-stats");
+  Entities::set_stats_report_enabled(simulation_stats_arg == "yes");
+
+  const std::string& preload_pixel_collisions_arg = args.get_argument_value("-preload-pixel-collisions");
+  PixelBitsCache::set_preloading_enabled(preload_pixel_collisions_arg == "yes");
+
   // Start loading resources in background.
   resource_provider.start_preloading_resources();
 
@@ -267,6 +283,7 @@ MainLoop::~MainLoop() {
   root_surface = nullptr;
 
   if (lua_context != nullptr) {
+    QuestFiles::finish_async_saves();
     lua_context->exit();
   }
   CurrentQuest::quit();
@@ -399,6 +416,8 @@ void MainLoop::run() {
 
   while (!is_exiting()) {
 
+    Profiler::begin_frame();
+
     // Measure the time of the last iteration.
     uint32_t now = System::get_real_time() - time_dropped;
     uint32_t last_frame_duration = now - last_frame_date;
@@ -418,7 +437,10 @@ void MainLoop::run() {
     }
 
     // 1. Detect and handle input events.
-    check_input();
+    {
+      SOLARUS_PROFILE_ZONE("MainLoop::check_input");
+      check_input();
+    }
 
     // 2. Update the world once, or several times (skipping some draws)
     // to catch up if the system is slow.
@@ -445,15 +467,20 @@ void MainLoop::run() {
     }
 
     // 4. Sleep if we have time, to save CPU and GPU cycles.
-    if (debug_lag > 0 && !turbo) {
-      // Extra sleep time for debugging, useful to simulate slower systems.
-      System::sleep(debug_lag);
-    }
+    {
+      SOLARUS_PROFILE_ZONE("MainLoop::sleep");
+      if (debug_lag > 0 && !turbo) {
+        // Extra sleep time for debugging, useful to simulate slower systems.
+        System::sleep(debug_lag);
+      }
 
-    last_frame_duration = (System::get_real_time() - time_dropped) - last_frame_date;
-    if (last_frame_duration < System::timestep && !turbo) {
-      System::sleep(System::timestep - last_frame_duration);
+      last_frame_duration = (System::get_real_time() - time_dropped) - last_frame_date;
+      if (last_frame_duration < System::timestep && !turbo) {
+        System::sleep(System::timestep - last_frame_duration);
+      }
     }
+
+    Profiler::end_frame();
   }
 
   Logger::info("Simulation finished");
@@ -466,10 +493,14 @@ void MainLoop::run() {
  * Otherwise, use run() to execute the standard main loop.
  */
 void MainLoop::step() {
+
+  SOLARUS_PROFILE_ZONE("MainLoop::step");
+
   if (game != nullptr) {
     game->update();
   }
   lua_context->update();
+  QuestFiles::update_async_saves();
   System::update();
 
   // Go to another game?
@@ -481,6 +512,7 @@ void MainLoop::step() {
       game->start();
     }
     else {
+      QuestFiles::finish_async_saves();
       lua_context->exit();
       lua_context->initialize(Arguments());
       Music::stop_playing();
@@ -590,6 +622,8 @@ void MainLoop::notify_input(const InputEvent& event) {
  */
 void MainLoop::draw() {
 
+  SOLARUS_PROFILE_ZONE("MainLoop::draw");
+
   root_surface->clear();
 
   if (game != nullptr) {
@@ -21,10 +21,12 @@
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/ResourceProvider.h"
 #include "solarus/core/Savegame.h"
+#include "solarus/entities/CollisionBroadPhase.h"
 #include "solarus/entities/Destination.h"
 #include "solarus/entities/Ground.h"
 #include "solarus/entities/GroundInfo.h"
 #include "solarus/entities/Hero.h"
+#include "solarus/entities/NavigationGrid.h"
 #include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/TilePattern.h"
 #include "solarus/entities/Tileset.h"
@@ -32,9 +34,60 @@
 #include "solarus/graphics/Surface.h"
 #include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
+#include <memory>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Vector borrowed from a pool for the duration of a scope.
+ *
+ * Collision tests are called very often and may run Lua code that
+ * makes other collision tests. Each nesting level borrows its own vector and
+ * gives it back with its capacity, so that queries do not allocate memory.
+ */
+template<typename V>
+class PooledVector {
+
+  public:
+
+    PooledVector():
+      vector() {
+      std::vector<std::unique_ptr<V>>& pool = get_pool();
+      if (pool.empty()) {
+        vector = std::unique_ptr<V>(new V());
+      }
+      else {
+        vector = std::move(pool.back());
+        pool.pop_back();
+      }
+    }
+
+    ~PooledVector() {
+      vector->clear();  // Don't keep entities alive.
+      get_pool().push_back(std::move(vector));
+    }
+
+    PooledVector(const PooledVector& other) = delete;
+    PooledVector& operator=(const PooledVector& other) = delete;
+
+    V& operator*() {
+      return *vector;
+    }
+
+  private:
+
+    static std::vector<std::unique_ptr<V>>& get_pool() {
+      static std::vector<std::unique_ptr<V>> pool;
+      return pool;
+    }
+
+    std::unique_ptr<V> vector;
+};
+
+}  // Anonymous namespace.
+
 /**
  * \brief Creates a map.
  * \param id Id of the map, used to determine the data file and
@@ -55,7 +108,8 @@ Map::Map(const std::string& id):
   started(false),
   destination_name(""),
   entities(nullptr),
-  suspended(false) {
+  suspended(false),
+  collision_broad_phase() {
 
 }
 
@@ -283,19 +337,20 @@ void Map::load(Game& game) {
       Video::get_quest_size()
   );
 
-  // Read the map data file.
-  MapData data;
-  const std::string& file_name = std::string("maps/") + get_id() + ".dat";
-  bool success = data.import_from_quest_file(file_name);
-
-  if (!success) {
-    Debug::die("Failed to load map data file '" + file_name + "'");
+  // Read the map data file, unless it was already read in background.
+  ResourceProvider& resource_provider = game.get_resource_provider();
+  const std::shared_ptr<const MapData> map_data = resource_provider.get_map_data(get_id());
+  if (map_data == nullptr) {
+    Debug::die("Failed to load map data file 'maps/" + get_id() + ".dat'");
   }
+  const MapData& data = *map_data;
+
+  // Maps reachable from here will probably be needed soon.
+  resource_provider.preload_map_destinations(data);
 
   // Initialize the map from the data just read.
   this->savegame = std::static_pointer_cast<Savegame>(
         game.get_savegame().shared_from_this());  // TODO make Game::get_savegame() return a shared_ptr.
-  ResourceProvider& resource_provider = game.get_resource_provider();
   location.set_xy(data.get_location());
   location.set_size(data.get_size());
   width8 = data.get_size().width / 8;
@@ -506,10 +561,39 @@ void Map::update() {
   check_suspended();
 
   // Update the elements.
+  collision_broad_phase.begin_frame();
   entities->update();
+  check_deferred_collisions();
   get_lua_context().map_on_update(*this);
 }
 
+/**
+ * \brief Checks the collisions postponed while entities were updated.
+ *
+ * Candidate detectors of all entities that moved are found at once by the
+ * collision broad phase.
+ */
+void Map::check_deferred_collisions() {
+
+  collision_broad_phase.end_frame(entities->get_entities());
+
+  const int num_entities = collision_broad_phase.get_num_entities();
+  for (int i = 0; i < num_entities; ++i) {
+
+    if (suspended) {
+      break;
+    }
+
+    Entity& entity = *collision_broad_phase.get_entity(i);
+    if (entity.is_being_removed() ||
+        !entity.is_enabled()) {
+      continue;
+    }
+    check_collision_with_detectors(entity, collision_broad_phase.get_candidates(i));
+  }
+  collision_broad_phase.clear();
+}
+
 /**
  * \brief Returns whether the map is currently suspended.
  * \return true if the map is suspended.
@@ -902,9 +986,9 @@ bool Map::test_collision_with_entities(
     return false;
   }
 
-  EntityVector entities_nearby;
-  get_entities().get_entities_in_rectangle_z_sorted(collision_box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  PooledVector<EntityVector> entities_nearby;
+  get_entities().get_entities_in_rectangle_z_sorted(collision_box, *entities_nearby);
+  for (const EntityPtr& entity_nearby: *entities_nearby) {
 
     if (entity_nearby->overlaps(collision_box) &&
         (entity_nearby->get_layer() == layer || entity_nearby->has_layer_independent_collisions()) &&
@@ -1125,13 +1209,21 @@ Ground Map::get_ground(
     return Ground::EMPTY;
   }
 
+  // Most squares have a uniform ground that is already known.
+  if (entity_to_check == nullptr || !entity_to_check->is_ground_modifier()) {
+    Ground ground = Ground::EMPTY;
+    if (entities->get_navigation_grid().get_ground(layer, xy.x, xy.y, ground)) {
+      return ground;
+    }
+  }
+
   // See if a dynamic entity changes the ground.
   const Rectangle box(xy, Size(1, 1));
-  ConstEntityVector entities_nearby;
-  get_entities().get_entities_in_rectangle_z_sorted(box, entities_nearby);
+  PooledVector<ConstEntityVector> entities_nearby;
+  get_entities().get_entities_in_rectangle_z_sorted(box, *entities_nearby);
 
-  const auto& rend = entities_nearby.rend();
-  for (auto it = entities_nearby.rbegin(); it != rend; ++it) {
+  const auto& rend = (*entities_nearby).rend();
+  for (auto it = (*entities_nearby).rbegin(); it != rend; ++it) {
     const Entity& entity_nearby = *(*it);
 
     const Ground ground = entity_nearby.get_modified_ground();
@@ -1303,9 +1395,15 @@ Ground Map::get_ground_from_entity(const Entity& entity, const Point& xy) const
  * This function is called by an entity sensitive to the entity detectors
  * when this entity has just moved on the map, or when a detector
  * wants to check this entity.
- * We check whether or not the entity overlaps an entity detector.
+ * We check whether or not the entity overlaps an entity detector,
+ * and then whether its sprites with pixel-precise collisions enabled
+ * overlap detectors.
+ * Detectors are found with a single query for all these tests.
  * If the map is suspended, this function does nothing.
  *
+ * If the collision broad phase is enabled and entities are being updated,
+ * the check is postponed until all entities are updated.
+ *
  * \param entity The entity that has just moved (this entity should have
  * a movement sensible to the collisions).
  */
@@ -1316,22 +1414,54 @@ void Map::check_collision_with_detectors(Entity& entity) {
   }
 
   if (entity.is_being_removed() ||
-      !entity.is_enabled()) {
+      !entity.is_enabled() ||
+      entity.is_sleeping()) {
     return;
   }
 
-  // Check this entity with each detector.
+  if (collision_broad_phase.defer(entity)) {
+    // Checked once at the end of entity updates.
+    return;
+  }
 
-  // Extend the box because some collision tests work without overlapping.
-  Rectangle box = entity.get_extended_bounding_box(8);
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle_z_sorted(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  // Find detectors near the entity.
+  const Rectangle boxes[] = {
+      CollisionBroadPhase::get_simple_box(entity),
+      CollisionBroadPhase::get_sprites_box(entity)
+  };
+  PooledVector<EntityMatchVector> entities_nearby;
+  entities->get_entities_in_rectangles_z_sorted(boxes, 2, *entities_nearby);
+
+  check_collision_with_detectors(entity, *entities_nearby);
+}
+
+/**
+ * \brief Checks the collisions between an entity and detectors already found
+ * near it.
+ * \param entity The entity that has just moved.
+ * \param entities_nearby Entities near it sorted by Z order, with
+ * CollisionBroadPhase::simple_mask set if simple collisions are possible and
+ * CollisionBroadPhase::sprites_mask set if pixel-precise collisions are
+ * possible.
+ */
+void Map::check_collision_with_detectors(
+    Entity& entity,
+    const EntityMatchVector& entities_nearby
+) {
+
+  // Check this entity with each detector.
+  for (const std::pair<EntityPtr, uint32_t>& match: entities_nearby) {
 
     if (entity.is_being_removed()) {
       return;
     }
 
+    if ((match.second & CollisionBroadPhase::simple_mask) == 0) {
+      continue;
+    }
+
+    const EntityPtr& entity_nearby = match.first;
+
     if (!entity_nearby->is_detector()) {
       // Most entities are detectors anyway.
       continue;
@@ -1339,10 +1469,47 @@ void Map::check_collision_with_detectors(Entity& entity) {
 
     if (entity_nearby->is_enabled() &&
         !entity_nearby->is_suspended() &&
+        !entity_nearby->is_sleeping() &&
         !entity_nearby->is_being_removed()) {
       entity_nearby->check_collision(entity);
     }
   }
+
+  // Detect pixel-precise collisions.
+  const std::vector<Entity::NamedSprite> sprites = entity.get_named_sprites();
+  for (const Entity::NamedSprite& named_sprite: sprites) {
+    if (named_sprite.removed) {
+      continue;
+    }
+    Sprite& sprite = *named_sprite.sprite;
+    if (!sprite.are_pixel_collisions_enabled()) {
+      continue;
+    }
+
+    if (!entity.is_enabled()) {
+      return;
+    }
+
+    for (const std::pair<EntityPtr, uint32_t>& match: entities_nearby) {
+
+      if (entity.is_being_removed()) {
+        return;
+      }
+
+      const EntityPtr& entity_nearby = match.first;
+      if ((match.second & CollisionBroadPhase::sprites_mask) == 0 ||
+          !entity_nearby->is_detector()) {
+        continue;
+      }
+
+      if (!entity_nearby->is_being_removed()
+          && !entity_nearby->is_suspended()
+          && !entity_nearby->is_sleeping()
+          && entity_nearby->is_enabled()) {
+        entity_nearby->check_collision(entity, sprite);
+      }
+    }
+  }
 }
 
 /**
@@ -1361,7 +1528,8 @@ void Map::check_collision_from_detector(Entity& detector) {
   }
 
   if (detector.is_being_removed() ||
-      !detector.is_enabled()) {
+      !detector.is_enabled() ||
+      detector.is_sleeping()) {
     return;
   }
 
@@ -1370,9 +1538,9 @@ void Map::check_collision_from_detector(Entity& detector) {
 
   // Check each entity with this detector.
   Rectangle box = detector.get_extended_bounding_box(8);
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle_z_sorted(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  PooledVector<EntityVector> entities_nearby;
+  entities->get_entities_in_rectangle_z_sorted(box, *entities_nearby);
+  for (const EntityPtr& entity_nearby: *entities_nearby) {
 
     if (detector.is_being_removed()) {
       return;
@@ -1380,6 +1548,7 @@ void Map::check_collision_from_detector(Entity& detector) {
 
     if (entity_nearby->is_enabled() &&
         !entity_nearby->is_suspended() &&
+        !entity_nearby->is_sleeping() &&
         !entity_nearby->is_being_removed() &&
         entity_nearby.get() != &detector &&
         entity_nearby.get() != &get_entities().get_hero()
@@ -1407,7 +1576,8 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
   }
 
   if (detector.is_being_removed() ||
-      !detector.is_enabled()) {
+      !detector.is_enabled() ||
+      detector.is_sleeping()) {
     return;
   }
 
@@ -1416,9 +1586,9 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
 
   // Check each entity with this detector.
   Rectangle box = detector.get_max_bounding_box();
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle_z_sorted(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  PooledVector<EntityVector> entities_nearby;
+  entities->get_entities_in_rectangle_z_sorted(box, *entities_nearby);
+  for (const EntityPtr& entity_nearby: *entities_nearby) {
 
     if (detector.is_being_removed()) {
       return;
@@ -1426,6 +1596,7 @@ void Map::check_collision_from_detector(Entity& detector, Sprite& detector_sprit
 
     if (entity_nearby->is_enabled() &&
         !entity_nearby->is_suspended() &&
+        !entity_nearby->is_sleeping() &&
         !entity_nearby->is_being_removed() &&
         entity_nearby.get() != &detector &&
         entity_nearby.get() != &get_entities().get_hero()
@@ -1459,9 +1630,9 @@ void Map::check_collision_with_detectors(Entity& entity, Sprite& sprite) {
 
   // Check each detector.
   Rectangle box = entity.get_max_bounding_box();
-  std::vector<EntityPtr> entities_nearby;
-  entities->get_entities_in_rectangle_z_sorted(box, entities_nearby);
-  for (const EntityPtr& entity_nearby: entities_nearby) {
+  PooledVector<EntityVector> entities_nearby;
+  entities->get_entities_in_rectangle_z_sorted(box, *entities_nearby);
+  for (const EntityPtr& entity_nearby: *entities_nearby) {
 
     if (entity.is_being_removed()) {
       return;
@@ -1473,6 +1644,7 @@ void Map::check_collision_with_detectors(Entity& entity, Sprite& sprite) {
 
     if (!entity_nearby->is_being_removed()
         && !entity_nearby->is_suspended()
+        && !entity_nearby->is_sleeping()
         && entity_nearby->is_enabled()) {
       entity_nearby->check_collision(entity, sprite);
     }
@@ -23,8 +23,91 @@
 #include <algorithm>
 #include <iostream> // print functions
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SOLARUS_PIXEL_BITS_SSE2
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define SOLARUS_PIXEL_BITS_NEON
+#  include <arm_neon.h>
+#endif
+
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Detects whether two rows of pixel bits have a common opaque pixel.
+ *
+ * Row b is shifted to the left so that its first pixel is aligned with
+ * the first pixel of row a.
+ * The word after the last one compared in row b must be readable.
+ *
+ * \param bits_a First word to compare in row a.
+ * \param bits_b First word to compare in row b.
+ * \param shift Number of pixels of row b to skip in its first word (0 to 63).
+ * \param nb_words Number of words to compare.
+ * \return \c true if there is a collision.
+ */
+inline bool test_rows(
+    const uint64_t* bits_a,
+    const uint64_t* bits_b,
+    int shift,
+    int nb_words
+) {
+  int j = 0;
+
+#if defined(SOLARUS_PIXEL_BITS_SSE2)
+  if (nb_words >= 2) {
+    // Shifting by 64 gives zero, so shift 0 needs no special case.
+    const __m128i left_shift = _mm_cvtsi32_si128(shift);
+    const __m128i right_shift = _mm_cvtsi32_si128(64 - shift);
+    __m128i result = _mm_setzero_si128();
+    for (; j + 1 < nb_words; j += 2) {
+      const __m128i mask_a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits_a + j));
+      const __m128i mask_b = _mm_or_si128(
+          _mm_sll_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bits_b + j)), left_shift),
+          _mm_srl_epi64(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bits_b + j + 1)), right_shift)
+      );
+      result = _mm_or_si128(result, _mm_and_si128(mask_a, mask_b));
+    }
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(result, _mm_setzero_si128())) != 0xFFFF) {
+      return true;
+    }
+  }
+#elif defined(SOLARUS_PIXEL_BITS_NEON)
+  if (nb_words >= 2) {
+    // Shifting by 64 or more gives zero, so shift 0 needs no special case.
+    const int64x2_t left_shift = vdupq_n_s64(shift);
+    const int64x2_t right_shift = vdupq_n_s64(shift - 64);
+    uint64x2_t result = vdupq_n_u64(0);
+    for (; j + 1 < nb_words; j += 2) {
+      const uint64x2_t mask_a = vld1q_u64(bits_a + j);
+      const uint64x2_t mask_b = vorrq_u64(
+          vshlq_u64(vld1q_u64(bits_b + j), left_shift),
+          vshlq_u64(vld1q_u64(bits_b + j + 1), right_shift)
+      );
+      result = vorrq_u64(result, vandq_u64(mask_a, mask_b));
+    }
+    if ((vgetq_lane_u64(result, 0) | vgetq_lane_u64(result, 1)) != 0) {
+      return true;
+    }
+  }
+#endif
+
+  for (; j < nb_words; ++j) {
+    uint64_t mask_b = bits_b[j] << shift;
+    if (shift != 0) {
+      mask_b |= bits_b[j + 1] >> (64 - shift);
+    }
+    if ((bits_a[j] & mask_b) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Creates a pixel bits object.
  * \param surface The surface where the image is.
@@ -33,15 +116,65 @@ namespace Solarus {
 PixelBits::PixelBits(const Surface& surface, const Rectangle& image_position):
   width(0),
   height(0),
-  nb_integers_per_row(0),
-  bits() {
+  nb_words_per_row(0),
+  row_stride(0),
+  bits(),
+  row_spans(),
+  opaque_box(0, 0, 0, 0) {
+
+  const int surface_width = surface.get_width();
+  build(surface.get_size(), image_position, [&](int x, int y) {
+    return surface.is_pixel_transparent(y * surface_width + x);
+  });
+}
+
+/**
+ * \brief Creates a pixel bits object from a software surface.
+ *
+ * Unlike the other constructor, this one can be called from any thread.
+ *
+ * \param surface A software surface in RGBA format.
+ * \param image_position Position of the image on this surface.
+ */
+PixelBits::PixelBits(const SDL_Surface& surface, const Rectangle& image_position):
+  width(0),
+  height(0),
+  nb_words_per_row(0),
+  row_stride(0),
+  bits(),
+  row_spans(),
+  opaque_box(0, 0, 0, 0) {
+
+  Debug::check_assertion(surface.format->BytesPerPixel == 4 && surface.format->Amask != 0,
+      "Surface is not in RGBA format");
+  const uint8_t* pixels = static_cast<const uint8_t*>(surface.pixels);
+  const uint32_t alpha_mask = surface.format->Amask;
+  const int pitch = surface.pitch;
+  build(Size(surface.w, surface.h), image_position, [&](int x, int y) {
+    const uint32_t pixel = reinterpret_cast<const uint32_t*>(pixels + y * pitch)[x];
+    return (pixel & alpha_mask) == 0;
+  });
+}
+
+/**
+ * \brief Fills the bits from the pixels of an image.
+ * \param surface_size Size of the surface where the image is.
+ * \param image_position Position of the image on this surface.
+ * \param is_pixel_transparent Function returning whether the pixel at the
+ * given coordinates of the surface is transparent.
+ */
+template<typename IsTransparent>
+void PixelBits::build(
+    const Size& surface_size,
+    const Rectangle& image_position,
+    IsTransparent is_pixel_transparent) {
 
   // Create a list of boolean values representing the transparency of each pixel.
   // This list is implemented as bit fields.
 
   // Clip the rectangle passed as parameter.
   const Rectangle clipped_image_position(
-      image_position.get_intersection(Rectangle(surface.get_size()))
+      image_position.get_intersection(Rectangle(surface_size))
   );
 
   if (clipped_image_position.is_flat()) {
@@ -51,37 +184,46 @@ PixelBits::PixelBits(const Surface& surface, const Rectangle& image_position):
   width = clipped_image_position.get_width();
   height = clipped_image_position.get_height();
 
-  nb_integers_per_row = width >> 5; // width / 32
-  if ((width & 31) != 0) { // width % 32 != 0
-    nb_integers_per_row++;
-  }
-
-  int pixel_index = clipped_image_position.get_y() * surface.get_width() + clipped_image_position.get_x();
-
-  bits.resize(height);
+  nb_words_per_row = (width + 63) >> 6;
+  // Keep a zero word after each row for shifted reads,
+  // and start each row on 128 bits.
+  row_stride = (nb_words_per_row + 2) & ~1;
+
+  bits.assign(height * row_stride, 0);
+  row_spans.resize(height);
+  int min_x = width;
+  int max_x = 0;
+  int min_y = height;
+  int max_y = 0;
   for (int i = 0; i < height; ++i) {
-    bits[i].resize(nb_integers_per_row);
+    uint64_t* row = &bits[i * row_stride];
+    RowSpan& span = row_spans[i];
+    span.first = 0;
+    span.end = 0;
 
-    // Fill the bits for this row, using nb_integers_per_row sequences of 32 bits.
-    int k = -1;
-    uint32_t mask = 0x00000000;  // Current bit in the sequence of 32 bits.
+    // Fill the bits for this row, using nb_words_per_row sequences of 64 bits.
     for (int j = 0; j < width; ++j) {
-      if (mask == 0x00000000) {
-        // Time for a new sequence of 32 bits.
-        k++;
-        mask = 0x80000000;
-        bits[i][k] = 0x00000000;  // Initialize the sequence to transparent.
-      }
 
       // If the pixel is opaque.
-      if (!surface.is_pixel_transparent(pixel_index)) {
-        bits[i][k] |= mask;
+      if (!is_pixel_transparent(clipped_image_position.get_x() + j, clipped_image_position.get_y() + i)) {
+        row[j >> 6] |= uint64_t(0x8000000000000000) >> (j & 63);
+        if (span.end == span.first) {
+          span.first = j;
+        }
+        span.end = j + 1;
       }
+    }
 
-      mask >>= 1;
-      ++pixel_index;
+    if (span.end != span.first) {
+      min_x = std::min(min_x, span.first);
+      max_x = std::max(max_x, span.end);
+      min_y = std::min(min_y, i);
+      max_y = i + 1;
     }
-    pixel_index += surface.get_width() - width;
+  }
+
+  if (min_x < max_x) {
+    opaque_box = Rectangle(min_x, min_y, max_x - min_x, max_y - min_y);
   }
 }
 
@@ -99,134 +241,87 @@ bool PixelBits::test_aligned_collision(const PixelBits& other,
 ) const {
   const bool debug_pixel_collisions = false;
 
-  if (bits.empty()) {
-    // No image.
-    return false;
-  }
-
-  // Compute both bounding boxes.
-  const Rectangle bounding_box1(location1.x, location1.y, width, height);
-  const Rectangle bounding_box2(location2.x, location2.y, other.width, other.height);
+  // Compute both areas of opaque pixels.
+  // Empty images have a flat area.
+  Rectangle opaque_box1(opaque_box);
+  opaque_box1.add_xy(location1);
+  Rectangle opaque_box2(other.opaque_box);
+  opaque_box2.add_xy(location2);
 
-  // Check collision between the two bounding boxes.
-  if (!bounding_box1.overlaps(bounding_box2)) {
+  // Check collision between the two areas.
+  if (!opaque_box1.overlaps(opaque_box2)) {
     return false;
   }
 
-  if (debug_pixel_collisions) {
-    std::cout << System::now() << "\n bounding box collision\n";
-    std::cout << "rect1 = " << bounding_box1 << "\n";
-    std::cout << "rect2 = " << bounding_box2 << "\n";
-    print();
-    other.print();
-  }
-
   // Compute the intersection between both rectangles.
-  const int intersection_x = std::max(bounding_box1.get_x(), bounding_box2.get_x());
-  const int intersection_y = std::max(bounding_box1.get_y(), bounding_box2.get_y());
+  const int intersection_x = std::max(opaque_box1.get_x(), opaque_box2.get_x());
+  const int intersection_y = std::max(opaque_box1.get_y(), opaque_box2.get_y());
   const Rectangle intersection(
       intersection_x,
       intersection_y,
-      std::min(bounding_box1.get_x() + bounding_box1.get_width(),
-          bounding_box2.get_x() + bounding_box2.get_width()) - intersection_x,
-      std::min(bounding_box1.get_y() + bounding_box1.get_height(),
-          bounding_box2.get_y() + bounding_box2.get_height()) - intersection_y);
+      std::min(opaque_box1.get_x() + opaque_box1.get_width(),
+          opaque_box2.get_x() + opaque_box2.get_width()) - intersection_x,
+      std::min(opaque_box1.get_y() + opaque_box1.get_height(),
+          opaque_box2.get_y() + opaque_box2.get_height()) - intersection_y);
 
   if (debug_pixel_collisions) {
+    std::cout << System::now() << "\n opaque area collision\n";
+    std::cout << "rect1 = " << opaque_box1 << "\n";
+    std::cout << "rect2 = " << opaque_box2 << "\n";
     std::cout << "intersection: " << intersection << "\n";
+    print();
+    other.print();
   }
 
-  // compute the relative position of the intersection rectangle for each bounding_box
-  Point offset1 = intersection.get_xy() - bounding_box1.get_xy();
-  Point offset2 = intersection.get_xy() - bounding_box2.get_xy();
-
-  if (debug_pixel_collisions) {
-    std::cout << "offset1.x = " << offset1.x << ", offset1.y = " << offset1.y;
-    std::cout << ", offset2.x = " << offset2.x << ", offset2.y = " << offset2.y << std::endl;
-  }
-
-  // For each row of the intersection, we will call row 'a' the row coming from the right bounding box
-  // and row 'b' the one coming from the left bounding box.
-
-  std::vector<std::vector<uint32_t>>::const_iterator rows_a;           // for each row: array of masks of the right bounding box
-  std::vector<std::vector<uint32_t>>::const_iterator rows_b;           // for each row: array of masks of the left bounding box
-
-  int nb_masks_per_row_a;    // number of masks on row a that are in the intersection (row b may have one more mask)
-  int nb_masks_per_row_b;    // number of masks on row b that are in the intersection
-  int nb_unused_masks_row_b; // number of unused masks on row b (i.e. before the intersection)
-  int nb_unused_bits_row_b;  // number of unused bits on the first used mask of row b
-  int nb_used_bits_row_b;    // number of bits used on the first used mask of row b
-
-  // make sure row a starts after row b
-  if (bounding_box1.get_x() > bounding_box2.get_x()) {
-    rows_a = this->bits.begin() + offset1.y;
-    rows_b = other.bits.begin() + offset2.y;
-    nb_unused_masks_row_b = offset2.x >> 5;
-    nb_unused_bits_row_b = offset2.x & 31;
-  }
-  else {
-    rows_a = other.bits.begin() + offset2.y;
-    rows_b = this->bits.begin() + offset1.y;
-    nb_unused_masks_row_b = offset1.x >> 5;
-    nb_unused_bits_row_b = offset1.x & 31;
-  }
-  nb_used_bits_row_b = 32 - nb_unused_bits_row_b;
-
-  // compute the number of masks in the intersection on row a
-  nb_masks_per_row_a = intersection.get_width() >> 5;
-  if ((intersection.get_width() & 31) != 0) {
-    nb_masks_per_row_a++;
-  }
-
-  // compute the number of masks in the intersection on row b
-  nb_masks_per_row_b = (intersection.get_width() + nb_unused_bits_row_b) >> 5;
-  if (((intersection.get_width() + nb_unused_bits_row_b) & 31) != 0) {
-    nb_masks_per_row_b++;
-  }
-
-  // check the collisions each row of the intersection rectangle
+  // Column and row of each image where the intersection starts.
+  const int column1 = intersection.get_x() - location1.x;
+  const int column2 = intersection.get_x() - location2.x;
+  const int row1 = intersection.get_y() - location1.y;
+  const int row2 = intersection.get_y() - location2.y;
+
+  // We will call image 'a' the one whose first column in the intersection
+  // has the lowest position in its word, and image 'b' the other one.
+  // The comparison starts at the beginning of the word of a,
+  // so a is read word by word and b is shifted.
+  // The extra columns before the intersection are transparent in a or in b.
+  const bool this_is_a = (column1 & 63) <= (column2 & 63);
+  const PixelBits& a = this_is_a ? *this : other;
+  const PixelBits& b = this_is_a ? other : *this;
+  const int column_a = this_is_a ? column1 : column2;
+  const int column_b = this_is_a ? column2 : column1;
+  const int row_a = this_is_a ? row1 : row2;
+  const int row_b = this_is_a ? row2 : row1;
+  const int extra_columns = column_a & 63;
+  const int start_b = column_b - extra_columns;
+  const int shift = start_b & 63;
+  const int nb_words = (intersection.get_width() + extra_columns + 63) >> 6;
+
+  const uint64_t* bits_a = &a.bits[row_a * a.row_stride + (column_a >> 6)];
+  const uint64_t* bits_b = &b.bits[row_b * b.row_stride + (start_b >> 6)];
+
+  // Check each row of the intersection rectangle.
   for (int i = 0; i < intersection.get_height(); ++i) {
 
-    // current row
-    const std::vector<uint32_t>& bits_a = *rows_a;
-    const std::vector<uint32_t>& bits_b = *rows_b;
-
-    ++rows_a;
-    ++rows_b;
-
-    if (debug_pixel_collisions) {
-      std::cout << "*** checking row " << i << " of the intersection rectangle\n";
-    }
-
-    // Check each mask.
-    for (int j = 0; j < nb_masks_per_row_a; ++j) {
-
-      // We compare the left of a with the right part of b,
-      // and the right part of a with the right part of the next b if any.
-
-      uint32_t mask_a = bits_a[j];
-      uint32_t mask_b = bits_b[j + nb_unused_masks_row_b];
-      uint32_t mask_a_left = mask_a >> nb_unused_bits_row_b;
-      uint32_t next_mask_b_left = 0x00000000;
-      if (j + 1 < nb_masks_per_row_a ||            // Not the last a-mask.
-          nb_masks_per_row_b > nb_masks_per_row_a  // Last a-mask but there exists one more b-mask.
-          ) {
-        // We are still inside the intersection: next_mask_b_left exists.
-        next_mask_b_left = bits_b[j + nb_unused_masks_row_b + 1] >> nb_used_bits_row_b;
-      }
+    // Skip rows whose opaque pixels cannot overlap.
+    const RowSpan& span_a = a.row_spans[row_a + i];
+    const RowSpan& span_b = b.row_spans[row_b + i];
+    if (span_a.first - column_a < span_b.end - column_b &&
+        span_b.first - column_b < span_a.end - column_a) {
 
       if (debug_pixel_collisions) {
+        std::cout << "*** checking row " << i << " of the intersection rectangle\n";
         std::cout << "mask_a = ";
-        print_mask(mask_a);
-        std::cout << ", mask b = ";
-        print_mask(mask_b);
+        print_mask(bits_a[0]);
         std::cout << "\n";
       }
 
-      if (((mask_a_left & mask_b) | (mask_a & next_mask_b_left)) != 0x00000000) {
+      if (test_rows(bits_a, bits_b, shift, nb_words)) {
         return true;
       }
     }
+
+    bits_a += a.row_stride;
+    bits_b += b.row_stride;
   }
 
   return false;
@@ -292,10 +387,8 @@ bool PixelBits::at(int x, int y) const {
   if(x < 0 || y < 0 || x >= width || y >= height) {
     return false;
   }
-  const auto& row = bits.at(y);
-  int index = x / 32;
-  int offset = x % 32;
-  return (row[index] << offset) & 0x80000000;
+  const uint64_t word = bits[y * row_stride + (x >> 6)];
+  return ((word << (x & 63)) & 0x8000000000000000) != 0;
 }
 
 /**
@@ -318,12 +411,12 @@ void PixelBits::print() const {
 }
 
 /**
- * \brief Prints an ASCII representation of a 32-bit mask (for debugging purposes only).
+ * \brief Prints an ASCII representation of a 64-bit mask (for debugging purposes only).
  */
-void PixelBits::print_mask(uint32_t mask) const {
+void PixelBits::print_mask(uint64_t mask) const {
 
-  for (int i = 0; i < 32; i++) {
-    std::cout << (((mask & 0x80000000) != 0x00000000) ? "X" : ".");
+  for (int i = 0; i < 64; i++) {
+    std::cout << (((mask & 0x8000000000000000) != 0) ? "X" : ".");
     mask <<= 1;
   }
 }
@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Arguments.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/Profiler.h"
+#include "solarus/core/System.h"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace Solarus {
+
+bool Profiler::enabled = false;
+
+namespace {
+
+/**
+ * \brief A closed or still open zone of a frame.
+ */
+struct ZoneRecord {
+  const char* name;       /**< Name of the zone. */
+  uint64_t start;         /**< Start date in nanoseconds. */
+  uint64_t end;           /**< End date in nanoseconds, 0 while the zone is open. */
+  int depth;              /**< Nesting level, 0 for top-level zones. */
+};
+
+/**
+ * \brief All zones recorded during a frame.
+ */
+struct FrameRecord {
+  uint64_t number = 0;              /**< Index of this frame since the profiler started. */
+  uint64_t start = 0;               /**< Start date in nanoseconds. */
+  uint64_t end = 0;                 /**< End date in nanoseconds, 0 if the frame is incomplete. */
+  std::vector<ZoneRecord> zones;    /**< Zones in opening order. */
+};
+
+/**
+ * \brief Accumulated time of a zone name during a report interval.
+ */
+struct ZoneStats {
+  const char* name;       /**< Name of the zone. */
+  uint32_t calls;         /**< Number of times the zone was closed. */
+  uint64_t total;         /**< Total duration in nanoseconds. */
+};
+
+/**
+ * \brief Wraps the current state of the profiler.
+ */
+struct ProfilerContext {
+  std::chrono::steady_clock::time_point origin;   /**< Date 0 of all recorded dates. */
+  std::thread::id main_thread;                    /**< The only thread whose zones are recorded. */
+  std::vector<FrameRecord> frames;                /**< Ring buffer of the last frames. */
+  size_t current_frame = 0;                       /**< Index of the current frame in the ring. */
+  uint64_t num_frames = 0;                        /**< Number of frames started so far. */
+  bool in_frame = false;                          /**< Whether a frame is currently open. */
+  std::array<int, Profiler::max_depth> stack;     /**< Indexes of open zones in the current frame (-1 if dropped). */
+  int depth = 0;                                  /**< Number of zones currently open. */
+  std::string output_file_name;                   /**< Where to dump the trace when quitting (empty means no dump). */
+  bool report = false;                            /**< Whether to log a summary every report interval. */
+  uint32_t last_report_time = 0;                  /**< Last time of reporting in milliseconds. */
+  uint32_t frames_since_report = 0;               /**< Frames finished since the last report. */
+  std::vector<ZoneStats> stats;                   /**< Zone statistics since the last report. */
+};
+
+ProfilerContext context;
+
+/**
+ * \brief Returns the current date of the profiler.
+ * \return Nanoseconds elapsed since the profiler was initialized.
+ */
+uint64_t get_time_ns() {
+  return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - context.origin
+  ).count());
+}
+
+/**
+ * \brief Writes a nanosecond date or duration as microseconds.
+ * \param out The stream to write to.
+ * \param ns The value in nanoseconds.
+ */
+void write_microseconds(std::ostream& out, uint64_t ns) {
+
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%llu.%03u",
+      static_cast<unsigned long long>(ns / 1000),
+      static_cast<unsigned>(ns % 1000));
+  out << buffer;
+}
+
+/**
+ * \brief Writes a string as a JSON string literal.
+ * \param out The stream to write to.
+ * \param text The string to escape.
+ */
+void write_json_string(std::ostream& out, const char* text) {
+
+  out << '"';
+  for (const char* c = text; *c != '\0'; ++c) {
+    if (*c == '"' || *c == '\\') {
+      out << '\\' << *c;
+    }
+    else if (static_cast<unsigned char>(*c) < 0x20) {
+      out << ' ';
+    }
+    else {
+      out << *c;
+    }
+  }
+  out << '"';
+}
+
+/**
+ * \brief Writes a complete event of the Chrome trace format.
+ * \param out The stream to write to.
+ * \param name Name of the event.
+ * \param start Start date in nanoseconds.
+ * \param end End date in nanoseconds.
+ */
+void write_trace_event(std::ostream& out, const char* name, uint64_t start, uint64_t end) {
+
+  out << "{\"name\":";
+  write_json_string(out, name);
+  out << ",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":";
+  write_microseconds(out, start);
+  out << ",\"dur\":";
+  write_microseconds(out, end - start);
+  out << "}";
+}
+
+/**
+ * \brief Accumulates the zones of the frame that just finished
+ * and logs them if the report interval is elapsed.
+ * \param frame The frame that just finished.
+ */
+void update_report(const FrameRecord& frame) {
+
+  for (const ZoneRecord& zone : frame.zones) {
+    ZoneStats* zone_stats = nullptr;
+    for (ZoneStats& stats : context.stats) {
+      if (stats.name == zone.name) {
+        zone_stats = &stats;
+        break;
+      }
+    }
+    if (zone_stats == nullptr) {
+      context.stats.push_back({ zone.name, 0, 0 });
+      zone_stats = &context.stats.back();
+    }
+    ++zone_stats->calls;
+    zone_stats->total += zone.end - zone.start;
+  }
+  ++context.frames_since_report;
+
+  const uint32_t current_time = System::get_real_time();
+  if (current_time - context.last_report_time < Profiler::report_interval) {
+    return;
+  }
+  context.last_report_time = current_time;
+
+  std::ostringstream oss;
+  oss << "Profiler: frames=" << context.frames_since_report;
+  for (ZoneStats& stats : context.stats) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", stats.total / 1000000.0);
+    oss << " " << stats.name << "=" << stats.calls << "x/" << buffer << "ms";
+    stats.calls = 0;
+    stats.total = 0;
+  }
+  Logger::print(oss.str());
+  context.frames_since_report = 0;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Initializes the profiler.
+ *
+ * Options recognized:
+ *   -profile=yes|no
+ *   -profile-frames=N
+ *   -profile-output=FILE
+ *   -profile-report=yes|no
+ *   -perf-video-render=yes|no (same as -profile-report)
+ *   -perf-sound-play=yes|no (same as -profile-report)
+ *
+ * \param args Command-line arguments.
+ */
+void Profiler::initialize(const Arguments& args) {
+
+  context = ProfilerContext();
+  context.origin = std::chrono::steady_clock::now();
+  context.main_thread = std::this_thread::get_id();
+
+  context.report =
+      args.get_argument_value("-profile-report") == "yes" ||
+      args.get_argument_value("-perf-video-render") == "yes" ||
+      args.get_argument_value("-perf-sound-play") == "yes";
+  const bool record = args.get_argument_value("-profile") == "yes";
+  if (!record && !context.report) {
+    return;
+  }
+
+  int num_frames = default_num_frames;
+  const std::string& num_frames_arg = args.get_argument_value("-profile-frames");
+  if (!num_frames_arg.empty()) {
+    std::istringstream iss(num_frames_arg);
+    if (!(iss >> num_frames) || num_frames <= 0) {
+      Logger::error("Invalid number of profiled frames: '" + num_frames_arg + "'");
+      num_frames = default_num_frames;
+    }
+  }
+  context.frames.resize(num_frames);
+
+  if (record) {
+    context.output_file_name = args.get_argument_value("-profile-output", "solarus_profile.json");
+    Logger::info("Profiler: yes (" + context.output_file_name + ")");
+  }
+  context.last_report_time = System::get_real_time();
+
+  enabled = true;
+}
+
+/**
+ * \brief Stops the profiler and dumps the recorded frames if requested.
+ */
+void Profiler::quit() {
+
+  if (!context.output_file_name.empty()) {
+    dump_chrome_trace(context.output_file_name);
+  }
+  enabled = false;
+  context = ProfilerContext();
+}
+
+/**
+ * \brief Enables or disables the recording of zones.
+ *
+ * Zones already opened are still closed properly.
+ *
+ * \param enabled \c true to record zones.
+ */
+void Profiler::set_enabled(bool enabled) {
+
+  if (enabled && context.frames.empty()) {
+    context.frames.resize(default_num_frames);
+  }
+  Profiler::enabled = enabled;
+}
+
+/**
+ * \brief Starts recording a new frame.
+ *
+ * The oldest frame of the ring buffer is reused.
+ */
+void Profiler::begin_frame() {
+
+  if (!enabled) {
+    return;
+  }
+
+  if (context.in_frame) {
+    end_frame();
+  }
+
+  context.current_frame = (context.current_frame + 1) % context.frames.size();
+  FrameRecord& frame = context.frames[context.current_frame];
+  frame.number = context.num_frames;
+  frame.start = get_time_ns();
+  frame.end = 0;
+  frame.zones.clear();  // Keeps the capacity of previous frames.
+  ++context.num_frames;
+  context.in_frame = true;
+  context.depth = 0;
+}
+
+/**
+ * \brief Finishes the current frame.
+ *
+ * Zones that are still open are closed at the end of the frame.
+ */
+void Profiler::end_frame() {
+
+  if (!context.in_frame) {
+    return;
+  }
+
+  FrameRecord& frame = context.frames[context.current_frame];
+  frame.end = get_time_ns();
+  for (ZoneRecord& zone : frame.zones) {
+    if (zone.end == 0) {
+      zone.end = frame.end;
+    }
+  }
+  context.in_frame = false;
+  context.depth = 0;
+
+  if (context.report) {
+    update_report(frame);
+  }
+}
+
+/**
+ * \brief Opens a zone in the current frame.
+ *
+ * Zones opened outside a frame, deeper than max_depth or beyond
+ * max_zones_per_frame are not recorded.
+ * Only the main thread is profiled.
+ *
+ * \param name Name of the zone.
+ */
+void Profiler::begin_zone(const char* name) {
+
+  if (!enabled ||
+      std::this_thread::get_id() != context.main_thread) {
+    return;
+  }
+
+  int index = -1;
+  if (context.in_frame) {
+    FrameRecord& frame = context.frames[context.current_frame];
+    if (frame.zones.size() < static_cast<size_t>(max_zones_per_frame) &&
+        context.depth < max_depth) {
+      index = static_cast<int>(frame.zones.size());
+      frame.zones.push_back({ name, get_time_ns(), 0, context.depth });
+    }
+  }
+
+  if (context.depth < max_depth) {
+    context.stack[context.depth] = index;
+  }
+  ++context.depth;
+}
+
+/**
+ * \brief Closes the last zone opened.
+ */
+void Profiler::end_zone() {
+
+  if (context.depth <= 0 ||
+      std::this_thread::get_id() != context.main_thread) {
+    return;
+  }
+
+  --context.depth;
+  if (!context.in_frame || context.depth >= max_depth) {
+    return;
+  }
+
+  const int index = context.stack[context.depth];
+  if (index != -1) {
+    context.frames[context.current_frame].zones[index].end = get_time_ns();
+  }
+}
+
+/**
+ * \brief Writes the frames of the ring buffer in the Chrome trace format.
+ *
+ * Each frame is an event containing its zones as nested events.
+ * Only finished frames are written.
+ *
+ * \param file_name Path of the JSON file to write.
+ * \return \c true in case of success.
+ */
+bool Profiler::dump_chrome_trace(const std::string& file_name) {
+
+  std::ofstream out(file_name.c_str());
+  if (!out) {
+    Logger::error("Cannot write profiler trace file '" + file_name + "'");
+    return false;
+  }
+
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  const size_t num_frames = context.frames.size();
+  for (size_t i = 1; i <= num_frames; ++i) {
+    // Start just after the current frame: this is the oldest one.
+    const FrameRecord& frame = context.frames[(context.current_frame + i) % num_frames];
+    if (frame.end == 0) {
+      continue;
+    }
+
+    std::ostringstream frame_name;
+    frame_name << "Frame " << frame.number;
+    out << (first ? "\n" : ",\n");
+    write_trace_event(out, frame_name.str().c_str(), frame.start, frame.end);
+    first = false;
+
+    for (const ZoneRecord& zone : frame.zones) {
+      out << ",\n";
+      write_trace_event(out, zone.name, zone.start, zone.end);
+    }
+  }
+  out << "\n]}\n";
+
+  Logger::info("Profiler trace written to '" + file_name + "'");
+  return true;
+}
+
+}
@@ -21,11 +21,30 @@
 #include "solarus/core/QuestProperties.h"
 #include "solarus/lua/LuaContext.h"
 #include <physfs.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <cstdlib>  // exit(), mkstemp(), tmpnam()
-#include <cstdio>   // remove()
+#include <cstdio>   // remove(), rename()
 #ifdef SOLARUS_HAVE_UNISTD_H
-#  include <unistd.h>  // close()
+#  include <fcntl.h>   // open()
+#  include <unistd.h>  // close(), fsync()
+#endif
+#if defined(_WIN32) || defined(__CYGWIN__)
+#  include <io.h>  // _commit()
+#  ifndef NOMINMAX
+#    define NOMINMAX  // Keep std::min() and std::max() usable.
+#  endif
+#  include <windows.h>
+#endif
+#ifdef SOLARUS_HAVE_MMAP
+#  include <fcntl.h>     // open()
+#  include <sys/mman.h>  // mmap()
+#  include <sys/stat.h>  // fstat()
 #endif
 
 #ifdef ANDROID
@@ -67,6 +86,468 @@ std::string quest_write_dir_;
  */
 std::vector<std::string> temporary_files_;
 
+/**
+ * \brief A data file read in advance.
+ */
+struct PreloadedFile {
+  std::string buffer;           /**< Content of the file. */
+  uint64_t sequence;            /**< Order of preloading, to evict the oldest ones first. */
+};
+
+/**
+ * \brief Content of data files read in advance and not consumed yet.
+ */
+std::map<std::string, PreloadedFile> preloaded_files_;
+
+/**
+ * \brief Sequence number of the next preloaded file.
+ */
+uint64_t preloaded_files_sequence_ = 0;
+
+/**
+ * \brief Total size in bytes of preloaded files.
+ */
+size_t preloaded_files_size_ = 0;
+
+/**
+ * \brief Lock for preloaded files.
+ */
+std::mutex preloaded_files_mutex_;
+
+/**
+ * \brief Maximum total size in bytes of preloaded files.
+ */
+constexpr size_t max_preloaded_files_size = 64 * 1024 * 1024;
+
+/**
+ * \brief Files of the data directory smaller than this are read
+ * instead of mapped, because mapping has a higher fixed cost.
+ */
+constexpr size_t min_mapped_file_size = 16 * 1024;
+
+/**
+ * \brief Maximum size in bytes of a buffer kept for reuse.
+ */
+constexpr size_t max_pooled_buffer_size = 4 * 1024 * 1024;
+
+/**
+ * \brief Maximum number of buffers kept for reuse.
+ */
+constexpr size_t max_pooled_buffers = 8;
+
+/**
+ * \brief Memory of released file buffers, reused by the next reads.
+ */
+struct BufferPool {
+  std::mutex mutex;                               /**< Lock for the buffers. */
+  std::vector<std::pair<std::unique_ptr<char[]>, size_t>>
+      free_buffers;                               /**< Memory and capacity of unused buffers. */
+};
+
+/**
+ * \brief Buffers kept for reuse.
+ *
+ * File buffers only keep a weak reference, so that they can outlive it.
+ */
+std::shared_ptr<BufferPool> buffer_pool_ = std::make_shared<BufferPool>();
+
+/**
+ * \brief Data file buffer whose memory comes from the pool
+ * and returns there when it is destroyed.
+ */
+class PooledFileBuffer : public DataFileBuffer {
+
+  public:
+
+    /**
+     * \brief Creates a buffer of the given size with uninitialized content.
+     * \param size Size in bytes.
+     */
+    explicit PooledFileBuffer(size_t size):
+      pool(buffer_pool_),
+      capacity(0) {
+
+      {
+        std::lock_guard<std::mutex> lock(buffer_pool_->mutex);
+        auto& free_buffers = buffer_pool_->free_buffers;
+        auto best = free_buffers.end();
+        for (auto it = free_buffers.begin(); it != free_buffers.end(); ++it) {
+          if (it->second >= size && (best == free_buffers.end() || it->second < best->second)) {
+            best = it;
+          }
+        }
+        if (best != free_buffers.end()) {
+          memory = std::move(best->first);
+          capacity = best->second;
+          free_buffers.erase(best);
+        }
+      }
+
+      if (memory == nullptr) {
+        capacity = std::max(size, static_cast<size_t>(1));
+        memory = std::unique_ptr<char[]>(new char[capacity]);
+      }
+      set_content(memory.get(), size);
+    }
+
+    /**
+     * \brief Gives the memory back to the pool if it is worth keeping.
+     */
+    ~PooledFileBuffer() {
+
+      const std::shared_ptr<BufferPool>& owner = pool.lock();
+      if (owner == nullptr || capacity > max_pooled_buffer_size) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(owner->mutex);
+      if (owner->free_buffers.size() < max_pooled_buffers) {
+        owner->free_buffers.emplace_back(std::move(memory), capacity);
+      }
+    }
+
+    /**
+     * \brief Returns the memory to fill.
+     * \return The first byte of the content.
+     */
+    char* get_memory() {
+      return memory.get();
+    }
+
+  private:
+
+    std::weak_ptr<BufferPool> pool;   /**< Where to give the memory back. */
+    std::unique_ptr<char[]> memory;   /**< The memory. */
+    size_t capacity;                  /**< Size of the memory. */
+
+};
+
+#ifdef SOLARUS_HAVE_MMAP
+/**
+ * \brief Data file buffer that maps a file in memory.
+ */
+class MappedFileBuffer : public DataFileBuffer {
+
+  public:
+
+    MappedFileBuffer(void* address, size_t size):
+      address(address),
+      mapped_size(size) {
+      set_content(static_cast<const char*>(address), size);
+    }
+
+    ~MappedFileBuffer() {
+      munmap(address, mapped_size);
+    }
+
+  private:
+
+    void* address;          /**< Start of the mapping. */
+    size_t mapped_size;     /**< Size of the mapping. */
+
+};
+
+/**
+ * \brief Maps a data file in memory if it is a large enough regular file
+ * of the data directory.
+ *
+ * Files in an archive or in the write directory are not mapped:
+ * the former are compressed and the latter can be rewritten while mapped.
+ *
+ * \param file_name Name of an existing data file.
+ * \return The mapped file, or nullptr if it cannot be mapped.
+ */
+DataFileBufferPtr map_data_file(const std::string& file_name) {
+
+  const char* real_dir = PHYSFS_getRealDir(file_name.c_str());
+  if (real_dir == nullptr) {
+    return nullptr;
+  }
+  const char* write_dir = PHYSFS_getWriteDir();
+  if (write_dir != nullptr && std::string(real_dir) == write_dir) {
+    return nullptr;
+  }
+
+  // Opening fails if the real directory is an archive.
+  const std::string& path = std::string(real_dir) + "/" + file_name;
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 ||
+      !S_ISREG(info.st_mode) ||
+      static_cast<size_t>(info.st_size) < min_mapped_file_size) {
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = static_cast<size_t>(info.st_size);
+  void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED) {
+    return nullptr;
+  }
+  return std::make_shared<MappedFileBuffer>(address, size);
+}
+#endif
+
+/**
+ * \brief A file of the write directory to write in background.
+ */
+struct AsyncSave {
+  std::string file_name;                      /**< Name relative to the write directory. */
+  std::string path;                           /**< Full path of the file. */
+  std::function<std::string()> make_content;  /**< Produces the content, called from the writing thread. */
+  std::vector<std::function<void(bool)>>
+      callbacks;                              /**< Called from the main thread when written. */
+  bool success = false;                       /**< Whether the file was written. */
+};
+
+/**
+ * \brief State of the thread that writes files in background.
+ */
+struct AsyncSaveContext {
+  std::mutex mutex;                           /**< Lock for all fields. */
+  std::condition_variable work_condition;     /**< Notified when saves are requested or when stopping. */
+  std::condition_variable done_condition;     /**< Notified when a save is finished. */
+  std::thread thread;                         /**< The writing thread, started when first needed. */
+  bool stopping = false;                      /**< Whether the thread should stop when idle. */
+  std::deque<AsyncSave> pending;              /**< Saves not started yet, oldest first. */
+  std::string current_file_name;              /**< File being written, empty if none. */
+  std::vector<AsyncSave> finished;            /**< Saves whose callbacks were not called yet. */
+};
+
+AsyncSaveContext async_saves_;
+
+#if defined(_WIN32) || defined(__CYGWIN__)
+/**
+ * \brief Converts a UTF-8 path to Windows Unicode.
+ * \param path A path encoded in UTF-8.
+ * \return The same path encoded in UTF-16.
+ */
+std::wstring to_wide_path(const std::string& path) {
+
+  const int size_needed = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+  if (size_needed <= 0) {
+    return std::wstring();
+  }
+  std::wstring converted(size_needed, 0);
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &converted[0], size_needed);
+  converted.resize(size_needed - 1);  // Remove the terminating character.
+  return converted;
+}
+#endif
+
+/**
+ * \brief Writes a file so that it either keeps its old content or gets
+ * the complete new one, even if the program or the system crashes.
+ *
+ * The content goes to a temporary file that is flushed to the disk
+ * and then renamed.
+ *
+ * \param path Full path of the file, encoded in UTF-8.
+ * \param content The content to write.
+ * \return \c true in case of success.
+ */
+bool write_file_atomically(const std::string& path, const std::string& content) {
+
+  const std::string& tmp_path = path + ".solarus_tmp";
+#if defined(_WIN32) || defined(__CYGWIN__)
+  // Narrow functions would use the ANSI code page.
+  const std::wstring& wide_path = to_wide_path(path);
+  const std::wstring& wide_tmp_path = to_wide_path(tmp_path);
+  FILE* file = _wfopen(wide_tmp_path.c_str(), L"wb");
+#else
+  FILE* file = std::fopen(tmp_path.c_str(), "wb");
+#endif
+  if (file == nullptr) {
+    return false;
+  }
+  bool success = std::fwrite(content.data(), 1, content.size(), file) == content.size() &&
+      std::fflush(file) == 0;
+#if defined(_WIN32) || defined(__CYGWIN__)
+  success = success && _commit(_fileno(file)) == 0;
+#elif defined(SOLARUS_HAVE_UNISTD_H)
+  success = success && fsync(fileno(file)) == 0;
+#endif
+  success = std::fclose(file) == 0 && success;
+
+  if (success) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    // rename() does not replace an existing file on Windows.
+    success = MoveFileExW(wide_tmp_path.c_str(), wide_path.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    success = std::rename(tmp_path.c_str(), path.c_str()) == 0;
+#endif
+  }
+  if (!success) {
+#if defined(_WIN32) || defined(__CYGWIN__)
+    _wremove(wide_tmp_path.c_str());
+#else
+    std::remove(tmp_path.c_str());
+#endif
+    return false;
+  }
+
+#if defined(SOLARUS_HAVE_UNISTD_H) && !defined(_WIN32)
+  // Also flush the directory so that the rename itself is durable.
+  const size_t separator_index = path.find_last_of('/');
+  const std::string& dir_path = separator_index == std::string::npos ?
+      std::string(".") : path.substr(0, separator_index);
+  const int dir_fd = open(dir_path.c_str(), O_RDONLY);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+#endif
+  return true;
+}
+
+/**
+ * \brief Function executed by the thread that writes files in background.
+ *
+ * Exits when asked to stop and no save is pending.
+ */
+void run_async_saves() {
+
+  std::unique_lock<std::mutex> lock(async_saves_.mutex);
+  while (true) {
+    if (async_saves_.pending.empty()) {
+      if (async_saves_.stopping) {
+        return;
+      }
+      async_saves_.work_condition.wait(lock);
+      continue;
+    }
+
+    AsyncSave save = std::move(async_saves_.pending.front());
+    async_saves_.pending.pop_front();
+    async_saves_.current_file_name = save.file_name;
+
+    lock.unlock();
+    save.success = write_file_atomically(save.path, save.make_content());
+    save.make_content = nullptr;
+    lock.lock();
+
+    async_saves_.current_file_name.clear();
+    async_saves_.finished.push_back(std::move(save));
+    async_saves_.done_condition.notify_all();
+  }
+}
+
+/**
+ * \brief Stops the thread that writes files in background.
+ *
+ * Pending saves are written first.
+ * Callbacks not called yet are dropped.
+ */
+void stop_async_saves() {
+
+  {
+    std::lock_guard<std::mutex> lock(async_saves_.mutex);
+    if (!async_saves_.thread.joinable()) {
+      return;
+    }
+    async_saves_.stopping = true;
+  }
+  async_saves_.work_condition.notify_all();
+  async_saves_.thread.join();
+
+  std::lock_guard<std::mutex> lock(async_saves_.mutex);
+  async_saves_.thread = std::thread();
+  async_saves_.stopping = false;
+  async_saves_.finished.clear();
+}
+
+/**
+ * \brief Takes the preloaded content of a file if any.
+ * \param[in] file_name Name of a data file.
+ * \param[out] buffer Its content if it was preloaded.
+ * \return \c true if the file was preloaded.
+ */
+bool take_preloaded_file(const std::string& file_name, std::string& buffer) {
+
+  wait_async_save(file_name);
+
+  std::lock_guard<std::mutex> lock(preloaded_files_mutex_);
+  const auto it = preloaded_files_.find(file_name);
+  if (it == preloaded_files_.end()) {
+    return false;
+  }
+  buffer = std::move(it->second.buffer);
+  preloaded_files_size_ -= buffer.size();
+  preloaded_files_.erase(it);
+  return true;
+}
+
+/**
+ * \brief Checks that a data file exists and opens it for reading.
+ * \param file_name Name of the file to open.
+ * \return The opened file.
+ */
+PHYSFS_file* open_data_file(const std::string& file_name) {
+
+  Debug::check_assertion(PHYSFS_exists(file_name.c_str()),
+      std::string("Data file '") + file_name + "' does not exist"
+  );
+  Debug::check_assertion(!PHYSFS_isDirectory(file_name.c_str()),
+      std::string("Data file '") + file_name + "' is a directory"
+  );
+  PHYSFS_file* file = PHYSFS_openRead(file_name.c_str());
+  Debug::check_assertion(file != nullptr,
+      std::string("Cannot open data file '") + file_name + "'"
+  );
+  return file;
+}
+
+/**
+ * \brief Forgets the preloaded content of a file if any.
+ * \param file_name Name of a data file.
+ */
+void forget_preloaded_file(const std::string& file_name) {
+
+  std::lock_guard<std::mutex> lock(preloaded_files_mutex_);
+  const auto it = preloaded_files_.find(file_name);
+  if (it != preloaded_files_.end()) {
+    preloaded_files_size_ -= it->second.buffer.size();
+    preloaded_files_.erase(it);
+  }
+}
+
+/**
+ * \brief Stores the content of a file read in advance.
+ *
+ * If too much memory is used by preloaded files, the oldest ones are
+ * forgotten: files preloaded for maps that were not entered are never
+ * taken.
+ *
+ * \param file_name Name of a data file.
+ * \param buffer Its content.
+ */
+void store_preloaded_file(const std::string& file_name, std::string&& buffer) {
+
+  std::lock_guard<std::mutex> lock(preloaded_files_mutex_);
+  const size_t size = buffer.size();
+  if (size > max_preloaded_files_size ||
+      preloaded_files_.find(file_name) != preloaded_files_.end()) {
+    return;
+  }
+  while (!preloaded_files_.empty() &&
+      preloaded_files_size_ + size > max_preloaded_files_size) {
+    const auto oldest = std::min_element(preloaded_files_.begin(), preloaded_files_.end(),
+        [](const std::pair<const std::string, PreloadedFile>& first,
+            const std::pair<const std::string, PreloadedFile>& second) {
+      return first.second.sequence < second.second.sequence;
+    });
+    preloaded_files_size_ -= oldest->second.buffer.size();
+    preloaded_files_.erase(oldest);
+  }
+  PreloadedFile& file = preloaded_files_[file_name];
+  file.buffer = std::move(buffer);
+  file.sequence = preloaded_files_sequence_++;
+  preloaded_files_size_ += size;
+}
+
 /**
  * \brief Sets the directory where the engine can write files.
  *
@@ -187,8 +668,15 @@ SOLARUS_API void close_quest() {
 
   CurrentQuest::quit();
 
+  stop_async_saves();
   remove_temporary_files();
 
+  {
+    std::lock_guard<std::mutex> lock(preloaded_files_mutex_);
+    preloaded_files_.clear();
+    preloaded_files_size_ = 0;
+  }
+
   quest_path_ = "";
   solarus_write_dir_ = "";
   quest_write_dir_ = "";
@@ -274,6 +762,7 @@ SOLARUS_API bool data_file_exists(
     bool language_specific
 ) {
   const std::string& actual_file_name = get_actual_file_name(file_name, language_specific);
+  wait_async_save(actual_file_name);
   Logger::info(actual_file_name);
   Logger::info(std::to_string(PHYSFS_exists(actual_file_name.c_str())));
   return PHYSFS_exists(actual_file_name.c_str());
@@ -313,26 +802,20 @@ SOLARUS_API std::string get_actual_file_name(
 SOLARUS_API std::string data_file_read(
     const std::string& file_name
 ) {
-  // Open the file.
-  Debug::check_assertion(PHYSFS_exists(file_name.c_str()),
-      std::string("Data file '") + file_name + "' does not exist"
-  );
-  Debug::check_assertion(!PHYSFS_isDirectory(file_name.c_str()),
-      std::string("Data file '") + file_name + "' is a directory"
-  );
-  PHYSFS_file* file = PHYSFS_openRead(file_name.c_str());
-  Debug::check_assertion(file != nullptr,
-      std::string("Cannot open data file '") + file_name + "'"
-  );
-
-  // Load it into memory.
-  size_t size =  static_cast<size_t>(PHYSFS_fileLength(file));
-  std::vector<char> buffer(size);
+  // Use the content read in advance if any.
+  std::string buffer;
+  if (take_preloaded_file(file_name, buffer)) {
+    return buffer;
+  }
 
-  PHYSFS_read(file, buffer.data(), 1, (PHYSFS_uint32) size);
+  // Load the file into memory.
+  PHYSFS_file* file = open_data_file(file_name);
+  const size_t size = static_cast<size_t>(PHYSFS_fileLength(file));
+  buffer.resize(size);
+  PHYSFS_read(file, &buffer[0], 1, (PHYSFS_uint32) size);
   PHYSFS_close(file);
 
-  return std::string(buffer.data(), size);
+  return buffer;
 }
 
 /**
@@ -348,6 +831,113 @@ SOLARUS_API std::string data_file_read(
   return data_file_read(get_actual_file_name(file_name, language_specific));
 }
 
+/**
+ * \brief Opens a data file and gives read-only access to its content.
+ *
+ * Unlike data_file_read(), the content is not copied into a string:
+ * large files of the data directory are mapped in memory,
+ * other files are read once into a buffer recycled after use.
+ * This function can be called from any thread.
+ *
+ * \param file_name Name of the file to open.
+ * \return The content of the file.
+ */
+SOLARUS_API DataFileBufferPtr data_file_read_buffer(
+    const std::string& file_name
+) {
+  // Use the content read in advance if any.
+  std::string preloaded_buffer;
+  if (take_preloaded_file(file_name, preloaded_buffer)) {
+    return DataFileBuffer::create(std::move(preloaded_buffer));
+  }
+
+  PHYSFS_file* file = open_data_file(file_name);
+
+#ifdef SOLARUS_HAVE_MMAP
+  const DataFileBufferPtr& mapped_buffer = map_data_file(file_name);
+  if (mapped_buffer != nullptr) {
+    PHYSFS_close(file);
+    return mapped_buffer;
+  }
+#endif
+
+  const size_t size = static_cast<size_t>(PHYSFS_fileLength(file));
+  const std::shared_ptr<PooledFileBuffer>& buffer = std::make_shared<PooledFileBuffer>(size);
+  PHYSFS_read(file, buffer->get_memory(), 1, (PHYSFS_uint32) size);
+  PHYSFS_close(file);
+  return buffer;
+}
+
+/**
+ * \brief Opens a data file and gives read-only access to its content.
+ * \param file_name Name of the file to open.
+ * \param language_specific \c true if the file is specific to the current language.
+ * \return The content of the file.
+ */
+SOLARUS_API DataFileBufferPtr data_file_read_buffer(
+    const std::string& file_name,
+    bool language_specific
+) {
+  return data_file_read_buffer(get_actual_file_name(file_name, language_specific));
+}
+
+/**
+ * \brief Reads a data file in advance so that the next data_file_read()
+ * call on it does not access the disk.
+ *
+ * The content is kept until it is read once, or until newer preloaded
+ * files need the memory.
+ * Nothing happens if the file does not exist or if it is already preloaded.
+ * This function can be called from any thread.
+ *
+ * \param file_name Name of the file to preload.
+ */
+SOLARUS_API void data_file_preload(
+    const std::string& file_name
+) {
+  {
+    std::lock_guard<std::mutex> lock(preloaded_files_mutex_);
+    if (preloaded_files_.find(file_name) != preloaded_files_.end()) {
+      return;
+    }
+  }
+
+  wait_async_save(file_name);
+  if (!PHYSFS_exists(file_name.c_str()) ||
+      PHYSFS_isDirectory(file_name.c_str())) {
+    return;
+  }
+
+  PHYSFS_file* file = PHYSFS_openRead(file_name.c_str());
+  if (file == nullptr) {
+    return;
+  }
+  const size_t size = static_cast<size_t>(PHYSFS_fileLength(file));
+  std::string buffer(size, '\0');
+  PHYSFS_read(file, &buffer[0], 1, (PHYSFS_uint32) size);
+  PHYSFS_close(file);
+
+  store_preloaded_file(file_name, std::move(buffer));
+}
+
+/**
+ * \brief Gives the content of a data file already read by the caller
+ * so that the next data_file_read() call on it returns it.
+ *
+ * This is useful when a thread needs to parse a file in advance
+ * and the main thread will read it again later.
+ * This function can be called from any thread.
+ *
+ * \param file_name Name of the file.
+ * \param buffer Its content.
+ */
+SOLARUS_API void data_file_preload(
+    const std::string& file_name,
+    const std::string& buffer
+) {
+  store_preloaded_file(file_name, std::string(buffer));
+}
+
 /**
  * \brief Saves a buffer into a data file.
  * \param file_name Name of the file to write, relative to Solarus write directory.
@@ -358,6 +948,9 @@ SOLARUS_API void data_file_save(
     const std::string& file_name,
     const std::string& buffer
 ) {
+  wait_async_save(file_name);
+  forget_preloaded_file(file_name);
+
   // open the file to write
   PHYSFS_file* file = PHYSFS_openWrite(file_name.c_str());
   if (file == nullptr) {
@@ -374,6 +967,125 @@ SOLARUS_API void data_file_save(
   PHYSFS_close(file);
 }
 
+/**
+ * \brief Saves a file into the write directory in background.
+ *
+ * The file is written to a temporary file first, flushed to the disk and
+ * then renamed, so that it is never left half-written.
+ * If the same file is saved again before its writing starts,
+ * only the last content is written: bursts of saves are coalesced.
+ *
+ * Other functions of QuestFiles that access the file wait until it is
+ * written, so they always see the last saved content.
+ *
+ * \param file_name Name of the file to write, relative to the Solarus
+ * write directory.
+ * \param make_content Function producing the content to write.
+ * It is called from the writing thread, so it should work on a copy
+ * of the data.
+ * \param callback Function to call with \c true in case of success
+ * or \c false in case of failure, from update_async_saves().
+ * Can be empty.
+ */
+SOLARUS_API void data_file_save_async(
+    const std::string& file_name,
+    const std::function<std::string()>& make_content,
+    const std::function<void(bool)>& callback
+) {
+  forget_preloaded_file(file_name);
+
+  const char* write_dir = PHYSFS_getWriteDir();
+  Debug::check_assertion(write_dir != nullptr,
+      std::string("Cannot save file '") + file_name + "': no write directory"
+  );
+  const std::string& path = std::string(write_dir) + PHYSFS_getDirSeparator() + file_name;
+
+  std::lock_guard<std::mutex> lock(async_saves_.mutex);
+  if (!async_saves_.thread.joinable()) {
+    async_saves_.thread = std::thread(run_async_saves);
+  }
+
+  for (AsyncSave& save : async_saves_.pending) {
+    if (save.file_name == file_name) {
+      // Not started yet: just write the new content instead.
+      save.make_content = make_content;
+      save.callbacks.push_back(callback);
+      return;
+    }
+  }
+
+  AsyncSave save;
+  save.file_name = file_name;
+  save.path = path;
+  save.make_content = make_content;
+  save.callbacks.push_back(callback);
+  async_saves_.pending.push_back(std::move(save));
+  async_saves_.work_condition.notify_one();
+}
+
+/**
+ * \brief Calls the callbacks of files saved in background since
+ * the last call.
+ *
+ * Must be called from the main thread.
+ */
+SOLARUS_API void update_async_saves() {
+
+  std::vector<AsyncSave> finished;
+  {
+    std::lock_guard<std::mutex> lock(async_saves_.mutex);
+    finished.swap(async_saves_.finished);
+  }
+
+  for (const AsyncSave& save : finished) {
+    if (!save.success) {
+      Debug::error(std::string("Cannot write file '") + save.file_name + "'");
+    }
+    for (const std::function<void(bool)>& callback : save.callbacks) {
+      if (callback) {
+        callback(save.success);
+      }
+    }
+  }
+}
+
+/**
+ * \brief Waits until all files saved in background are written
+ * and calls their callbacks.
+ *
+ * Must be called from the main thread.
+ */
+SOLARUS_API void finish_async_saves() {
+
+  {
+    std::unique_lock<std::mutex> lock(async_saves_.mutex);
+    while (!async_saves_.pending.empty() ||
+        !async_saves_.current_file_name.empty()) {
+      async_saves_.done_condition.wait(lock);
+    }
+  }
+  update_async_saves();
+}
+
+/**
+ * \brief Waits until a file is no longer being written in background.
+ *
+ * This ensures that reading a file just saved returns the new content.
+ *
+ * \param file_name Name of a file.
+ */
+SOLARUS_API void wait_async_save(const std::string& file_name) {
+
+  std::unique_lock<std::mutex> lock(async_saves_.mutex);
+  while (async_saves_.current_file_name == file_name ||
+      std::find_if(async_saves_.pending.begin(), async_saves_.pending.end(),
+          [&file_name](const AsyncSave& save) {
+        return save.file_name == file_name;
+      }) != async_saves_.pending.end()) {
+    async_saves_.done_condition.wait(lock);
+  }
+}
+
 /**
  * \brief Removes a file from the write directory.
  * \param file_name Name of the file to delete, relative to the Solarus
@@ -382,6 +1094,9 @@ SOLARUS_API void data_file_save(
  */
 SOLARUS_API bool data_file_delete(const std::string& file_name) {
 
+  wait_async_save(file_name);
+  forget_preloaded_file(file_name);
+
   if (!PHYSFS_delete(file_name.c_str())) {
     return false;
   }
@@ -417,6 +1132,34 @@ SOLARUS_API bool data_file_is_dir(const std::string& file_name) {
       PHYSFS_isDirectory(file_name.c_str());
 }
 
+/**
+ * \brief Returns the size and the last modification time of a data file.
+ *
+ * This allows to detect changes in a file without reading it.
+ *
+ * \param[in] file_name A file name relative to the quest data directory
+ * or to Solarus write directory.
+ * \param[out] size Size of the file in bytes.
+ * \param[out] modification_time Last modification time of the file,
+ * or -1 if it cannot be determined.
+ * \return \c false if the file does not exist or cannot be opened.
+ */
+SOLARUS_API bool data_file_get_info(
+    const std::string& file_name,
+    int64_t& size,
+    int64_t& modification_time
+) {
+  PHYSFS_file* file = PHYSFS_openRead(file_name.c_str());
+  if (file == nullptr) {
+    return false;
+  }
+  size = PHYSFS_fileLength(file);
+  PHYSFS_close(file);
+
+  modification_time = PHYSFS_getLastModTime(file_name.c_str());
+  return true;
+}
+
 /**
  * \brief Lists files of a directory.
  * \param dir_path Name of the directory to list, relative to the quest data
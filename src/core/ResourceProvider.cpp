@@ -14,88 +14,632 @@
  * You should have received a copy of the GNU General Public License along
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
+#include "solarus/audio/Music.h"
 #include "solarus/core/CurrentQuest.h"
-#include "solarus/core/ResourceProvider.h"
+#include "solarus/core/MapData.h"
 #include "solarus/core/QuestDatabase.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/core/ResourceProvider.h"
+#include "solarus/entities/EntityData.h"
+#include "solarus/entities/EntityType.h"
+#include "solarus/graphics/PixelBitsCache.h"
+#include "solarus/graphics/SpriteData.h"
+#include "solarus/graphics/Surface.h"
+#include <algorithm>
+#include <set>
 
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Returns the sprites that entities of a map are created with.
+ * \param map_data A map.
+ * \return The sprite ids found in entity properties.
+ */
+std::set<std::string> get_sprite_ids(const MapData& map_data) {
+
+  std::set<std::string> sprite_ids;
+  for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
+    for (int i = 0; i < map_data.get_num_entities(layer); ++i) {
+      const EntityData& entity = map_data.get_entity({ layer, i });
+      if (entity.is_string("sprite")) {
+        const std::string& sprite_id = entity.get_string("sprite");
+        if (!sprite_id.empty()) {
+          sprite_ids.insert(sprite_id);
+        }
+      }
+    }
+  }
+  return sprite_ids;
+}
+
+}
+
+/**
+ * \brief Compares the urgency of two jobs.
+ *
+ * Jobs with a higher priority come first, and then the oldest ones.
+ *
+ * \param other Another job.
+ * \return \c true if this job is less urgent than the other one.
+ */
+bool ResourceProvider::Job::operator<(const Job& other) const {
+
+  if (priority != other.priority) {
+    return priority < other.priority;
+  }
+  return sequence > other.sequence;
+}
+
 /**
  * \brief Creates a resource provider.
  */
-ResourceProvider::ResourceProvider() {
+ResourceProvider::ResourceProvider():
+  workers(),
+  mutex(),
+  jobs_available(),
+  stopping(false),
+  jobs(),
+  next_sequence(0),
+  entries(),
+  tileset_cache() {
 }
 
 /**
- * \brief Preloads resources in background in a separate thread.
+ * \brief Destroys the resource provider.
+ */
+ResourceProvider::~ResourceProvider() {
+
+  stop_workers();
+}
+
+/**
+ * \brief Preloads resources in background in worker threads.
  */
 void ResourceProvider::start_preloading_resources() {
 
   // Put all tilesets in the cache, without loading them yet.
   const QuestDatabase& database = CurrentQuest::get_database();
-  const QuestDatabase::ResourceMap& tileset_ids = database.get_resource_elements(ResourceType::TILESET);
-  std::vector<std::shared_ptr<Tileset>> tilesets_to_preload;
-  for (const auto& pair : tileset_ids) {
-    const std::string& tileset_id = pair.first;
-    std::shared_ptr<Tileset> tileset = std::make_shared<Tileset>(tileset_id);
-    tileset_cache.emplace(tileset_id, tileset);
-    tilesets_to_preload.emplace_back(tileset);
-  }
-
-  // Start loading them in a separate thread.
-  preloader_thread = std::thread([this, tilesets_to_preload]() {
-
-    for (const std::shared_ptr<Tileset>& tileset : tilesets_to_preload) {
-      if (tileset_cache.empty()) {
-        // clear() was probably called in the meantime.
-        // No reason to continue.
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& kvp : database.get_resource_elements(ResourceType::TILESET)) {
+      const std::string& tileset_id = kvp.first;
+      tileset_cache.emplace(tileset_id, std::make_shared<Tileset>(tileset_id));
+    }
+  }
+
+  start_workers();
+
+  for (const auto& kvp : database.get_resource_elements(ResourceType::TILESET)) {
+    preload(ResourceType::TILESET, kvp.first, Priority::LOW);
+  }
+
+  // Sounds are decoded the first time they are played.
+  // Request them first so that they are the first files forgotten
+  // if preloaded files take too much memory.
+  for (const auto& kvp : database.get_resource_elements(ResourceType::SOUND)) {
+    preload(ResourceType::SOUND, kvp.first, Priority::LOW);
+  }
+
+  // Fonts are all loaded the first time a text is drawn,
+  // and dialogs when the language is set.
+  for (const auto& kvp : database.get_resource_elements(ResourceType::FONT)) {
+    preload(ResourceType::FONT, kvp.first, Priority::LOW);
+  }
+  for (const auto& kvp : database.get_resource_elements(ResourceType::LANGUAGE)) {
+    preload(ResourceType::LANGUAGE, kvp.first, Priority::LOW);
+  }
+
+  // Optionally analyze sprite images for pixel-precise collisions.
+  if (PixelBitsCache::is_preloading_enabled()) {
+    for (const auto& kvp : database.get_resource_elements(ResourceType::SPRITE)) {
+      preload(ResourceType::SPRITE, kvp.first, Priority::LOW);
+    }
+  }
+}
+
+/**
+ * \brief Starts the worker threads if they are not running yet.
+ */
+void ResourceProvider::start_workers() {
+
+  if (!workers.empty()) {
+    return;
+  }
+
+  // Leave a core to the main thread.
+  const int num_cores = static_cast<int>(std::thread::hardware_concurrency());
+  const int num_workers = std::max(1, std::min(num_cores - 1, max_workers));
+
+  std::lock_guard<std::mutex> lock(mutex);
+  stopping = false;
+  for (int i = 0; i < num_workers; ++i) {
+    workers.emplace_back(&ResourceProvider::run_worker, this);
+  }
+}
+
+/**
+ * \brief Stops the worker threads and waits for them to finish.
+ *
+ * A resource being loaded is finished first. Pending jobs are dropped.
+ */
+void ResourceProvider::stop_workers() {
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  jobs_available.notify_all();
+
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+  workers.clear();
+}
+
+/**
+ * \brief Main function of a worker thread.
+ *
+ * Loads requested resources, most urgent first, until workers are stopped.
+ */
+void ResourceProvider::run_worker() {
+
+  while (true) {
+
+    ResourceKey key;
+    Priority priority;
+    std::shared_ptr<Entry> entry;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      jobs_available.wait(lock, [this]() {
+        return stopping || !jobs.empty();
+      });
+      if (stopping) {
         return;
       }
-      tileset->load();
-      std::this_thread::yield();
+
+      const Job job = jobs.top();
+      jobs.pop();
+      const auto it = entries.find(job.key);
+      if (it == entries.end() || it->second->started) {
+        // Already loaded, being loaded, or obsolete request.
+        continue;
+      }
+      entry = it->second;
+      entry->started = true;
+      key = job.key;
+      priority = job.priority;
+    }
+
+    load(key, *entry, priority);
+  }
+}
+
+/**
+ * \brief Returns the loading state of a resource element, creating it if needed.
+ *
+ * The mutex must be locked.
+ *
+ * \param key A resource element.
+ * \return Its loading state.
+ */
+std::shared_ptr<ResourceProvider::Entry> ResourceProvider::get_entry(const ResourceKey& key) {
+
+  std::shared_ptr<Entry>& entry = entries[key];
+  if (entry == nullptr) {
+    entry = std::make_shared<Entry>();
+    entry->future = entry->promise.get_future().share();
+  }
+  return entry;
+}
+
+/**
+ * \brief Requests to load a resource element in background.
+ *
+ * If the element was already requested with a lower priority,
+ * its priority is raised.
+ * Requests are ignored if workers are not running.
+ *
+ * \param resource_type Type of resource.
+ * \param element_id Id of the element to load.
+ * \param priority Urgency of the request.
+ * \return A future that becomes ready when the element is loaded.
+ * It is only guaranteed to become ready if workers are running
+ * or if the main thread needs the element.
+ */
+std::shared_future<void> ResourceProvider::preload(
+    ResourceType resource_type,
+    const std::string& element_id,
+    Priority priority) {
+
+  const ResourceKey key(resource_type, element_id);
+  std::shared_future<void> future;
+  bool queued = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const std::shared_ptr<Entry>& entry = get_entry(key);
+    future = entry->future;
+    if (!entry->started && !stopping && !workers.empty()) {
+      // If the element was already queued, the old job will be skipped.
+      jobs.push({ priority, next_sequence++, key });
+      queued = true;
     }
-  });
+  }
+
+  if (queued) {
+    jobs_available.notify_one();
+  }
+  return future;
+}
+
+/**
+ * \brief Requests to load the maps that teletransporters of a map lead to.
+ *
+ * Maps reached by scrolling through a side of the map get a high priority
+ * because their transition cannot hide a delay.
+ * Maps loaded in advance for a previous map and not used are forgotten.
+ *
+ * \param map_data A map that was just loaded.
+ */
+void ResourceProvider::preload_map_destinations(const MapData& map_data) {
+
+  if (workers.empty()) {
+    // Nothing is loaded in background.
+    return;
+  }
+
+  std::map<std::string, Priority> destination_map_ids;
+  for (int layer = map_data.get_min_layer(); layer <= map_data.get_max_layer(); ++layer) {
+    for (int i = 0; i < map_data.get_num_entities(layer); ++i) {
+      const EntityData& entity = map_data.get_entity({ layer, i });
+      if (entity.get_type() != EntityType::TELETRANSPORTER) {
+        continue;
+      }
+      const std::string& destination_map_id = entity.get_string("destination_map");
+      if (destination_map_id.empty()) {
+        continue;
+      }
+      const bool scrolling = entity.get_string("transition") == "scrolling" ||
+          entity.get_string("destination") == "_side";
+      Priority& priority = destination_map_ids[destination_map_id];
+      if (scrolling) {
+        priority = Priority::HIGH;
+      }
+      else if (priority == Priority::LOW) {
+        priority = Priority::NORMAL;
+      }
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = entries.begin(); it != entries.end();) {
+      const ResourceKey& key = it->first;
+      const Entry& entry = *it->second;
+      if (key.first == ResourceType::MAP &&
+          entry.started &&
+          entry.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+          destination_map_ids.find(key.second) == destination_map_ids.end()) {
+        it = entries.erase(it);
+      }
+      else {
+        ++it;
+      }
+    }
+  }
+
+  for (const auto& kvp : destination_map_ids) {
+    preload(ResourceType::MAP, kvp.first, kvp.second);
+  }
+}
+
+/**
+ * \brief Makes sure that a resource element is loaded, from the main thread.
+ *
+ * If no worker has started loading it, it is loaded now.
+ * Otherwise, waits for the worker.
+ * Errors that occurred while loading are rethrown.
+ *
+ * \param key A resource element.
+ */
+void ResourceProvider::load_now(const ResourceKey& key) {
+
+  std::shared_ptr<Entry> entry;
+  bool must_load = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    entry = get_entry(key);
+    if (!entry->started) {
+      entry->started = true;
+      must_load = true;
+    }
+  }
+
+  if (must_load) {
+    load(key, *entry, Priority::HIGH);
+  }
+  entry->future.get();
+}
+
+/**
+ * \brief Loads a resource element and fulfills its promise.
+ *
+ * Can be called from any thread.
+ *
+ * \param key The resource element.
+ * \param entry Its loading state, already marked as started.
+ * \param priority Priority of the request, also used for dependencies.
+ */
+void ResourceProvider::load(const ResourceKey& key, Entry& entry, Priority priority) {
+
+  const ResourceType resource_type = key.first;
+  const std::string& element_id = key.second;
+
+  try {
+    switch (resource_type) {
+
+    case ResourceType::TILESET:
+    {
+      std::shared_ptr<Tileset> tileset;
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        const auto it = tileset_cache.find(element_id);
+        if (it != tileset_cache.end()) {
+          tileset = it->second;
+        }
+      }
+      if (tileset != nullptr) {
+        tileset->load();
+      }
+    }
+      break;
+
+    case ResourceType::MAP:
+    {
+      std::shared_ptr<MapData> map_data = std::make_shared<MapData>();
+      const std::string& file_name = std::string("maps/") + element_id + ".dat";
+      if (!map_data->import_from_quest_file(file_name)) {
+        // The map will fail to load when actually needed.
+        break;
+      }
+      QuestFiles::data_file_preload(std::string("maps/") + element_id + ".lua");
+      entry.map_data = map_data;
+
+      // Warm what building the map will need.
+      preload(ResourceType::TILESET, map_data->get_tileset_id(), priority);
+      for (const std::string& sprite_id : get_sprite_ids(*map_data)) {
+        preload(ResourceType::SPRITE, sprite_id, priority);
+      }
+      const std::string& music_id = map_data->get_music_id();
+      if (music_id != Music::none && music_id != Music::unchanged) {
+        preload(ResourceType::MUSIC, music_id, priority);
+      }
+    }
+      break;
+
+    case ResourceType::SPRITE:
+      load_sprite(element_id, priority);
+      break;
+
+    case ResourceType::SOUND:
+      QuestFiles::data_file_preload(std::string("sounds/") + element_id + ".ogg");
+      break;
+
+    case ResourceType::MUSIC:
+    {
+      const std::string& file_name_start = std::string("musics/") + element_id;
+      QuestFiles::data_file_preload(file_name_start + ".ogg");
+      QuestFiles::data_file_preload(file_name_start + ".it");
+      QuestFiles::data_file_preload(file_name_start + ".spc");
+    }
+      break;
+
+    case ResourceType::FONT:
+    {
+      // Same files as FontResource::load_fonts().
+      const std::string& file_name_start = std::string("fonts/") + element_id;
+      const std::string extensions[] = {
+          ".png", ".PNG", ".ttf", ".TTF", ".otf", ".OTF", ".ttc", ".TTC", ".fon", ".FON"
+      };
+      for (const std::string& extension : extensions) {
+        const std::string& file_name = file_name_start + extension;
+        if (!QuestFiles::data_file_exists(file_name)) {
+          continue;
+        }
+        if (extension == ".png" || extension == ".PNG") {
+          // Bitmap font.
+          Surface::preload_file(file_name, Surface::DIR_DATA);
+        }
+        else {
+          // Outline font.
+          QuestFiles::data_file_preload(file_name);
+        }
+        break;
+      }
+    }
+      break;
+
+    case ResourceType::LANGUAGE:
+    {
+      const std::string& directory = std::string("languages/") + element_id + "/text/";
+      QuestFiles::data_file_preload(directory + "dialogs.dat");
+      QuestFiles::data_file_preload(directory + "strings.dat");
+    }
+      break;
+
+    default:
+      // Nothing to load in advance.
+      break;
+    }
+
+    entry.promise.set_value();
+  }
+  catch (...) {
+    entry.promise.set_exception(std::current_exception());
+  }
+
+  if (resource_type != ResourceType::TILESET &&
+      resource_type != ResourceType::MAP) {
+    // Only files were read in advance, and they are forgotten once used:
+    // forget the request too so that it can be loaded again.
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = entries.find(key);
+    if (it != entries.end() && it->second.get() == &entry) {
+      entries.erase(it);
+    }
+  }
+}
+
+/**
+ * \brief Reads the files of a sprite in advance.
+ *
+ * The sprite data file and the decoded images it uses are kept in memory
+ * until the main thread creates the sprite.
+ * If pixel bits preloading is enabled, frames are also analyzed.
+ *
+ * \param sprite_id Id of a sprite animation set.
+ * \param priority Priority of the request.
+ */
+void ResourceProvider::load_sprite(const std::string& sprite_id, Priority priority) {
+
+  const std::string& file_name = std::string("sprites/") + sprite_id + ".dat";
+  if (!QuestFiles::data_file_exists(file_name)) {
+    return;
+  }
+  const std::string& buffer = QuestFiles::data_file_read(file_name);
+  SpriteData data;
+  if (!data.import_from_quest_buffer(buffer, file_name)) {
+    return;
+  }
+  QuestFiles::data_file_preload(file_name, buffer);
+
+  // Images are needed soon only if the sprite is.
+  if (priority != Priority::LOW) {
+    std::set<std::string> image_file_names;
+    for (const auto& kvp : data.get_animations()) {
+      const SpriteAnimationData& animation = kvp.second;
+      if (!animation.src_image_is_tileset()) {
+        image_file_names.insert(animation.get_src_image());
+      }
+    }
+    for (const std::string& image_file_name : image_file_names) {
+      Surface::preload_file(image_file_name, Surface::DIR_SPRITES);
+    }
+  }
+
+  if (PixelBitsCache::is_preloading_enabled()) {
+    preload_sprite_pixel_bits(data);
+  }
+}
+
+/**
+ * \brief Creates the pixel bits of all frames of a sprite.
+ *
+ * Frames that come from tilesets are skipped.
+ * This function is called from worker threads.
+ *
+ * \param data The sprite animation set.
+ */
+void ResourceProvider::preload_sprite_pixel_bits(const SpriteData& data) {
+
+  // Group frames by image to load each image once.
+  std::map<std::string, std::vector<Rectangle>> frames_by_image;
+  for (const auto& kvp : data.get_animations()) {
+    const SpriteAnimationData& animation = kvp.second;
+    if (animation.src_image_is_tileset()) {
+      continue;
+    }
+    std::vector<Rectangle>& frames = frames_by_image["sprites/" + animation.get_src_image()];
+    for (const SpriteAnimationDirectionData& direction : animation.get_directions()) {
+      const std::vector<Rectangle>& direction_frames = direction.get_all_frames();
+      frames.insert(frames.end(), direction_frames.begin(), direction_frames.end());
+    }
+  }
+
+  for (const auto& kvp : frames_by_image) {
+    PixelBitsCache::preload_pixel_bits(kvp.first, kvp.second);
+  }
 }
 
 /**
  * \brief Clears all stored resources.
+ *
+ * Worker threads are stopped.
  */
 void ResourceProvider::clear() {
 
+  stop_workers();
+
+  std::lock_guard<std::mutex> lock(mutex);
+  jobs = std::priority_queue<Job>();
+  entries.clear();
   tileset_cache.clear();
-  preloader_thread.join();
 }
 
 /**
  * \brief Provides the tileset with the given id.
+ *
+ * If a worker is loading it, waits for it to finish.
+ *
  * \param tileset_id A tileset id.
  * \return The corresponding tileset.
  */
 Tileset& ResourceProvider::get_tileset(const std::string& tileset_id) {
 
   std::shared_ptr<Tileset> tileset;
-  auto it = tileset_cache.find(tileset_id);
-  if (it->second != nullptr) {
-    tileset = it->second;
-  }
-  else {
-    tileset = std::make_shared<Tileset>(tileset_id);
-    tileset_cache.emplace(tileset_id, tileset);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    const auto it = tileset_cache.find(tileset_id);
+    if (it != tileset_cache.end() && it->second != nullptr) {
+      tileset = it->second;
+    }
+    else {
+      tileset = std::make_shared<Tileset>(tileset_id);
+      tileset_cache[tileset_id] = tileset;
+    }
   }
 
-  tileset->load();
+  load_now(ResourceKey(ResourceType::TILESET, tileset_id));
 
   return *tileset;
 }
 
 /**
  * \brief Returns all tilesets currently in cache.
+ *
+ * Only the main thread adds tilesets to the cache.
+ *
  * \return The loaded tilesets.
  */
 const std::map<std::string, std::shared_ptr<Tileset>>& ResourceProvider::get_loaded_tilesets() {
   return tileset_cache;
 }
 
+/**
+ * \brief Provides the data of a map.
+ *
+ * If the map was loaded in advance, its data is returned and forgotten.
+ * Otherwise, it is loaded now.
+ *
+ * \param map_id A map id.
+ * \return The data of this map.
+ */
+std::shared_ptr<const MapData> ResourceProvider::get_map_data(const std::string& map_id) {
+
+  const ResourceKey key(ResourceType::MAP, map_id);
+  load_now(key);
+
+  std::shared_ptr<MapData> map_data;
+  std::lock_guard<std::mutex> lock(mutex);
+  const auto it = entries.find(key);
+  if (it != entries.end()) {
+    map_data = it->second->map_data;
+    entries.erase(it);
+  }
+  return map_data;
+}
+
 /**
  * \brief Notifies the resource provider that cached data (if any) is no longer valid.
  *
@@ -108,6 +652,9 @@ void ResourceProvider::invalidate_resource_element(
     ResourceType resource_type,
     const std::string& element_id) {
 
+  std::lock_guard<std::mutex> lock(mutex);
+  entries.erase(ResourceKey(resource_type, element_id));
+
   switch (resource_type) {
 
   case ResourceType::TILESET:
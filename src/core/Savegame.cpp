@@ -23,7 +23,9 @@
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include <lua.hpp>
+#include <algorithm>
 #include <sstream>
+#include <vector>
 
 namespace Solarus {
 
@@ -310,14 +312,49 @@ int Savegame::l_newindex(lua_State* l) {
 
 /**
  * \brief Saves the data into a file.
+ *
+ * The file is written in background from a snapshot of the current values
+ * (see QuestFiles::data_file_save_async()).
+ *
+ * \param callback Function to call from the main loop with \c true
+ * when the file is written, or with \c false if it could not be written.
+ * Can be empty.
+ */
+void Savegame::save(const std::function<void(bool)>& callback) {
+
+  const std::shared_ptr<const SavedValues> values =
+      std::make_shared<const SavedValues>(saved_values);
+  QuestFiles::data_file_save_async(file_name, [values]() {
+    return export_values(*values);
+  }, callback);
+  empty = false;
+}
+
+/**
+ * \brief Converts saved values to the text of a savegame file.
+ *
+ * Values are written in alphabetical order of keys.
+ *
+ * \param values The values to save.
+ * \return The content of the savegame file.
  */
-void Savegame::save() {
+std::string Savegame::export_values(const SavedValues& values) {
+
+  std::vector<const SavedValues::value_type*> sorted_values;
+  sorted_values.reserve(values.size());
+  for (const auto& kvp: values) {
+    sorted_values.push_back(&kvp);
+  }
+  std::sort(sorted_values.begin(), sorted_values.end(), [](
+      const SavedValues::value_type* lhs, const SavedValues::value_type* rhs) {
+    return lhs->first < rhs->first;
+  });
 
   std::ostringstream oss;
-  for (const auto& kvp: saved_values) {
-    const std::string& key = kvp.first;
+  for (const SavedValues::value_type* kvp: sorted_values) {
+    const std::string& key = kvp->first;
     oss << key << " = ";
-    const SavedValue& value = kvp.second;
+    const SavedValue& value = kvp->second;
     if (value.type == SavedValue::VALUE_BOOLEAN) {
       oss << (value.int_data ? "true" : "false");
     }
@@ -330,9 +367,7 @@ void Savegame::save() {
     oss << "\n";
   }
 
-  const std::string& text = oss.str();
-  QuestFiles::data_file_save(file_name, text);
-  empty = false;
+  return oss.str();
 }
 
 /**
@@ -482,8 +517,9 @@ void Savegame::set_string(const std::string& key, const std::string& value) {
   Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  saved_values[key].type = SavedValue::VALUE_STRING;
-  saved_values[key].string_data = value;
+  SavedValue& saved_value = saved_values[key];
+  saved_value.type = SavedValue::VALUE_STRING;
+  saved_value.string_data = value;
 }
 
 /**
@@ -538,8 +574,9 @@ void Savegame::set_integer(const std::string& key, int value) {
   Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  saved_values[key].type = SavedValue::VALUE_INTEGER;
-  saved_values[key].int_data = value;
+  SavedValue& saved_value = saved_values[key];
+  saved_value.type = SavedValue::VALUE_INTEGER;
+  saved_value.int_data = value;
 }
 
 /**
@@ -594,8 +631,9 @@ void Savegame::set_boolean(const std::string& key, bool value) {
   Debug::check_assertion(LuaTools::is_valid_lua_identifier(key),
       std::string("Savegame variable '") + key + "' is not a valid key");
 
-  saved_values[key].type = SavedValue::VALUE_BOOLEAN;
-  saved_values[key].int_data = value;
+  SavedValue& saved_value = saved_values[key];
+  saved_value.type = SavedValue::VALUE_BOOLEAN;
+  saved_value.int_data = value;
 }
 
 /**
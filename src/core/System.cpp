@@ -17,6 +17,7 @@
 #include "solarus/audio/Sound.h"
 #include "solarus/core/FontResource.h"
 #include "solarus/core/InputEvent.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Random.h"
 #include "solarus/core/System.h"
@@ -49,6 +50,9 @@ void System::initialize(const Arguments& args) {
   initial_time = get_real_time();
   ticks = 0;
 
+  // profiler
+  Profiler::initialize(args);
+
   // audio
   printf("sound init\n");
   Sound::initialize(args);
@@ -84,6 +88,8 @@ void System::quit() {
   FontResource::quit();
   Video::quit();
 
+  Profiler::quit();
+
   SDL_Quit();
 }
 
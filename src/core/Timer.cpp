@@ -160,6 +160,23 @@ void Timer::set_expiration_date(uint32_t expiration_date) {
   this->finished = System::now() >= this->expiration_date;
 }
 
+/**
+ * \brief Returns the next date when update() has something to do.
+ *
+ * This is the expiration date, or the date of the next clock sound
+ * if it comes first.
+ * Suspending the timer or changing its dates may change this value.
+ *
+ * \return The next date to update this timer in milliseconds.
+ */
+uint32_t Timer::get_next_update_date() const {
+
+  if (is_with_sound() && !finished && next_sound_date < expiration_date) {
+    return next_sound_date;
+  }
+  return expiration_date;
+}
+
 /**
  * \brief Updates the timer.
  */
@@ -0,0 +1,419 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Map.h"
+#include "solarus/core/Scale.h"
+#include "solarus/entities/AnimatedTileMap.h"
+#include "solarus/entities/Camera.h"
+#include "solarus/entities/Tile.h"
+#include "solarus/entities/TilePattern.h"
+#include "solarus/entities/Tileset.h"
+#include "solarus/graphics/DefaultShaders.h"
+#include "solarus/graphics/Renderer.h"
+#include "solarus/graphics/Shader.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include <algorithm>
+#include <string>
+
+namespace Solarus {
+
+namespace {
+
+constexpr int max_pattern_ids = 254;    /**< Patterns that can go through the frames texture. */
+constexpr uint8_t fixed_square = 255;   /**< Alpha of index texels giving a tileset square directly. */
+
+/**
+ * \brief Returns the fragment shader of tile maps.
+ *
+ * Each texel of the index texture (sol_texture) describes an 8x8 square
+ * of the map:
+ * - alpha 0: nothing to draw,
+ * - alpha 255: red, green and the two halves of blue give the coordinates
+ *   of a tileset square,
+ * - other alpha values: id + 1 of a pattern in the frames texture,
+ *   red and green give the square inside this pattern.
+ * Texels of the frames texture give the tileset position in pixels of the
+ * current frame of each pattern, on 16 bits per coordinate.
+ */
+const std::string& get_fragment_source() {
+
+  static const std::string source = DefaultShaders::get_default_fragment_compat_header() +
+R"(
+uniform sampler2D sol_texture;
+uniform sampler2D sol_tileset;
+uniform sampler2D sol_tile_frames;
+uniform vec2 sol_input_size;
+uniform vec2 sol_tileset_size;
+uniform float sol_num_tile_frames;
+uniform bool sol_alpha_mult;
+COMPAT_VARYING vec2 sol_vtex_coord;
+COMPAT_VARYING vec4 sol_vcolor;
+
+vec4 to_bytes(vec4 texel) {
+    return floor(texel * 255.0 + 0.5);
+}
+
+void main() {
+    vec2 map_xy = sol_vtex_coord * sol_input_size * 8.0;
+    vec2 square = floor(map_xy / 8.0);
+    vec4 entry = to_bytes(COMPAT_TEXTURE(sol_texture, (square + 0.5) / sol_input_size));
+    if (entry.a == 0.0) {
+        FragColor = vec4(0.0);
+        return;
+    }
+
+    vec2 tileset_xy;
+    if (entry.a == 255.0) {
+        vec2 high = vec2(mod(entry.b, 16.0), floor(entry.b / 16.0));
+        tileset_xy = (entry.rg + high * 256.0) * 8.0;
+    } else {
+        vec4 frame = to_bytes(COMPAT_TEXTURE(sol_tile_frames,
+            vec2((entry.a - 0.5) / sol_num_tile_frames, 0.5)));
+        tileset_xy = frame.rb + frame.ga * 256.0 + entry.rg * 8.0;
+    }
+    tileset_xy += map_xy - square * 8.0;
+
+    vec4 tex_color = COMPAT_TEXTURE(sol_tileset, tileset_xy / sol_tileset_size);
+    FragColor = tex_color * sol_vcolor;
+    if (sol_alpha_mult) {
+        FragColor.rgb *= sol_vcolor.a; //Premultiply by opacity too
+    }
+}
+)";
+  return source;
+}
+
+/**
+ * \brief Writes a pixel into a buffer of RGBA pixels.
+ * \param pixels The buffer.
+ * \param index Index of the pixel.
+ * \param r Red byte.
+ * \param g Green byte.
+ * \param b Blue byte.
+ * \param a Alpha byte.
+ */
+void set_pixel(std::string& pixels, size_t index, int r, int g, int b, int a) {
+
+  pixels[index * 4] = static_cast<char>(r);
+  pixels[index * 4 + 1] = static_cast<char>(g);
+  pixels[index * 4 + 2] = static_cast<char>(b);
+  pixels[index * 4 + 3] = static_cast<char>(a);
+}
+
+/**
+ * \brief Creates a texture with the given pixels.
+ * \param size Size of the texture.
+ * \param pixels The RGBA pixels.
+ * \return The texture, ready to be drawn with the tile map shader.
+ */
+SurfacePtr create_data_surface(const Size& size, const std::string& pixels) {
+
+  SDL_PixelFormat* format = Video::get_pixel_format();
+  SDL_Surface_UniquePtr sdl_surface(SDL_CreateRGBSurface(
+      0,
+      size.width,
+      size.height,
+      32,
+      format->Rmask,
+      format->Gmask,
+      format->Bmask,
+      format->Amask
+  ));
+  Debug::check_assertion(sdl_surface != nullptr,
+      std::string("Failed to create tile map surface: ") + SDL_GetError());
+
+  const size_t row_size = size.width * 4;
+  char* dst = static_cast<char*>(sdl_surface->pixels);
+  for (int row = 0; row < size.height; ++row) {
+    std::copy(pixels.begin() + row * row_size, pixels.begin() + (row + 1) * row_size,
+        dst + row * sdl_surface->pitch);
+  }
+
+  // Pixels are data, not colors: they must not be premultiplied.
+  return Surface::create(std::move(sdl_surface), false);
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates a tile map for the animated regions of a map.
+ *
+ * The map must be loaded and the video system must support
+ * the tile map shader.
+ *
+ * \param map The map.
+ */
+AnimatedTileMap::AnimatedTileMap(Map& map):
+  map(map),
+  shader(Video::get_renderer().create_shader(
+      DefaultShaders::get_default_vertex_source(),
+      get_fragment_source(),
+      0.0
+  )) {
+
+  if (!is_valid()) {
+    return;
+  }
+
+  const SurfacePtr& tileset_image = map.get_tileset().get_tiles_image();
+  shader->set_uniform_texture("sol_tileset", tileset_image);
+  shader->set_uniform_2f("sol_tileset_size", tileset_image->get_width(), tileset_image->get_height());
+}
+
+/**
+ * \brief Returns whether the tile map shader could be compiled.
+ *
+ * When this is not the case, no tile is accepted.
+ *
+ * \return \c true if tiles can be drawn by this tile map.
+ */
+bool AnimatedTileMap::is_valid() const {
+  return shader != nullptr && shader->is_valid();
+}
+
+/**
+ * \brief Fills the index texture of a layer with the tiles that can
+ * be drawn by the shader.
+ *
+ * Must be called for each layer before update_frames() is called.
+ *
+ * \param layer The layer.
+ * \param tiles Tiles of animated regions of this layer, in drawing order.
+ * \param[out] rejected_tiles Tiles that still have to be drawn separately.
+ */
+void AnimatedTileMap::build_layer(
+    int layer,
+    const std::vector<TilePtr>& tiles,
+    std::vector<TilePtr>& rejected_tiles
+) {
+  Debug::check_assertion(frames_surface == nullptr, "Tile map already built");
+
+  if (!is_valid()) {
+    rejected_tiles.insert(rejected_tiles.end(), tiles.begin(), tiles.end());
+    return;
+  }
+
+  // The shader can only draw one tile per square,
+  // so overlapping tiles are drawn separately to keep their order.
+  const int map_width8 = map.get_width8();
+  const int map_height8 = map.get_height8();
+  std::vector<uint8_t> tiles_per_square(map_width8 * map_height8, 0);
+  for (const TilePtr& tile : tiles) {
+    const Rectangle& box = tile->get_bounding_box();
+    for (int y8 = box.get_y() / 8; y8 < (box.get_y() + box.get_height() + 7) / 8; ++y8) {
+      for (int x8 = box.get_x() / 8; x8 < (box.get_x() + box.get_width() + 7) / 8; ++x8) {
+        if (x8 >= 0 && x8 < map_width8 && y8 >= 0 && y8 < map_height8) {
+          uint8_t& count = tiles_per_square[y8 * map_width8 + x8];
+          count = std::min(count + 1, 2);
+        }
+      }
+    }
+  }
+
+  std::string index_pixels(map_width8 * map_height8 * 4, '\0');
+  bool empty = true;
+  for (const TilePtr& tile : tiles) {
+    if (add_tile(*tile, tiles_per_square, index_pixels)) {
+      empty = false;
+    }
+    else {
+      rejected_tiles.push_back(tile);
+    }
+  }
+
+  if (empty) {
+    return;
+  }
+
+  SurfacePtr index_surface = create_data_surface(Size(map_width8, map_height8), index_pixels);
+  index_surface->set_shader(shader);
+  index_surface->set_scale(Scale(8.0f, 8.0f));
+  index_surfaces[layer] = index_surface;
+}
+
+/**
+ * \brief Writes a tile into an index texture if the shader can draw it.
+ * \param tile The tile to add.
+ * \param tiles_per_square Number of tiles on each square of the map (at most 2).
+ * \param index_pixels Pixels of the index texture.
+ * \return \c true if the tile was added.
+ */
+bool AnimatedTileMap::add_tile(
+    const Tile& tile,
+    const std::vector<uint8_t>& tiles_per_square,
+    std::string& index_pixels
+) {
+  if (!tile.has_tile_pattern() || tile.get_tileset() != nullptr) {
+    return false;
+  }
+
+  const TilePattern& pattern = tile.get_tile_pattern();
+  Point position;
+  if (!pattern.is_drawn_at_its_position() ||
+      !pattern.get_position_in_tileset(position)) {
+    return false;
+  }
+
+  const Rectangle& box = tile.get_bounding_box();
+  const Rectangle map_box(Point(), map.get_size());
+  if (!map_box.contains(box) || box.get_x() % 8 != 0 || box.get_y() % 8 != 0) {
+    return false;
+  }
+  if (pattern.get_width() % 8 != 0 || pattern.get_height() % 8 != 0) {
+    return false;
+  }
+
+  const int map_width8 = map.get_width8();
+  const int tile_x8 = box.get_x() / 8;
+  const int tile_y8 = box.get_y() / 8;
+  const int tile_width8 = box.get_width() / 8;
+  const int tile_height8 = box.get_height() / 8;
+  const int pattern_width8 = pattern.get_width() / 8;
+  const int pattern_height8 = pattern.get_height() / 8;
+  for (int i = 0; i < tile_height8; ++i) {
+    for (int j = 0; j < tile_width8; ++j) {
+      if (tiles_per_square[(tile_y8 + i) * map_width8 + tile_x8 + j] != 1) {
+        return false;
+      }
+    }
+  }
+
+  // Squares of patterns that never change and are aligned in the tileset
+  // are stored directly, others through the frames texture.
+  const bool fixed = !pattern.is_animated() &&
+      position.x % 8 == 0 && position.y % 8 == 0;
+  int pattern_id = -1;
+  if (!fixed) {
+    if (pattern_width8 > 256 || pattern_height8 > 256) {
+      return false;
+    }
+    pattern_id = get_pattern_id(pattern);
+    if (pattern_id == -1) {
+      return false;
+    }
+  }
+
+  // A tile bigger than its pattern repeats it.
+  for (int i = 0; i < tile_height8; ++i) {
+    for (int j = 0; j < tile_width8; ++j) {
+      const size_t square_index = (tile_y8 + i) * map_width8 + tile_x8 + j;
+      const int pattern_x8 = j % pattern_width8;
+      const int pattern_y8 = i % pattern_height8;
+      if (fixed) {
+        const int x8 = position.x / 8 + pattern_x8;
+        const int y8 = position.y / 8 + pattern_y8;
+        set_pixel(index_pixels, square_index,
+            x8 & 0xff, y8 & 0xff, ((x8 >> 8) & 0x0f) | ((y8 >> 8) << 4), fixed_square);
+      }
+      else {
+        set_pixel(index_pixels, square_index, pattern_x8, pattern_y8, 0, pattern_id + 1);
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * \brief Returns the index of a pattern in the frames texture,
+ * adding it if necessary.
+ * \param pattern A tile pattern.
+ * \return Its index, or -1 if there are already too many patterns.
+ */
+int AnimatedTileMap::get_pattern_id(const TilePattern& pattern) {
+
+  const auto it = pattern_ids.find(&pattern);
+  if (it != pattern_ids.end()) {
+    return it->second;
+  }
+
+  if (patterns.size() >= max_pattern_ids) {
+    return -1;
+  }
+
+  const int pattern_id = patterns.size();
+  patterns.push_back(&pattern);
+  pattern_ids.emplace(&pattern, pattern_id);
+  return pattern_id;
+}
+
+/**
+ * \brief Updates the frames texture with the current frame of
+ * animated patterns.
+ *
+ * Call this at each frame before drawing layers.
+ */
+void AnimatedTileMap::update_frames() {
+
+  if (patterns.empty()) {
+    return;
+  }
+
+  frames_pixels.resize(patterns.size() * 4);
+  for (size_t i = 0; i < patterns.size(); ++i) {
+    Point position;
+    patterns[i]->get_position_in_tileset(position);
+    set_pixel(frames_pixels, i,
+        position.x & 0xff, (position.x >> 8) & 0xff,
+        position.y & 0xff, (position.y >> 8) & 0xff);
+  }
+
+  if (frames_surface == nullptr) {
+    frames_surface = create_data_surface(Size(patterns.size(), 1), frames_pixels);
+    shader->set_uniform_texture("sol_tile_frames", frames_surface);
+    shader->set_uniform_1f("sol_num_tile_frames", patterns.size());
+  }
+  else {
+    // Only uploaded if a frame has changed.
+    frames_surface->set_pixels(frames_pixels);
+  }
+}
+
+/**
+ * \brief Draws the tiles of a layer that are in the tile map.
+ * \param layer The layer to draw.
+ */
+void AnimatedTileMap::draw_on_map(int layer) {
+
+  const auto it = index_surfaces.find(layer);
+  if (it == index_surfaces.end()) {
+    return;
+  }
+
+  const CameraPtr& camera = map.get_camera();
+  if (camera == nullptr) {
+    return;
+  }
+
+  const Rectangle& camera_box = camera->get_bounding_box();
+  const Rectangle visible_box = camera_box & Rectangle(Point(), map.get_size());
+  if (visible_box.is_flat()) {
+    return;
+  }
+
+  // Draw the squares visible by the camera, each texel becoming 8x8 pixels.
+  const int x8 = visible_box.get_x() / 8;
+  const int y8 = visible_box.get_y() / 8;
+  const int right8 = (visible_box.get_x() + visible_box.get_width() + 7) / 8;
+  const int bottom8 = (visible_box.get_y() + visible_box.get_height() + 7) / 8;
+  const Rectangle region(x8, y8, right8 - x8, bottom8 - y8);
+  const Point dst_position(x8 * 8 - camera_box.get_x(), y8 * 8 - camera_box.get_y());
+  it->second->draw_region(region, map.get_camera_surface(), dst_position);
+}
+
+}
+
@@ -66,6 +66,21 @@ void AnimatedTilePattern::update() {
   }
 }
 
+/**
+ * \brief Returns the frame currently displayed.
+ * \return Index of the current frame in the list of frames.
+ */
+int AnimatedTilePattern::get_current_frame() const {
+
+  int final_frame_index = frame_index;
+  int num_frames = frames.size();
+  if (mirror_loop && frame_index >= num_frames) {
+    final_frame_index = (2 * frames.size() - 2) - frame_index;
+  }
+  Debug::check_assertion(final_frame_index >= 0 && final_frame_index < num_frames, "Wrong frame index");
+  return final_frame_index;
+}
+
 /**
  * \copydoc TilePattern::draw
  */
@@ -77,13 +92,7 @@ void AnimatedTilePattern::draw(
 ) const {
   const SurfacePtr& tileset_image = tileset.get_tiles_image();
 
-  int final_frame_index = frame_index;
-  int num_frames = frames.size();
-  if (mirror_loop && frame_index >= num_frames) {
-    final_frame_index = (2 * frames.size() - 2) - frame_index;
-  }
-  Debug::check_assertion(final_frame_index >= 0 && final_frame_index < num_frames, "Wrong frame index");
-  const Rectangle& src = frames[final_frame_index];
+  const Rectangle& src = frames[get_current_frame()];
   Point dst = dst_position;
 
   if (parallax) {
@@ -110,5 +119,16 @@ bool AnimatedTilePattern::is_drawn_at_its_position() const {
   return !parallax;
 }
 
+/**
+ * \copydoc TilePattern::get_position_in_tileset
+ */
+bool AnimatedTilePattern::get_position_in_tileset(Point& position) const {
+
+  if (parallax) {
+    return false;
+  }
+  position = frames[get_current_frame()].get_xy();
+  return true;
 }
 
+}
@@ -0,0 +1,255 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/entities/CollisionBroadPhase.h"
+#include "solarus/entities/Entity.h"
+#include <algorithm>
+
+namespace Solarus {
+
+bool CollisionBroadPhase::enabled = false;
+
+/**
+ * \brief Sets whether collision checks are deferred to a broad phase.
+ *
+ * This only takes effect from the next frame.
+ *
+ * \param enabled \c true to enable the broad phase.
+ */
+void CollisionBroadPhase::set_enabled(bool enabled) {
+  CollisionBroadPhase::enabled = enabled;
+}
+
+/**
+ * \brief Returns the area where detectors may have simple collisions
+ * with an entity.
+ *
+ * The box is extended because some collision tests work without overlapping.
+ *
+ * \param entity An entity.
+ * \return The area to search.
+ */
+Rectangle CollisionBroadPhase::get_simple_box(const Entity& entity) {
+  return entity.get_extended_bounding_box(8);
+}
+
+/**
+ * \brief Returns the area where detectors may have pixel-precise collisions
+ * with sprites of an entity.
+ * \param entity An entity.
+ * \return The area to search.
+ */
+Rectangle CollisionBroadPhase::get_sprites_box(const Entity& entity) {
+  return entity.get_max_bounding_box();
+}
+
+/**
+ * \brief Creates an inactive broad phase.
+ */
+CollisionBroadPhase::CollisionBroadPhase():
+  deferring(false),
+  movers(),
+  movers_set(),
+  mover_boxes(),
+  detectors(),
+  detector_boxes(),
+  intervals(),
+  active_movers(),
+  active_detectors(),
+  candidates() {
+
+}
+
+/**
+ * \brief Starts recording collision checks if the broad phase is enabled.
+ *
+ * Call this before updating entities.
+ */
+void CollisionBroadPhase::begin_frame() {
+
+  clear();
+  deferring = is_enabled();
+}
+
+/**
+ * \brief Records that an entity wants to check collisions with detectors.
+ * \param entity An entity that has just moved.
+ * \return \c true if the check is deferred to the end of the frame,
+ * \c false if the caller should check collisions immediately.
+ */
+bool CollisionBroadPhase::defer(Entity& entity) {
+
+  if (!deferring) {
+    return false;
+  }
+
+  if (movers_set.insert(&entity).second) {
+    movers.push_back(std::static_pointer_cast<Entity>(entity.shared_from_this()));
+  }
+  return true;
+}
+
+/**
+ * \brief Stops recording and finds the candidate detectors of each entity
+ * recorded during the frame.
+ *
+ * Afterwards, get_candidates() returns for each recorded entity the
+ * detectors near it, sorted by Z order, with simple_mask and sprites_mask
+ * telling which tests are needed, exactly like
+ * Entities::get_entities_in_rectangles_z_sorted() does.
+ *
+ * \param entities All entities of the map that may be detectors.
+ */
+void CollisionBroadPhase::end_frame(const EntityVector& entities) {
+
+  deferring = false;
+  if (movers.empty()) {
+    return;
+  }
+
+  const int num_movers = movers.size();
+  for (const EntityPtr& mover : movers) {
+    mover_boxes.push_back(get_simple_box(*mover));
+    mover_boxes.push_back(get_sprites_box(*mover));
+  }
+  for (const EntityPtr& entity : entities) {
+    if (entity->is_detector() && !entity->is_being_removed()) {
+      detectors.push_back(entity);
+      detector_boxes.push_back(entity->get_max_bounding_box());
+    }
+  }
+
+  if (candidates.size() < movers.size()) {
+    candidates.resize(movers.size());
+  }
+
+  // Sort all extents on the x axis.
+  for (int i = 0; i < num_movers; ++i) {
+    const Rectangle box = mover_boxes[2 * i] | mover_boxes[2 * i + 1];
+    intervals.push_back({ box.get_left(), box.get_right(), i, false });
+  }
+  for (int i = 0; i < static_cast<int>(detectors.size()); ++i) {
+    const Rectangle& box = detector_boxes[i];
+    intervals.push_back({ box.get_left(), box.get_right(), i, true });
+  }
+  std::sort(intervals.begin(), intervals.end(), [](const Interval& first, const Interval& second) {
+    return first.left < second.left;
+  });
+
+  // Sweep: each extent is compared to the ones of the other kind
+  // that are not finished yet.
+  for (const Interval& interval : intervals) {
+    std::vector<int>& same_kind = interval.detector ? active_detectors : active_movers;
+    std::vector<int>& other_kind = interval.detector ? active_movers : active_detectors;
+
+    const int left = interval.left;
+    other_kind.erase(std::remove_if(other_kind.begin(), other_kind.end(), [&](int index) {
+      const Rectangle& box = interval.detector ?
+          mover_boxes[2 * index] | mover_boxes[2 * index + 1] :
+          detector_boxes[index];
+      return box.get_right() <= left;
+    }), other_kind.end());
+
+    for (int index : other_kind) {
+      if (interval.detector) {
+        add_candidate(index, interval.index);
+      }
+      else {
+        add_candidate(interval.index, index);
+      }
+    }
+    same_kind.push_back(interval.index);
+  }
+
+  EntityZOrderComparator comparator;
+  for (int i = 0; i < num_movers; ++i) {
+    std::sort(candidates[i].begin(), candidates[i].end(),
+        [&comparator](const std::pair<EntityPtr, uint32_t>& first,
+                      const std::pair<EntityPtr, uint32_t>& second) {
+      return comparator(first.first, second.first);
+    });
+  }
+
+  detectors.clear();  // Don't keep entities alive.
+  detector_boxes.clear();
+  intervals.clear();
+  active_movers.clear();
+  active_detectors.clear();
+}
+
+/**
+ * \brief Tests the boxes of an entity and a detector that overlap on the x
+ * axis and stores the detector as a candidate if needed.
+ * \param entity_index Index of the entity that moved.
+ * \param detector_index Index of the detector.
+ */
+void CollisionBroadPhase::add_candidate(int entity_index, int detector_index) {
+
+  const Rectangle& detector_box = detector_boxes[detector_index];
+  uint32_t mask = 0;
+  if (mover_boxes[2 * entity_index].overlaps(detector_box)) {
+    mask |= simple_mask;
+  }
+  if (mover_boxes[2 * entity_index + 1].overlaps(detector_box)) {
+    mask |= sprites_mask;
+  }
+  if (mask != 0) {
+    candidates[entity_index].emplace_back(detectors[detector_index], mask);
+  }
+}
+
+/**
+ * \brief Forgets the entities recorded during the last frame.
+ */
+void CollisionBroadPhase::clear() {
+
+  for (EntityMatchVector& entity_candidates : candidates) {
+    entity_candidates.clear();
+  }
+  movers.clear();
+  movers_set.clear();
+  mover_boxes.clear();
+}
+
+/**
+ * \brief Returns the number of entities recorded during the last frame.
+ * \return The number of entities.
+ */
+int CollisionBroadPhase::get_num_entities() const {
+  return movers.size();
+}
+
+/**
+ * \brief Returns an entity recorded during the last frame.
+ * \param index Index of the entity.
+ * \return The entity.
+ */
+const EntityPtr& CollisionBroadPhase::get_entity(int index) const {
+  return movers[index];
+}
+
+/**
+ * \brief Returns the candidate detectors of an entity recorded during
+ * the last frame.
+ * \param index Index of the entity.
+ * \return The detectors near this entity, sorted by Z order.
+ */
+const EntityMatchVector& CollisionBroadPhase::get_candidates(int index) const {
+  return candidates[index];
+}
+
+}
+
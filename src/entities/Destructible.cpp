@@ -500,6 +500,9 @@ void Destructible::update() {
     }
     is_regenerating = true;
     regeneration_date = 0;
+    if (is_ground_modifier()) {
+      update_ground_observers();  // The ground is back.
+    }
     get_lua_context()->destructible_on_regenerating(*this);
   }
   else if (is_regenerating &&
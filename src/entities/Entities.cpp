@@ -19,12 +19,17 @@
 #include "solarus/core/Debug.h"
 #include "solarus/core/Game.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Logger.h"
+#include "solarus/core/Profiler.h"
+#include "solarus/core/System.h"
+#include "solarus/entities/AnimatedTileMap.h"
 #include "solarus/entities/Boomerang.h"
 #include "solarus/entities/CrystalBlock.h"
 #include "solarus/entities/Destination.h"
 #include "solarus/entities/Entities.h"
 #include "solarus/entities/EntityTypeInfo.h"
 #include "solarus/entities/Hero.h"
+#include "solarus/entities/NavigationGrid.h"
 #include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/Separator.h"
 #include "solarus/entities/SeparatorPtr.h"
@@ -34,7 +39,9 @@
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Color.h"
 #include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
 #include "solarus/lua/LuaContext.h"
+#include <algorithm>
 #include <sstream>
 #include <lua.hpp>
 
@@ -76,19 +83,28 @@ class DrawingOrderComparator {
         return false;
       }
 
-      if (first->is_drawn_in_y_order()) {
+      if (first->is_drawn_in_y_order() &&
+          first->get_y() != second->get_y()) {
         // Both entities are displayed in Y order.
         return first->get_y() < second->get_y();
       }
 
-      // Both entities are displayed in Z order.
+      // Both entities are displayed in Z order or have the same Y.
       return first->get_z() < second->get_z();
     }
 
 };
 
+/**
+ * \brief Distance added to the optimization distance to put an entity
+ * to sleep, so that it does not sleep and wake up repeatedly at the limit.
+ */
+constexpr int sleeping_margin = 16;
+
 }  // Anonymous namespace.
 
+bool Entities::stats_report_enabled = false;
+
 /**
  * \brief Constructor.
  * \param game The game.
@@ -103,16 +119,27 @@ Entities::Entities(Game& game, Map& map):
   tiles_ground(),
   non_animated_regions(),
   tiles_in_animated_regions(),
+  tiles_drawn_separately(),
+  animated_tile_map(nullptr),
+  navigation_grid(new NavigationGrid(map, *this)),
   hero(game.get_hero()),
   camera(nullptr),
   named_entities(),
+  entity_names(),
   all_entities(),
   quadtree(new EntityTree()),
   z_orders(),
-  entities_drawn_not_at_their_position(),
   entities_to_draw(),
+  entities_in_draw_lists(),
+  drawn_area(),
+  drawing_order_changed(),
   entities_to_remove(),
-  default_destination(nullptr) {
+  default_destination(nullptr),
+  num_sleeping_entities(0),
+  max_sleeping_distance(0),
+  report_num_frames(0),
+  report_num_sleeping_entities(0),
+  last_report_time(0) {
 
   // Initialize the size.
   initialize_layers();
@@ -224,6 +251,7 @@ void Entities::set_tile_ground(int layer, int x8, int y8, Ground ground) {
   if (x8 >= 0 && x8 < map_width8 && y8 >= 0 && y8 < map_height8) {
     int index = y8 * map_width8 + x8;
     tiles_ground[layer][index] = ground;
+    navigation_grid->notify_tile_ground_changed(layer, x8, y8);
   }
 }
 
@@ -276,7 +304,8 @@ EntityPtr Entities::find_entity(const std::string& name) {
  * The hero is included if the prefix matches.
  *
  * \param prefix Prefix of the name.
- * \return The entities having this prefix in their name, in arbitrary order.
+ * \return The entities having this prefix in their name, in alphabetical
+ * order of names if the prefix is not empty.
  */
 EntityVector Entities::get_entities_with_prefix(const std::string& prefix) {
 
@@ -294,10 +323,11 @@ EntityVector Entities::get_entities_with_prefix(const std::string& prefix) {
   }
 
   // Normal case: add entities whose name starts with the prefix.
-  for (const auto& kvp: named_entities) {
-    const EntityPtr& entity = kvp.second;
-    if (entity->has_prefix(prefix) &&
-        !entity->is_being_removed()) {
+  for (auto it = entity_names.lower_bound(prefix);
+       it != entity_names.end() && it->compare(0, prefix.size(), prefix) == 0;
+       ++it) {
+    const EntityPtr& entity = named_entities.find(*it)->second;
+    if (!entity->is_being_removed()) {
       entities.push_back(entity);
     }
   }
@@ -324,7 +354,8 @@ EntityVector Entities::get_entities_with_prefix_z_sorted(const std::string& pref
  * the specified name prefix.
  * \param type Type of entity.
  * \param prefix Prefix of the name.
- * \return The entities of this type and having this prefix in their name, in arbitrary order.
+ * \return The entities of this type and having this prefix in their name,
+ * in alphabetical order of names if the prefix is not empty.
  */
 EntityVector Entities::get_entities_with_prefix(
     EntityType type, const std::string& prefix) {
@@ -342,10 +373,11 @@ EntityVector Entities::get_entities_with_prefix(
   }
 
   // Normal case: add entities whose name starts with the prefix.
-  for (const auto& kvp: named_entities) {
-    const EntityPtr& entity = kvp.second;
+  for (auto it = entity_names.lower_bound(prefix);
+       it != entity_names.end() && it->compare(0, prefix.size(), prefix) == 0;
+       ++it) {
+    const EntityPtr& entity = named_entities.find(*it)->second;
     if (entity->get_type() == type &&
-        entity->has_prefix(prefix) &&
         !entity->is_being_removed()
     ) {
       entities.push_back(entity);
@@ -379,6 +411,18 @@ EntityVector Entities::get_entities_with_prefix_z_sorted(
  */
 bool Entities::has_entity_with_prefix(const std::string& prefix) const {
 
+  if (!prefix.empty()) {
+    for (auto it = entity_names.lower_bound(prefix);
+         it != entity_names.end() && it->compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+      const EntityPtr& entity = named_entities.find(*it)->second;
+      if (entity->get_type() != EntityType::HERO && !entity->is_being_removed()) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   for (const EntityPtr& entity: all_entities) {
     if (entity->has_prefix(prefix) && !entity->is_being_removed()) {
       return true;
@@ -391,6 +435,10 @@ bool Entities::has_entity_with_prefix(const std::string& prefix) const {
 /**
  * \brief Returns all entities whose bounding box overlaps the given rectangle.
  * Entities are sorted according to their Z index on the map.
+ *
+ * The result vector is cleared first. Its memory is reused, so callers that
+ * keep the vector from one call to another avoid allocations.
+ *
  * \param[in] rectangle A rectangle.
  * \param[out] result The entities in that rectangle.
  */
@@ -398,12 +446,11 @@ void Entities::get_entities_in_rectangle_z_sorted(
     const Rectangle& rectangle, ConstEntityVector& result
 ) const {
 
-  EntityVector non_const_result = quadtree->get_elements(rectangle);
-
-  result.reserve(non_const_result.size());
-  for (const ConstEntityPtr& entity : non_const_result) {
-      result.push_back(entity);
-  }
+  result.clear();
+  quadtree->visit_elements(rectangle, [&result](const EntityPtr& entity) {
+    result.push_back(entity);
+  });
+  std::sort(result.begin(), result.end(), EntityZOrderComparator());
 }
 
 /**
@@ -413,7 +460,26 @@ void Entities::get_entities_in_rectangle_z_sorted(
     const Rectangle& rectangle, EntityVector& result
 ) {
 
-  result = quadtree->get_elements(rectangle);
+  quadtree->get_elements(rectangle, result);
+}
+
+/**
+ * \brief Returns all entities whose bounding box overlaps any of several
+ * rectangles.
+ *
+ * Each entity is returned once, with a mask telling the rectangles it
+ * overlaps: bit \c i is set if it overlaps <tt>rectangles[i]</tt>.
+ * Entities are sorted according to their Z index on the map.
+ *
+ * \param[in] rectangles The rectangles to check.
+ * \param[in] num_rectangles Number of rectangles (32 at most).
+ * \param[out] result The entities in these rectangles with their masks.
+ */
+void Entities::get_entities_in_rectangles_z_sorted(
+    const Rectangle* rectangles, int num_rectangles, EntityMatchVector& result
+) {
+
+  quadtree->get_elements(rectangles, num_rectangles, result);
 }
 
 /**
@@ -577,6 +643,7 @@ void Entities::bring_to_front(Entity& entity) {
   const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   int layer = entity.get_layer();
   z_orders.at(layer).bring_to_front(shared_entity);
+  drawing_order_changed[layer] = true;
 }
 
 /**
@@ -588,6 +655,7 @@ void Entities::bring_to_back(Entity& entity) {
   const EntityPtr& shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
   int layer = entity.get_layer();
   z_orders.at(layer).bring_to_back(shared_entity);
+  drawing_order_changed[layer] = true;
 }
 
 /**
@@ -611,8 +679,12 @@ void Entities::notify_map_starting(Map& map, const std::shared_ptr<Destination>&
       add_entity(tile);
     }
   }
+  build_animated_tile_map();
 
   // Now, tiles_in_animated_regions contains the tiles that won't be optimized.
+  // Compute the ground of each square once for all.
+  navigation_grid->build();
+
   // Notify entities.
   for (const EntityPtr& entity: all_entities) {
     entity->notify_map_starting(map, destination);
@@ -684,6 +756,7 @@ void Entities::notify_tileset_changed() {
       tile->notify_tileset_changed();
     }
   }
+  build_animated_tile_map();
 
   for (const EntityPtr& entity: all_entities) {
     entity->notify_tileset_changed();
@@ -716,10 +789,36 @@ void Entities::initialize_layers() {
     tiles_ground[layer] = std::vector<Ground>();
     non_animated_regions[layer] = std::unique_ptr<NonAnimatedRegions>();
     tiles_in_animated_regions[layer] = std::vector<TilePtr>();
+    tiles_drawn_separately[layer] = std::vector<TilePtr>();
     z_orders[layer] = ZOrderInfo();
   }
 }
 
+/**
+ * \brief Chooses how to draw the tiles in animated regions.
+ *
+ * With the tile map shader, most of them are drawn with a single draw call
+ * per layer. The other ones are drawn one by one.
+ */
+void Entities::build_animated_tile_map() {
+
+  animated_tile_map = nullptr;
+  if (Video::is_tile_map_shader_enabled()) {
+    animated_tile_map = std::unique_ptr<AnimatedTileMap>(new AnimatedTileMap(map));
+  }
+
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    std::vector<TilePtr>& separate_tiles = tiles_drawn_separately[layer];
+    separate_tiles.clear();
+    if (animated_tile_map != nullptr) {
+      animated_tile_map->build_layer(layer, tiles_in_animated_regions[layer], separate_tiles);
+    }
+    else {
+      separate_tiles = tiles_in_animated_regions[layer];
+    }
+  }
+}
+
 /**
  * \brief Adds tile creation info to the map.
  *
@@ -939,14 +1038,12 @@ void Entities::add_entity(const EntityPtr& entity) {
       break;
     }
 
-    // Update the list of entities drawn not at their position.
-    if (!entity->is_drawn_at_its_position()) {
-      entities_drawn_not_at_their_position[layer].push_back(entity);
-    }
-
     // Track the insertion order.
     z_orders[layer].add(entity);
 
+    // Update the drawing list.
+    add_entity_to_draw(entity);
+
     // Update the list of entities by type.
     auto it = entities_by_type.find(type);
     if (it == entities_by_type.end()) {
@@ -995,12 +1092,17 @@ void Entities::add_entity(const EntityPtr& entity) {
       entity->set_name(name);
     }
     named_entities[name] = entity;
+    entity_names.insert(name);
   }
 
   // Notify the entity.
   if (type != EntityType::HERO) {
     entity->set_map(map);
   }
+
+  // Update the ground and the occupancy of squares below the entity.
+  navigation_grid->notify_ground_modifier_changed(*entity);
+  navigation_grid->notify_entity_added(*entity);
 }
 
 /**
@@ -1022,6 +1124,7 @@ void Entities::remove_entity(Entity& entity) {
     // the same name right now.
     if (!entity.get_name().empty()) {
       named_entities.erase(entity.get_name());
+      entity_names.erase(entity.get_name());
     }
   }
 }
@@ -1066,9 +1169,12 @@ void Entities::remove_marked_entities() {
 
     // Remove it from the whole list.
     all_entities.remove(entity);
+    // Its name may already be used by a new entity.
     const std::string& name = entity->get_name();
-    if (!name.empty()) {
+    const auto& name_it = named_entities.find(name);
+    if (name_it != named_entities.end() && name_it->second == entity) {
       named_entities.erase(name);
+      entity_names.erase(name);
     }
 
     // Update the specific entities lists.
@@ -1085,6 +1191,9 @@ void Entities::remove_marked_entities() {
     // Track the insertion order.
     z_orders.at(layer).remove(entity);
 
+    // Update the drawing list.
+    remove_entity_to_draw(entity, layer);
+
     // Update the list of entities by type.
     const auto& it = entities_by_type.find(type);
     if (it != entities_by_type.end()) {
@@ -1092,6 +1201,9 @@ void Entities::remove_marked_entities() {
       sets[layer].erase(entity);
     }
 
+    // Forget its ground.
+    navigation_grid->notify_entity_removed(*entity);
+
     // Destroy it.
     notify_entity_removed(*entity);
   }
@@ -1125,31 +1237,164 @@ void Entities::set_suspended(bool suspended) {
  */
 void Entities::update() {
 
+  SOLARUS_PROFILE_ZONE("Entities::update");
+
   Debug::check_assertion(map.is_started(), "The map is not started");
 
   // First update the hero.
   hero->update();
 
-  // Update the dynamic entities.
+  // Wake up sleeping entities that the camera approached.
+  wake_up_entities_near_camera();
+
+  // Update the dynamic entities, except the ones too far from the camera.
+  num_sleeping_entities = 0;
+  max_sleeping_distance = 0;
   for (const EntityPtr& entity: all_entities) {
 
     if (
-        !entity->is_being_removed() &&
-        entity->get_type() != EntityType::CAMERA  // The camera is updated after.
+        entity->is_being_removed() ||
+        entity->get_type() == EntityType::CAMERA  // The camera is updated after.
     ) {
-      entity->update();
+      continue;
+    }
+
+    if (!entity->is_sleeping() &&
+        is_beyond_optimization_distance(*entity, sleeping_margin)) {
+      entity->set_sleeping(true);
+    }
+
+    if (entity->is_sleeping()) {
+      ++num_sleeping_entities;
+      max_sleeping_distance = std::max(max_sleeping_distance, entity->get_optimization_distance());
+      continue;
     }
+    entity->update();
   }
 
   // Update the camera after everyone else.
   camera->update();
-  entities_to_draw.clear();  // Invalidate entities to draw.
   for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
     non_animated_regions[layer]->update();
   }
 
   // Remove the entities that have to be removed now.
   remove_marked_entities();
+
+  report_stats();
+}
+
+/**
+ * \brief Returns whether an entity is far enough from the visible area
+ * to sleep.
+ * \param entity A map entity.
+ * \param margin Additional distance required.
+ * \return \c true if the entity is beyond its optimization distance plus
+ * the margin.
+ */
+bool Entities::is_beyond_optimization_distance(const Entity& entity, int margin) const {
+
+  const int distance = entity.get_optimization_distance();
+  if (distance <= 0 || camera == nullptr) {
+    return false;
+  }
+
+  const Rectangle& visible_area = camera->get_bounding_box();
+  const Rectangle& box = entity.get_max_bounding_box();
+  const int dx = std::max({ 0,
+      visible_area.get_x() - box.get_x() - box.get_width(),
+      box.get_x() - visible_area.get_x() - visible_area.get_width() });
+  const int dy = std::max({ 0,
+      visible_area.get_y() - box.get_y() - box.get_height(),
+      box.get_y() - visible_area.get_y() - visible_area.get_height() });
+  const int limit = distance + margin;
+  return dx * dx + dy * dy > limit * limit;
+}
+
+/**
+ * \brief Wakes up the sleeping entities that are no longer beyond their
+ * optimization distance.
+ *
+ * Only the area where such entities can be is looked up in the quadtree.
+ */
+void Entities::wake_up_entities_near_camera() {
+
+  if (num_sleeping_entities == 0 || camera == nullptr) {
+    return;
+  }
+
+  const Rectangle& visible_area = camera->get_bounding_box();
+  const Rectangle search_area(
+      visible_area.get_x() - max_sleeping_distance,
+      visible_area.get_y() - max_sleeping_distance,
+      visible_area.get_width() + 2 * max_sleeping_distance,
+      visible_area.get_height() + 2 * max_sleeping_distance
+  );
+
+  EntityVector entities_to_wake_up;
+  quadtree->visit_elements(search_area, [&](const EntityPtr& entity) {
+    if (entity->is_sleeping() &&
+        !entity->is_being_removed() &&
+        !is_beyond_optimization_distance(*entity, 0)) {
+      entities_to_wake_up.push_back(entity);
+    }
+  });
+
+  // Waking up can run collision callbacks that change the quadtree.
+  for (const EntityPtr& entity: entities_to_wake_up) {
+    entity->set_sleeping(false);
+  }
+}
+
+/**
+ * \brief Returns the number of entities that were sleeping during the last
+ * update.
+ * \return The number of sleeping entities.
+ */
+int Entities::get_num_sleeping_entities() const {
+  return num_sleeping_entities;
+}
+
+/**
+ * \brief Returns whether the number of sleeping entities is logged.
+ * \return \c true if stats are logged every second.
+ */
+bool Entities::is_stats_report_enabled() {
+  return stats_report_enabled;
+}
+
+/**
+ * \brief Sets whether the number of sleeping entities is logged.
+ * \param enabled \c true to log stats every second.
+ */
+void Entities::set_stats_report_enabled(bool enabled) {
+  stats_report_enabled = enabled;
+}
+
+/**
+ * \brief Logs the average number of sleeping entities every second
+ * if enabled.
+ */
+void Entities::report_stats() {
+
+  if (!stats_report_enabled) {
+    return;
+  }
+
+  ++report_num_frames;
+  report_num_sleeping_entities += num_sleeping_entities;
+
+  const uint32_t now = System::get_real_time();
+  if (now - last_report_time >= 1000) {
+    std::ostringstream oss;
+    oss << "Entities: frames=" << report_num_frames
+        << " sleeping=" << report_num_sleeping_entities / report_num_frames << "/frame"
+        << " of " << all_entities.size();
+    Logger::print(oss.str());
+    last_report_time = now;
+    report_num_frames = 0;
+    report_num_sleeping_entities = 0;
+  }
 }
 
 /**
@@ -1157,6 +1402,8 @@ void Entities::update() {
  */
 void Entities::draw() {
 
+  SOLARUS_PROFILE_ZONE("Entities::draw");
+
   const CameraPtr& camera = get_camera();
   if (camera == nullptr) {
     return;
@@ -1164,58 +1411,57 @@ void Entities::draw() {
 
   const SurfacePtr& camera_surface = camera->get_surface();
 
-  // Lazily build the list of entities to draw.
-  if (entities_to_draw.empty()) {
-
-    // Add entities in the camera,
-    // or nearby because of possible
-    // on_pre_draw()/on_draw()/on_post_draw() reimplementations.
-    // TODO it would probably be better to detect entities with
-    // such events and make their is_drawn_at_its_position()
-    // method return false.
-    EntityVector entities_in_camera;
-    Rectangle around_camera(
-        Point(
-            camera->get_x() - camera->get_size().width,
-            camera->get_y() - camera->get_size().height
-        ),
-        camera->get_size() * 3
-    );
-    get_entities_in_rectangle_z_sorted(around_camera, entities_in_camera);
+  if (animated_tile_map != nullptr) {
+    animated_tile_map->update_frames();
+  }
 
-    for (const EntityPtr& entity : entities_in_camera) {
-      int layer = entity->get_layer();
-      Debug::check_assertion(map.is_valid_layer(layer), "Invalid layer");
-      entities_to_draw[layer].push_back(entity);
-    }
+  // Draw entities in the camera,
+  // or nearby because of possible
+  // on_pre_draw()/on_draw()/on_post_draw() reimplementations.
+  // TODO it would probably be better to detect entities with
+  // such events and make their is_drawn_at_its_position()
+  // method return false.
+  const Rectangle around_camera(
+      Point(
+          camera->get_x() - camera->get_size().width,
+          camera->get_y() - camera->get_size().height
+      ),
+      camera->get_size() * 3
+  );
+
+  if (around_camera != drawn_area) {
+    set_drawn_area(around_camera);
+  }
+
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
 
-    // Add entities displayed even when out of the camera.
-    for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-      for (const EntityPtr& entity : entities_drawn_not_at_their_position[layer]) {
-        entities_to_draw[layer].push_back(entity);
+    // Forget entities that went away from the camera since the last cycle.
+    EntitiesToDraw& layer_entities_to_draw = entities_to_draw[layer];
+    layer_entities_to_draw.erase(
+        std::remove_if(layer_entities_to_draw.begin(), layer_entities_to_draw.end(),
+            [this](const EntityPtr& entity) {
+      if (is_in_drawn_area(*entity)) {
+        return false;
       }
+      entities_in_draw_lists.erase(entity.get());
+      return true;
+    }), layer_entities_to_draw.end());
 
-      // Sort them and remove duplicates.
-      // Duplicate drawings are a problem for entities with semi-transparency.
-      // Using an std::set would be slower because duplicates are rare:
-      // there are not often a lot of dynamic entities displayed out of the camera.
-      std::sort(entities_to_draw[layer].begin(), entities_to_draw[layer].end(), DrawingOrderComparator());
-      entities_to_draw[layer].erase(
-            std::unique(entities_to_draw[layer].begin(), entities_to_draw[layer].end()),
-            entities_to_draw[layer].end()
-      );
+    // Restore the drawing order of entities that changed since the last cycle.
+    if (drawing_order_changed[layer]) {
+      sort_entities_to_draw(layer);
+      drawing_order_changed[layer] = false;
     }
 
-  }
-
-  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
-
     // Draw the animated tiles and the tiles that overlap them:
     // in other words, draw all regions containing animated tiles
     // (and maybe more, but we don't care because non-animated tiles
     // will be drawn later).
-    for (unsigned int i = 0; i < tiles_in_animated_regions[layer].size(); ++i) {
-      Tile& tile = *tiles_in_animated_regions[layer][i];
+    if (animated_tile_map != nullptr) {
+      animated_tile_map->draw_on_map(layer);
+    }
+    for (unsigned int i = 0; i < tiles_drawn_separately[layer].size(); ++i) {
+      Tile& tile = *tiles_drawn_separately[layer][i];
       if (tile.overlaps(*camera) || !tile.is_drawn_at_its_position()) {
         tile.draw(*camera);
       }
@@ -1226,7 +1472,9 @@ void Entities::draw() {
     non_animated_regions[layer]->draw_on_map();
 
     // Draw dynamic entities, ordered by their data structure.
-    for (const EntityPtr& entity: entities_to_draw[layer]) {
+    // Use indexes because drawing may run Lua code that creates entities.
+    for (size_t i = 0; i < layer_entities_to_draw.size(); ++i) {
+      const EntityPtr entity = layer_entities_to_draw[i];
       if (!entity->is_being_removed() &&
           entity->is_enabled() &&
           entity->is_visible()) {
@@ -1241,6 +1489,119 @@ void Entities::draw() {
   }
 }
 
+/**
+ * \brief Returns whether an entity has to be in the drawing list of its layer.
+ * \param entity An entity other than a tile.
+ * \return \c true if the entity is near the camera or is not drawn at
+ * its position.
+ */
+bool Entities::is_in_drawn_area(const Entity& entity) const {
+
+  return !entity.is_drawn_at_its_position() ||
+      entity.get_max_bounding_box().overlaps(drawn_area);
+}
+
+/**
+ * \brief Adds an entity to the drawing list of its layer if it has to be drawn.
+ *
+ * Nothing happens if the entity is a tile, is already in the list or is far
+ * from the drawn area. It is removed by draw() once it leaves the area.
+ *
+ * \param entity The entity.
+ */
+void Entities::add_entity_to_draw(const EntityPtr& entity) {
+
+  if (entity->get_type() == EntityType::TILE ||
+      !is_in_drawn_area(*entity) ||
+      !entities_in_draw_lists.insert(entity.get()).second) {
+    return;
+  }
+
+  const int layer = entity->get_layer();
+  entities_to_draw[layer].push_back(entity);
+  drawing_order_changed[layer] = true;
+}
+
+/**
+ * \brief Removes an entity from the drawing list of a layer.
+ * \param entity The entity.
+ * \param layer The layer where the entity was.
+ */
+void Entities::remove_entity_to_draw(const EntityPtr& entity, int layer) {
+
+  if (entities_in_draw_lists.erase(entity.get()) == 0) {
+    return;
+  }
+
+  EntitiesToDraw& layer_entities_to_draw = entities_to_draw[layer];
+  layer_entities_to_draw.erase(
+      std::remove(layer_entities_to_draw.begin(), layer_entities_to_draw.end(), entity),
+      layer_entities_to_draw.end()
+  );
+}
+
+/**
+ * \brief Changes the area where entities are drawn.
+ *
+ * Entities that enter the area are added to the drawing lists.
+ * Entities that leave it are removed by the next draw().
+ *
+ * \param area The new area around the camera.
+ */
+void Entities::set_drawn_area(const Rectangle& area) {
+
+  drawn_area = area;
+
+  EntityVector entities_in_area;
+  quadtree->visit_elements(area, [&entities_in_area](const EntityPtr& entity) {
+    entities_in_area.push_back(entity);
+  });
+  for (const EntityPtr& entity : entities_in_area) {
+    add_entity_to_draw(entity);
+  }
+}
+
+/**
+ * \brief Restores the drawing order of the entities of a layer.
+ *
+ * The list is usually almost sorted because only a few entities move
+ * between two cycles, so an insertion sort is used.
+ * If the list turns out to be too much out of order, it is sorted
+ * from scratch instead.
+ *
+ * \param layer The layer to sort.
+ */
+void Entities::sort_entities_to_draw(int layer) {
+
+  EntitiesToDraw& layer_entities = entities_to_draw[layer];
+  const DrawingOrderComparator comparator;
+  const size_t max_shifts = 4 * layer_entities.size() + 16;
+  size_t num_shifts = 0;
+
+  for (size_t i = 1; i < layer_entities.size(); ++i) {
+
+    if (!comparator(layer_entities[i], layer_entities[i - 1])) {
+      // Already in place.
+      continue;
+    }
+
+    EntityPtr entity = std::move(layer_entities[i]);
+    size_t j = i;
+    while (j > 0 && comparator(entity, layer_entities[j - 1])) {
+      layer_entities[j] = std::move(layer_entities[j - 1]);
+      --j;
+      ++num_shifts;
+    }
+    layer_entities[j] = std::move(entity);
+
+    if (num_shifts > max_shifts) {
+      // Too many changes: a full sort will be faster.
+      std::sort(layer_entities.begin(), layer_entities.end(), comparator);
+      return;
+    }
+  }
+}
+
 /**
  * \brief Changes the layer of an entity.
  * \param entity An entity.
@@ -1269,6 +1630,9 @@ void Entities::set_entity_layer(Entity& entity, int layer) {
     z_orders.at(old_layer).remove(shared_entity);
     z_orders.at(layer).add(shared_entity);
 
+    // Update the drawing lists.
+    remove_entity_to_draw(shared_entity, old_layer);
+
     // Update the list of entities by type and layer.
     const EntityType type = entity.get_type();
     const auto& it = entities_by_type.find(type);
@@ -1280,6 +1644,8 @@ void Entities::set_entity_layer(Entity& entity, int layer) {
 
     // Update the entity after the lists because this function might be called again.
     entity.set_layer(layer);
+    add_entity_to_draw(shared_entity);
+    navigation_grid->notify_ground_modifier_changed(entity);
   }
 }
 
@@ -1295,7 +1661,54 @@ void Entities::notify_entity_bounding_box_changed(Entity& entity) {
   // Note that if the entity is not in the quadtree
   // (i.e. not managed by MapEntities) this does nothing.
   EntityPtr shared_entity = std::static_pointer_cast<Entity>(entity.shared_from_this());
-  quadtree->move(shared_entity, shared_entity->get_max_bounding_box());
+  const bool managed = quadtree->move(shared_entity, shared_entity->get_max_bounding_box());
+
+  // Update the navigation grid.
+  if (entity.is_ground_modifier()) {
+    navigation_grid->notify_ground_modifier_changed(entity);
+  }
+  navigation_grid->notify_entity_moved(entity);
+
+  // The entity may have to be drawn now,
+  // or at another place if it is drawn in Y order.
+  if (managed) {
+    add_entity_to_draw(shared_entity);
+  }
+  if (entity.is_drawn_in_y_order()) {
+    drawing_order_changed[entity.get_layer()] = true;
+  }
+}
+
+/**
+ * \brief This function should be called whenever an entity starts or stops
+ * being drawn in Y order.
+ * \param entity The entity modified.
+ */
+void Entities::notify_entity_drawing_order_changed(Entity& entity) {
+
+  drawing_order_changed[entity.get_layer()] = true;
+}
+
+/**
+ * \brief This function should be called whenever an entity may have changed
+ * the ground below it.
+ *
+ * This includes ground modifiers that move, appear, disappear or change
+ * their ground, and entities that just stopped being ground modifiers.
+ *
+ * \param entity The entity modified.
+ */
+void Entities::notify_entity_ground_changed(Entity& entity) {
+
+  navigation_grid->notify_ground_modifier_changed(entity);
+}
+
+/**
+ * \brief Returns the cached ground of each 8x8 square of the map.
+ * \return The navigation grid.
+ */
+NavigationGrid& Entities::get_navigation_grid() {
+  return *navigation_grid;
 }
 
 /**
@@ -90,8 +90,9 @@ Entity::Entity(
   enabled(true),
   suspended(false),
   when_suspended(0),
-  optimization_distance(default_optimization_distance),
-  optimization_distance2(default_optimization_distance * default_optimization_distance) {
+  optimization_distance(-1),
+  optimization_distance2(0),
+  sleeping(false) {
 
   Debug::check_assertion(size.width >= 0 && size.height >= 0,
       "Invalid entity size: width and height must be positive");
@@ -177,6 +178,9 @@ Ground Entity::get_modified_ground() const {
  */
 void Entity::update_ground_observers() {
 
+  // Update the cached ground of the map.
+  get_entities().notify_entity_ground_changed(*this);
+
   // Update overlapping entities that are sensible to their ground.
   const Rectangle& box = get_bounding_box();
   std::vector<EntityPtr> entities_nearby;
@@ -1213,12 +1217,17 @@ void Entity::set_origin(const Point& origin) {
 /**
  * \brief Returns the optimization distance of this entity.
  *
- * Above this distance from the visible area, the engine may decide to
- * skip updates.
+ * Above this distance from the visible area, the engine puts the entity
+ * to sleep: see set_sleeping().
+ * Unless it was set, this is the default optimization distance of the type.
  *
  * \return The optimization distance (0 means infinite).
  */
 int Entity::get_optimization_distance() const {
+
+  if (optimization_distance < 0) {
+    return get_default_optimization_distance(get_type());
+  }
   return optimization_distance;
 }
 
@@ -1227,6 +1236,11 @@ int Entity::get_optimization_distance() const {
  * \return Square of the optimization distance (0 means infinite).
  */
 int Entity::get_optimization_distance2() const {
+
+  if (optimization_distance < 0) {
+    const int distance = get_default_optimization_distance(get_type());
+    return distance * distance;
+  }
   return optimization_distance2;
 }
 
@@ -1239,8 +1253,88 @@ int Entity::get_optimization_distance2() const {
  * \param distance The optimization distance (0 means infinite).
  */
 void Entity::set_optimization_distance(int distance) {
-  this->optimization_distance = distance;
-  this->optimization_distance2 = distance * distance;
+  this->optimization_distance = std::max(distance, 0);
+  this->optimization_distance2 = this->optimization_distance * this->optimization_distance;
+
+  if (optimization_distance == 0) {
+    // Nothing would wake it up otherwise.
+    set_sleeping(false);
+  }
+}
+
+/**
+ * \brief Returns the optimization distance of entities of a type
+ * when it is not set.
+ *
+ * Only types whose behavior does not matter far from the visible area
+ * sleep by default. Others are always updated unless a script
+ * sets their optimization distance.
+ *
+ * \param type A type of entity.
+ * \return The default optimization distance (0 means infinite).
+ */
+int Entity::get_default_optimization_distance(EntityType type) {
+
+  switch (type) {
+
+  case EntityType::DESTRUCTIBLE:
+  case EntityType::DYNAMIC_TILE:
+  case EntityType::PICKABLE:
+    return 320;
+
+  default:
+    return 0;
+  }
+}
+
+/**
+ * \brief Returns whether this entity is sleeping.
+ * \return \c true if updates of this entity are skipped because it is
+ * beyond its optimization distance.
+ */
+bool Entity::is_sleeping() const {
+  return sleeping;
+}
+
+/**
+ * \brief Puts this entity to sleep or wakes it up.
+ *
+ * A sleeping entity is not updated and does not detect collisions.
+ * Its sprites and its movement are suspended like when the map is
+ * suspended, so that they continue normally when it wakes up.
+ * Unlike suspending, this is not notified to Lua and does not affect
+ * timers.
+ *
+ * \param sleeping \c true to put the entity to sleep.
+ */
+void Entity::set_sleeping(bool sleeping) {
+
+  if (sleeping == this->sleeping) {
+    return;
+  }
+
+  this->sleeping = sleeping;
+
+  if (is_suspended()) {
+    // Everything is already suspended until the map is resumed.
+    return;
+  }
+
+  set_sprites_suspended(sleeping || !is_enabled());
+  if (movement != nullptr) {
+    if (!movement->get_ignore_suspend()) {
+      movement->set_suspended(sleeping || !is_enabled());
+    }
+  }
+  if (stream_action != nullptr) {
+    stream_action->set_suspended(sleeping || !is_enabled());
+  }
+
+  if (!sleeping && is_on_map()) {
+    // Collision tests were disabled during the sleep.
+    get_map().check_collision_from_detector(*this);
+    check_collision_with_detectors();
+  }
 }
 
 /**
@@ -1650,7 +1744,15 @@ bool Entity::is_drawn_in_y_order() const {
  * as the hero.
  */
 void Entity::set_drawn_in_y_order(bool drawn_in_y_order) {
+
+  if (drawn_in_y_order == this->drawn_in_y_order) {
+    return;
+  }
+
   this->drawn_in_y_order = drawn_in_y_order;
+  if (is_on_map()) {
+    get_entities().notify_entity_drawing_order_changed(*this);
+  }
 }
 
 /**
@@ -1682,8 +1784,8 @@ void Entity::set_movement(const std::shared_ptr<Movement>& movement) {
     movement->set_lua_notifications_enabled(true);
     movement->set_entity(this);
 
-    if (movement->is_suspended() != suspended) {
-      if (!suspended) {
+    if (movement->is_suspended() != (suspended || sleeping)) {
+      if (!suspended && !sleeping) {
         movement->set_suspended(false);
       }
       else {
@@ -2416,20 +2518,8 @@ void Entity::check_collision_with_detectors() {
     return;
   }
 
-  // Detect simple collisions.
+  // Detect simple and pixel-precise collisions.
   get_map().check_collision_with_detectors(*this);
-
-  // Detect pixel-precise collisions.
-  std::vector<NamedSprite> sprites = this->sprites;
-  for (const NamedSprite& named_sprite: sprites) {
-    if (named_sprite.removed) {
-      continue;
-    }
-    Sprite& sprite = *named_sprite.sprite;
-    if (sprite.are_pixel_collisions_enabled()) {
-      get_map().check_collision_with_detectors(*this, sprite);
-    }
-  }
 }
 
 /**
@@ -2533,7 +2623,7 @@ void Entity::set_enabled(bool enabled) {
 
     this->enabled = true;
 
-    if (!is_suspended()) {
+    if (!is_suspended() && !is_sleeping()) {
       // Enabling an entity that is not suspended:
       // unsuspend its movement, its sprites and its timers.
       if (get_movement() != nullptr) {
@@ -2556,6 +2646,10 @@ void Entity::set_enabled(bool enabled) {
         get_lua_context()->set_entity_timers_suspended_as_map(*this, false);
       }
     }
+    else if (!is_suspended() && is_on_map()) {
+      // Sleeping: the movement and sprites are resumed when waking up.
+      get_lua_context()->set_entity_timers_suspended_as_map(*this, false);
+    }
     notify_enabled(true);
   }
   else {
@@ -3621,16 +3715,17 @@ void Entity::set_suspended(bool suspended) {
   }
 
   // Suspend/unsuspend sprite animations.
-  set_sprites_suspended(suspended);
+  // They stay suspended while the entity is sleeping.
+  set_sprites_suspended(suspended || sleeping);
 
   // Suspend/unsuspend the movement.
   if (movement != nullptr) {
     if (!movement->get_ignore_suspend()) {
-      movement->set_suspended(suspended || !is_enabled());
+      movement->set_suspended(suspended || sleeping || !is_enabled());
     }
   }
   if (stream_action != nullptr) {
-    stream_action->set_suspended(suspended || !is_enabled());
+    stream_action->set_suspended(suspended || sleeping || !is_enabled());
   }
 
   if (is_on_map()) {
@@ -0,0 +1,496 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Map.h"
+#include "solarus/core/System.h"
+#include "solarus/entities/Entities.h"
+#include "solarus/entities/Entity.h"
+#include "solarus/entities/NavigationGrid.h"
+#include <algorithm>
+
+namespace Solarus {
+
+/**
+ * \brief Returns whether two path queries are identical.
+ * \param other Another query.
+ * \return \c true if both queries have the same parameters.
+ */
+bool NavigationGrid::PathQuery::operator==(const PathQuery& other) const {
+
+  return layer == other.layer &&
+      source_index == other.source_index &&
+      target_index == other.target_index &&
+      type == other.type &&
+      entity == other.entity &&
+      ground_obstacles == other.ground_obstacles &&
+      max_nodes == other.max_nodes;
+}
+
+/**
+ * \brief Creates an empty navigation grid.
+ *
+ * Call build() once entities of the map are created.
+ *
+ * \param map The map.
+ * \param entities Entities of the map.
+ */
+NavigationGrid::NavigationGrid(Map& map, Entities& entities):
+  map(map),
+  entities(entities),
+  built(false),
+  version(0),
+  min_layer(map.get_min_layer()),
+  width8(map.get_width8()),
+  height8(map.get_height8()),
+  layers(),
+  footprints(),
+  occupancy(),
+  occupied_cells(),
+  entities_nearby(),
+  path_cache(),
+  path_cache_uses(0) {
+
+}
+
+/**
+ * \brief Initializes the grid from the tiles and the current ground modifiers.
+ *
+ * Squares covered by ground modifiers are only resolved lazily when
+ * their ground is requested.
+ */
+void NavigationGrid::build() {
+
+  const int num_cells = width8 * height8;
+  layers.clear();
+  for (int layer = map.get_min_layer(); layer <= map.get_max_layer(); ++layer) {
+    Layer cells;
+    cells.grounds.resize(num_cells);
+    cells.states.assign(num_cells, CellState::CLEAN);
+    for (int index = 0; index < num_cells; ++index) {
+      cells.grounds[index] = entities.get_tile_ground(
+          layer, (index % width8) * 8, (index / width8) * 8
+      );
+    }
+    layers.push_back(std::move(cells));
+  }
+
+  built = true;
+  footprints.clear();
+  occupancy.assign(num_cells, 0);
+  occupied_cells.clear();
+  for (const EntityPtr& entity : entities.get_entities()) {
+    notify_ground_modifier_changed(*entity);
+    notify_entity_added(*entity);
+  }
+  ++version;
+}
+
+/**
+ * \brief Returns the ground of a point if it is uniform on its 8x8 square.
+ *
+ * The point must be inside the map.
+ *
+ * \param layer Layer of the point.
+ * \param x X coordinate of the point.
+ * \param y Y coordinate of the point.
+ * \param[out] ground The ground at this point if the function returns \c true.
+ * \return \c false if the grid cannot tell the ground of this point:
+ * in this case, a precise query is needed.
+ */
+bool NavigationGrid::get_ground(int layer, int x, int y, Ground& ground) {
+
+  if (!built) {
+    return false;
+  }
+
+  const int index = (y >> 3) * width8 + (x >> 3);
+  Layer& cells = layers[layer - min_layer];
+  if (cells.states[index] == CellState::DIRTY) {
+    resolve_cell(layer, index);
+  }
+
+  if (cells.states[index] == CellState::MIXED) {
+    return false;
+  }
+
+  ground = cells.grounds[index];
+  return true;
+}
+
+/**
+ * \brief Tells what is known about the obstacles of an 8x8 square
+ * for an entity.
+ *
+ * The answer matches Map::test_collision_with_obstacles() on the square
+ * for an entity that is not a ground modifier.
+ * Any entity overlapping the square, on any layer, may be an obstacle:
+ * the square is then only known to be free after a precise test.
+ *
+ * \param layer Layer of the square.
+ * \param x8 X coordinate of the square (divided by 8).
+ * \param y8 Y coordinate of the square (divided by 8).
+ * \param ground_obstacles Grounds that are obstacles for the entity
+ * (see get_ground_obstacles()).
+ * \param check_ground \c false to ignore the ground of the square.
+ * \return Whether the square is free, blocked or unknown.
+ */
+NavigationGrid::Walkability NavigationGrid::get_walkability(
+    int layer, int x8, int y8, uint32_t ground_obstacles, bool check_ground) {
+
+  if (!built ||
+      x8 < 0 || x8 >= width8 ||
+      y8 < 0 || y8 >= height8) {
+    return Walkability::UNKNOWN;
+  }
+
+  if (check_ground) {
+    Ground ground = Ground::EMPTY;
+    if (!get_ground(layer, x8 * 8, y8 * 8, ground)) {
+      return Walkability::UNKNOWN;
+    }
+    switch (ground) {
+
+    case Ground::WALL_TOP_RIGHT:
+    case Ground::WALL_TOP_LEFT:
+    case Ground::WALL_BOTTOM_LEFT:
+    case Ground::WALL_BOTTOM_RIGHT:
+    case Ground::WALL_TOP_RIGHT_WATER:
+    case Ground::WALL_TOP_LEFT_WATER:
+    case Ground::WALL_BOTTOM_LEFT_WATER:
+    case Ground::WALL_BOTTOM_RIGHT_WATER:
+      // Depends on the point.
+      return Walkability::UNKNOWN;
+
+    default:
+      if (ground_obstacles & (1 << static_cast<int>(ground))) {
+        return Walkability::BLOCKED;
+      }
+      break;
+    }
+  }
+
+  if (occupancy[y8 * width8 + x8] != 0) {
+    return Walkability::UNKNOWN;
+  }
+  return Walkability::FREE;
+}
+
+/**
+ * \brief Notifies the grid that an entity may have changed the ground.
+ *
+ * Squares below the previous and the new area of the entity are invalidated.
+ * This is harmless if the entity is not and was not a ground modifier.
+ *
+ * \param entity The entity that moved, changed its ground, was enabled,
+ * disabled or is being removed.
+ */
+void NavigationGrid::notify_ground_modifier_changed(const Entity& entity) {
+
+  if (!built) {
+    return;
+  }
+
+  const auto it = footprints.find(&entity);
+  if (it != footprints.end()) {
+    invalidate(it->second.layer, it->second.box);
+  }
+
+  if (!entity.is_ground_modifier()) {
+    if (it != footprints.end()) {
+      footprints.erase(it);
+    }
+    return;
+  }
+
+  const Footprint footprint = { entity.get_layer(), entity.get_bounding_box() };
+  invalidate(footprint.layer, footprint.box);
+  footprints[&entity] = footprint;
+}
+
+/**
+ * \brief Notifies the grid that an entity was added to the map.
+ * \param entity The entity.
+ */
+void NavigationGrid::notify_entity_added(const Entity& entity) {
+
+  if (!built) {
+    return;
+  }
+
+  const Rectangle cells = get_cells(entity.get_bounding_box());
+  if (occupied_cells.emplace(&entity, cells).second) {
+    add_occupancy(cells, 1);
+  }
+}
+
+/**
+ * \brief Notifies the grid that the bounding box of an entity changed.
+ *
+ * This does nothing if the entity was not added to the map.
+ *
+ * \param entity The entity.
+ */
+void NavigationGrid::notify_entity_moved(const Entity& entity) {
+
+  const auto it = occupied_cells.find(&entity);
+  if (it == occupied_cells.end()) {
+    return;
+  }
+
+  const Rectangle cells = get_cells(entity.get_bounding_box());
+  if (it->second == cells) {
+    // Still on the same squares.
+    return;
+  }
+  add_occupancy(it->second, -1);
+  it->second = cells;
+  add_occupancy(cells, 1);
+}
+
+/**
+ * \brief Notifies the grid that an entity is destroyed.
+ * \param entity The entity removed from the map.
+ */
+void NavigationGrid::notify_entity_removed(const Entity& entity) {
+
+  // Forget its paths, another entity may be created at the same address.
+  path_cache.erase(std::remove_if(path_cache.begin(), path_cache.end(),
+      [&entity](const CachedPath& cached_path) {
+    return cached_path.query.entity == &entity;
+  }), path_cache.end());
+
+  const auto occupied_it = occupied_cells.find(&entity);
+  if (occupied_it != occupied_cells.end()) {
+    add_occupancy(occupied_it->second, -1);
+    occupied_cells.erase(occupied_it);
+  }
+
+  const auto it = footprints.find(&entity);
+  if (it == footprints.end()) {
+    return;
+  }
+
+  invalidate(it->second.layer, it->second.box);
+  footprints.erase(it);
+}
+
+/**
+ * \brief Notifies the grid that the tile ground of a square has changed.
+ * \param layer Layer of the square.
+ * \param x8 X coordinate of the square (divided by 8).
+ * \param y8 Y coordinate of the square (divided by 8).
+ */
+void NavigationGrid::notify_tile_ground_changed(int layer, int x8, int y8) {
+
+  if (!built) {
+    return;
+  }
+
+  invalidate(layer, Rectangle(x8 * 8, y8 * 8, 8, 8));
+}
+
+/**
+ * \brief Returns the squares of the map overlapping a rectangle.
+ * \param box A rectangle in map coordinates.
+ * \return The squares, in units of 8 pixels (empty if the rectangle is flat
+ * or outside the map).
+ */
+Rectangle NavigationGrid::get_cells(const Rectangle& box) const {
+
+  if (box.is_flat()) {
+    return Rectangle();
+  }
+
+  const int x8_min = std::max(0, box.get_x() >> 3);
+  const int y8_min = std::max(0, box.get_y() >> 3);
+  const int x8_max = std::min(width8 - 1, (box.get_x() + box.get_width() - 1) >> 3);
+  const int y8_max = std::min(height8 - 1, (box.get_y() + box.get_height() - 1) >> 3);
+  if (x8_max < x8_min || y8_max < y8_min) {
+    return Rectangle();
+  }
+  return Rectangle(x8_min, y8_min, x8_max - x8_min + 1, y8_max - y8_min + 1);
+}
+
+/**
+ * \brief Marks the squares overlapping a rectangle as dirty.
+ * \param layer Layer of the rectangle.
+ * \param box The rectangle in map coordinates.
+ */
+void NavigationGrid::invalidate(int layer, const Rectangle& box) {
+
+  if (!map.is_valid_layer(layer)) {
+    return;
+  }
+
+  const Rectangle cells_box = get_cells(box);
+  if (cells_box.is_flat()) {
+    return;
+  }
+
+  Layer& cells = layers[layer - min_layer];
+  for (int y8 = cells_box.get_y(); y8 < cells_box.get_y() + cells_box.get_height(); ++y8) {
+    for (int x8 = cells_box.get_x(); x8 < cells_box.get_x() + cells_box.get_width(); ++x8) {
+      cells.states[y8 * width8 + x8] = CellState::DIRTY;
+    }
+  }
+  ++version;
+}
+
+/**
+ * \brief Updates the number of entities overlapping some squares.
+ * \param cells The squares, in units of 8 pixels.
+ * \param delta 1 for an entity arriving on them, -1 for an entity leaving.
+ */
+void NavigationGrid::add_occupancy(const Rectangle& cells, int delta) {
+
+  for (int y8 = cells.get_y(); y8 < cells.get_y() + cells.get_height(); ++y8) {
+    for (int x8 = cells.get_x(); x8 < cells.get_x() + cells.get_width(); ++x8) {
+      occupancy[y8 * width8 + x8] += delta;
+    }
+  }
+}
+
+/**
+ * \brief Computes again the ground of a dirty square.
+ *
+ * This applies the same rules as Map::get_ground() to the whole square.
+ *
+ * \param layer Layer of the square.
+ * \param index Index of the square.
+ */
+void NavigationGrid::resolve_cell(int layer, int index) {
+
+  const Rectangle cell((index % width8) * 8, (index / width8) * 8, 8, 8);
+  Layer& cells = layers[layer - min_layer];
+
+  entities.get_entities_in_rectangle_z_sorted(cell, entities_nearby);
+
+  const Entity* modifier = nullptr;
+  for (const ConstEntityPtr& entity_nearby : entities_nearby) {
+
+    if (entity_nearby->get_modified_ground() == Ground::EMPTY ||
+        entity_nearby->get_layer() != layer ||
+        !entity_nearby->is_enabled() ||
+        entity_nearby->is_being_removed() ||
+        !entity_nearby->overlaps(cell)
+    ) {
+      continue;
+    }
+
+    if (modifier != nullptr ||
+        !entity_nearby->get_bounding_box().contains(cell)) {
+      // Several grounds on this square: the result depends on the point.
+      cells.states[index] = CellState::MIXED;
+      entities_nearby.clear();
+      return;
+    }
+    modifier = entity_nearby.get();
+  }
+  entities_nearby.clear();  // Don't keep entities alive.
+
+  if (modifier != nullptr) {
+    cells.grounds[index] = map.get_ground_from_entity(*modifier, cell.get_xy());
+  }
+  else {
+    cells.grounds[index] = entities.get_tile_ground(layer, cell.get_x(), cell.get_y());
+  }
+  cells.states[index] = CellState::CLEAN;
+}
+
+/**
+ * \brief Looks for a recent result of a path finding computation.
+ *
+ * A path is only reused if no ground changed since it was computed
+ * and if it is recent enough. Other entities may have moved in the meantime,
+ * so paths are not kept more than path_cache_delay milliseconds.
+ *
+ * \param query Parameters of the computation.
+ * \param[out] path The path found if the function returns \c true.
+ * \return \c true if a path was found in the cache.
+ */
+bool NavigationGrid::get_cached_path(const PathQuery& query, std::string& path) {
+
+  const uint32_t now = System::now();
+  for (CachedPath& cached_path : path_cache) {
+    if (cached_path.query == query) {
+      if (cached_path.version != version ||
+          now - cached_path.date >= path_cache_delay) {
+        return false;
+      }
+      cached_path.last_use = ++path_cache_uses;
+      path = cached_path.path;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Stores the result of a path finding computation.
+ *
+ * The least recently used path is forgotten if the cache is full.
+ *
+ * \param query Parameters of the computation.
+ * \param path The path found, or an empty string if there is no path.
+ */
+void NavigationGrid::set_cached_path(const PathQuery& query, const std::string& path) {
+
+  CachedPath* slot = nullptr;
+  for (CachedPath& cached_path : path_cache) {
+    if (cached_path.query == query) {
+      slot = &cached_path;
+      break;
+    }
+  }
+
+  if (slot == nullptr) {
+    if (path_cache.size() < static_cast<size_t>(path_cache_size)) {
+      path_cache.emplace_back();
+      slot = &path_cache.back();
+    }
+    else {
+      slot = &*std::min_element(path_cache.begin(), path_cache.end(),
+          [](const CachedPath& first, const CachedPath& second) {
+        return first.last_use < second.last_use;
+      });
+    }
+  }
+
+  slot->query = query;
+  slot->path = path;
+  slot->version = version;
+  slot->date = System::now();
+  slot->last_use = ++path_cache_uses;
+}
+
+/**
+ * \brief Returns the grounds that are obstacles for an entity.
+ * \param entity An entity.
+ * \return A bit mask with one bit set for each ground that is an obstacle.
+ */
+uint32_t NavigationGrid::get_ground_obstacles(const Entity& entity) {
+
+  uint32_t ground_obstacles = 0;
+  for (int i = 0; i <= static_cast<int>(Ground::LAVA); ++i) {
+    if (entity.is_ground_obstacle(static_cast<Ground>(i))) {
+      ground_obstacles |= 1 << i;
+    }
+  }
+  return ground_obstacles;
+}
+
+}
+
@@ -21,9 +21,19 @@
 #include "solarus/entities/NonAnimatedRegions.h"
 #include "solarus/entities/Tileset.h"
 #include "solarus/graphics/Surface.h"
+#include <algorithm>
+#include <cstdlib>
 
 namespace Solarus {
 
+namespace {
+
+constexpr int max_cells_built_per_frame = 1;    /**< Cells built in advance at each frame. */
+constexpr int prediction_frames = 50;           /**< How far ahead the camera movement is extrapolated. */
+constexpr size_t max_cache_bytes = 16 * 1024 * 1024;  /**< Memory budget of drawn cells. */
+
+}
+
 /**
  * \brief Constructor.
  * \param map The map. Its size must be known.
@@ -32,7 +42,11 @@ namespace Solarus {
 NonAnimatedRegions::NonAnimatedRegions(Map& map, int layer):
   map(map),
   layer(layer),
-  non_animated_tiles(map.get_size(), Size(512, 256)) {
+  non_animated_tiles(map.get_size(), Size(512, 256)),
+  cache_bytes(0),
+  frame(0),
+  num_cells_built(0),
+  has_previous_camera_xy(false) {
 
 }
 
@@ -118,6 +132,7 @@ void NonAnimatedRegions::build(std::vector<TileInfo>& rejected_tiles) {
 void NonAnimatedRegions::notify_tileset_changed() {
 
   optimized_tiles_surfaces.clear();
+  cache_bytes = 0;
   // Everything will be redrawn when necessary.
 }
 
@@ -154,45 +169,160 @@ bool NonAnimatedRegions::overlaps_animated_tile(const TileInfo& tile) const {
   return false;
 }
 
+/**
+ * \brief Returns the cells that overlap a rectangle of the map.
+ * \param area A rectangle in map coordinates.
+ * \return The rows and columns of cells overlapping this rectangle,
+ * as a rectangle in cell units. It is empty if the area is outside the map.
+ */
+Rectangle NonAnimatedRegions::get_cells_in(const Rectangle& area) const {
+
+  const Rectangle map_area = area & Rectangle(Point(), map.get_size());
+  if (map_area.is_flat()) {
+    return Rectangle(0, 0, 0, 0);
+  }
+
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  const int row1 = map_area.get_y() / cell_size.height;
+  const int row2 = (map_area.get_y() + map_area.get_height() - 1) / cell_size.height;
+  const int column1 = map_area.get_x() / cell_size.width;
+  const int column2 = (map_area.get_x() + map_area.get_width() - 1) / cell_size.width;
+  return Rectangle(column1, row1, column2 - column1 + 1, row2 - row1 + 1);
+}
+
+/**
+ * \brief Returns the area the camera will probably show soon.
+ *
+ * The last movement of the camera is extrapolated, at most one cell away.
+ *
+ * \param camera_box Current bounding box of the camera.
+ * \return The current bounding box extended toward where the camera moves.
+ */
+Rectangle NonAnimatedRegions::get_predicted_camera_box(const Rectangle& camera_box) const {
+
+  if (camera_velocity == Point()) {
+    return camera_box;
+  }
+
+  const Size& cell_size = non_animated_tiles.get_cell_size();
+  Point ahead = camera_velocity * prediction_frames;
+  ahead.x = std::max(-cell_size.width, std::min(ahead.x, cell_size.width));
+  ahead.y = std::max(-cell_size.height, std::min(ahead.y, cell_size.height));
+
+  return camera_box | Rectangle(camera_box.get_xy() + ahead, camera_box.get_size());
+}
+
 /**
  * \brief Called at each frame of the main loop.
+ *
+ * Builds in advance some cells the camera is moving toward
+ * and frees cells far from the camera if the cache is too big.
  */
 void NonAnimatedRegions::update() {
 
-  // Limit the size of the cache to avoid growing the memory usage.
-  if (optimized_tiles_surfaces.size() < 25) {
-    return;
-  }
+  ++frame;
 
-  std::vector<int> indexes_to_clear;
   const CameraPtr& camera = map.get_camera();
   if (camera == nullptr) {
     return;
   }
 
+  const Rectangle& camera_box = camera->get_bounding_box();
+  if (has_previous_camera_xy) {
+    camera_velocity = camera_box.get_xy() - previous_camera_xy;
+  }
+  previous_camera_xy = camera_box.get_xy();
+  has_previous_camera_xy = true;
+
+  // The predicted box contains the visible one.
+  const Rectangle cells_needed = get_cells_in(get_predicted_camera_box(camera_box));
+  build_cells_ahead(cells_needed, camera_box.get_center());
+  num_cells_built = 0;
+
+  evict_cells(cells_needed);
+}
+
+/**
+ * \brief Builds cells that are not visible yet but will probably be soon.
+ *
+ * Cells built since the last update count in the budget, and the nearest
+ * cells from the camera are built first.
+ *
+ * \param cells Rows and columns of cells that should be ready.
+ * \param camera_center Center of the camera in map coordinates.
+ */
+void NonAnimatedRegions::build_cells_ahead(const Rectangle& cells, const Point& camera_center) {
+
+  if (num_cells_built >= max_cells_built_per_frame) {
+    return;
+  }
+
+  const int num_columns = non_animated_tiles.get_num_columns();
   const Size& cell_size = non_animated_tiles.get_cell_size();
-  const Rectangle& camera_position = camera->get_bounding_box();
-  const int row1 = camera_position.get_y() / cell_size.height;
-  const int row2 = (camera_position.get_y() + camera_position.get_height()) / cell_size.height;
-  const int column1 = camera_position.get_x() / cell_size.width;
-  const int column2 = (camera_position.get_x() + camera_position.get_width()) / cell_size.width;
-
-  for (const auto& kvp : optimized_tiles_surfaces) {
-    const int cell_index = kvp.first;
-    const int row = cell_index / non_animated_tiles.get_num_columns();
-    const int column = cell_index % non_animated_tiles.get_num_columns();
-    if (column < column1 || column > column2 || row < row1 || row > row2) {
-      indexes_to_clear.push_back(cell_index);
+  std::vector<std::pair<int, int>> missing_cells;  // Distance to the camera and cell index.
+  for (int i = cells.get_y(); i < cells.get_y() + cells.get_height(); ++i) {
+    for (int j = cells.get_x(); j < cells.get_x() + cells.get_width(); ++j) {
+      const int cell_index = i * num_columns + j;
+      if (optimized_tiles_surfaces.find(cell_index) == optimized_tiles_surfaces.end()) {
+        const Point cell_center = {
+            j * cell_size.width + cell_size.width / 2,
+            i * cell_size.height + cell_size.height / 2
+        };
+        const Point distance = cell_center - camera_center;
+        missing_cells.emplace_back(std::abs(distance.x) + std::abs(distance.y), cell_index);
+      }
+    }
+  }
+
+  std::sort(missing_cells.begin(), missing_cells.end());
+  for (const std::pair<int, int>& missing_cell : missing_cells) {
+    if (num_cells_built >= max_cells_built_per_frame) {
+      break;
     }
+    build_cell(missing_cell.second);
   }
+}
+
+/**
+ * \brief Frees the least recently used cells until the cache fits in
+ * its memory budget.
+ * \param cells_to_keep Rows and columns of cells that must not be freed.
+ */
+void NonAnimatedRegions::evict_cells(const Rectangle& cells_to_keep) {
+
+  const int num_columns = non_animated_tiles.get_num_columns();
+  while (cache_bytes > max_cache_bytes) {
+
+    auto oldest = optimized_tiles_surfaces.end();
+    for (auto it = optimized_tiles_surfaces.begin(); it != optimized_tiles_surfaces.end(); ++it) {
+      const int row = it->first / num_columns;
+      const int column = it->first % num_columns;
+      if (cells_to_keep.contains(column, row)) {
+        continue;
+      }
+      if (oldest == optimized_tiles_surfaces.end() ||
+          it->second.last_used < oldest->second.last_used) {
+        oldest = it;
+      }
+    }
+
+    if (oldest == optimized_tiles_surfaces.end()) {
+      // Everything is needed.
+      return;
+    }
 
-  for (int cell_index : indexes_to_clear) {
-    optimized_tiles_surfaces.erase(cell_index);
+    const SurfacePtr& surface = oldest->second.surface;
+    if (surface != nullptr) {
+      cache_bytes -= surface->get_width() * surface->get_height() * 4;
+    }
+    optimized_tiles_surfaces.erase(oldest);
   }
 }
 
 /**
  * \brief Draws a layer of non-animated regions of tiles on the current map.
+ *
+ * Visible cells not built yet are built now, whatever the budget.
  */
 void NonAnimatedRegions::draw_on_map() {
 
@@ -202,36 +332,28 @@ void NonAnimatedRegions::draw_on_map() {
   }
 
   // Check all grid cells that overlap the camera.
-  const int num_rows = non_animated_tiles.get_num_rows();
   const int num_columns = non_animated_tiles.get_num_columns();
   const Size& cell_size = non_animated_tiles.get_cell_size();
   const Rectangle& camera_position = camera->get_bounding_box();
+  const Rectangle cells = get_cells_in(camera_position);
 
-  const int row1 = camera_position.get_y() / cell_size.height;
-  const int row2 = (camera_position.get_y() + camera_position.get_height()) / cell_size.height;
-  const int column1 = camera_position.get_x() / cell_size.width;
-  const int column2 = (camera_position.get_x() + camera_position.get_width()) / cell_size.width;
-
-  if (row1 > row2 || column1 > column2) {
-    // No cell.
-    return;
-  }
-
-  for (int i = row1; i <= row2; ++i) {
-    if (i < 0 || i >= num_rows) {
-      continue;
-    }
-
-    for (int j = column1; j <= column2; ++j) {
-      if (j < 0 || j >= num_columns) {
-        continue;
-      }
+  for (int i = cells.get_y(); i < cells.get_y() + cells.get_height(); ++i) {
+    for (int j = cells.get_x(); j < cells.get_x() + cells.get_width(); ++j) {
 
       // Make sure this cell is built.
-      int cell_index = i * num_columns + j;
-      if (optimized_tiles_surfaces.find(cell_index) == optimized_tiles_surfaces.end()) {
+      const int cell_index = i * num_columns + j;
+      auto it = optimized_tiles_surfaces.find(cell_index);
+      if (it == optimized_tiles_surfaces.end()) {
         // Lazily build the cell.
         build_cell(cell_index);
+        it = optimized_tiles_surfaces.find(cell_index);
+      }
+      it->second.last_used = frame;
+
+      const SurfacePtr& cell_surface = it->second.surface;
+      if (cell_surface == nullptr) {
+        // No non-animated tile here.
+        continue;
       }
 
       const Point cell_xy = {
@@ -240,7 +362,7 @@ void NonAnimatedRegions::draw_on_map() {
       };
 
       const Point dst_position = cell_xy - camera_position.get_xy();
-      optimized_tiles_surfaces.at(cell_index)->draw(
+      cell_surface->draw(
           map.get_camera_surface(), dst_position
       );
     }
@@ -271,11 +393,26 @@ void NonAnimatedRegions::build_cell(int cell_index) {
       row * cell_size.height
   };
 
-  SurfacePtr cell_surface = Surface::create(cell_size,true);
-  optimized_tiles_surfaces[cell_index] = cell_surface;
+  ++num_cells_built;
+  CachedCell& cached_cell = optimized_tiles_surfaces[cell_index];
+  cached_cell.last_used = frame;
 
   const std::vector<TileInfo>& tiles_in_cell =
       non_animated_tiles.get_elements(cell_index);
+  if (tiles_in_cell.empty()) {
+    // Nothing to draw: don't waste a surface.
+    return;
+  }
+
+  // The last cells might exceed the map border.
+  const Size surface_size(
+      std::min(cell_size.width, map.get_width() - cell_xy.x),
+      std::min(cell_size.height, map.get_height() - cell_xy.y)
+  );
+  SurfacePtr cell_surface = Surface::create(surface_size, true);
+  cached_cell.surface = cell_surface;
+  cache_bytes += surface_size.width * surface_size.height * 4;
+
   for (const TileInfo& tile: tiles_in_cell) {
 
     Rectangle dst_position(
@@ -299,14 +436,8 @@ void NonAnimatedRegions::build_cell(int cell_index) {
   // We may have drawn too much.
   // We have to make sure we don't exceed the non-animated regions.
   // Erase 8x8 squares that contain animated tiles.
-  for (int y = cell_xy.y; y < cell_xy.y + cell_size.height; y += 8) {
-    if (y >= map.get_height()) {  // The last cell might exceed the map border.
-      continue;
-    }
-    for (int x = cell_xy.x; x < cell_xy.x + cell_size.width; x += 8) {
-      if (x >= map.get_width()) {
-        continue;
-      }
+  for (int y = cell_xy.y; y < cell_xy.y + surface_size.height; y += 8) {
+    for (int x = cell_xy.x; x < cell_xy.x + surface_size.width; x += 8) {
 
       int square_index = (y / 8) * map.get_width8() + (x / 8);
 
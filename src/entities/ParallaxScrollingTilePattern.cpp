@@ -84,5 +84,12 @@ bool ParallaxScrollingTilePattern::is_drawn_at_its_position() const {
   return false;
 }
 
+/**
+ * \copydoc TilePattern::get_position_in_tileset
+ */
+bool ParallaxScrollingTilePattern::get_position_in_tileset(Point& /* position */) const {
+  return false;
+}
+
 }
 
@@ -115,5 +115,12 @@ bool SelfScrollingTilePattern::is_animated() const {
   return true;
 }
 
+/**
+ * \copydoc TilePattern::get_position_in_tileset
+ */
+bool SelfScrollingTilePattern::get_position_in_tileset(Point& /* position */) const {
+  return false;
+}
+
 }
 
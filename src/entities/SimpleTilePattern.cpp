@@ -64,5 +64,13 @@ bool SimpleTilePattern::is_animated() const {
   return false;
 }
 
+/**
+ * \copydoc TilePattern::get_position_in_tileset
+ */
+bool SimpleTilePattern::get_position_in_tileset(Point& position) const {
+  position = position_in_tileset.get_xy();
+  return true;
+}
+
 }
 
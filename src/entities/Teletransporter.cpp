@@ -60,7 +60,8 @@ Teletransporter::Teletransporter(
   destination_name(destination_name),
   destination_side(-1),
   transition_direction(0),
-  transporting_hero(false) {
+  transporting_hero(false),
+  hero_close(false) {
 
   set_collision_modes(CollisionMode::COLLISION_CUSTOM);
 
@@ -105,6 +106,39 @@ void Teletransporter::notify_creating() {
     set_layer_independent_collisions(true);
     transition_direction = (destination_side + 2) % 4;
   }
+
+  // The destination may differ from the map data if created from Lua.
+  preload_destination_map(ResourceProvider::Priority::NORMAL);
+}
+
+/**
+ * \copydoc Entity::update
+ */
+void Teletransporter::update() {
+
+  Entity::update();
+
+  // Load the destination map in priority when the hero comes close.
+  const bool was_hero_close = hero_close;
+  hero_close = get_extended_bounding_box(48).overlaps(get_hero().get_bounding_box());
+  if (hero_close && !was_hero_close) {
+    preload_destination_map(ResourceProvider::Priority::HIGH);
+  }
+}
+
+/**
+ * \brief Requests to load in background the map this teletransporter
+ * leads to.
+ * \param priority Urgency of the request.
+ */
+void Teletransporter::preload_destination_map(ResourceProvider::Priority priority) {
+
+  if (destination_map_id.empty() ||
+      destination_map_id == get_map().get_id()) {
+    return;
+  }
+  get_game().get_resource_provider().preload(
+        ResourceType::MAP, destination_map_id, priority);
 }
 
 /**
@@ -169,6 +203,9 @@ const std::string& Teletransporter::get_destination_map_id() const {
  */
 void Teletransporter::set_destination_map_id(const std::string& map_id) {
   this->destination_map_id = map_id;
+  if (is_on_map()) {
+    preload_destination_map(ResourceProvider::Priority::NORMAL);
+  }
 }
 
 /**
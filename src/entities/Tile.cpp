@@ -102,6 +102,14 @@ void Tile::draw_on_surface(const SurfacePtr& dst_surface, const Point& viewport)
   );
 }
 
+/**
+ * \brief Returns whether the pattern of this tile exists in its tileset.
+ * \return \c true if the tile has a pattern.
+ */
+bool Tile::has_tile_pattern() const {
+  return tile_pattern != nullptr;
+}
+
 /**
  * \brief Returns the pattern of this tile.
  * \return The tile pattern.
@@ -118,6 +126,14 @@ const std::string& Tile::get_tile_pattern_id() const {
   return tile_pattern_id;
 }
 
+/**
+ * \brief Returns the tileset of the pattern of this tile.
+ * \return The tileset, or nullptr if it is the one of the map.
+ */
+const Tileset* Tile::get_tileset() const {
+  return tileset;
+}
+
 /**
  * \brief Returns whether the pattern is animated.
  *
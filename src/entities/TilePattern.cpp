@@ -126,6 +126,23 @@ bool TilePattern::is_drawn_at_its_position() const {
   return true;
 }
 
+/**
+ * \brief Returns where the current image of this tile pattern is in the
+ * tileset image.
+ *
+ * This only makes sense for tile patterns whose drawing is a plain copy of
+ * a rectangle of the tileset at the tile position, possibly changing
+ * over time.
+ * Such tile patterns can be drawn by the GPU from the tileset directly.
+ * Returns false by default.
+ *
+ * \param[out] position Top-left corner of the current image in the tileset.
+ * \return \c true if the tile pattern is drawn as a rectangle of the tileset.
+ */
+bool TilePattern::get_position_in_tileset(Point& /* position */) const {
+  return false;
+}
+
 /**
  * \brief Fills a rectangle by repeating this tile pattern.
  * \param dst_surface The destination surface.
@@ -28,25 +28,27 @@ Hq3xFilter::Hq3xFilter():
 }
 
 /**
- * \copydoc PixelFilter::get_scaling_factor
+ * \copydoc SoftwarePixelFilter::get_scaling_factor
  */
 int Hq3xFilter::get_scaling_factor() const {
   return 3;
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::filter_rows
  */
-void Hq3xFilter::filter(
+void Hq3xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
+    int first_row,
+    int last_row,
     uint32_t* dst) const {
 
   // Make sure hqx is initialized.
   Hq4xFilter::initialize_hqx();
 
-  hq3x_32(const_cast<uint32_t*>(src), dst, src_width, src_height);
+  hq3x_32_rows(const_cast<uint32_t*>(src), dst, src_width, src_height, first_row, last_row);
 }
 
 }
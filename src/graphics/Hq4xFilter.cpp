@@ -16,11 +16,12 @@
  */
 #include "solarus/graphics/Hq4xFilter.h"
 #include "solarus/third_party/hqx/hqx.h"
+#include <mutex>
 
 namespace Solarus {
 
 namespace {
-  bool hqx_initialized = false;   /**< Whether the common hqx initialization was done. */
+  std::once_flag hqx_initialized;   /**< Whether the common hqx initialization was done. */
 }
 
 /**
@@ -31,38 +32,38 @@ Hq4xFilter::Hq4xFilter():
 }
 
 /**
- * \copydoc PixelFilter::get_scaling_factor
+ * \copydoc SoftwarePixelFilter::get_scaling_factor
  */
 int Hq4xFilter::get_scaling_factor() const {
   return 4;
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::filter_rows
  */
-void Hq4xFilter::filter(
+void Hq4xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
+    int first_row,
+    int last_row,
     uint32_t* dst) const {
 
   // Make sure hqx is initialized.
   initialize_hqx();
 
-  hq4x_32(const_cast<uint32_t*>(src), dst, src_width, src_height);
+  hq4x_32_rows(const_cast<uint32_t*>(src), dst, src_width, src_height, first_row, last_row);
 }
 
 /**
  * \brief Performs the initialization common to the 3 variants of hqx.
  *
  * Does nothing if the initialization was already done.
+ * This function is thread-safe.
  */
 void Hq4xFilter::initialize_hqx() {
 
-  if (!hqx_initialized) {
-    hqx_initialized = true;
-    hqxInit();
-  }
+  std::call_once(hqx_initialized, hqxInit);
 }
 
 }
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/PixelBitsCache.h"
+#include "solarus/graphics/Surface.h"
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace Solarus {
+
+namespace {
+
+/**
+ * \brief Identifies a frame in an image file.
+ */
+struct FrameKey {
+
+  std::string image_file_name;  /**< Image file relative to the data directory. */
+  int x;                        /**< X coordinate of the frame in the image. */
+  int y;                        /**< Y coordinate of the frame in the image. */
+  int width;                    /**< Width of the frame. */
+  int height;                   /**< Height of the frame. */
+
+  FrameKey(const std::string& image_file_name, const Rectangle& frame):
+    image_file_name(image_file_name),
+    x(frame.get_x()),
+    y(frame.get_y()),
+    width(frame.get_width()),
+    height(frame.get_height()) {
+  }
+
+  bool operator<(const FrameKey& other) const {
+    return std::tie(image_file_name, x, y, width, height) <
+        std::tie(other.image_file_name, other.x, other.y, other.width, other.height);
+  }
+};
+
+/**
+ * \brief State of the cache.
+ */
+struct CacheContext {
+  std::mutex mutex;                   /**< Lock for all fields. */
+  std::map<FrameKey, std::shared_ptr<const PixelBits>>
+      pixel_bits;                     /**< Pixel bits of each frame created so far. */
+  bool preloading_enabled = false;    /**< Whether sprites are analyzed in background. */
+};
+
+CacheContext context;
+
+/**
+ * \brief Stores new pixel bits unless another thread did it in the meantime.
+ * \param key The frame.
+ * \param pixel_bits Pixel bits just created for this frame.
+ * \return The pixel bits now in the cache for this frame.
+ */
+std::shared_ptr<const PixelBits> store(
+    const FrameKey& key,
+    const std::shared_ptr<const PixelBits>& pixel_bits) {
+
+  std::lock_guard<std::mutex> lock(context.mutex);
+  return context.pixel_bits.emplace(key, pixel_bits).first->second;
+}
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Returns the pixel bits of a frame, creating them if needed.
+ * \param image_file_name Name of the image file, relative to the data
+ * directory.
+ * \param image The image loaded from this file.
+ * \param frame Position of the frame in the image.
+ * \return The pixel bits of this frame.
+ */
+std::shared_ptr<const PixelBits> PixelBitsCache::get_pixel_bits(
+    const std::string& image_file_name,
+    const Surface& image,
+    const Rectangle& frame) {
+
+  const FrameKey key(image_file_name, frame);
+  {
+    std::lock_guard<std::mutex> lock(context.mutex);
+    const auto it = context.pixel_bits.find(key);
+    if (it != context.pixel_bits.end()) {
+      return it->second;
+    }
+  }
+
+  // Analyze the pixels without locking.
+  return store(key, std::make_shared<const PixelBits>(image, frame));
+}
+
+/**
+ * \brief Creates in advance the pixel bits of frames of an image file.
+ *
+ * The image is loaded as a software surface,
+ * so this function can be called from any thread.
+ * Frames already in the cache are skipped.
+ *
+ * \param image_file_name Name of the image file, relative to the data
+ * directory.
+ * \param frames Positions of frames in the image.
+ */
+void PixelBitsCache::preload_pixel_bits(
+    const std::string& image_file_name,
+    const std::vector<Rectangle>& frames) {
+
+  std::vector<Rectangle> missing_frames;
+  {
+    std::lock_guard<std::mutex> lock(context.mutex);
+    for (const Rectangle& frame : frames) {
+      if (context.pixel_bits.find(FrameKey(image_file_name, frame)) == context.pixel_bits.end()) {
+        missing_frames.push_back(frame);
+      }
+    }
+  }
+
+  if (missing_frames.empty()) {
+    return;
+  }
+
+  SDL_Surface_UniquePtr image = Surface::create_sdl_surface_from_file(image_file_name);
+  if (image == nullptr) {
+    return;
+  }
+
+  for (const Rectangle& frame : missing_frames) {
+    store(FrameKey(image_file_name, frame), std::make_shared<const PixelBits>(*image, frame));
+  }
+}
+
+/**
+ * \brief Returns the number of frames whose pixel bits are in the cache.
+ * \return The number of pixel bits.
+ */
+int PixelBitsCache::get_num_pixel_bits() {
+
+  std::lock_guard<std::mutex> lock(context.mutex);
+  return context.pixel_bits.size();
+}
+
+/**
+ * \brief Forgets all pixel bits.
+ *
+ * Sprites still using them keep them alive.
+ */
+void PixelBitsCache::clear() {
+
+  std::lock_guard<std::mutex> lock(context.mutex);
+  context.pixel_bits.clear();
+}
+
+/**
+ * \brief Returns whether pixel bits of all sprites should be created
+ * in background when the quest starts.
+ * \return \c true if preloading is enabled.
+ */
+bool PixelBitsCache::is_preloading_enabled() {
+
+  std::lock_guard<std::mutex> lock(context.mutex);
+  return context.preloading_enabled;
+}
+
+/**
+ * \brief Sets whether pixel bits of all sprites should be created
+ * in background when the quest starts.
+ * \param preloading_enabled \c true to enable preloading.
+ */
+void PixelBitsCache::set_preloading_enabled(bool preloading_enabled) {
+
+  std::lock_guard<std::mutex> lock(context.mutex);
+  context.preloading_enabled = preloading_enabled;
+}
+
+}
+
@@ -16,8 +16,66 @@
  */
 #include "solarus/graphics/Scale2xFilter.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SOLARUS_SCALE2X_SSE2
+#  include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define SOLARUS_SCALE2X_NEON
+#  include <arm_neon.h>
+#endif
+
 namespace Solarus {
 
+namespace {
+
+/**
+ * \brief Scales one pixel of a row.
+ *
+ * With the neighbors named like this:
+ *    B
+ *  D E F
+ *    H
+ * E becomes 4 pixels, each one taking the color of its two neighbors
+ * if they are equal and if the image is not flat around E.
+ *
+ * \param line The source row.
+ * \param above The row above, or the source row for the first row.
+ * \param below The row below, or the source row for the last row.
+ * \param col Column of the pixel.
+ * \param width Width of the rows.
+ * \param dst_line0 First destination row.
+ * \param dst_line1 Second destination row.
+ */
+inline void scale_pixel(
+    const uint32_t* line,
+    const uint32_t* above,
+    const uint32_t* below,
+    int col,
+    int width,
+    uint32_t* dst_line0,
+    uint32_t* dst_line1) {
+
+  const uint32_t e = line[col];
+  const uint32_t b = above[col];
+  const uint32_t h = below[col];
+  const uint32_t d = (col == 0) ? e : line[col - 1];
+  const uint32_t f = (col == width - 1) ? e : line[col + 1];
+
+  uint32_t* e1 = &dst_line0[col * 2];
+  uint32_t* e3 = &dst_line1[col * 2];
+  if (b != h && d != f) {
+    e1[0] = (d == b) ? d : e;
+    e1[1] = (b == f) ? f : e;
+    e3[0] = (d == h) ? d : e;
+    e3[1] = (h == f) ? f : e;
+  }
+  else {
+    e1[0] = e1[1] = e3[0] = e3[1] = e;
+  }
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Constructor.
  */
@@ -26,71 +84,96 @@ Scale2xFilter::Scale2xFilter():
 }
 
 /**
- * \copydoc PixelFilter::get_scaling_factor
+ * \copydoc SoftwarePixelFilter::get_scaling_factor
  */
 int Scale2xFilter::get_scaling_factor() const {
   return 2;
 }
 
 /**
- * \copydoc PixelFilter::filter
+ * \copydoc SoftwarePixelFilter::filter_rows
+ *
+ * Inner pixels are processed 4 at a time with SSE2 or NEON if available.
  */
-void Scale2xFilter::filter(
+void Scale2xFilter::filter_rows(
     const uint32_t* src,
     int src_width,
     int src_height,
+    int first_row,
+    int last_row,
     uint32_t* dst) const {
 
   const int dst_width = src_width * 2;
 
-  int e1 = 0;
-  int e2, e3, e4;
-  int b, d, e = 0, f,  h;
-  for (int row = 0; row < src_height; row++) {
-    for (int col = 0; col < src_width; col++) {
-
-      // compute a to i
-
-      b = e - src_width;
-      d = e - 1;
-      f = e + 1;
-      h = e + src_width;
-
-      if (row == 0) {
-        b = e;
-      }
-      if (row == src_height - 1) {
-        h = e;
-      }
-      if (col == 0) {
-        d = e;
-      }
-      if (col == src_width - 1) {
-        f = e;
-      }
-
-      // compute e1 to e4
-      e2 = e1 + 1;
-      e3 = e1 + dst_width;
-      e4 = e3 + 1;
-
-      // compute the color
-
-      if (src[b] != src[h] && src[d] != src[f]) {
-        dst[e1] = src[(src[d] == src[b]) ? d : e];
-        dst[e2] = src[(src[b] == src[f]) ? f : e];
-        dst[e3] = src[(src[d] == src[h]) ? d : e];
-        dst[e4] = src[(src[h] == src[f]) ? f : e];
-      }
-      else {
-        dst[e1] = dst[e2] = dst[e3] = dst[e4] = src[e];
-      }
-      e1 += 2;
-      e++;
+  for (int row = first_row; row < last_row; ++row) {
+
+    const uint32_t* line = &src[row * src_width];
+    const uint32_t* above = (row == 0) ? line : line - src_width;
+    const uint32_t* below = (row == src_height - 1) ? line : line + src_width;
+    uint32_t* dst_line0 = &dst[row * 2 * dst_width];
+    uint32_t* dst_line1 = dst_line0 + dst_width;
+
+    // The first column has no left neighbor.
+    scale_pixel(line, above, below, 0, src_width, dst_line0, dst_line1);
+    int col = 1;
+
+#if defined(SOLARUS_SCALE2X_SSE2)
+    // Columns whose right neighbors all exist.
+    for (; col + 4 < src_width; col += 4) {
+      const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&line[col]));
+      const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&above[col]));
+      const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&below[col]));
+      const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&line[col - 1]));
+      const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&line[col + 1]));
+
+      // Pixels where the image is not flat.
+      const __m128i flat = _mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f));
+      const __m128i use_d0 = _mm_andnot_si128(flat, _mm_cmpeq_epi32(d, b));
+      const __m128i use_f1 = _mm_andnot_si128(flat, _mm_cmpeq_epi32(b, f));
+      const __m128i use_d2 = _mm_andnot_si128(flat, _mm_cmpeq_epi32(d, h));
+      const __m128i use_f3 = _mm_andnot_si128(flat, _mm_cmpeq_epi32(h, f));
+
+      const __m128i e0 = _mm_or_si128(_mm_and_si128(use_d0, d), _mm_andnot_si128(use_d0, e));
+      const __m128i e1 = _mm_or_si128(_mm_and_si128(use_f1, f), _mm_andnot_si128(use_f1, e));
+      const __m128i e2 = _mm_or_si128(_mm_and_si128(use_d2, d), _mm_andnot_si128(use_d2, e));
+      const __m128i e3 = _mm_or_si128(_mm_and_si128(use_f3, f), _mm_andnot_si128(use_f3, e));
+
+      __m128i* out0 = reinterpret_cast<__m128i*>(&dst_line0[col * 2]);
+      __m128i* out1 = reinterpret_cast<__m128i*>(&dst_line1[col * 2]);
+      _mm_storeu_si128(out0, _mm_unpacklo_epi32(e0, e1));
+      _mm_storeu_si128(out0 + 1, _mm_unpackhi_epi32(e0, e1));
+      _mm_storeu_si128(out1, _mm_unpacklo_epi32(e2, e3));
+      _mm_storeu_si128(out1 + 1, _mm_unpackhi_epi32(e2, e3));
     }
-    e1 += dst_width;
-  }
+#elif defined(SOLARUS_SCALE2X_NEON)
+    // Columns whose right neighbors all exist.
+    for (; col + 4 < src_width; col += 4) {
+      const uint32x4_t e = vld1q_u32(&line[col]);
+      const uint32x4_t b = vld1q_u32(&above[col]);
+      const uint32x4_t h = vld1q_u32(&below[col]);
+      const uint32x4_t d = vld1q_u32(&line[col - 1]);
+      const uint32x4_t f = vld1q_u32(&line[col + 1]);
+
+      // Pixels where the image is not flat.
+      const uint32x4_t flat = vorrq_u32(vceqq_u32(b, h), vceqq_u32(d, f));
+      const uint32x4_t e0 = vbslq_u32(vbicq_u32(vceqq_u32(d, b), flat), d, e);
+      const uint32x4_t e1 = vbslq_u32(vbicq_u32(vceqq_u32(b, f), flat), f, e);
+      const uint32x4_t e2 = vbslq_u32(vbicq_u32(vceqq_u32(d, h), flat), d, e);
+      const uint32x4_t e3 = vbslq_u32(vbicq_u32(vceqq_u32(h, f), flat), f, e);
+
+      const uint32x4x2_t top = vzipq_u32(e0, e1);
+      const uint32x4x2_t bottom = vzipq_u32(e2, e3);
+      vst1q_u32(&dst_line0[col * 2], top.val[0]);
+      vst1q_u32(&dst_line0[col * 2 + 4], top.val[1]);
+      vst1q_u32(&dst_line1[col * 2], bottom.val[0]);
+      vst1q_u32(&dst_line1[col * 2 + 4], bottom.val[1]);
+    }
+#endif
 
+    for (; col < src_width; ++col) {
+      scale_pixel(line, above, below, col, src_width, dst_line0, dst_line1);
+    }
+  }
 }
 
 }
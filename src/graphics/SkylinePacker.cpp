@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/graphics/SkylinePacker.h"
+#include <algorithm>
+#include <limits>
+
+namespace Solarus {
+
+/**
+ * \brief Creates an empty packer.
+ * \param size Size of the area to fill.
+ */
+SkylinePacker::SkylinePacker(const Size& size):
+  size(size),
+  used_area(0),
+  skyline() {
+
+  skyline.push_back({ 0, 0, size.width });
+}
+
+/**
+ * \brief Returns the size of the area.
+ * \return The size of the area.
+ */
+const Size& SkylinePacker::get_size() const {
+  return size;
+}
+
+/**
+ * \brief Returns the area covered by the rectangles inserted so far.
+ * \return The used area in pixels.
+ */
+int SkylinePacker::get_used_area() const {
+  return used_area;
+}
+
+/**
+ * \brief Finds a place for a new rectangle.
+ * \param[in] rectangle_size Size of the rectangle to place.
+ * \param[out] position Top-left corner of the rectangle if it fits.
+ * \return \c true if the rectangle was placed,
+ * \c false if there is not enough space left.
+ */
+bool SkylinePacker::insert(const Size& rectangle_size, Point& position) {
+
+  if (rectangle_size.width <= 0 || rectangle_size.height <= 0) {
+    return false;
+  }
+
+  int best_bottom = std::numeric_limits<int>::max();
+  int best_width = std::numeric_limits<int>::max();
+  size_t best_index = skyline.size();
+  Point best_position;
+  for (size_t i = 0; i < skyline.size(); ++i) {
+    const int y = get_fit_y(i, rectangle_size);
+    if (y < 0) {
+      continue;
+    }
+    const int bottom = y + rectangle_size.height;
+    if (bottom < best_bottom ||
+        (bottom == best_bottom && skyline[i].width < best_width)) {
+      best_bottom = bottom;
+      best_width = skyline[i].width;
+      best_index = i;
+      best_position = Point(skyline[i].x, y);
+    }
+  }
+
+  if (best_index == skyline.size()) {
+    return false;
+  }
+
+  add_segment(best_index, best_position, rectangle_size);
+  used_area += rectangle_size.width * rectangle_size.height;
+  position = best_position;
+  return true;
+}
+
+/**
+ * \brief Returns where a rectangle would be placed if its left side
+ * was at the start of a segment.
+ * \param index Index of the segment.
+ * \param rectangle_size Size of the rectangle.
+ * \return The y coordinate of the rectangle, or -1 if it does not fit there.
+ */
+int SkylinePacker::get_fit_y(size_t index, const Size& rectangle_size) const {
+
+  if (skyline[index].x + rectangle_size.width > size.width) {
+    return -1;
+  }
+
+  int y = 0;
+  int remaining_width = rectangle_size.width;
+  while (remaining_width > 0) {
+    // Segments cover the whole width, so the loop stays in the skyline.
+    y = std::max(y, skyline[index].y);
+    if (y + rectangle_size.height > size.height) {
+      return -1;
+    }
+    remaining_width -= skyline[index].width;
+    ++index;
+  }
+  return y;
+}
+
+/**
+ * \brief Raises the skyline above a rectangle just placed.
+ * \param index Index of the segment where the rectangle starts.
+ * \param position Position of the rectangle.
+ * \param rectangle_size Size of the rectangle.
+ */
+void SkylinePacker::add_segment(
+    size_t index,
+    const Point& position,
+    const Size& rectangle_size) {
+
+  skyline.insert(skyline.begin() + index,
+      { position.x, position.y + rectangle_size.height, rectangle_size.width });
+
+  // Cut the segments now hidden by the new one.
+  const int right = position.x + rectangle_size.width;
+  size_t i = index + 1;
+  while (i < skyline.size() && skyline[i].x < right) {
+    const int hidden_width = right - skyline[i].x;
+    if (hidden_width >= skyline[i].width) {
+      skyline.erase(skyline.begin() + i);
+    }
+    else {
+      skyline[i].x += hidden_width;
+      skyline[i].width -= hidden_width;
+      break;
+    }
+  }
+
+  // Merge neighbors at the same height.
+  i = 0;
+  while (i + 1 < skyline.size()) {
+    if (skyline[i].y == skyline[i + 1].y) {
+      skyline[i].width += skyline[i + 1].width;
+      skyline.erase(skyline.begin() + i + 1);
+    }
+    else {
+      ++i;
+    }
+  }
+}
+
+}
+
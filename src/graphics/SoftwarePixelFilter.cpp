@@ -15,9 +15,89 @@
  * with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 #include "solarus/graphics/SoftwarePixelFilter.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace Solarus {
 
+namespace {
+
+constexpr unsigned max_threads = 8;     /**< Maximum number of filtering threads. */
+constexpr int bands_per_thread = 4;     /**< Bands per thread, to balance uneven rows. */
+
+/**
+ * \brief State of the filtering threads and of the image being filtered.
+ */
+struct FilterContext {
+  std::mutex mutex;                         /**< Lock for all fields. */
+  std::condition_variable work_condition;   /**< Notified when bands are available or when stopping. */
+  std::condition_variable done_condition;   /**< Notified when the image is completely filtered. */
+  std::vector<std::thread> threads;         /**< The filtering threads. */
+  bool stopping = false;                    /**< Whether threads should stop. */
+
+  const SoftwarePixelFilter* filter = nullptr;  /**< Filter being applied or nullptr. */
+  const uint32_t* src = nullptr;            /**< Source pixels. */
+  int src_width = 0;                        /**< Width of the source. */
+  int src_height = 0;                       /**< Height of the source. */
+  uint32_t* dst = nullptr;                  /**< Destination pixels. */
+  int band_height = 0;                      /**< Number of rows of a band. */
+  int num_bands = 0;                        /**< Number of bands of the image. */
+  int next_band = 0;                        /**< Next band to give to a thread. */
+  int num_bands_done = 0;                   /**< Number of bands completely filtered. */
+};
+
+FilterContext context;
+
+/**
+ * \brief Filters the next band of the current image if any.
+ * \param lock Lock on the context, released while filtering.
+ * \return \c true if a band was filtered.
+ */
+bool filter_next_band(std::unique_lock<std::mutex>& lock) {
+
+  if (context.filter == nullptr || context.next_band >= context.num_bands) {
+    return false;
+  }
+
+  const SoftwarePixelFilter& filter = *context.filter;
+  const uint32_t* src = context.src;
+  const int src_width = context.src_width;
+  const int src_height = context.src_height;
+  uint32_t* dst = context.dst;
+  const int first_row = context.next_band * context.band_height;
+  const int last_row = std::min(first_row + context.band_height, src_height);
+  ++context.next_band;
+
+  lock.unlock();
+  filter.filter_rows(src, src_width, src_height, first_row, last_row, dst);
+  lock.lock();
+
+  ++context.num_bands_done;
+  if (context.num_bands_done == context.num_bands) {
+    context.filter = nullptr;
+    context.done_condition.notify_all();
+  }
+  return true;
+}
+
+/**
+ * \brief Function executed by filtering threads.
+ */
+void run_thread() {
+
+  std::unique_lock<std::mutex> lock(context.mutex);
+  while (!context.stopping) {
+    if (!filter_next_band(lock)) {
+      context.work_condition.wait(lock);
+    }
+  }
+}
+
+}  // Anonymous namespace.
+
 /**
  * \brief Constructor.
  */
@@ -30,5 +110,116 @@ SoftwarePixelFilter::SoftwarePixelFilter() {
 SoftwarePixelFilter::~SoftwarePixelFilter() {
 }
 
+/**
+ * \brief Applies the algorithm on a rectangle of pixels.
+ *
+ * Returns when the whole rectangle is filtered.
+ *
+ * \param src The rectangle of pixels in RGBA format.
+ * Must be a buffer of size src_width * src_height.
+ * \param src_width Width of the rectangle.
+ * \param src_height Height of the rectangle.
+ * \param dst The destination rectangle to write.
+ * Must be a buffer of size
+ * src_width * src_height * get_scaling_factor()^2.
+ */
+void SoftwarePixelFilter::filter(
+    const uint32_t* src,
+    int src_width,
+    int src_height,
+    uint32_t* dst) const {
+
+  start_filter(src, src_width, src_height, dst);
+  finish_filter();
+}
+
+/**
+ * \brief Starts applying the algorithm on a rectangle of pixels in background.
+ *
+ * Buffers must remain valid and the source must not be modified until
+ * finish_filter() is called.
+ * If another filtering was in progress, waits for it first.
+ *
+ * \param src The rectangle of pixels in RGBA format.
+ * Must be a buffer of size src_width * src_height.
+ * \param src_width Width of the rectangle.
+ * \param src_height Height of the rectangle.
+ * \param dst The destination rectangle to write.
+ * Must be a buffer of size
+ * src_width * src_height * get_scaling_factor()^2.
+ */
+void SoftwarePixelFilter::start_filter(
+    const uint32_t* src,
+    int src_width,
+    int src_height,
+    uint32_t* dst) const {
+
+  finish_filter();
+
+  if (src_width <= 0 || src_height <= 0) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(context.mutex);
+  if (context.threads.empty()) {
+    const unsigned num_cores = std::thread::hardware_concurrency();
+    const unsigned num_threads = std::min(std::max(num_cores, 2u) - 1, max_threads);
+    for (unsigned i = 0; i < num_threads; ++i) {
+      context.threads.emplace_back(run_thread);
+    }
+  }
+
+  const int wanted_num_bands = (context.threads.size() + 1) * bands_per_thread;
+  context.filter = this;
+  context.src = src;
+  context.src_width = src_width;
+  context.src_height = src_height;
+  context.dst = dst;
+  context.band_height = (src_height + wanted_num_bands - 1) / wanted_num_bands;
+  context.num_bands = (src_height + context.band_height - 1) / context.band_height;
+  context.next_band = 0;
+  context.num_bands_done = 0;
+  context.work_condition.notify_all();
+}
+
+/**
+ * \brief Waits for the end of the filtering started by start_filter().
+ *
+ * The calling thread helps filtering the remaining bands.
+ * Does nothing if no filtering is in progress.
+ */
+void SoftwarePixelFilter::finish_filter() {
+
+  std::unique_lock<std::mutex> lock(context.mutex);
+  while (filter_next_band(lock)) {
+  }
+  while (context.filter != nullptr) {
+    context.done_condition.wait(lock);
+  }
+}
+
+/**
+ * \brief Stops the filtering threads.
+ *
+ * They are created again if a filter is used later.
+ */
+void SoftwarePixelFilter::quit() {
+
+  finish_filter();
+
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(context.mutex);
+    context.stopping = true;
+    threads.swap(context.threads);
+  }
+  context.work_condition.notify_all();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  std::lock_guard<std::mutex> lock(context.mutex);
+  context.stopping = false;
+}
+
 }
 
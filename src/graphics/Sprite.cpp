@@ -21,6 +21,7 @@
 #include "solarus/core/Size.h"
 #include "solarus/core/System.h"
 #include "solarus/graphics/Color.h"
+#include "solarus/graphics/PixelBitsCache.h"
 #include "solarus/graphics/Sprite.h"
 #include "solarus/graphics/SpriteAnimation.h"
 #include "solarus/graphics/SpriteAnimationDirection.h"
@@ -56,6 +57,7 @@ void Sprite::quit() {
     delete kvp.second;
   }
   all_animation_sets.clear();
+  PixelBitsCache::clear();
 }
 
 /**
@@ -38,6 +38,7 @@ SpriteAnimation::SpriteAnimation(
     int loop_on_frame):
 
   src_image(nullptr),
+  src_image_file_name(),
   src_image_is_tileset(image_file_name == "tileset"),
   directions(directions),
   frame_delay(frame_delay),
@@ -46,6 +47,7 @@ SpriteAnimation::SpriteAnimation(
 
   if (!src_image_is_tileset) {
     src_image = Surface::create(image_file_name);
+    src_image_file_name = "sprites/" + image_file_name;
     if (src_image == nullptr) {
       Debug::error(std::string("Cannot load sprite image '" + image_file_name + "'"));
     };
@@ -67,8 +69,9 @@ void SpriteAnimation::set_tileset(const Tileset& tileset) {
   }
 
   src_image = tileset.get_entities_image();
+  std::string file_name = std::string("tilesets/") + tileset.get_id() + ".entities.png";
+  src_image_file_name = file_name;
   if (src_image == nullptr) {
-    std::string file_name = std::string("tilesets/") + tileset.get_id() + ".entities.png";
     Debug::error(std::string("Missing sprites image for tileset '") + tileset.get_id() + "': " + file_name);
   }
 
@@ -185,7 +188,7 @@ void SpriteAnimation::do_enable_pixel_collisions() {
   }
 
   for (SpriteAnimationDirection& direction: directions) {
-    direction.enable_pixel_collisions(*src_image);
+    direction.enable_pixel_collisions(src_image, src_image_file_name);
   }
 }
 
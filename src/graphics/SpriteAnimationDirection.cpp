@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Debug.h"
 #include "solarus/core/PixelBits.h"
+#include "solarus/graphics/PixelBitsCache.h"
 #include "solarus/graphics/SpriteAnimationDirection.h"
 #include "solarus/graphics/Surface.h"
 #include <memory>
@@ -32,7 +33,10 @@ SpriteAnimationDirection::SpriteAnimationDirection(
     const std::vector<Rectangle>& frames,
     const Point& origin):
   frames(frames),
-  origin(origin) {
+  origin(origin),
+  src_image(nullptr),
+  src_image_file_name(),
+  pixel_bits() {
 
   Debug::check_assertion(!frames.empty(), "Empty sprite direction");
 }
@@ -100,14 +104,21 @@ void SpriteAnimationDirection::draw(Surface& dst_surface,
  * to be able to detect pixel-perfect collisions.
  * If the pixel-perfect collisions are already enabled, this function does nothing.
  *
+ * The bit fields of a frame are only computed the first time they are
+ * needed, and they are shared with other sprites through PixelBitsCache.
+ *
  * \param src_image the surface containing the animations
+ * \param src_image_file_name file name of this surface relative to
+ * the data directory
  */
-void SpriteAnimationDirection::enable_pixel_collisions(Surface& src_image) {
-
+void SpriteAnimationDirection::enable_pixel_collisions(
+    const SurfacePtr& src_image,
+    const std::string& src_image_file_name
+) {
   if (!are_pixel_collisions_enabled()) {
-    for (int i = 0; i < get_nb_frames(); i++) {
-      pixel_bits.emplace_back(src_image, frames[i]);
-    }
+    this->src_image = src_image;
+    this->src_image_file_name = src_image_file_name;
+    pixel_bits.assign(get_nb_frames(), nullptr);
   }
 }
 
@@ -116,6 +127,7 @@ void SpriteAnimationDirection::enable_pixel_collisions(Surface& src_image) {
  */
 void SpriteAnimationDirection::disable_pixel_collisions() {
   pixel_bits.clear();
+  src_image = nullptr;
 }
 
 /**
@@ -126,5 +138,30 @@ bool SpriteAnimationDirection::are_pixel_collisions_enabled() const {
   return !pixel_bits.empty();
 }
 
+/**
+ * \brief Returns the pixel bits object of a frame.
+ *
+ * It represents the transparent bits of the frame and permits to detect
+ * pixel-precise collisions.
+ * The pixel collisions must be enabled.
+ *
+ * \param frame A frame of the animation.
+ * \return The pixel bits object of a frame.
+ */
+const PixelBits& SpriteAnimationDirection::get_pixel_bits(int frame) const {
+
+  SOLARUS_ASSERT(are_pixel_collisions_enabled(),
+      "Pixel-precise collisions are not enabled for this sprite");
+  SOLARUS_ASSERT(frame >= 0 && frame < get_nb_frames(), "Invalid frame number");
+
+  std::shared_ptr<const PixelBits>& frame_pixel_bits = pixel_bits[frame];
+  if (frame_pixel_bits == nullptr) {
+    frame_pixel_bits = PixelBitsCache::get_pixel_bits(
+        src_image_file_name, *src_image, frames[frame]
+    );
+  }
+  return *frame_pixel_bits;
+}
+
 }
 
@@ -41,6 +41,88 @@ namespace {
 std::mutex image_files_cache_mutex;
 std::map<std::string, SurfaceImplPtr> image_files_cache;
 
+/**
+ * \brief An image decoded in advance.
+ */
+struct PreloadedImage {
+  SDL_Surface_UniquePtr surface;  /**< The decoded pixels. */
+  uint64_t sequence;              /**< Order of preloading, to evict the oldest ones first. */
+};
+
+std::mutex preloaded_image_files_mutex;
+std::map<std::string, PreloadedImage> preloaded_image_files;  /**< Decoded images not uploaded yet. */
+size_t preloaded_image_files_size = 0;                         /**< Total size in bytes of their pixels. */
+uint64_t preloaded_image_files_sequence = 0;                   /**< Sequence number of the next preloaded image. */
+constexpr size_t max_preloaded_image_files_size = 64 * 1024 * 1024;
+
+/**
+ * \brief Returns the name of an image file relative to the quest data directory.
+ * \param file_name Name of the image file, relative to the base directory.
+ * \param base_directory The base directory.
+ * \return The actual file name.
+ */
+std::string get_actual_image_file_name(
+    const std::string& file_name,
+    Surface::ImageDirectory base_directory) {
+
+  std::string prefix;
+  bool language_specific = false;
+
+  if (base_directory == Surface::DIR_SPRITES) {
+    prefix = "sprites/";
+  }
+  else if (base_directory == Surface::DIR_LANGUAGE) {
+    language_specific = true;
+    prefix = "images/";
+  }
+  std::string prefixed_file_name = prefix + file_name;
+
+  return QuestFiles::get_actual_file_name(prefixed_file_name, language_specific);
+}
+
+/**
+ * \brief Returns and forgets an image decoded in advance.
+ * \param actual_file_name Name of the image file.
+ * \return The decoded image, or nullptr if it was not preloaded.
+ */
+SDL_Surface_UniquePtr take_preloaded_image_file(const std::string& actual_file_name) {
+
+  std::lock_guard<std::mutex> lock(preloaded_image_files_mutex);
+  const auto it = preloaded_image_files.find(actual_file_name);
+  if (it == preloaded_image_files.end()) {
+    return nullptr;
+  }
+  SDL_Surface_UniquePtr surface = std::move(it->second.surface);
+  preloaded_image_files_size -= surface->pitch * surface->h;
+  preloaded_image_files.erase(it);
+  return surface;
+}
+
+/**
+ * \brief Forgets the oldest preloaded images until some size fits.
+ *
+ * Images preloaded for maps that were not entered are never taken, so
+ * they make room for newer ones.
+ * The preloaded images mutex must be locked.
+ *
+ * \param size Size in bytes to make room for.
+ */
+void evict_preloaded_image_files(size_t size) {
+
+  while (!preloaded_image_files.empty() &&
+      preloaded_image_files_size + size > max_preloaded_image_files_size) {
+    const auto oldest = std::min_element(
+        preloaded_image_files.begin(), preloaded_image_files.end(),
+        [](const std::pair<const std::string, PreloadedImage>& first,
+            const std::pair<const std::string, PreloadedImage>& second) {
+      return first.second.sequence < second.second.sequence;
+    });
+    const SDL_Surface& surface = *oldest->second.surface;
+    preloaded_image_files_size -= surface.pitch * surface.h;
+    preloaded_image_files.erase(oldest);
+  }
+}
+
 }
 
 /**
@@ -48,6 +130,59 @@ std::map<std::string, SurfaceImplPtr> image_files_cache;
  */
 void Surface::empty_cache() {
   image_files_cache.clear();
+
+  std::lock_guard<std::mutex> lock(preloaded_image_files_mutex);
+  preloaded_image_files.clear();
+  preloaded_image_files_size = 0;
+}
+
+/**
+ * \brief Decodes an image file in advance so that the next surface created
+ * from it only has to upload it.
+ *
+ * Nothing happens if the image is already loaded or preloaded.
+ * If too much memory is used by preloaded images, the oldest ones are
+ * forgotten.
+ * This function can be called from any thread.
+ *
+ * \param file_name Name of the image file, relative to the base directory.
+ * \param base_directory The base directory to use.
+ */
+void Surface::preload_file(
+    const std::string& file_name,
+    ImageDirectory base_directory) {
+
+  const std::string& actual_file_name = get_actual_image_file_name(file_name, base_directory);
+  {
+    std::lock_guard<std::mutex> lock(image_files_cache_mutex);
+    if (image_files_cache.find(actual_file_name) != image_files_cache.end()) {
+      return;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(preloaded_image_files_mutex);
+    if (preloaded_image_files.find(actual_file_name) != preloaded_image_files.end()) {
+      return;
+    }
+  }
+
+  // Decode without locking.
+  SDL_Surface_UniquePtr surface = create_sdl_surface_from_file(actual_file_name);
+  if (surface == nullptr) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(preloaded_image_files_mutex);
+  const size_t size = surface->pitch * surface->h;
+  if (size > max_preloaded_image_files_size ||
+      preloaded_image_files.find(actual_file_name) != preloaded_image_files.end()) {
+    return;
+  }
+  evict_preloaded_image_files(size);
+  PreloadedImage& image = preloaded_image_files[actual_file_name];
+  image.surface = std::move(surface);
+  image.sequence = preloaded_image_files_sequence++;
+  preloaded_image_files_size += size;
 }
 
 /**
@@ -180,8 +315,8 @@ SDL_Surface_UniquePtr Surface::create_sdl_surface_from_file(
     return nullptr;
   }
 
-  const std::string& buffer = QuestFiles::data_file_read(file_name);
-  SDL_RWops* rw = SDL_RWFromMem(const_cast<char*>(buffer.data()), (int) buffer.size());
+  const DataFileBufferPtr& buffer = QuestFiles::data_file_read_buffer(file_name);
+  SDL_RWops* rw = SDL_RWFromConstMem(buffer->data(), (int) buffer->size());
   SDL_Surface_UniquePtr surface = SDL_Surface_UniquePtr(IMG_Load_RW(rw, 0));
   SDL_RWclose(rw);
 
@@ -237,19 +372,7 @@ SurfaceImplPtr Surface::get_surface_from_file(
     const std::string& file_name,
     ImageDirectory base_directory) {
 
-  std::string prefix;
-  bool language_specific = false;
-
-  if (base_directory == DIR_SPRITES) {
-    prefix = "sprites/";
-  }
-  else if (base_directory == DIR_LANGUAGE) {
-    language_specific = true;
-    prefix = "images/";
-  }
-  std::string prefixed_file_name = prefix + file_name;
-
-  const std::string& actual_file_name = QuestFiles::get_actual_file_name(prefixed_file_name, language_specific);
+  const std::string& actual_file_name = get_actual_image_file_name(file_name, base_directory);
   if (!QuestFiles::data_file_exists(actual_file_name)) {
     // File not found.
     return nullptr;
@@ -263,7 +386,11 @@ SurfaceImplPtr Surface::get_surface_from_file(
   if (it != image_files_cache.end()) {
     texture = it->second;
   } else {
-    texture = Video::get_renderer().create_texture(create_sdl_surface_from_file(actual_file_name));
+    SDL_Surface_UniquePtr surface = take_preloaded_image_file(actual_file_name);
+    if (surface == nullptr) {
+      surface = create_sdl_surface_from_file(actual_file_name);
+    }
+    texture = Video::get_renderer().create_image_texture(std::move(surface));
     image_files_cache[actual_file_name] = texture;
   }
   return texture;
@@ -320,6 +447,19 @@ std::string Surface::get_pixels() const {
   return internal_surface->get_pixels();
 }
 
+/**
+ * \brief Returns a buffer of the raw pixels of a region of this surface.
+ *
+ * Pixels returned have the RGBA 32-bit format.
+ * Only the pixels of this region are read back from the video memory.
+ *
+ * \param region The region to get, must be inside the surface.
+ * \return The pixel buffer of the region, row by row.
+ */
+std::string Surface::get_pixels(const Rectangle& region) const {
+  return internal_surface->get_pixels(region);
+}
+
 /**
  * @brief Set pixels of this surface from a RGBA buffer
  * @param buffer a string considerer as array of bytes with pixels in RGBA
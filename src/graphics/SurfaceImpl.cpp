@@ -1,6 +1,7 @@
 #include "solarus/graphics/SurfaceImpl.h"
 #include <solarus/core/Debug.h>
 #include <solarus/graphics/Video.h>
+#include <algorithm>
 
 namespace Solarus {
 
@@ -8,6 +9,23 @@ SurfaceImpl::~SurfaceImpl() {
   Video::invalidate(*this);
 }
 
+/**
+ * @brief default implementation synchronising the whole surface
+ * @param region the region of interest
+ * @return a valid SDL_Surface
+ */
+SDL_Surface* SurfaceImpl::get_surface(const Rectangle& /* region */) const {
+  return get_surface();
+}
+
+/**
+ * @brief default implementation uploading the whole surface
+ * @param region the modified region
+ */
+void SurfaceImpl::upload_surface(const Rectangle& /* region */) {
+  upload_surface();
+}
+
 /**
  * @brief is_premultiplied
  * @return
@@ -46,13 +64,55 @@ std::string SurfaceImpl::get_pixels() const {
   return std::string(buffer, num_pixels * converted_surface->format->BytesPerPixel);
 }
 
+std::string SurfaceImpl::get_pixels(const Rectangle& region) const {
+  Debug::check_assertion(Rectangle(0, 0, get_width(), get_height()).contains(region),
+      "Pixel region is outside the surface");
+  SDL_Surface* surface = get_surface(region);
+  const char* buffer = static_cast<const char*>(surface->pixels);
+  size_t pitch = surface->pitch;
+
+  std::string converted_pixels;
+  if (surface->format->format != SDL_PIXELFORMAT_ABGR8888) {
+    // Convert to RGBA format. Should never happen
+    converted_pixels = get_pixels();
+    buffer = converted_pixels.data();
+    pitch = get_width() * 4;
+  }
+
+  const size_t row_size = region.get_width() * 4;
+  std::string pixels;
+  pixels.reserve(row_size * region.get_height());
+  for (int y = region.get_y(); y < region.get_y() + region.get_height(); ++y) {
+    pixels.append(buffer + y * pitch + region.get_x() * 4, row_size);
+  }
+  return pixels;
+}
+
 void SurfaceImpl::set_pixels(const std::string& buffer) {
   auto surface = get_surface();
   if (surface->format->format == SDL_PIXELFORMAT_ABGR8888) {
     // No conversion needed.
+    // Only upload the rows that actually change.
     char* pixels = static_cast<char*>(surface->pixels);
-    std::copy(buffer.begin(), buffer.end(), pixels);
-    upload_surface();
+    const size_t row_size = surface->pitch;
+    const size_t size = std::min(buffer.size(), row_size * surface->h);
+    int first_changed_row = -1;
+    int last_changed_row = -1;
+    int row = 0;
+    for (size_t offset = 0; offset < size; offset += row_size) {
+      const size_t length = std::min(row_size, size - offset);
+      if (!std::equal(buffer.data() + offset, buffer.data() + offset + length, pixels + offset)) {
+        if (first_changed_row == -1) {
+          first_changed_row = row;
+        }
+        last_changed_row = row;
+      }
+      ++row;
+    }
+    if (first_changed_row != -1) {
+      std::copy(buffer.begin(), buffer.begin() + size, pixels);
+      upload_surface(Rectangle(0, first_changed_row, get_width(), last_changed_row - first_changed_row + 1));
+    }
     return;
   }
   //Should never happen
@@ -18,7 +18,7 @@
 #include "solarus/core/CurrentQuest.h"
 #include "solarus/core/Debug.h"
 #include "solarus/core/Logger.h"
-#include "solarus/core/PerfCounter.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/Rectangle.h"
 #include "solarus/core/Size.h"
@@ -34,6 +34,7 @@
 #include "solarus/graphics/Renderer.h"
 #include "solarus/graphics/sdlrenderer/SDLRenderer.h"
 #include "solarus/graphics/glrenderer/GlRenderer.h"
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include <utility>
@@ -64,6 +65,11 @@ struct VideoContext {
   const SoftwareVideoMode*
   default_video_mode = nullptr;         /**< Default software video mode. */
   SurfacePtr scaled_surface = nullptr;      /**< The screen surface used with software-scaled modes. */
+  bool pipeline_software_filter = false;    /**< Whether software filters run during the next frame. */
+  bool software_filter_pending = false;     /**< Whether a frame is being filtered in background. */
+  std::vector<uint32_t> filter_input;       /**< Copy of the frame being filtered in background. */
+  std::vector<uint32_t> filter_output;      /**< Result of the background filtering. */
+  bool tile_map_shader = false;             /**< Whether animated tiles should be drawn by a tile map shader. */
   SurfacePtr screen_surface = nullptr;      /**< Strange surface representing the window */
   ShaderPtr  current_shader = nullptr;      /**< Current fullscreen effect */
 
@@ -75,7 +81,6 @@ struct VideoContext {
   bool disable_window = false;              /**< Indicates that no window is displayed (used for unit tests). */
   bool fullscreen_window = false;           /**< True if the window is in fullscreen. */
   bool visible_cursor = true;               /**< True if the mouse cursor is visible. */
-  bool pc_render = false;                   /**< Whether rendering performance counter is used. */
 };
 
 VideoContext context;
@@ -102,6 +107,44 @@ RendererPtr create_chain(SDL_Window* w, bool force_software) {
 }
 
 
+/**
+ * \brief Applies a software filter to the quest surface in background,
+ * while the main thread simulates the next frame.
+ *
+ * The scaled surface receives the frame filtered since the previous call,
+ * so what is displayed is one frame late.
+ *
+ * \param software_filter The filter to apply.
+ * \param quest_surface The quest surface to filter.
+ */
+void apply_pipelined_software_filter(
+    const SoftwarePixelFilter& software_filter,
+    const Surface& quest_surface) {
+
+  SoftwarePixelFilter::finish_filter();
+
+  if (context.software_filter_pending) {
+    SurfaceImpl& scaled_impl = context.scaled_surface->get_impl();
+    SDL_Surface* scaled_internal_surface = scaled_impl.get_surface();
+    std::copy(context.filter_output.begin(), context.filter_output.end(),
+        static_cast<uint32_t*>(scaled_internal_surface->pixels));
+    scaled_impl.upload_surface();
+  }
+
+  // Copy the frame because the quest surface will be drawn again meanwhile.
+  const SDL_Surface* quest_internal_surface = quest_surface.get_impl().get_surface();
+  const int width = quest_internal_surface->w;
+  const int height = quest_internal_surface->h;
+  const uint32_t* quest_pixels = static_cast<const uint32_t*>(quest_internal_surface->pixels);
+  const int factor = software_filter.get_scaling_factor();
+  context.filter_input.assign(quest_pixels, quest_pixels + width * height);
+  context.filter_output.resize(width * height * factor * factor);
+
+  software_filter.start_filter(
+      context.filter_input.data(), width, height, context.filter_output.data());
+  context.software_filter_pending = true;
+}
+
 /**
  * \brief Creates the window but does not show it.
  * \param args Command-line arguments.
@@ -206,8 +249,11 @@ namespace Video {
  * This method should be called when the program starts.
  * Options recognized:
  *   -no-video
- *   -perf-video-render=yes|no
  *   -quest-size=WIDTHxHEIGHT
+ *   -texture-atlas=yes|no
+ *   -pipeline-pixel-filter=yes|no
+ *   -render-stats=yes|no
+ *   -tile-map-shader=yes|no
  *
  * \param args Command-line arguments.
  */
@@ -224,10 +270,9 @@ void initialize(const Arguments& args) {
 
 
 
-  // Check the -no-video, -perf-video-render and the -quest-size options.
+  // Check the -no-video and the -quest-size options.
   const std::string& quest_size_string = args.get_argument_value("-quest-size");
   context.disable_window = args.has_argument("-no-video");
-  context.pc_render = args.get_argument_value("-perf-video-render") == "yes";
 
   context.geometry.wanted_quest_size = {
     SOLARUS_DEFAULT_QUEST_WIDTH,
@@ -240,6 +285,16 @@ void initialize(const Arguments& args) {
     }
   }
 
+  // Check the -texture-atlas and -render-stats options.
+  GlRenderer::set_atlas_enabled(args.get_argument_value("-texture-atlas") == "yes");
+  GlRenderer::set_stats_report_enabled(args.get_argument_value("-render-stats") == "yes");
+
+  // Check the -pipeline-pixel-filter option.
+  context.pipeline_software_filter = args.get_argument_value("-pipeline-pixel-filter") == "yes";
+
+  // Check the -tile-map-shader option.
+  context.tile_map_shader = args.get_argument_value("-tile-map-shader") == "yes";
+
   // Create a pixel format anyway to make surface and color operations work,
   context.rgba_format = SDL_AllocFormat(SDL_PIXELFORMAT_ABGR8888);
 
@@ -259,6 +314,8 @@ void quit() {
     return;
   }
 
+  SoftwarePixelFilter::quit();
+
   if (is_fullscreen()) {
     // Get back on desktop before destroy the window.
     SDL_SetWindowFullscreen(context.main_window, 0);
@@ -304,6 +361,21 @@ Renderer &get_renderer() {
   return *context.renderer;
 }
 
+/**
+ * \brief Returns whether tiles in animated regions should be drawn
+ * with a tile map shader.
+ *
+ * This requires the -tile-map-shader option and a renderer that
+ * supports shaders for all draws.
+ *
+ * \return \c true to use the tile map shader.
+ */
+bool is_tile_map_shader_enabled() {
+  return context.tile_map_shader &&
+      context.renderer != nullptr &&
+      context.renderer->has_surface_shaders();
+}
+
 /**
  * \brief Returns the pixel format to use.
  * \return The pixel format to use.
@@ -359,9 +431,8 @@ void hide_window() {
  * \param quest_surface The quest surface to render on the screen.
  */
 void render(const SurfacePtr& quest_surface) {
-  if (context.pc_render) {
-    PerfCounter::update("video-render");
-  }
+
+  SOLARUS_PROFILE_ZONE("Video::render");
 
   if (context.disable_window) {
     return;
@@ -376,7 +447,12 @@ void render(const SurfacePtr& quest_surface) {
   if (software_filter != nullptr) {
     Debug::check_assertion(context.scaled_surface != nullptr,
                            "Missing destination surface for scaling");
-    quest_surface->apply_pixel_filter(*software_filter, *context.scaled_surface);
+    if (context.pipeline_software_filter) {
+      apply_pipelined_software_filter(*software_filter, *quest_surface);
+    }
+    else {
+      quest_surface->apply_pixel_filter(*software_filter, *context.scaled_surface);
+    }
     surface_to_render = context.scaled_surface;
   }
 
@@ -424,6 +500,8 @@ void render(const SurfacePtr& quest_surface) {
  * @brief present the final result to the screen
  */
 void finish() {
+
+  SOLARUS_PROFILE_ZONE("Video::finish");
   context.renderer->present(context.main_window);
 }
 
@@ -753,6 +831,9 @@ bool set_video_mode(const SoftwareVideoMode& mode) {
   context.video_mode = &mode;
   if (!context.disable_window) {
 
+    // The previous filter may still be running in background.
+    SoftwarePixelFilter::finish_filter();
+    context.software_filter_pending = false;
     context.scaled_surface = nullptr;
 
     Size render_size = context.geometry.quest_size;
@@ -5,14 +5,18 @@
 #include <solarus/graphics/Surface.h>
 #include <solarus/core/Debug.h>
 #include <solarus/core/Logger.h>
+#include <solarus/core/Profiler.h>
 #include <solarus/graphics/Shader.h>
 #include <solarus/graphics/DefaultShaders.h>
+#include <solarus/graphics/SkylinePacker.h>
 #include <solarus/core/System.h>
 
 #include <glm/gtx/matrix_transform_2d.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cmath>
 #include <sstream>
 
 
@@ -23,6 +27,8 @@ namespace Solarus {
 using namespace glm;
 
 GlRenderer* GlRenderer::instance = nullptr;
+bool GlRenderer::atlas_enabled = false;
+bool GlRenderer::stats_report_enabled = false;
 
 
 /**
@@ -185,6 +191,62 @@ SurfaceImplPtr GlRenderer::create_texture(SDL_Surface_UniquePtr&& surface) {
   return SurfaceImplPtr(new GlTexture(std::move(surface)));
 }
 
+/**
+ * @brief create a texture for an image file, packed into an atlas if enabled
+ *
+ * Small images share a few big textures, so that drawing sprites
+ * and tiles from different images does not break the batch.
+ *
+ * @param surface the image pixels
+ * @return the surface impl
+ */
+SurfaceImplPtr GlRenderer::create_image_texture(SDL_Surface_UniquePtr&& surface) {
+  if(!atlas_enabled ||
+     surface->w > ATLAS_MAX_IMAGE_SIZE ||
+     surface->h > ATLAS_MAX_IMAGE_SIZE) {
+    return create_texture(std::move(surface));
+  }
+
+  //Keep a transparent pixel between images for rotated or scaled draws
+  const Size padded_size(surface->w + 1,surface->h + 1);
+  Point position;
+  if(!atlas_packer || !atlas_packer->insert(padded_size,position)) {
+    //Start a new page, the previous one lives as long as its images
+    atlas_page = create_texture(ATLAS_PAGE_SIZE,ATLAS_PAGE_SIZE);
+    atlas_packer.reset(new SkylinePacker(Size(ATLAS_PAGE_SIZE,ATLAS_PAGE_SIZE)));
+    atlas_packer->insert(padded_size,position);
+  }
+
+  glBindTexture(GL_TEXTURE_2D,atlas_page->as<GlTexture>().tex_id);
+  glTexSubImage2D(GL_TEXTURE_2D,
+                  0,
+                  position.x,position.y,
+                  surface->w,surface->h,
+                  GL_RGBA,GL_UNSIGNED_BYTE,
+                  surface->pixels);
+  rebind_texture();
+  return SurfaceImplPtr(new GlTexture(std::move(surface),atlas_page,position));
+}
+
+/**
+ * @brief Sets whether image files are packed into atlas textures
+ *
+ * Only affects images loaded afterwards.
+ *
+ * @param enabled true to use atlases
+ */
+void GlRenderer::set_atlas_enabled(bool enabled) {
+  atlas_enabled = enabled;
+}
+
+/**
+ * @brief Sets whether draw calls and batch breaks are logged every second
+ * @param enabled true to log them
+ */
+void GlRenderer::set_stats_report_enabled(bool enabled) {
+  stats_report_enabled = enabled;
+}
+
 SurfaceImplPtr GlRenderer::create_window_surface(SDL_Window* /*w*/, int width, int height) {
   return SurfaceImplPtr(new GlTexture(width,height,true));
 }
@@ -220,6 +282,8 @@ void GlRenderer::set_render_target(GlTexture* target) {
 }
 
 void GlRenderer::bind_as_gl_target(SurfaceImpl& surf) {
+  GlTexture& target = surf.as<GlTexture>();
+  target.add_dirty_region(Rectangle(0,0,target.get_width(),target.get_height())); //Unknown GL draws follow
   set_state(current_texture,current_shader,&surf.as<GlTexture>(),current_blend_mode);
 }
 
@@ -241,6 +305,21 @@ void GlRenderer::draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos&
 void GlRenderer::draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos& infos, GlShader& shader) {
   const GlTexture& glsrc = src.as<GlTexture>();
   GlTexture& gldst = dst.as<GlTexture>();
+  if(glsrc.is_in_atlas()) {
+    if(&shader == &main_shader->as<GlShader>() &&
+       Rectangle(0,0,glsrc.get_width(),glsrc.get_height()).contains(infos.region)) {
+      //Draw from the atlas, with the region moved to the image location
+      const GlTexture& page = glsrc.atlas_page->as<GlTexture>();
+      Rectangle region = infos.region;
+      region.add_xy(glsrc.atlas_position);
+      set_state(&page,&shader,&gldst,make_gl_blend_modes(gldst,&glsrc,infos.blend_mode));
+      glUniform1i(shader.get_uniform_location(VCOLOR_ONLY_NAME),false);
+      add_sprite(DrawInfos(infos,region,infos.dst_position));
+      return;
+    }
+    //Custom shaders see the texture size and repeated regions need wrapping
+    glsrc.detach_from_atlas();
+  }
   set_state(&glsrc,&shader,&gldst,make_gl_blend_modes(gldst,&glsrc,infos.blend_mode));
   glUniform1i(shader.get_uniform_location(VCOLOR_ONLY_NAME),false);
   add_sprite(infos);
@@ -248,6 +327,7 @@ void GlRenderer::draw(SurfaceImpl& dst, const SurfaceImpl& src, const DrawInfos&
 
 void GlRenderer::clear(SurfaceImpl& dst) {
   GlTexture* t = &dst.as<GlTexture>();
+  t->add_dirty_region(Rectangle(0,0,t->get_width(),t->get_height()));
   if(t == current_target) {
     buffered_sprites = 0; //Trash pending batch, after all we'll clear
     glClear(GL_COLOR_BUFFER_BIT);
@@ -260,39 +340,69 @@ void GlRenderer::clear(SurfaceImpl& dst) {
 }
 
 /**
- * @brief read pixel of the given texture to a buffer
+ * @brief read pixels of a region of the given texture to a buffer
  * @param from the texture
- * @param to the buffer
+ * @param region the region to read
+ * @param to the buffer of the whole texture, only the region is written
  */
-void GlRenderer::read_pixels(GlTexture* from, void* to) {
+void GlRenderer::read_pixels(GlTexture* from, const Rectangle& region, void* to) {
   //Make sure we draw everything before read
   set_state(current_texture,current_shader,from,current_blend_mode,true);
-  glReadPixels(0,0,
-               from->get_width(),from->get_height(),
+  const int width = from->get_width();
+  uint32_t* pixels = static_cast<uint32_t*>(to) + region.get_y() * width;
+  if(region.get_x() == 0 && region.get_width() == width) {
+    //Whole rows: read in place
+    glReadPixels(0,region.get_y(),
+                 width,region.get_height(),
+                 GL_RGBA,
+                 GL_UNSIGNED_BYTE,
+                 pixels);
+    return;
+  }
+
+  transfer_buffer.resize(region.get_width() * region.get_height());
+  glReadPixels(region.get_x(),region.get_y(),
+               region.get_width(),region.get_height(),
                GL_RGBA,
                GL_UNSIGNED_BYTE,
-               to);
+               transfer_buffer.data());
+  for(int row = 0; row < region.get_height(); ++row) {
+    const auto src_row = transfer_buffer.begin() + row * region.get_width();
+    std::copy(src_row,src_row + region.get_width(),pixels + row * width + region.get_x());
+  }
 }
 
 /**
- * @brief put pixels into the given texture
+ * @brief put pixels of a region into the given texture
  * @param to texture to upload pixel to
- * @param data pixel data (RGBA unsigned bytes)
+ * @param region the region to upload
+ * @param data pixel data of the whole texture (RGBA unsigned bytes)
  */
-void GlRenderer::put_pixels(GlTexture* to, void* data) {
+void GlRenderer::put_pixels(GlTexture* to, const Rectangle& region, void* data) {
   if(current_target == to) {
     //Texture is attached, detach
     restart_batch(); //draw everything
     glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,0,0);
     current_target = nullptr; //Set target as invalid
   }
+  const int width = to->get_width();
+  const uint32_t* pixels = static_cast<const uint32_t*>(data) + region.get_y() * width;
+  if(region.get_x() != 0 || region.get_width() != width) {
+    //Partial rows: gather them first
+    transfer_buffer.resize(region.get_width() * region.get_height());
+    for(int row = 0; row < region.get_height(); ++row) {
+      const uint32_t* src_row = pixels + row * width + region.get_x();
+      std::copy(src_row,src_row + region.get_width(),transfer_buffer.begin() + row * region.get_width());
+    }
+    pixels = transfer_buffer.data();
+  }
   glBindTexture(GL_TEXTURE_2D,to->get_texture());
   glTexSubImage2D(GL_TEXTURE_2D,
                   0,
-                  0,0,
-                  to->get_width(),to->get_height(),
+                  region.get_x(),region.get_y(),
+                  region.get_width(),region.get_height(),
                   GL_RGBA,GL_UNSIGNED_BYTE,
-                  data);
+                  pixels);
   GlRenderer::get().rebind_texture();
 }
 
@@ -334,8 +444,40 @@ std::string GlRenderer::get_name() const {
 }
 
 void GlRenderer::present(SDL_Window* window) {
+  SOLARUS_PROFILE_ZONE("GlRenderer::present");
   restart_batch(); //Draw last batch that could be 'stuck'
   SDL_GL_SwapWindow(window);
+  update_stats();
+}
+
+/**
+ * @brief count the batches of the frame just presented and log them
+ * every second if enabled
+ */
+void GlRenderer::update_stats() {
+  if(stats_report_enabled) {
+    ++report_num_frames;
+    report_num_draw_calls += num_draw_calls;
+    report_num_batch_breaks += num_batch_breaks;
+    report_max_draw_calls = std::max(report_max_draw_calls,num_draw_calls);
+
+    const uint32_t now = System::get_real_time();
+    if(now - last_report_time >= STATS_REPORT_INTERVAL) {
+      std::ostringstream oss;
+      oss << "GlRenderer: frames=" << report_num_frames
+          << " draw_calls=" << report_num_draw_calls / report_num_frames << "/frame"
+          << " (max " << report_max_draw_calls << ")"
+          << " batch_breaks=" << report_num_batch_breaks / report_num_frames << "/frame";
+      Logger::print(oss.str());
+      last_report_time = now;
+      report_num_frames = 0;
+      report_num_draw_calls = 0;
+      report_num_batch_breaks = 0;
+      report_max_draw_calls = 0;
+    }
+  }
+  num_draw_calls = 0;
+  num_batch_breaks = 0;
 }
 
 void GlRenderer::on_window_size_changed(const Rectangle& viewport) {
@@ -347,6 +489,14 @@ void GlRenderer::on_window_size_changed(const Rectangle& viewport) {
   }
 }
 
+/**
+ * @brief tells whether custom shaders can be used to draw on any surface
+ * @return true, every draw goes through a shader
+ */
+bool GlRenderer::has_surface_shaders() const {
+  return true;
+}
+
 const DrawProxy& GlRenderer::default_terminal() const {
   return static_cast<const DrawProxy&>(*main_shader.get());
 }
@@ -404,12 +554,14 @@ size_t GlRenderer::buffered_vertices() const {
  */
 void GlRenderer::restart_batch() {
   if(current_target && buffered_sprites > 0) {
+    SOLARUS_PROFILE_ZONE("GlRenderer::draw_batch");
     //Stuff to render!
     if(test_texture != current_target) {
       Debug::warning("InCONSISTENT state");
     }
     glBufferSubData(GL_ARRAY_BUFFER, 0, buffered_vertices()*sizeof(Vertex), vertex_buffer.data());
     glDrawElements(GL_TRIANGLES, buffered_indices(), GL_UNSIGNED_SHORT, nullptr);
+    ++num_draw_calls;
     //Orphan buffer to refill faster
     glBufferData(GL_ARRAY_BUFFER, vertex_buffer.size()*sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
 
@@ -480,6 +632,9 @@ void GlRenderer::set_state(const GlTexture *src, GlShader* shad, GlTexture* dst,
      mode != current_blend_mode ||
      force) { //Need to restart the batch!
 
+    if(buffered_sprites > 0) {
+      ++num_batch_breaks;
+    }
     restart_batch(); //Draw current buffer if needed
     set_shader(shad);
     set_render_target(dst);
@@ -671,6 +826,17 @@ void GlRenderer::add_sprite(const DrawInfos& infos) {
   current_vertex[2].position = pos + br;
   current_vertex[3].position = pos + tr;
 
+  //Remember which pixels of the target change for the next read back
+  vec2 min_position = min(min(current_vertex[0].position,current_vertex[1].position),
+                          min(current_vertex[2].position,current_vertex[3].position));
+  vec2 max_position = max(max(current_vertex[0].position,current_vertex[1].position),
+                          max(current_vertex[2].position,current_vertex[3].position));
+  current_target->add_dirty_region(Rectangle(
+                                     Point(static_cast<int>(std::floor(min_position.x)),
+                                           static_cast<int>(std::floor(min_position.y))),
+                                     Point(static_cast<int>(std::ceil(max_position.x)),
+                                           static_cast<int>(std::ceil(max_position.y)))));
+
   current_vertex[0].texcoords = infos.region.get_top_left();
   current_vertex[1].texcoords = infos.region.get_bottom_left();
   current_vertex[2].texcoords = infos.region.get_bottom_right();
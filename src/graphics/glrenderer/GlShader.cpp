@@ -238,6 +238,8 @@ void GlShader::bind() {
     glActiveTexture(GL_TEXTURE0 + texture_unit);
     glBindTexture(GL_TEXTURE_2D,kvp.second.surface->get_impl().as<GlTexture>().get_texture());
   }
+  //Leave other units alone when textures are created or uploaded later
+  glActiveTexture(GL_TEXTURE0);
 }
 
 void GlShader::unbind() {
@@ -16,6 +16,7 @@ inline glm::mat3 uv_view(int width, int height) {
 GlTexture::GlTexture(int width, int height, bool screen_tex)
   : target(true),
     uv_transform(uv_view(width,height)),
+    dirty_region(0,0,width,height),
     fbo(GlRenderer::get().get_fbo(width,height,screen_tex)) {
   glGenTextures(1,&tex_id);
   glBindTexture(GL_TEXTURE_2D,tex_id);
@@ -52,7 +53,21 @@ GlTexture::GlTexture(SDL_Surface_UniquePtr a_surface)
   GlRenderer::get().rebind_texture();
 }
 
-void GlTexture::set_texture_params() {
+/**
+ * @brief create a static texture whose pixels are stored in an atlas
+ * @param a_surface the pixels, kept as software surface
+ * @param a_atlas_page the atlas texture, where the pixels are already uploaded
+ * @param a_atlas_position position of the pixels in the atlas
+ */
+GlTexture::GlTexture(SDL_Surface_UniquePtr a_surface, const SurfaceImplPtr& a_atlas_page, const Point& a_atlas_position)
+  : target(false),
+    uv_transform(uv_view(a_surface->w,a_surface->h)),
+    surface(std::move(a_surface)),
+    atlas_page(a_atlas_page),
+    atlas_position(a_atlas_position) {
+}
+
+void GlTexture::set_texture_params() const {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -66,30 +81,91 @@ void GlTexture::set_texture_params() {
  * to upload it to the texture for changes to be reflected
  */
 void GlTexture::upload_surface() {
-  SDL_Surface* surface = get_surface();
-  GlRenderer::get().put_pixels(this,surface->pixels);
+  upload_surface(Rectangle(0,0,get_width(),get_height()));
+}
+
+/**
+ * @brief upload a modified region of the surface
+ * @param region the region to transfer
+ */
+void GlTexture::upload_surface(const Rectangle& region) {
+  detach_from_atlas();
+  SDL_Surface* surface = get_surface(region);
+  GlRenderer::get().put_pixels(this,region,surface->pixels);
 }
 
 /**
  * \copydoc SurfaceImpl::get_texture
  */
 GLuint GlTexture::get_texture() const {
+  detach_from_atlas(); // The caller wants a texture of its own
   return tex_id;
 }
 
+/**
+ * @brief tells if the pixels of this texture are stored in an atlas
+ * @return true if the texture is part of an atlas
+ */
+bool GlTexture::is_in_atlas() const {
+  return atlas_page != nullptr;
+}
+
+/**
+ * @brief move the pixels out of the atlas into a texture of their own
+ *
+ * Done once when the texture is used in a way the atlas does not
+ * support: modified, used as target, drawn with a custom shader
+ * or with a region repeating the image.
+ */
+void GlTexture::detach_from_atlas() const {
+  if(!atlas_page) {
+    return;
+  }
+  glGenTextures(1,&tex_id);
+  glBindTexture(GL_TEXTURE_2D,tex_id);
+  glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,surface->w,surface->h,0,GL_RGBA,GL_UNSIGNED_BYTE,surface->pixels);
+  set_texture_params();
+  atlas_page = nullptr;
+  GlRenderer::get().rebind_texture();
+}
+
 /**
  * \copydoc SurfaceImpl::get_surface
  */
 SDL_Surface* GlTexture::get_surface() const {
-  if (target and surface_dirty) {
-    GlRenderer::get().read_pixels(const_cast<GlTexture*>(this),surface->pixels);
-    surface_dirty = false;
+  if (!dirty_region.is_flat()) {
+    GlRenderer::get().read_pixels(const_cast<GlTexture*>(this),dirty_region,surface->pixels);
+    dirty_region = Rectangle();
   }
   return surface.get();
 }
 
+/**
+ * \copydoc SurfaceImpl::get_surface(const Rectangle&)
+ *
+ * Only the part of the region drawn since the last read is transferred.
+ */
+SDL_Surface* GlTexture::get_surface(const Rectangle& region) const {
+  const Rectangle to_read = dirty_region & region;
+  if (!to_read.is_flat()) {
+    GlRenderer::get().read_pixels(const_cast<GlTexture*>(this),to_read,surface->pixels);
+    if (to_read == dirty_region) {
+      dirty_region = Rectangle();
+    }
+  }
+  return surface.get();
+}
+
+/**
+ * @brief tag a region as modified on the GPU
+ * @param region the region drawn, clipped to the texture
+ */
+void GlTexture::add_dirty_region(const Rectangle& region) {
+  dirty_region |= region & Rectangle(0,0,get_width(),get_height());
+}
+
 GlTexture& GlTexture::targetable()  {
-  surface_dirty = true; //Just tag the surface as outdated
+  detach_from_atlas();
   if(!fbo)
     fbo = GlRenderer::get().get_fbo(get_width(),get_height());
   return *this;
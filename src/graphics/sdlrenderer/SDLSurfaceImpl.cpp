@@ -56,11 +56,21 @@ SDLSurfaceImpl::SDLSurfaceImpl(SDL_Renderer* renderer, SDL_Surface_UniquePtr sur
  * to upload it to the texture for changes to be reflected
  */
 void SDLSurfaceImpl::upload_surface() {
-  Rectangle rect(0,0,get_width(),get_height());
+  upload_surface(Rectangle(0,0,get_width(),get_height()));
+}
+
+/**
+ * @brief upload a modified region of the surface
+ * @param region the region to transfer
+ */
+void SDLSurfaceImpl::upload_surface(const Rectangle& region) {
   SDL_Surface* surface = get_surface();
+  const char* pixels = static_cast<const char*>(surface->pixels) +
+      region.get_y() * surface->pitch +
+      region.get_x() * surface->format->BytesPerPixel;
   SDL_UpdateTexture(get_texture(),
-                    rect,
-                    surface->pixels,
+                    region,
+                    pixels,
                     surface->pitch
                     );
 }
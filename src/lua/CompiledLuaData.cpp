@@ -0,0 +1,819 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/lua/CompiledLuaData.h"
+#include <lua.hpp>
+#include <algorithm>
+#include <cstring>
+
+namespace Solarus {
+
+namespace {
+
+const char magic[] = { 'S', 'D', 'A', 'T' };  /**< First bytes of a compiled file. */
+constexpr size_t header_size = 16;            /**< Magic, version and source hash. */
+constexpr int max_depth = 32;                 /**< Maximum nesting of tables. */
+
+/**
+ * \brief Kinds of values, stored in the 4 high bits of a value code.
+ *
+ * The 28 low bits are an index in the number, string or table array.
+ */
+enum ValueType : uint32_t {
+  VALUE_NIL,
+  VALUE_FALSE,
+  VALUE_TRUE,
+  VALUE_NUMBER,
+  VALUE_STRING,
+  VALUE_TABLE
+};
+
+constexpr uint32_t index_mask = 0x0fffffff;
+constexpr uint32_t invalid_value = 0xffffffff;
+
+uint32_t make_value(ValueType type, uint32_t index) {
+  return (static_cast<uint32_t>(type) << 28) | index;
+}
+
+ValueType get_value_type(uint32_t value) {
+  return static_cast<ValueType>(value >> 28);
+}
+
+uint32_t get_value_index(uint32_t value) {
+  return value & index_mask;
+}
+
+void write_uint32(std::string& buffer, uint32_t value) {
+
+  for (int i = 0; i < 4; ++i) {
+    buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+void write_uint64(std::string& buffer, uint64_t value) {
+
+  for (int i = 0; i < 8; ++i) {
+    buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+void write_double(std::string& buffer, double value) {
+
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(bits));
+  write_uint64(buffer, bits);
+}
+
+/**
+ * \brief Reads little-endian values from a buffer with bounds checking.
+ *
+ * After an out of bounds read, all reads return zero and is_valid()
+ * returns \c false.
+ */
+class Reader {
+
+  public:
+
+    Reader(const char* buffer, size_t size):
+      buffer(buffer),
+      size(size),
+      position(0),
+      valid(true) {
+    }
+
+    bool is_valid() const {
+      return valid;
+    }
+
+    bool is_at_end() const {
+      return position == size;
+    }
+
+    bool can_read(uint64_t num_bytes) {
+      if (!valid || size - position < num_bytes) {
+        valid = false;
+      }
+      return valid;
+    }
+
+    uint32_t read_uint32() {
+      if (!can_read(4)) {
+        return 0;
+      }
+      uint32_t value = 0;
+      for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(buffer[position + i])) << (i * 8);
+      }
+      position += 4;
+      return value;
+    }
+
+    uint64_t read_uint64() {
+      const uint64_t low = read_uint32();
+      const uint64_t high = read_uint32();
+      return low | (high << 32);
+    }
+
+    double read_double() {
+      const uint64_t bits = read_uint64();
+      double value = 0.0;
+      std::memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+
+    std::string read_string() {
+      const uint32_t value_size = read_uint32();
+      if (!can_read(value_size)) {
+        return std::string();
+      }
+      std::string value(buffer + position, value_size);
+      position += value_size;
+      return value;
+    }
+
+    /**
+     * \brief Reads the number of elements of an array.
+     * \param element_size Minimum size of an element in bytes,
+     * to reject counts that the buffer cannot hold.
+     * \return The number of elements.
+     */
+    uint32_t read_count(size_t element_size) {
+      const uint32_t count = read_uint32();
+      if (count > index_mask || !can_read(static_cast<uint64_t>(count) * element_size)) {
+        valid = false;
+        return 0;
+      }
+      return count;
+    }
+
+  private:
+
+    const char* buffer;
+    size_t size;
+    size_t position;
+    bool valid;
+
+};
+
+}  // Anonymous namespace.
+
+/**
+ * \brief Creates an empty compiled data file.
+ */
+CompiledLuaData::CompiledLuaData():
+  source_hash(0) {
+}
+
+/**
+ * \brief Returns the name of the compiled file of a data file.
+ * \param file_name Name of a Lua data file, like "maps/outside.dat".
+ * \return Name of its compiled file, like "maps/outside.datc".
+ */
+std::string CompiledLuaData::get_compiled_file_name(const std::string& file_name) {
+  return file_name + "c";
+}
+
+/**
+ * \brief Computes the hash of a data file that compiled files store.
+ *
+ * This is the 64-bit FNV-1a hash of the content.
+ *
+ * \param source Content of a Lua data file.
+ * \return The hash.
+ */
+uint64_t CompiledLuaData::compute_source_hash(const std::string& source) {
+  return compute_source_hash(source.data(), source.size());
+}
+
+/**
+ * \brief Computes the hash of a data file that compiled files store.
+ * \param source Content of a Lua data file.
+ * \param size Size of the content in bytes.
+ * \return The hash.
+ */
+uint64_t CompiledLuaData::compute_source_hash(const char* source, size_t size) {
+
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(source[i]);
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/**
+ * \brief Returns whether a compiled file can replace a data file.
+ *
+ * Only the header is checked: the format version and the source hash.
+ *
+ * \param buffer Content of a compiled file.
+ * \param source Content of the Lua data file.
+ * \return \c true if the compiled file was made from this source
+ * with the current format.
+ */
+bool CompiledLuaData::is_up_to_date(const std::string& buffer, const std::string& source) {
+  return is_up_to_date(buffer.data(), buffer.size(), compute_source_hash(source));
+}
+
+/**
+ * \brief Returns whether a compiled file can replace a data file.
+ * \param buffer Content of a compiled file.
+ * \param size Size of the compiled file in bytes.
+ * \param source_hash Hash of the Lua data file (see compute_source_hash()).
+ * \return \c true if the compiled file was made from this source
+ * with the current format.
+ */
+bool CompiledLuaData::is_up_to_date(const char* buffer, size_t size, uint64_t source_hash) {
+
+  if (size < header_size ||
+      std::memcmp(buffer, magic, sizeof(magic)) != 0) {
+    return false;
+  }
+  Reader reader(buffer, size);
+  reader.read_uint32();  // Magic.
+  return reader.read_uint32() == format_version &&
+      reader.read_uint64() == source_hash;
+}
+
+/**
+ * \brief Returns the hash of the data file this was compiled from.
+ * \return The source hash.
+ */
+uint64_t CompiledLuaData::get_source_hash() const {
+  return source_hash;
+}
+
+/**
+ * \brief Returns the number of calls recorded.
+ * \return The number of calls of the data file.
+ */
+int CompiledLuaData::get_num_calls() const {
+  return static_cast<int>(calls.size());
+}
+
+/**
+ * \brief Compiles a Lua data file.
+ *
+ * The data file is executed once in an empty environment where every
+ * global is a function that records its arguments.
+ *
+ * \param source Content of the Lua data file.
+ * \param file_name Name of the file to use in error messages.
+ * \return \c true in case of success, \c false if the file has an error
+ * or passes values that cannot be compiled (functions, userdata, cycles).
+ */
+bool CompiledLuaData::compile(const std::string& source, const std::string& file_name) {
+
+  *this = CompiledLuaData();
+  source_hash = compute_source_hash(source);
+
+  lua_State* l = luaL_newstate();
+  if (luaL_loadbuffer(l, source.data(), source.size(), file_name.c_str()) != 0) {
+    Debug::error(std::string("Failed to load data file: ") + lua_tostring(l, -1));
+    lua_close(l);
+    return false;
+  }
+
+  // Environment of the chunk: any global is a recorder.
+  lua_newtable(l);
+                                  // chunk env
+  lua_newtable(l);
+                                  // chunk env meta
+  lua_pushlightuserdata(l, this);
+  lua_pushcclosure(l, l_get_recorder, 1);
+  lua_setfield(l, -2, "__index");
+  lua_setmetatable(l, -2);
+                                  // chunk env
+  lua_setfenv(l, -2);
+                                  // chunk
+  bool success = true;
+  if (lua_pcall(l, 0, 0, 0) != 0) {
+    Debug::error(std::string("Failed to compile data file: ") + lua_tostring(l, -1));
+    success = false;
+  }
+  lua_close(l);
+
+  string_indexes.clear();
+  number_indexes.clear();
+  return success;
+}
+
+/**
+ * \brief __index metamethod of the environment of a data file being compiled.
+ *
+ * Returns a function that records calls to the requested global.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int CompiledLuaData::l_get_recorder(lua_State* l) {
+
+  if (lua_type(l, 2) != LUA_TSTRING) {
+    return 0;
+  }
+                                  // env name
+  lua_pushvalue(l, lua_upvalueindex(1));
+  lua_pushvalue(l, 2);
+  lua_pushcclosure(l, l_record_call, 2);
+                                  // env name recorder
+  lua_pushvalue(l, 2);
+  lua_pushvalue(l, -2);
+  lua_rawset(l, 1);
+  return 1;
+}
+
+/**
+ * \brief Function called instead of a global of a data file being compiled.
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int CompiledLuaData::l_record_call(lua_State* l) {
+
+  CompiledLuaData& data = *static_cast<CompiledLuaData*>(
+      lua_touserdata(l, lua_upvalueindex(1))
+  );
+  if (!data.record_call(l)) {
+    return luaL_error(l, "Unsupported value in arguments of '%s'",
+        lua_tostring(l, lua_upvalueindex(2)));
+  }
+  return 0;
+}
+
+/**
+ * \brief Records a call of a data file being compiled.
+ * \param l The Lua context with the arguments of the call on the stack
+ * and the function name as second upvalue.
+ * \return \c false if an argument cannot be compiled.
+ */
+bool CompiledLuaData::record_call(lua_State* l) {
+
+  const int num_args = lua_gettop(l);
+  std::vector<uint32_t> call_args;
+  call_args.reserve(num_args);
+  for (int i = 1; i <= num_args; ++i) {
+    const uint32_t value = add_value(l, i, 0);
+    if (value == invalid_value) {
+      return false;
+    }
+    call_args.push_back(value);
+  }
+
+  size_t name_size = 0;
+  const char* name = lua_tolstring(l, lua_upvalueindex(2), &name_size);
+  Call call;
+  call.name = add_string(std::string(name, name_size));
+  call.first_arg = static_cast<uint32_t>(args.size());
+  call.num_args = static_cast<uint32_t>(call_args.size());
+  calls.push_back(call);
+  args.insert(args.end(), call_args.begin(), call_args.end());
+  return true;
+}
+
+/**
+ * \brief Adds a string to the string table if it is not there yet.
+ * \param value The string.
+ * \return Its index in the string table.
+ */
+uint32_t CompiledLuaData::add_string(const std::string& value) {
+
+  const auto it = string_indexes.find(value);
+  if (it != string_indexes.end()) {
+    return it->second;
+  }
+  const uint32_t index = static_cast<uint32_t>(strings.size());
+  strings.push_back(value);
+  string_indexes.emplace(value, index);
+  return index;
+}
+
+/**
+ * \brief Adds a Lua value to the compiled data.
+ *
+ * Tables are stored after the tables they contain.
+ * Their keys are sorted so that compiling is deterministic.
+ *
+ * \param l A Lua context.
+ * \param index Index of the value in the stack.
+ * \param depth Number of tables containing the value.
+ * \return Code of the value, or an invalid code if it cannot be compiled.
+ */
+uint32_t CompiledLuaData::add_value(lua_State* l, int index, int depth) {
+
+  switch (lua_type(l, index)) {
+
+  case LUA_TNIL:
+    return make_value(VALUE_NIL, 0);
+
+  case LUA_TBOOLEAN:
+    return make_value(lua_toboolean(l, index) ? VALUE_TRUE : VALUE_FALSE, 0);
+
+  case LUA_TNUMBER:
+  {
+    const double number = lua_tonumber(l, index);
+    uint64_t bits = 0;
+    std::memcpy(&bits, &number, sizeof(bits));
+    const auto it = number_indexes.find(bits);
+    if (it != number_indexes.end()) {
+      return make_value(VALUE_NUMBER, it->second);
+    }
+    const uint32_t number_index = static_cast<uint32_t>(numbers.size());
+    if (number_index > index_mask) {
+      return invalid_value;
+    }
+    numbers.push_back(number);
+    number_indexes.emplace(bits, number_index);
+    return make_value(VALUE_NUMBER, number_index);
+  }
+
+  case LUA_TSTRING:
+  {
+    size_t size = 0;
+    const char* value = lua_tolstring(l, index, &size);
+    const uint32_t string_index = add_string(std::string(value, size));
+    if (string_index > index_mask) {
+      return invalid_value;
+    }
+    return make_value(VALUE_STRING, string_index);
+  }
+
+  case LUA_TTABLE:
+  {
+    if (depth >= max_depth || !lua_checkstack(l, 2)) {
+      return invalid_value;
+    }
+    if (index < 0) {
+      index = lua_gettop(l) + index + 1;
+    }
+
+    std::vector<std::pair<uint32_t, uint32_t>> table_fields;
+    lua_pushnil(l);
+    while (lua_next(l, index) != 0) {
+      const int key_type = lua_type(l, -2);
+      if (key_type != LUA_TNUMBER && key_type != LUA_TSTRING) {
+        lua_pop(l, 2);
+        return invalid_value;
+      }
+      const uint32_t key = add_value(l, -2, depth + 1);
+      const uint32_t value = add_value(l, -1, depth + 1);
+      lua_pop(l, 1);
+      if (key == invalid_value || value == invalid_value) {
+        lua_pop(l, 1);
+        return invalid_value;
+      }
+      table_fields.emplace_back(key, value);
+    }
+
+    // Numbers first in increasing order, then strings in alphabetical order.
+    std::sort(table_fields.begin(), table_fields.end(), [this](
+        const std::pair<uint32_t, uint32_t>& field1,
+        const std::pair<uint32_t, uint32_t>& field2) {
+      const ValueType type1 = get_value_type(field1.first);
+      const ValueType type2 = get_value_type(field2.first);
+      if (type1 != type2) {
+        return type1 < type2;
+      }
+      if (type1 == VALUE_NUMBER) {
+        return numbers[get_value_index(field1.first)] < numbers[get_value_index(field2.first)];
+      }
+      return strings[get_value_index(field1.first)] < strings[get_value_index(field2.first)];
+    });
+
+    Table table;
+    table.first_field = static_cast<uint32_t>(fields.size());
+    table.num_fields = static_cast<uint32_t>(table_fields.size());
+    for (const std::pair<uint32_t, uint32_t>& field : table_fields) {
+      fields.push_back(field.first);
+      fields.push_back(field.second);
+    }
+    const uint32_t table_index = static_cast<uint32_t>(tables.size());
+    if (table_index > index_mask) {
+      return invalid_value;
+    }
+    tables.push_back(table);
+    return make_value(VALUE_TABLE, table_index);
+  }
+
+  default:
+    return invalid_value;
+  }
+}
+
+/**
+ * \brief Writes the compiled data into memory.
+ *
+ * All integers are stored in little-endian.
+ *
+ * \param[out] buffer The buffer to write.
+ * \return \c true in case of success.
+ */
+bool CompiledLuaData::export_to_buffer(std::string& buffer) const {
+
+  buffer.clear();
+  buffer.append(magic, sizeof(magic));
+  write_uint32(buffer, format_version);
+  write_uint64(buffer, source_hash);
+
+  write_uint32(buffer, static_cast<uint32_t>(strings.size()));
+  for (const std::string& value : strings) {
+    write_uint32(buffer, static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+  }
+
+  write_uint32(buffer, static_cast<uint32_t>(numbers.size()));
+  for (const double value : numbers) {
+    write_double(buffer, value);
+  }
+
+  write_uint32(buffer, static_cast<uint32_t>(tables.size()));
+  for (const Table& table : tables) {
+    write_uint32(buffer, table.first_field);
+    write_uint32(buffer, table.num_fields);
+  }
+
+  write_uint32(buffer, static_cast<uint32_t>(fields.size()));
+  for (const uint32_t value : fields) {
+    write_uint32(buffer, value);
+  }
+
+  write_uint32(buffer, static_cast<uint32_t>(calls.size()));
+  for (const Call& call : calls) {
+    write_uint32(buffer, call.name);
+    write_uint32(buffer, call.first_arg);
+    write_uint32(buffer, call.num_args);
+  }
+
+  write_uint32(buffer, static_cast<uint32_t>(args.size()));
+  for (const uint32_t value : args) {
+    write_uint32(buffer, value);
+  }
+  return true;
+}
+
+/**
+ * \brief Reads compiled data from memory.
+ *
+ * Every index is checked, so that an invalid file is rejected here
+ * rather than read out of bounds later.
+ *
+ * \param buffer Content of a compiled file.
+ * \param file_name Name of the file to use in error messages.
+ * \return \c true in case of success, \c false if the file is invalid
+ * or has another format version.
+ */
+bool CompiledLuaData::import_from_buffer(
+    const std::string& buffer,
+    const std::string& file_name
+) {
+  return import_from_buffer(buffer.data(), buffer.size(), file_name);
+}
+
+/**
+ * \brief Reads compiled data from memory.
+ * \param buffer Content of a compiled file.
+ * \param size Size of the compiled file in bytes.
+ * \param file_name Name of the file to use in error messages.
+ * \return \c true in case of success, \c false if the file is invalid
+ * or has another format version.
+ */
+bool CompiledLuaData::import_from_buffer(
+    const char* buffer,
+    size_t size,
+    const std::string& file_name
+) {
+  *this = CompiledLuaData();
+
+  Reader reader(buffer, size);
+  if (size < header_size ||
+      std::memcmp(buffer, magic, sizeof(magic)) != 0) {
+    Debug::error(std::string("Invalid compiled data file '") + file_name + "'");
+    return false;
+  }
+  reader.read_uint32();  // Magic.
+  const uint32_t version = reader.read_uint32();
+  if (version != format_version) {
+    Debug::error(std::string("Unsupported version of compiled data file '") + file_name + "'");
+    return false;
+  }
+  source_hash = reader.read_uint64();
+
+  strings.resize(reader.read_count(4));
+  for (std::string& value : strings) {
+    value = reader.read_string();
+  }
+
+  numbers.resize(reader.read_count(8));
+  for (double& value : numbers) {
+    value = reader.read_double();
+  }
+
+  tables.resize(reader.read_count(8));
+  for (Table& table : tables) {
+    table.first_field = reader.read_uint32();
+    table.num_fields = reader.read_uint32();
+  }
+
+  fields.resize(reader.read_count(4));
+  for (uint32_t& value : fields) {
+    value = reader.read_uint32();
+  }
+
+  calls.resize(reader.read_count(12));
+  for (Call& call : calls) {
+    call.name = reader.read_uint32();
+    call.first_arg = reader.read_uint32();
+    call.num_args = reader.read_uint32();
+  }
+
+  args.resize(reader.read_count(4));
+  for (uint32_t& value : args) {
+    value = reader.read_uint32();
+  }
+
+  // Tables only contain tables with a lower index, so the nesting of
+  // each one is known when it is checked.
+  // Too deep tables would overflow the stack of push_value().
+  bool valid = reader.is_valid() && reader.is_at_end() && fields.size() % 2 == 0;
+  std::vector<int> table_depths(tables.size(), 1);
+  for (uint32_t i = 0; valid && i < tables.size(); ++i) {
+    const Table& table = tables[i];
+    const uint64_t end = static_cast<uint64_t>(table.first_field) + table.num_fields * 2ULL;
+    valid = end <= fields.size();
+    for (uint64_t j = table.first_field; valid && j < end; j += 2) {
+      const ValueType key_type = get_value_type(fields[j]);
+      valid = (key_type == VALUE_NUMBER || key_type == VALUE_STRING) &&
+          check_value(fields[j], i) &&
+          check_value(fields[j + 1], i);
+      if (valid && get_value_type(fields[j + 1]) == VALUE_TABLE) {
+        const int child_depth = table_depths[get_value_index(fields[j + 1])];
+        table_depths[i] = std::max(table_depths[i], child_depth + 1);
+        valid = table_depths[i] <= max_depth;
+      }
+    }
+  }
+  for (const Call& call : calls) {
+    if (!valid) {
+      break;
+    }
+    const uint64_t end = static_cast<uint64_t>(call.first_arg) + call.num_args;
+    valid = call.name < strings.size() && end <= args.size();
+    for (uint64_t j = call.first_arg; valid && j < end; ++j) {
+      valid = check_value(args[j], static_cast<uint32_t>(tables.size()));
+    }
+  }
+
+  if (!valid) {
+    Debug::error(std::string("Invalid compiled data file '") + file_name + "'");
+    *this = CompiledLuaData();
+    return false;
+  }
+  return true;
+}
+
+/**
+ * \brief Checks that a value code refers to existing data.
+ * \param value A value code.
+ * \param max_table Tables allowed are the ones with a lower index.
+ * This prevents cycles.
+ * \return \c true if the value is valid.
+ */
+bool CompiledLuaData::check_value(uint32_t value, uint32_t max_table) const {
+
+  const uint32_t index = get_value_index(value);
+  switch (get_value_type(value)) {
+
+  case VALUE_NIL:
+  case VALUE_FALSE:
+  case VALUE_TRUE:
+    return index == 0;
+
+  case VALUE_NUMBER:
+    return index < numbers.size();
+
+  case VALUE_STRING:
+    return index < strings.size();
+
+  case VALUE_TABLE:
+    return index < max_table;
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * \brief Pushes onto the stack a function that replays the recorded calls.
+ *
+ * The function can be passed to LuaData::import_from_lua() instead of the
+ * chunk of the data file: it calls the same globals with the same arguments.
+ * This object must exist until the function is no longer used.
+ *
+ * \param l A Lua context.
+ */
+void CompiledLuaData::push_chunk(lua_State* l) const {
+
+  lua_pushlightuserdata(l, const_cast<CompiledLuaData*>(this));
+  lua_pushcclosure(l, l_replay, 1);
+}
+
+/**
+ * \brief Pushes a value onto the stack.
+ * \param l A Lua context.
+ * \param value Code of a valid value.
+ */
+void CompiledLuaData::push_value(lua_State* l, uint32_t value) const {
+
+  const uint32_t index = get_value_index(value);
+  switch (get_value_type(value)) {
+
+  case VALUE_FALSE:
+    lua_pushboolean(l, false);
+    break;
+
+  case VALUE_TRUE:
+    lua_pushboolean(l, true);
+    break;
+
+  case VALUE_NUMBER:
+    lua_pushnumber(l, numbers[index]);
+    break;
+
+  case VALUE_STRING:
+    lua_pushlstring(l, strings[index].data(), strings[index].size());
+    break;
+
+  case VALUE_TABLE:
+  {
+    const Table& table = tables[index];
+    if (!lua_checkstack(l, 3)) {
+      luaL_error(l, "Compiled data tables are too deep");
+    }
+    const uint32_t* field = fields.data() + table.first_field;
+    const uint32_t* end = field + table.num_fields * 2;
+    int num_numbers = 0;
+    for (const uint32_t* key = field; key != end; key += 2) {
+      if (get_value_type(*key) == VALUE_NUMBER) {
+        ++num_numbers;
+      }
+    }
+    lua_createtable(l, num_numbers, table.num_fields - num_numbers);
+    for (; field != end; field += 2) {
+      push_value(l, field[0]);
+      push_value(l, field[1]);
+      lua_rawset(l, -3);
+    }
+    break;
+  }
+
+  default:
+    lua_pushnil(l);
+    break;
+  }
+}
+
+/**
+ * \brief Function pushed by push_chunk().
+ *
+ * Replays the calls of the data file on the globals of the Lua context.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int CompiledLuaData::l_replay(lua_State* l) {
+
+  const CompiledLuaData& data = *static_cast<const CompiledLuaData*>(
+      lua_touserdata(l, lua_upvalueindex(1))
+  );
+  for (const Call& call : data.calls) {
+    const std::string& name = data.strings[call.name];
+    if (!lua_checkstack(l, static_cast<int>(call.num_args) + 1)) {
+      return luaL_error(l, "Too many arguments in call to '%s'", name.c_str());
+    }
+    lua_getfield(l, LUA_GLOBALSINDEX, name.c_str());
+    if (!lua_isfunction(l, -1)) {
+      return luaL_error(l, "attempt to call global '%s' (a %s value)",
+          name.c_str(), luaL_typename(l, -1));
+    }
+    for (uint32_t i = 0; i < call.num_args; ++i) {
+      data.push_value(l, data.args[call.first_arg + i]);
+    }
+    lua_call(l, static_cast<int>(call.num_args), 0);
+  }
+  return 0;
+}
+
+}
+
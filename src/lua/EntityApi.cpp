@@ -6567,10 +6567,7 @@ int LuaContext::custom_entity_api_set_follow_streams(lua_State* l) {
  */
 void LuaContext::entity_on_update(Entity& entity) {
 
-  // This particular method is tried so often that we want to optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (!userdata_has_field(entity, method_name)) {
+  if (!userdata_has_event(entity, LuaEvent::ON_UPDATE)) {
     return;
   }
 
@@ -6684,7 +6681,7 @@ void LuaContext::entity_on_disabled(Entity& entity) {
  */
 void LuaContext::entity_on_pre_draw(Entity& entity, Camera& camera) {
 
-  if (!userdata_has_field(entity, "on_pre_draw")) {
+  if (!userdata_has_event(entity, LuaEvent::ON_PRE_DRAW)) {
     return;
   }
   run_on_main([this, &entity, &camera](lua_State* l){
@@ -6704,7 +6701,7 @@ void LuaContext::entity_on_pre_draw(Entity& entity, Camera& camera) {
  */
 void LuaContext::entity_on_post_draw(Entity& entity, Camera& camera) {
 
-  if (!userdata_has_field(entity, "on_post_draw")) {
+  if (!userdata_has_event(entity, LuaEvent::ON_POST_DRAW)) {
     return;
   }
   run_on_main([this, &entity, &camera](lua_State* l){
@@ -6726,7 +6723,7 @@ void LuaContext::entity_on_post_draw(Entity& entity, Camera& camera) {
 void LuaContext::entity_on_position_changed(
     Entity& entity, const Point& xy, int layer) {
 
-  if (!userdata_has_field(entity, "on_position_changed")) {
+  if (!userdata_has_event(entity, LuaEvent::ON_POSITION_CHANGED)) {
     return;
   }
   run_on_main([this, &entity, xy, layer](lua_State* l){
@@ -6790,7 +6787,7 @@ void LuaContext::entity_on_movement_started(
 void LuaContext::entity_on_movement_changed(
     Entity& entity, Movement& movement) {
 
-  if (!userdata_has_field(entity, "on_movement_changed")) {
+  if (!userdata_has_event(entity, LuaEvent::ON_MOVEMENT_CHANGED)) {
     return;
   }
 
@@ -7088,7 +7085,7 @@ void LuaContext::carried_object_on_breaking(CarriedObject& carried_object) {
  */
 void LuaContext::block_on_moving(Block& block) {
 
-  if (!userdata_has_field(block, "on_moving")) {
+  if (!userdata_has_event(block, LuaEvent::ON_MOVING)) {
     return;
   }
   run_on_main([this, &block](lua_State* l){
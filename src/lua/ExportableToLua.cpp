@@ -96,6 +96,40 @@ void ExportableToLua::set_with_lua_table(bool with_lua_table) {
   this->with_lua_table = with_lua_table;
 }
 
+/**
+ * \brief Returns whether a cached event is defined in the table of this
+ * userdata.
+ *
+ * Events defined in the metatable of the type are not included.
+ *
+ * \param event The event to test.
+ * \return \c true if the userdata table has a field with the name of this
+ * event.
+ */
+bool ExportableToLua::has_lua_event(LuaEvent event) const {
+  return lua_events.test(static_cast<size_t>(event));
+}
+
+/**
+ * \brief Sets whether a cached event is defined in the table of this
+ * userdata.
+ *
+ * This is called by __newindex when the field of an event changes.
+ *
+ * \param event The event.
+ * \param defined \c true if the userdata table has a field for this event.
+ */
+void ExportableToLua::set_lua_event(LuaEvent event, bool defined) {
+  lua_events.set(static_cast<size_t>(event), defined);
+}
+
+/**
+ * \brief Forgets all cached events of this userdata.
+ */
+void ExportableToLua::clear_lua_events() {
+  lua_events.reset();
+}
+
 /**
  * \brief Returns the name identifying this type in Lua.
  * \return The name identifying this type in Lua.
@@ -78,6 +78,9 @@ int LuaContext::file_api_open(lua_State* l) {
     // file_name is relative to the data directory, the data archive or the
     // quest write directory.
     // Let's determine the real file name and pass it to io.open().
+    // Don't race with a save of the same file in background.
+    QuestFiles::wait_async_save(file_name);
+
     std::string real_file_name;
     if (writing) {
 
@@ -225,12 +225,23 @@ int LuaContext::game_api_save(lua_State* l) {
 
   return state_boundary_handle(l, [&] {
     Savegame& savegame = *check_game(l, 1);
+    const ScopedLuaRef& callback_ref = LuaTools::opt_function(l, 2);
 
     if (QuestFiles::get_quest_write_dir().empty()) {
       LuaTools::error(l, "Cannot save game: no write directory was specified in quest.dat");
     }
 
-    savegame.save();
+    if (callback_ref.is_empty()) {
+      savegame.save();
+    }
+    else {
+      savegame.save([callback_ref](bool success) {
+        lua_State* l = get().get_internal_state();
+        push_ref(l, callback_ref);
+        lua_pushboolean(l, success);
+        LuaTools::call_function(l, 1, 0, "game:save() callback");
+      });
+    }
 
     return 0;
   });
@@ -1642,10 +1653,7 @@ void LuaContext::game_on_finished(Game& game) {
 void LuaContext::game_on_update(Game& game) {
 
   push_game(current_l, game.get_savegame());
-  // This particular method is tried so often that we want to optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (userdata_has_field(game.get_savegame(), method_name)) {
+  if (userdata_has_event(game.get_savegame(), LuaEvent::ON_UPDATE)) {
     on_update();
   }
   menus_on_update(-1);
@@ -1663,7 +1671,7 @@ void LuaContext::game_on_update(Game& game) {
 void LuaContext::game_on_draw(Game& game, const SurfacePtr& dst_surface) {
 
   push_game(current_l, game.get_savegame());
-  if (userdata_has_field(game.get_savegame(), "on_draw")) {
+  if (userdata_has_event(game.get_savegame(), LuaEvent::ON_DRAW)) {
     on_draw(dst_surface);
   }
   menus_on_draw(-1, dst_surface);
@@ -21,8 +21,10 @@
 #include "solarus/core/EquipmentItem.h"
 #include "solarus/core/Logger.h"
 #include "solarus/core/Map.h"
+#include "solarus/core/Profiler.h"
 #include "solarus/core/QuestFiles.h"
 #include "solarus/core/QuestProperties.h"
+#include "solarus/core/System.h"
 #include "solarus/core/Timer.h"
 #include "solarus/core/Treasure.h"
 #include "solarus/entities/Block.h"
@@ -44,6 +46,7 @@
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
 #include "solarus/core/Arguments.h"
+#include <cstring>
 #include <sstream>
 
 namespace Solarus {
@@ -56,7 +59,12 @@ LuaContext* LuaContext::lua_context;
  */
 LuaContext::LuaContext(MainLoop& main_loop):
   current_l(nullptr),
-  main_loop(main_loop) {
+  main_loop(main_loop),
+  timer_creation_order(0),
+  callback_stats_enabled(false),
+  num_callbacks_skipped(0),
+  report_num_frames(0),
+  last_report_time(0) {
 
 }
 
@@ -138,6 +146,33 @@ void LuaContext::initialize(const Arguments& args) {
   lua_setfield(current_l, LUA_REGISTRYINDEX, "sol.userdata_tables");
                                   // --
 
+  // Create the metatable of type metatables, to know which events
+  // they define.
+  metatable_events.reset();
+  lua_newtable(current_l);
+                                  // meta_meta
+  lua_pushcfunction(current_l, metatable_meta_newindex);
+                                  // meta_meta __newindex
+  lua_setfield(current_l, -2, "__newindex");
+                                  // meta_meta
+  lua_setfield(current_l, LUA_REGISTRYINDEX, "sol.metatable_meta");
+                                  // --
+
+  // Wrap setmetatable() and getmetatable() so that Lua code cannot
+  // silently replace or see the metatable of type metatables.
+  lua_getglobal(current_l, "setmetatable");
+                                  // setmetatable
+  lua_setfield(current_l, LUA_REGISTRYINDEX, "setmetatable");
+                                  // --
+  lua_getglobal(current_l, "getmetatable");
+                                  // getmetatable
+  lua_setfield(current_l, LUA_REGISTRYINDEX, "getmetatable");
+                                  // --
+  lua_register(current_l, "setmetatable", l_setmetatable);
+  lua_register(current_l, "getmetatable", l_getmetatable);
+
+  callback_stats_enabled = args.get_argument_value("-lua-stats") == "yes";
+
   // Create the sol table that will contain the whole Solarus API.
   lua_newtable(current_l);
   lua_setglobal(current_l, "sol");
@@ -223,6 +258,8 @@ void LuaContext::exit() {
  */
 void LuaContext::update() {
 
+  SOLARUS_PROFILE_ZONE("LuaContext::update");
+
   // Make sure the stack does not leak.
   Debug::check_assertion(lua_gettop(main_l) == 0,
       "Non-empty stack before LuaContext::update()"
@@ -262,6 +299,8 @@ void LuaContext::update() {
 
   current_l = main_l; //Ensure we run again on the main thread
 
+  update_callback_stats();
+
   Debug::check_assertion(lua_gettop(main_l) == 0,
       "Non-empty stack after LuaContext::update()"
   );
@@ -614,6 +653,105 @@ bool LuaContext::userdata_has_field(
   return it->second.find(key) != it->second.end();
 }
 
+/**
+ * \brief Returns whether a userdata has a cached event.
+ *
+ * This is equivalent to userdata_has_field() with the name of the event,
+ * but it only tests bits unless the metatable of a type defines the event.
+ * If the event is not defined, the callback is counted as skipped.
+ *
+ * \param userdata A userdata.
+ * \param event The event to test.
+ * \return \c true if this event exists on the userdata or on its metatable.
+ */
+bool LuaContext::userdata_has_event(
+    const ExportableToLua& userdata, LuaEvent event) {
+
+  if (userdata.has_lua_event(event)) {
+    return true;
+  }
+
+  // Events of metatables are only tracked when they get defined,
+  // so the metatable still has to be checked when the bit is set.
+  if (metatable_events.test(static_cast<size_t>(event)) &&
+      userdata_has_metafield(userdata, get_lua_event_name(event))) {
+    return true;
+  }
+
+  ++num_callbacks_skipped;
+  return false;
+}
+
+/**
+ * \brief Returns the Lua name of a cached event.
+ * \param event A cached event.
+ * \return The name of the corresponding method.
+ */
+const char* LuaContext::get_lua_event_name(LuaEvent event) {
+
+  static const char* const names[] = {
+      "on_update",
+      "on_draw",
+      "on_pre_draw",
+      "on_post_draw",
+      "on_position_changed",
+      "on_movement_changed",
+      "on_frame_changed",
+      "on_moving"
+  };
+  static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(LuaEvent::NB_EVENTS),
+      "Missing event names");
+
+  return names[static_cast<size_t>(event)];
+}
+
+/**
+ * \brief Returns the cached event with the specified Lua name if any.
+ * \param[in] name A method name.
+ * \param[out] event The corresponding event if any.
+ * \return \c true if the name is the one of a cached event.
+ */
+bool LuaContext::get_lua_event_by_name(const char* name, LuaEvent& event) {
+
+  // Events all start with "on_": avoid comparing other keys.
+  if (std::strncmp(name, "on_", 3) != 0) {
+    return false;
+  }
+
+  for (size_t i = 0; i < static_cast<size_t>(LuaEvent::NB_EVENTS); ++i) {
+    if (std::strcmp(name, get_lua_event_name(static_cast<LuaEvent>(i))) == 0) {
+      event = static_cast<LuaEvent>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * \brief Logs the number of skipped callbacks every second if enabled.
+ *
+ * This function is called at each cycle.
+ */
+void LuaContext::update_callback_stats() {
+
+  if (!callback_stats_enabled) {
+    num_callbacks_skipped = 0;
+    return;
+  }
+
+  ++report_num_frames;
+  const uint32_t now = System::get_real_time();
+  if (now - last_report_time >= 1000) {
+    std::ostringstream oss;
+    oss << "LuaContext: frames=" << report_num_frames
+        << " callbacks_skipped=" << num_callbacks_skipped / report_num_frames << "/frame";
+    Logger::print(oss.str());
+    last_report_time = now;
+    report_num_frames = 0;
+    num_callbacks_skipped = 0;
+  }
+}
+
 /**
  * \brief Returns whether the metatable of a userdata has the specified field.
  * \param userdata A userdata.
@@ -744,8 +882,8 @@ bool LuaContext::load_file(const std::string& script_name) {
 
   // Load the file.
   // "@" tells Lua that the name is a file name, which is useful for better error messages.
-  const std::string& buffer = QuestFiles::data_file_read(file_name);
-  int result = luaL_loadbuffer(current_l, buffer.data(), buffer.size(), ("@" + file_name).c_str());
+  const DataFileBufferPtr& buffer = QuestFiles::data_file_read_buffer(file_name);
+  int result = luaL_loadbuffer(current_l, buffer->data(), buffer->size(), ("@" + file_name).c_str());
 
   if (result != 0) {
     Debug::error(std::string("Failed to load script '")
@@ -1052,6 +1190,14 @@ void LuaContext::register_type(
     lua_setfield(current_l, -3, "__index");
                                   // meta nil
   }
+  lua_settop(current_l, 1);
+                                  // meta
+
+  // Watch new fields of the metatable to know which events it defines.
+  lua_getfield(current_l, LUA_REGISTRYINDEX, "sol.metatable_meta");
+                                  // meta meta_meta
+  lua_setmetatable(current_l, -2);
+                                  // meta
   lua_settop(current_l, 0);
                                   // --
 }
@@ -1333,7 +1479,8 @@ int LuaContext::userdata_meta_gc(lua_State* l) {
   // Note that the full userdata disappears from Lua but it may come back later!
   // So we need to keep its table if the refcount is not zero.
   // The full userdata is destroyed but the light userdata and its table persist.
-  // Its table will be destroyed from ~ExportableToLua().
+  // Its table will be destroyed from ~ExportableToLua(), and so will the
+  // cached events of that table.
 
   // We don't need to remove the entry from sol.all_userdata
   // because it is already done: that table is weak on its values and the
@@ -1375,6 +1522,7 @@ void LuaContext::notify_userdata_destroyed(ExportableToLua& userdata) {
     lua_pop(current_l, 1);
                                   // ...
     get().userdata_fields.erase(&userdata);
+    userdata.clear_lua_events();
   }
 }
 
@@ -1393,6 +1541,7 @@ void LuaContext::userdata_close_lua() {
     ExportableToLua* userdata = static_cast<ExportableToLua*>(
         lua_touserdata(current_l, -2));
     userdata->set_lua_context(nullptr);
+    userdata->clear_lua_events();
     lua_pop(current_l, 1);
   }
   lua_pop(current_l, 1);
@@ -1461,19 +1610,59 @@ int LuaContext::userdata_meta_newindex_as_table(lua_State* l) {
                                   // ... udata_tables udata_table
 
   if (lua_isstring(l, 2)) {
+    const char* key = lua_tostring(l, 2);
     if (!lua_isnil(l, 3)) {
       // Add the key to the list of existing strings keys on this userdata.
-      get().userdata_fields[userdata.get()].insert(lua_tostring(l, 2));
+      get().userdata_fields[userdata.get()].insert(key);
     }
     else {
       // Assigning nil: remove the key from the list.
-      get().userdata_fields[userdata.get()].erase(lua_tostring(l, 2));
+      get().userdata_fields[userdata.get()].erase(key);
+    }
+
+    LuaEvent event;
+    if (get_lua_event_by_name(key, event)) {
+      userdata->set_lua_event(event, !lua_isnil(l, 3));
     }
   }
 
   return 0;
 }
 
+/**
+ * \brief Implementation of __newindex for the metatables of userdata types.
+ *
+ * Lua code can make "metatable[key] = value" after
+ * sol.main.get_metatable(). The field is set normally, and if it is
+ * a cached event, the event is then looked for in metatables
+ * by userdata_has_event().
+ *
+ * This is only called for new keys, so removing an event from a metatable
+ * does not clear it.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::metatable_meta_newindex(lua_State* l) {
+
+  LuaTools::check_type(l, 1, LUA_TTABLE);
+  LuaTools::check_any(l, 2);
+  LuaTools::check_any(l, 3);
+
+  LuaEvent event;
+  if (lua_type(l, 2) == LUA_TSTRING &&
+      !lua_isnil(l, 3) &&
+      get_lua_event_by_name(lua_tostring(l, 2), event)) {
+    get().metatable_events.set(static_cast<size_t>(event));
+  }
+
+  lua_settop(l, 3);
+                                  // meta key value
+  lua_rawset(l, 1);
+                                  // meta
+  return 0;
+}
+
 /**
  * \brief Implementation of __index that allows userdata to be like tables.
  *
@@ -3315,6 +3504,69 @@ int LuaContext::l_loader(lua_State* l) {
   });
 }
 
+/**
+ * \brief Replacement of the standard setmetatable() function.
+ *
+ * If the table is the metatable of a userdata type, its own metatable
+ * is what detects new events (see metatable_meta_newindex).
+ * Replacing it would make events defined afterwards unnoticed,
+ * so from then on all events are looked for in metatables.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_setmetatable(lua_State* l) {
+
+  if (lua_type(l, 1) == LUA_TTABLE &&
+      lua_getmetatable(l, 1)) {
+                                  // table ... meta
+    lua_getfield(l, LUA_REGISTRYINDEX, "sol.metatable_meta");
+                                  // table ... meta meta_meta
+    if (lua_rawequal(l, -1, -2)) {
+      get().metatable_events.set();
+    }
+    lua_pop(l, 2);
+                                  // table ...
+  }
+
+  lua_getfield(l, LUA_REGISTRYINDEX, "setmetatable");
+                                  // table ... setmetatable
+  lua_insert(l, 1);
+                                  // setmetatable table ...
+  lua_call(l, lua_gettop(l) - 1, 1);
+                                  // table
+  return 1;
+}
+
+/**
+ * \brief Replacement of the standard getmetatable() function.
+ *
+ * The metatable of userdata type metatables is internal to the engine:
+ * getmetatable() returns nil for them like for other tables.
+ *
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::l_getmetatable(lua_State* l) {
+
+  lua_getfield(l, LUA_REGISTRYINDEX, "getmetatable");
+                                  // value ... getmetatable
+  lua_insert(l, 1);
+                                  // getmetatable value ...
+  lua_call(l, lua_gettop(l) - 1, 1);
+                                  // meta
+  lua_getfield(l, LUA_REGISTRYINDEX, "sol.metatable_meta");
+                                  // meta meta_meta
+  if (lua_rawequal(l, -1, -2)) {
+    lua_pushnil(l);
+                                  // meta meta_meta nil
+    return 1;
+  }
+  lua_pop(l, 1);
+                                  // meta
+  return 1;
+}
+
 /**
  * \brief A function that prints the stack trace of an error raised in Lua.
  * \param l The Lua context.
@@ -16,6 +16,7 @@
  */
 #include "solarus/core/Debug.h"
 #include "solarus/core/QuestFiles.h"
+#include "solarus/lua/CompiledLuaData.h"
 #include "solarus/lua/LuaData.h"
 #include <lua.hpp>
 #include <cstdio>
@@ -35,10 +36,26 @@ namespace Solarus {
 bool LuaData::import_from_buffer(
     const std::string& buffer,
     const std::string& file_name
+) {
+  return import_from_buffer(buffer.data(), buffer.size(), file_name);
+}
+
+/**
+ * \brief Imports a Lua data file from memory to this object.
+ * \param[in] buffer A memory area with the content of a data file
+ * encoded in UTF-8.
+ * \param[in] size Size of the memory area in bytes.
+ * \param[in] file_name Name of a file to use in error messages.
+ * \return \c true in case of success, \c false if the file could not be loaded.
+ */
+bool LuaData::import_from_buffer(
+    const char* buffer,
+    size_t size,
+    const std::string& file_name
 ) {
   // Read the file.
   lua_State* l = luaL_newstate();
-  if (luaL_loadbuffer(l, buffer.data(), buffer.size(), file_name.c_str()) != 0) {
+  if (luaL_loadbuffer(l, buffer, size, file_name.c_str()) != 0) {
     Debug::error(std::string("Failed to load data file: ") + lua_tostring(l, -1));
     lua_pop(l, 1);
     return false;
@@ -101,10 +118,85 @@ bool LuaData::import_from_quest_file(
     return false;
   }
 
-  const std::string& buffer = QuestFiles::data_file_read(
+  const DataFileBufferPtr& buffer = QuestFiles::data_file_read_buffer(
       quest_file_name, language_specific
   );
-  return import_from_buffer(buffer, quest_file_name);
+  return import_from_quest_buffer(
+      buffer->data(), buffer->size(), quest_file_name, language_specific
+  );
+}
+
+/**
+ * \brief Imports a Lua data file of the current quest already read in memory.
+ *
+ * If the quest has a compiled version of the file (see CompiledLuaData)
+ * made from this exact content, it is loaded instead, which avoids
+ * parsing and executing Lua code.
+ *
+ * \param[in] buffer Content of the data file encoded in UTF-8.
+ * \param[in] quest_file_name Path of the file, relative to the quest
+ * data path.
+ * \param[in] language_specific \c true if the file is in the
+ * language-specific directory of the current language.
+ * \return \c true in case of success, \c false if the file could not be loaded.
+ */
+bool LuaData::import_from_quest_buffer(
+    const std::string& buffer,
+    const std::string& quest_file_name,
+    bool language_specific
+) {
+  return import_from_quest_buffer(
+      buffer.data(), buffer.size(), quest_file_name, language_specific
+  );
+}
+
+/**
+ * \brief Imports a Lua data file of the current quest already read in memory.
+ * \param[in] buffer Content of the data file encoded in UTF-8.
+ * \param[in] size Size of the content in bytes.
+ * \param[in] quest_file_name Path of the file, relative to the quest
+ * data path.
+ * \param[in] language_specific \c true if the file is in the
+ * language-specific directory of the current language.
+ * \return \c true in case of success, \c false if the file could not be loaded.
+ */
+bool LuaData::import_from_quest_buffer(
+    const char* buffer,
+    size_t size,
+    const std::string& quest_file_name,
+    bool language_specific
+) {
+  const std::string& compiled_file_name =
+      CompiledLuaData::get_compiled_file_name(quest_file_name);
+  if (QuestFiles::data_file_exists(compiled_file_name, language_specific)) {
+    const DataFileBufferPtr& compiled_buffer = QuestFiles::data_file_read_buffer(
+        compiled_file_name, language_specific
+    );
+    const uint64_t source_hash = CompiledLuaData::compute_source_hash(buffer, size);
+    CompiledLuaData compiled;
+    if (CompiledLuaData::is_up_to_date(
+            compiled_buffer->data(), compiled_buffer->size(), source_hash) &&
+        compiled.import_from_buffer(
+            compiled_buffer->data(), compiled_buffer->size(), compiled_file_name)) {
+      return import_from_compiled(compiled);
+    }
+  }
+
+  return import_from_buffer(buffer, size, quest_file_name);
+}
+
+/**
+ * \brief Imports a compiled data file to this object.
+ * \param[in] compiled The compiled data.
+ * \return \c true in case of success, \c false if the data could not be loaded.
+ */
+bool LuaData::import_from_compiled(const CompiledLuaData& compiled) {
+
+  lua_State* l = luaL_newstate();
+  compiled.push_chunk(l);
+  bool success = import_from_lua(l);
+  lua_close(l);
+  return success;
 }
 
 /**
@@ -2421,10 +2421,7 @@ void LuaContext::map_on_finished(Map& map) {
 void LuaContext::map_on_update(Map& map) {
 
   push_map(current_l, map);
-  // This particular method is tried so often that we want to save optimize
-  // the std::string construction.
-  static const std::string method_name = "on_update";
-  if (userdata_has_field(map, method_name)) {
+  if (userdata_has_event(map, LuaEvent::ON_UPDATE)) {
     on_update();
   }
   menus_on_update(-1);
@@ -2442,7 +2439,7 @@ void LuaContext::map_on_update(Map& map) {
 void LuaContext::map_on_draw(Map& map, const SurfacePtr& dst_surface) {
 
   push_map(current_l, map);
-  if (userdata_has_field(map, "on_draw")) {
+  if (userdata_has_event(map, LuaEvent::ON_DRAW)) {
     on_draw(dst_surface);
   }
   menus_on_draw(-1, dst_surface);
@@ -252,6 +252,8 @@ void LuaContext::register_movement_module() {
   if (CurrentQuest::is_format_at_least({ 1, 6 })) {
     path_finding_movement_methods.insert(path_finding_movement_methods.end(), {
         { "get_angle", path_finding_movement_api_get_angle },
+        { "get_max_nodes", path_finding_movement_api_get_max_nodes },
+        { "set_max_nodes", path_finding_movement_api_set_max_nodes },
     });
   }
   path_finding_movement_methods.insert(
@@ -1524,6 +1526,38 @@ int LuaContext::path_finding_movement_api_set_speed(lua_State* l) {
   });
 }
 
+/**
+ * \brief Implementation of path_finding_movement:get_max_nodes().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::path_finding_movement_api_get_max_nodes(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    const PathFindingMovement& movement = *check_path_finding_movement(l, 1);
+    lua_pushinteger(l, movement.get_max_nodes());
+    return 1;
+  });
+}
+
+/**
+ * \brief Implementation of path_finding_movement:set_max_nodes().
+ * \param l The Lua context that is calling this function.
+ * \return Number of values to return to Lua.
+ */
+int LuaContext::path_finding_movement_api_set_max_nodes(lua_State* l) {
+
+  return state_boundary_handle(l, [&] {
+    PathFindingMovement& movement = *check_path_finding_movement(l, 1);
+    int max_nodes = LuaTools::check_int(l, 2);
+    if (max_nodes <= 0) {
+      LuaTools::arg_error(l, 2, "The number of nodes must be positive");
+    }
+    movement.set_max_nodes(max_nodes);
+    return 0;
+  });
+}
+
 /**
  * \brief Returns whether a value is a userdata of type circle movement.
  * \param l A Lua context.
@@ -2206,7 +2240,7 @@ void LuaContext::movement_on_position_changed(
     }
     lua_pop(current_l, 2);
                                     // ... movement
-    if (userdata_has_field(movement, "on_position_changed")) {
+    if (userdata_has_event(movement, LuaEvent::ON_POSITION_CHANGED)) {
       on_position_changed(xy);
     }
     lua_pop(current_l, 1);
@@ -753,7 +753,7 @@ void LuaContext::sprite_on_direction_changed(Sprite& sprite,
 void LuaContext::sprite_on_frame_changed(Sprite& sprite,
     const std::string& animation, int frame) {
 
-  if (!userdata_has_field(sprite, "on_frame_changed")) {
+  if (!userdata_has_event(sprite, LuaEvent::ON_FRAME_CHANGED)) {
     return;
   }
   run_on_main([this,&sprite,&animation,frame](lua_State* l){
@@ -1344,7 +1344,7 @@ void LuaContext::state_on_finished(
  */
 void LuaContext::state_on_update(CustomState& state) {
 
-  if (!userdata_has_field(state, "on_update")) {
+  if (!userdata_has_event(state, LuaEvent::ON_UPDATE)) {
     return;
   }
 
@@ -1385,7 +1385,7 @@ void LuaContext::state_on_suspended(CustomState& state, bool suspended) {
  */
 void LuaContext::state_on_pre_draw(CustomState& state, Camera& camera) {
 
-  if (!userdata_has_field(state, "on_pre_draw")) {
+  if (!userdata_has_event(state, LuaEvent::ON_PRE_DRAW)) {
     return;
   }
   run_on_main([this, &state, &camera](lua_State* l) {
@@ -1405,7 +1405,7 @@ void LuaContext::state_on_pre_draw(CustomState& state, Camera& camera) {
  */
 void LuaContext::state_on_post_draw(CustomState& state, Camera& camera) {
 
-  if (!userdata_has_field(state, "on_post_draw")) {
+  if (!userdata_has_event(state, LuaEvent::ON_POST_DRAW)) {
     return;
   }
   run_on_main([this, &state, &camera](lua_State* l) {
@@ -1489,7 +1489,7 @@ void LuaContext::state_on_map_finished(CustomState& state) {
  */
 void LuaContext::state_on_position_changed(CustomState& state, const Point& xy, int layer) {
 
-  if (!userdata_has_field(state, "on_position_changed")) {
+  if (!userdata_has_event(state, LuaEvent::ON_POSITION_CHANGED)) {
     return;
   }
   run_on_main([this, &state, xy, layer](lua_State* l) {
@@ -1571,7 +1571,7 @@ void LuaContext::state_on_movement_started(CustomState& state, Movement& movemen
  */
 void LuaContext::state_on_movement_changed(CustomState& state, Movement& movement) {
 
-  if (!userdata_has_field(state, "on_movement_changed")) {
+  if (!userdata_has_event(state, LuaEvent::ON_MOVEMENT_CHANGED)) {
     return;
   }
 
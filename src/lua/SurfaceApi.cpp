@@ -230,9 +230,22 @@ int LuaContext::surface_api_get_pixels(lua_State* l) {
 
   return state_boundary_handle(l, [&] {
     Surface& surface = *check_surface(l, 1);
-    // TODO optional parameters x, y, width, height
 
-    push_string(l, surface.get_pixels());
+    if (lua_gettop(l) >= 2) {
+      int x = LuaTools::check_int(l, 2);
+      int y = LuaTools::check_int(l, 3);
+      int width = LuaTools::check_int(l, 4);
+      int height = LuaTools::check_int(l, 5);
+      Rectangle region(x, y, width, height);
+      if (width <= 0 || height <= 0 ||
+          !Rectangle(surface.get_size()).contains(region)) {
+        LuaTools::arg_error(l, 2, "Region is outside the surface");
+      }
+      push_string(l, surface.get_pixels(region));
+    }
+    else {
+      push_string(l, surface.get_pixels());
+    }
     return 1;
   });
 }
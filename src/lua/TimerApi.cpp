@@ -25,6 +25,8 @@
 #include "solarus/lua/ExportableToLuaPtr.h"
 #include "solarus/lua/LuaContext.h"
 #include "solarus/lua/LuaTools.h"
+#include <algorithm>
+#include <functional>
 #include <list>
 #include <sstream>
 
@@ -130,6 +132,7 @@ void LuaContext::add_timer(
 
   timers[timer].callback_ref = callback_ref;
   timers[timer].context = context;
+  timers[timer].creation_order = timer_creation_order++;
 
   Game* game = main_loop.get_game();
   if (game != nullptr) {
@@ -168,6 +171,8 @@ void LuaContext::add_timer(
       timer->set_suspended(initially_suspended);
     }
   }
+
+  schedule_timer(timer);
 }
 
 /**
@@ -206,24 +211,94 @@ void LuaContext::remove_timers(int context_index) {
  */
 void LuaContext::destroy_timers() {
   timers.clear();
+  timer_queue.clear();
+}
+
+/**
+ * \brief Puts a timer in the timer queue at the date of its next update.
+ *
+ * This must be called when a timer starts, is resumed or when its dates
+ * change.
+ * Does nothing if the timer is suspended, removed or already in the queue
+ * at this date.
+ *
+ * \param timer A timer.
+ */
+void LuaContext::schedule_timer(const TimerPtr& timer) {
+
+  const auto it = timers.find(timer);
+  if (it == timers.end() ||
+      it->second.callback_ref.is_empty() ||
+      (timer->is_suspended() && !timer->is_finished())) {
+    return;
+  }
+
+  LuaTimerData& data = it->second;
+  const uint32_t date = timer->get_next_update_date();
+  if (data.scheduled && data.scheduled_date == date) {
+    return;
+  }
+
+  // A previous entry with another date becomes obsolete.
+  data.scheduled = true;
+  data.scheduled_date = date;
+  timer_queue.push_back({ date, data.creation_order, timer });
+  std::push_heap(timer_queue.begin(), timer_queue.end(),
+      std::greater<TimerQueueEntry>());
 }
 
 /**
- * \brief Updates all timers currently running for this script.
+ * \brief Updates the timers currently running for this script.
+ *
+ * Only timers whose expiration date or clock sound date is reached
+ * are updated.
  */
 void LuaContext::update_timers() {
 
-  // Update all timers.
-  for (const auto& kvp: timers) {
+  // Take the timers that need an update.
+  // Timers scheduled again by callbacks wait for the next cycle.
+  const uint32_t now = System::now();
+  std::vector<TimerPtr> timers_to_update;
+  while (!timer_queue.empty() && timer_queue.front().date <= now) {
+
+    std::pop_heap(timer_queue.begin(), timer_queue.end(),
+        std::greater<TimerQueueEntry>());
+    const TimerQueueEntry entry = std::move(timer_queue.back());
+    timer_queue.pop_back();
+
+    const auto it = timers.find(entry.timer);
+    if (it == timers.end() ||
+        !it->second.scheduled ||
+        it->second.scheduled_date != entry.date) {
+      // Obsolete entry.
+      continue;
+    }
+    it->second.scheduled = false;
+    timers_to_update.push_back(entry.timer);
+  }
 
-    const TimerPtr& timer = kvp.first;
-    const ScopedLuaRef& callback_ref = kvp.second.callback_ref;
-    if (!callback_ref.is_empty()) {
-      // The timer is not being removed: update it.
-      timer->update();
-      if (timer->is_finished()) {
-        do_timer_callback(timer);
-      }
+  for (const TimerPtr& timer: timers_to_update) {
+
+    const auto it = timers.find(timer);
+    if (it == timers.end() || it->second.callback_ref.is_empty()) {
+      // The timer is being removed.
+      continue;
+    }
+    timer->update();
+    if (timer->is_finished()) {
+      do_timer_callback(timer);
+    }
+    schedule_timer(timer);
+  }
+
+  // Drop obsolete entries if there are too many of them.
+  if (timer_queue.size() > 2 * timers.size() + 64) {
+    timer_queue.clear();
+    for (auto& kvp: timers) {
+      kvp.second.scheduled = false;
+    }
+    for (const auto& kvp: timers) {
+      schedule_timer(kvp.first);
     }
   }
 
@@ -258,6 +333,7 @@ void LuaContext::notify_timers_map_suspended(bool suspended) {
     }
     if (timer->is_suspended_with_map()) {
       timer->set_suspended(suspended);
+      schedule_timer(timer);
     }
     lua_pop(current_l, 1);
   }
@@ -282,6 +358,7 @@ void LuaContext::set_entity_timers_suspended_as_map(
 
       if (!suspended) {
         timer->set_suspended(false);
+        schedule_timer(timer);
       }
       else {
         // Suspend timers except the ones that ignore the map being suspended.
@@ -347,6 +424,7 @@ void LuaContext::do_timer_callback(const TimerPtr& timer) {
           // the main loop stepsize.
           do_timer_callback(timer);
         }
+        schedule_timer(timer);
       }
       else {
         callback_ref.clear();
@@ -497,6 +575,7 @@ int LuaContext::timer_api_set_with_sound(lua_State* l) {
     bool with_sound = LuaTools::opt_boolean(l, 2, true);
 
     timer->set_with_sound(with_sound);
+    get().schedule_timer(timer);
 
     return 0;
   });
@@ -529,6 +608,7 @@ int LuaContext::timer_api_set_suspended(lua_State* l) {
     bool suspended = LuaTools::opt_boolean(l, 2, true);
 
     timer->set_suspended(suspended);
+    get().schedule_timer(timer);
 
     return 0;
   });
@@ -571,6 +651,7 @@ int LuaContext::timer_api_set_suspended_with_map(lua_State* l) {
       // If the game is running, suspend/resume the timer like the map.
       timer->set_suspended(game->get_current_map().is_suspended());
     }
+    lua_context.schedule_timer(timer);
 
     return 0;
   });
@@ -627,6 +708,7 @@ int LuaContext::timer_api_set_remaining_time(lua_State* l) {
         // Execute the callback now.
         lua_context.do_timer_callback(timer);
       }
+      lua_context.schedule_timer(timer);
     }
 
     return 0;
@@ -61,23 +61,49 @@ void print_help(const Arguments& args) {
     << std::endl
     << "  -no-audio                     disables sounds and musics"
     << std::endl
+    << "  -sound-cache=yes|no           keeps sounds decoded by sol.audio.preload_sounds() in the quest write directory (default no)"
+    << std::endl
     << "  -no-video                     disables displaying"
     << std::endl
     << "  -quest-size=<width>x<height>  sets the size of the drawing area (if compatible with the quest)"
     << std::endl
+    << "  -texture-atlas=yes|no         packs small images into shared textures to draw them in fewer batches (default no)"
+    << std::endl
+    << "  -pipeline-pixel-filter=yes|no applies software video mode filters while the next frame is computed, one frame late (default no)"
+    << std::endl
+    << "  -render-stats=yes|no          logs the number of draw calls and batch breaks per frame every second (default no)"
+    << std::endl
+    << "  -tile-map-shader=yes|no       draws animated tiles of each layer in one pass with a shader, OpenGL only (default no)"
+    << std::endl
     << "  -lua-console=yes|no           accepts standard input lines as Lua commands (default yes)"
     << std::endl
+    << "  -lua-stats=yes|no             logs the number of skipped Lua callbacks per frame every second (default no)"
+    << std::endl
     << "  -turbo=yes|no                 runs as fast as possible rather than simulating real time (default no)"
     << std::endl
     << "  -lag=X                        slows down each frame of X milliseconds to simulate slower systems for debugging (default 0)"
     << std::endl
+    << "  -collision-broad-phase=yes|no checks collisions with detectors once per frame after all entities moved (default no)"
+    << std::endl
+    << "  -simulation-stats=yes|no      logs the number of entities asleep beyond their optimization distance every second (default no)"
+    << std::endl
+    << "  -preload-pixel-collisions=yes|no analyzes sprite images for pixel-precise collisions in background on start (default no)"
+    << std::endl
     << "  -cursor-visible=yes|no        sets the mouse cursor visibility on start (default leave unchanged)"
     << std::endl
     << "  -fullscreen=yes|no            sets fullscreen mode on start (default leave unchanged)"
     << std::endl
-    << "  -perf-sound-play=yes|no       enables performance reporting of sound playing (default no)"
+    << "  -profile=yes|no               records a frame profile of the engine (default no)"
+    << std::endl
+    << "  -profile-output=<file>        Chrome trace JSON file written when quitting (default solarus_profile.json)"
+    << std::endl
+    << "  -profile-frames=N             number of last frames kept by the profiler (default 300)"
+    << std::endl
+    << "  -profile-report=yes|no        logs the time spent in each profiled zone every second (default no)"
+    << std::endl
+    << "  -perf-sound-play=yes|no       same as -profile-report (deprecated)"
     << std::endl
-    << "  -perf-video-render=yes|no     enables performance reporting of video rendering, i.e. FPS (default no)"
+    << "  -perf-video-render=yes|no     same as -profile-report (deprecated)"
     << std::endl
     << "  -joypad-deadzone=<value>      sets the joypad axis deadzone between 0-32767 (default 10000)"
     << std::endl
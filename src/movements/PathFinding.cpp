@@ -18,7 +18,10 @@
 #include "solarus/core/Geometry.h"
 #include "solarus/core/Map.h"
 #include "solarus/entities/Entity.h"
+#include "solarus/entities/NavigationGrid.h"
 #include "solarus/movements/PathFinding.h"
+#include <algorithm>
+#include <cstdlib>
 #include <limits>
 
 namespace Solarus {
@@ -58,12 +61,47 @@ PathFinding::PathFinding(
     Entity& target_entity):
   map(map),
   source_entity(source_entity),
-  target_entity(target_entity) {
+  target_entity(target_entity),
+  max_nodes(default_max_nodes),
+  pool(get_node_pool()),
+  grid(map.get_entities().get_navigation_grid()),
+  ground_obstacles(0) {
 
   Debug::check_assertion(source_entity.is_aligned_to_grid(),
       "The source must be aligned on the map grid");
 }
 
+/**
+ * \brief Returns the node storage shared by all path computations.
+ * \return The node pool.
+ */
+PathFinding::NodePool& PathFinding::get_node_pool() {
+
+  static NodePool pool;
+  return pool;
+}
+
+/**
+ * \brief Returns the maximum number of nodes explored by a search.
+ * \return The node budget.
+ */
+int PathFinding::get_max_nodes() const {
+  return max_nodes;
+}
+
+/**
+ * \brief Sets the maximum number of nodes explored by a search.
+ *
+ * When the budget is exhausted, the target is considered as unreachable.
+ *
+ * \param max_nodes The node budget (must be positive).
+ */
+void PathFinding::set_max_nodes(int max_nodes) {
+
+  Debug::check_assertion(max_nodes > 0, "The node budget must be positive");
+  this->max_nodes = max_nodes;
+}
+
 /**
  * \brief Tries to find a path between the source point and the target point.
  * \return the path found, or an empty string if no path was found
@@ -106,127 +144,158 @@ std::string PathFinding::compute_path() {
  */
 std::string PathFinding::compute_path(const Point& offset) {
 
-  Point source = source_entity.get_bounding_box().get_xy();
+  const Point source = source_entity.get_bounding_box().get_xy();
   Point target = target_entity.get_bounding_box().get_xy() + offset;
 
-  // std::cout << "will compute a path from " << source << " to " << target << std::endl;
-
   target.x += 4;
   target.x += -target.x % 8;
   target.y += 4;
   target.y += -target.y % 8;
-  const int target_index = get_square_index(target);
 
   Debug::check_assertion(target.x % 8 == 0 && target.y % 8 == 0,
       "Could not snap the target to the map grid");
 
-  const int total_mdistance = Geometry::get_manhattan_distance(source, target);
-  if (total_mdistance > 200 || target_entity.get_layer() != source_entity.get_layer()) {
-    //std::cout << "too far, not computing a path\n";
-    return ""; // too far to compute a path
+  if (target_entity.get_layer() != source_entity.get_layer()) {
+    return "";
   }
 
-  std::string path = "";
+  const Rectangle map_box(map.get_size());
+  if (!map_box.contains(source) || !map_box.contains(target)) {
+    return "";
+  }
 
-  Node starting_node;
-  const int index = get_square_index(source);
-  starting_node.location = source;
-  starting_node.index = index;
-  starting_node.previous_cost = 0;
-  starting_node.heuristic = total_mdistance;
-  starting_node.total_cost = total_mdistance;
-  starting_node.direction = ' ';
-  starting_node.parent_index = -1;
+  // Each node explored makes at most one step towards the target.
+  const int min_steps = std::max(
+      std::abs(target.x - source.x),
+      std::abs(target.y - source.y)
+  ) / 8;
+  if (min_steps > max_nodes) {
+    return "";  // Too far to compute a path.
+  }
 
-  open_list.clear();
-  closed_list.clear();
-  open_list_indices.clear();
+  // See if the same path was computed recently, possibly for another entity
+  // with the same traversal rules.
+  const EntityType type = source_entity.get_type();
+  const NavigationGrid::PathQuery query = {
+      source_entity.get_layer(),
+      get_square_index(source),
+      get_square_index(target),
+      type,
+      type == EntityType::CUSTOM ? &source_entity : nullptr,
+      NavigationGrid::get_ground_obstacles(source_entity),
+      max_nodes
+  };
+  std::string path;
+  if (!grid.get_cached_path(query, path)) {
+    ground_obstacles = query.ground_obstacles;
+    path = search_path(source, target);
+    grid.set_cached_path(query, path);
+  }
+  return path;
+}
 
-  open_list[index] = starting_node;
-  open_list_indices.push_front(index);
+/**
+ * \brief Runs the A* algorithm between two squares of the map.
+ * \param source Top-left corner of the source square.
+ * \param target Top-left corner of the target square.
+ * \return the path found, or an empty string if no path was found
+ * (because there is no path or the node budget was exhausted)
+ */
+std::string PathFinding::search_path(const Point& source, const Point& target) {
+
+  const Rectangle map_box(map.get_size());
+  const int target_index = get_square_index(target);
 
-  bool finished = false;
-  while (!finished) {
+  // Start a new search: nodes stamped with an older generation are unvisited.
+  const size_t num_squares = static_cast<size_t>(map.get_width8() * map.get_height8());
+  if (pool.nodes.size() < num_squares) {
+    pool.nodes.resize(num_squares, Node());
+  }
+  ++pool.generation;
+  if (pool.generation == 0) {
+    // Wrapped around: old stamps would become valid again.
+    for (Node& node : pool.nodes) {
+      node.generation = 0;
+    }
+    pool.generation = 1;
+  }
+  pool.sequence = 0;
+  pool.open_heap.clear();
 
-    // pick the node with the lowest total cost in the open list
-    const int index = open_list_indices.front();
-    Node* current_node = &open_list[index];
-    open_list_indices.pop_front();
-    closed_list[index] = *current_node;
-    open_list.erase(index);
-    current_node = &closed_list[index];
+  const int source_index = get_square_index(source);
+  Node& starting_node = pool.nodes[source_index];
+  starting_node.generation = pool.generation;
+  starting_node.previous_cost = 0;
+  starting_node.heuristic = Geometry::get_manhattan_distance(source, target);
+  starting_node.total_cost = starting_node.heuristic;
+  starting_node.parent_index = -1;
+  starting_node.direction = ' ';
+  open_list_push(source_index);
 
-    //std::cout << System::now() << " picking the lowest cost node in the open list ("
-    //  << (open_list_indices.size() + 1) << " elements): "
-    //  << current_node->location << ", index = " << current_node->index
-    //  << ", cost = " << current_node->previous_cost << " + " << current_node->heuristic << "\n";
+  int num_closed_nodes = 0;
+  while (!pool.open_heap.empty()) {
 
+    // Pick the node with the lowest total cost in the open list.
+    const int index = open_list_pop();
     if (index == target_index) {
-      //std::cout << "target node was added to the closed list\n";
-      finished = true;
-      path = rebuild_path(current_node);
-      //std::cout << "rebuild done\n";
+      return rebuild_path(index);
     }
-    else {
-      // look at the accessible nodes from it
-      //std::cout << System::now() << " looking for accessible states\n";
-      for (int i = 0; i < 8; i++) {
-
-        Node new_node;
-        const int immediate_cost = (i & 1) ? 11 : 8;
-        new_node.previous_cost = current_node->previous_cost + immediate_cost;
-        new_node.location = current_node->location;
-        new_node.location += neighbours_locations[i];
-        new_node.index = get_square_index(new_node.location);
-        //std::cout << "  node in direction " << i << ": index = " << new_node.index << std::endl;
-
-        const bool in_closed_list = (closed_list.find(new_node.index) != closed_list.end());
-        if (!in_closed_list && Geometry::get_manhattan_distance(new_node.location, target) < 200
-            && is_node_transition_valid(*current_node, i)) {
-          //std::cout << "  node in direction " << i << " is not in the closed list\n";
-          // not in the closed list: look in the open list
-
-          const bool in_open_list = open_list.find(new_node.index) != open_list.end();
-
-          if (!in_open_list) {
-            // not in the open list: add it
-            new_node.heuristic = Geometry::get_manhattan_distance(new_node.location, target);
-            new_node.total_cost = new_node.previous_cost + new_node.heuristic;
-            new_node.parent_index = index;
-            new_node.direction = '0' + i;
-            open_list[new_node.index] = new_node;
-            add_index_sorted(&open_list[new_node.index]);
-            //std::cout << "  node in direction " << i << " is not in the open list, adding it with cost "
-            //  << new_node.previous_cost << " (" << current_node->previous_cost << " + "
-            //  << immediate_cost << ") + " << new_node.heuristic << " and parent " << new_node.parent_index << "\n";
-          }
-          else {
-            //std::cout << "  node in direction " << i << " is already in the open list\n";
-            Node* existing_node = &open_list[new_node.index];
-            // already in the open list: see if the current path is better
-            if (new_node.previous_cost < existing_node->previous_cost) {
-              existing_node->previous_cost = new_node.previous_cost;
-              existing_node->total_cost = existing_node->previous_cost + existing_node->heuristic;
-              existing_node->parent_index = index;
-              open_list_indices.sort();
-            }
-          }
-        }
-        else {
-          //std::cout << "skipping node in direction " << i << ": already in closed list = "
-          //  << in_closed_list << ", too far from target = "
-          //  << (get_manhattan_distance(new_node.location, target) >= 200) << ", invalid transition = "
-          //  << (!is_node_transition_valid(*current_node, i)) << std::endl;
-        }
+
+    ++num_closed_nodes;
+    if (num_closed_nodes > max_nodes) {
+      return "";  // Node budget exhausted.
+    }
+
+    const Point location = get_square_location(index);
+    const int previous_cost = pool.nodes[index].previous_cost;
+
+    // Look at the accessible nodes from it.
+    for (int i = 0; i < 8; i++) {
+
+      const Point new_location = location + neighbours_locations[i];
+      if (!map_box.contains(new_location)) {
+        continue;
       }
-      if (open_list_indices.empty()) {
-        finished = true;
+
+      const int new_index = get_square_index(new_location);
+      Node& new_node = pool.nodes[new_index];
+      const bool visited = new_node.generation == pool.generation;
+      if (visited && new_node.heap_position == -1) {
+        // Already in the closed list.
+        continue;
+      }
+
+      const int immediate_cost = (i & 1) ? 11 : 8;
+      const int new_cost = previous_cost + immediate_cost;
+      if (visited && new_cost >= new_node.previous_cost) {
+        // Already in the open list with a better path.
+        continue;
+      }
+
+      if (!is_node_transition_valid(location, i)) {
+        continue;
+      }
+
+      new_node.previous_cost = new_cost;
+      new_node.parent_index = index;
+      new_node.direction = '0' + i;
+      if (!visited) {
+        // Not in the open list: add it.
+        new_node.generation = pool.generation;
+        new_node.heuristic = Geometry::get_manhattan_distance(new_location, target);
+        new_node.total_cost = new_cost + new_node.heuristic;
+        open_list_push(new_index);
+      }
+      else {
+        // Already in the open list: the current path is better.
+        new_node.total_cost = new_cost + new_node.heuristic;
+        new_node.sequence = ++pool.sequence;
+        open_list_sift_up(new_node.heap_position);
       }
     }
   }
 
-  //std::cout << "path found: " << path << ", open nodes: " << open_list.size() << ", closed nodes: " << closed_list.size() << std::endl;
-  return path;
+  return "";
 }
 
 /**
@@ -243,69 +312,195 @@ int PathFinding::get_square_index(const Point& location) const {
 }
 
 /**
- * \brief Compares two nodes according to their total estimated cost.
- * \param other the other node
+ * \brief Returns the location of a node from its square index.
+ * \param index index of an 8*8 square of the map
+ * \return the top-left corner of this square
+ */
+Point PathFinding::get_square_location(int index) const {
+
+  const int width8 = map.get_width8();
+  return Point((index % width8) * 8, (index / width8) * 8);
+}
+
+/**
+ * \brief Returns whether a node should be picked before another one
+ * from the open list.
+ *
+ * Nodes are compared according to their total estimated cost, then
+ * to their heuristic. Remaining ties are broken in favor of the node most
+ * recently added or improved.
+ *
+ * \param first_index index of a node in the open list
+ * \param second_index index of another node in the open list
+ * \return \c true if the first node has priority
+ */
+bool PathFinding::is_better(int first_index, int second_index) const {
+
+  const Node& first = pool.nodes[first_index];
+  const Node& second = pool.nodes[second_index];
+  if (first.total_cost != second.total_cost) {
+    return first.total_cost < second.total_cost;
+  }
+  if (first.heuristic != second.heuristic) {
+    return first.heuristic < second.heuristic;
+  }
+  return first.sequence > second.sequence;
+}
+
+/**
+ * \brief Adds a node to the open list.
+ * \param index index of the node to add
  */
-bool PathFinding::Node::operator<(const Node& other) const {
-  return total_cost < other.total_cost;
+void PathFinding::open_list_push(int index) {
+
+  Node& node = pool.nodes[index];
+  node.sequence = ++pool.sequence;
+  node.heap_position = static_cast<int>(pool.open_heap.size());
+  pool.open_heap.push_back(index);
+  open_list_sift_up(node.heap_position);
 }
 
 /**
- * \brief Adds the index of a node to the sorted list of indices of the open
- * list, making sure that the list remains sorted.
- * \param node The node.
+ * \brief Removes the node with the highest priority from the open list
+ * and puts it in the closed list.
+ * \return index of this node
  */
-void PathFinding::add_index_sorted(Node* node) {
-
-  bool inserted = false;
-  for (auto it = open_list_indices.begin();
-      it != open_list_indices.end() && !inserted;
-      ++it) {
-    const int index = *it;
-    const Node* current_node = &open_list[index];
-    if (current_node->total_cost >= node->total_cost) {
-      open_list_indices.insert(it, node->index);
-      inserted = true;
+int PathFinding::open_list_pop() {
+
+  const int index = pool.open_heap.front();
+  const int last_index = pool.open_heap.back();
+  pool.open_heap.pop_back();
+  if (!pool.open_heap.empty()) {
+    pool.open_heap[0] = last_index;
+    pool.nodes[last_index].heap_position = 0;
+    open_list_sift_down(0);
+  }
+  pool.nodes[index].heap_position = -1;
+  return index;
+}
+
+/**
+ * \brief Moves up an element of the open list heap until its parent has
+ * priority over it.
+ * \param position position of the element in the heap
+ */
+void PathFinding::open_list_sift_up(int position) {
+
+  std::vector<int>& heap = pool.open_heap;
+  const int index = heap[position];
+  while (position > 0) {
+    const int parent_position = (position - 1) / 2;
+    const int parent_index = heap[parent_position];
+    if (!is_better(index, parent_index)) {
+      break;
     }
+    heap[position] = parent_index;
+    pool.nodes[parent_index].heap_position = position;
+    position = parent_position;
   }
+  heap[position] = index;
+  pool.nodes[index].heap_position = position;
+}
 
-  if (!inserted) {
-    open_list_indices.push_back(node->index);
+/**
+ * \brief Moves down an element of the open list heap until it has priority
+ * over its children.
+ * \param position position of the element in the heap
+ */
+void PathFinding::open_list_sift_down(int position) {
+
+  std::vector<int>& heap = pool.open_heap;
+  const int size = static_cast<int>(heap.size());
+  const int index = heap[position];
+  while (true) {
+    int child_position = 2 * position + 1;
+    if (child_position >= size) {
+      break;
+    }
+    if (child_position + 1 < size &&
+        is_better(heap[child_position + 1], heap[child_position])) {
+      ++child_position;
+    }
+    const int child_index = heap[child_position];
+    if (!is_better(child_index, index)) {
+      break;
+    }
+    heap[position] = child_index;
+    pool.nodes[child_index].heap_position = position;
+    position = child_position;
   }
+  heap[position] = index;
+  pool.nodes[index].heap_position = position;
 }
 
 /**
  * \brief Builds the string representation of the path found by the algorithm.
- * \param closed_list The closed list of A*.
- * \return final_node The final node of the path.
+ * \param final_index Index of the final node of the path.
+ * \return The path.
  */
-std::string PathFinding::rebuild_path(const Node* final_node) {
-
-  const Node* current_node = final_node;
-  std::string path = "";
-  while (current_node->direction != ' ') {
-    path = current_node->direction + path;
-    current_node = &closed_list[current_node->parent_index];
-    //std::cout << "current_node: " << current_node->index << ", path = " << path << std::endl;
+std::string PathFinding::rebuild_path(int final_index) const {
+
+  std::string path;
+  int index = final_index;
+  while (pool.nodes[index].direction != ' ') {
+    path += pool.nodes[index].direction;
+    index = pool.nodes[index].parent_index;
   }
+  std::reverse(path.begin(), path.end());
   return path;
 }
 
 /**
  * \brief Returns whether a transition between two nodes is valid, i.e.
  * whether there is no collision with the map.
- * \param initial_node the first node
+ *
+ * The navigation grid answers directly for most transitions.
+ * Only squares that it does not know are tested precisely.
+ *
+ * \param location location of the first node
  * \param direction the direction to take (0 to 7)
  * \return true if there is no collision for this transition
  */
 bool PathFinding::is_node_transition_valid(
-    const Node& initial_node, int direction) const {
+    const Point& location, int direction) const {
 
   Rectangle collision_box = transition_collision_boxes[direction];
-  collision_box.add_xy(initial_node.location);
+  collision_box.add_xy(location);
+  const int layer = source_entity.get_layer();
+
+  // The grid does not ignore the own ground of the entity.
+  if (!source_entity.is_ground_modifier()) {
+    // Like Map::test_collision_with_obstacles(), only check the ground
+    // on the border of the box, but entities on the whole box.
+    const int x8_min = collision_box.get_x() >> 3;
+    const int y8_min = collision_box.get_y() >> 3;
+    const int x8_max = x8_min + collision_box.get_width() / 8 - 1;
+    const int y8_max = y8_min + collision_box.get_height() / 8 - 1;
+    bool known = true;
+    for (int y8 = y8_min; y8 <= y8_max; ++y8) {
+      for (int x8 = x8_min; x8 <= x8_max; ++x8) {
+        const bool border = x8 == x8_min || x8 == x8_max ||
+            y8 == y8_min || y8 == y8_max;
+        switch (grid.get_walkability(layer, x8, y8, ground_obstacles, border)) {
+
+        case NavigationGrid::Walkability::BLOCKED:
+          return false;
+
+        case NavigationGrid::Walkability::UNKNOWN:
+          known = false;
+          break;
+
+        case NavigationGrid::Walkability::FREE:
+          break;
+        }
+      }
+    }
+    if (known) {
+      return true;
+    }
+  }
 
-  return !map.test_collision_with_obstacles(source_entity.get_layer(), collision_box, source_entity);
+  return !map.test_collision_with_obstacles(layer, collision_box, source_entity);
 }
 
 }
-
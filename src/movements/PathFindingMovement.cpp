@@ -31,7 +31,8 @@ namespace Solarus {
 PathFindingMovement::PathFindingMovement(int speed):
   PathMovement("", speed, false, false, true),
   target(),
-  next_recomputation_date(0) {
+  next_recomputation_date(0),
+  max_nodes(PathFinding::default_max_nodes) {
 
 }
 
@@ -44,6 +45,26 @@ void PathFindingMovement::set_target(const EntityPtr& target) {
   next_recomputation_date = System::now() + 100;
 }
 
+/**
+ * \brief Returns the maximum number of nodes explored when computing a path.
+ * \return The node budget of the path finding algorithm.
+ */
+int PathFindingMovement::get_max_nodes() const {
+  return max_nodes;
+}
+
+/**
+ * \brief Sets the maximum number of nodes explored when computing a path.
+ *
+ * A target that cannot be reached within this budget is considered as
+ * too far, and the movement becomes a random walk.
+ *
+ * \param max_nodes The node budget of the path finding algorithm.
+ */
+void PathFindingMovement::set_max_nodes(int max_nodes) {
+  this->max_nodes = max_nodes;
+}
+
 /**
  * \brief Updates the position.
  */
@@ -81,6 +102,7 @@ void PathFindingMovement::recompute_movement() {
 
   if (target != nullptr) {
     PathFinding path_finding(get_entity()->get_map(), *get_entity(), *target);
+    path_finding.set_max_nodes(max_nodes);
     std::string path = path_finding.compute_path();
 
     uint32_t min_delay;
@@ -71,7 +71,7 @@
 #define PIXEL11_90    *(dp+dpL+1) = Interp9(w[5], w[6], w[8]);
 #define PIXEL11_100   *(dp+dpL+1) = Interp10(w[5], w[6], w[8]);
 
-HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+HQX_API void HQX_CALLCONV hq2x_32_rows_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres, int firstRow, int lastRow )
 {
     int  i, j, k;
     int  prevline, nextline;
@@ -93,7 +93,14 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     //   | w7 | w8 | w9 |
     //   +----+----+----+
 
-    for (j=0; j<Yres; j++)
+    // Start at the first row requested, neighbors are still read
+    // from the whole image.
+    sRowP += firstRow * srb;
+    sp = (uint32_t *) sRowP;
+    dRowP += firstRow * drb * 2;
+    dp = (uint32_t *) dRowP;
+
+    for (j=firstRow; j<lastRow; j++)
     {
         if (j>0)      prevline = -spL; else prevline = 0;
         if (j<Yres-1) nextline =  spL; else nextline = 0;
@@ -2802,8 +2809,19 @@ HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp
     }
 }
 
+HQX_API void HQX_CALLCONV hq2x_32_rb( uint32_t * sp, uint32_t srb, uint32_t * dp, uint32_t drb, int Xres, int Yres )
+{
+    hq2x_32_rows_rb(sp, srb, dp, drb, Xres, Yres, 0, Yres);
+}
+
 HQX_API void HQX_CALLCONV hq2x_32( uint32_t * sp, uint32_t * dp, int Xres, int Yres )
 {
     uint32_t rowBytesL = Xres * 4;
     hq2x_32_rb(sp, rowBytesL, dp, rowBytesL * 2, Xres, Yres);
 }
+
+HQX_API void HQX_CALLCONV hq2x_32_rows( uint32_t * sp, uint32_t * dp, int Xres, int Yres, int firstRow, int lastRow )
+{
+    uint32_t rowBytesL = Xres * 4;
+    hq2x_32_rows_rb(sp, rowBytesL, dp, rowBytesL * 2, Xres, Yres, firstRow, lastRow);
+}
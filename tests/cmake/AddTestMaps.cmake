@@ -3,10 +3,15 @@ list(APPEND LUA_TEST_MAPS
   "all_entities"
   "basic_test"
   "dynamic_tile_tests"
+  "entity_optimization_tests"
   "jumper_tests"
+  "lua_event_tests"
+  "savegame_tests"
   "surface_tests"
   "oriented_collisions"
   "text_predict"
+  "tile_map_tests"
+  "timer_tests"
   "custom_state/can_traverse"
   "custom_state/can_traverse_ground"
   "custom_state/carried_object"
@@ -172,3 +177,8 @@ list(APPEND LUA_TEST_MAPS_REQUIRE_WINDOW
   "bugs/1200_create_shader_from_source"
   "bugs/1210_shader_scaling_factor"
 )
+
+# Tests that are also run with the tile map shader, which requires showing the window
+list(APPEND LUA_TEST_MAPS_TILE_MAP_SHADER
+  "tile_map_tests"
+)
@@ -1,13 +1,21 @@
 # Sources in the 'src/tests' directory that are a test with a main() function
 list(APPEND TEST_SOURCES
+  src/tests/CompiledData.cpp
+  src/tests/DataFileBuffer.cpp
+  src/tests/FlatStringMap.cpp
   src/tests/Initialization.cpp
   src/tests/MapData.cpp
   src/tests/LanguageData.cpp
   src/tests/PathFinding.cpp
   src/tests/PathMovement.cpp
+  src/tests/PcmRingBuffer.cpp
+  src/tests/PixelBits.cpp
+  src/tests/PixelFilters.cpp
   src/tests/PixelMovement.cpp
   src/tests/Quadtree.cpp
+  src/tests/SkylinePacker.cpp
   src/tests/SpriteData.cpp
+  src/tests/TextureAtlas.cpp
   src/tests/TilesetData.cpp
   src/tests/ShaderData.cpp
   src/tests/LuaMap.cpp
@@ -62,6 +70,14 @@ foreach(TEST_SOURCE ${TEST_SOURCES})
     foreach(MAP_ID ${LUA_TEST_MAPS_REQUIRE_WINDOW})
       _add_test("lua/${MAP_ID}" "bin/${TEST_TARGET}" -no-audio -turbo=yes "-map=${MAP_ID}" "${CMAKE_CURRENT_SOURCE_DIR}/testing_quest")
     endforeach()
+
+    # Lua map test: add an individual test for each map to run with the tile map shader
+    foreach(MAP_ID ${LUA_TEST_MAPS_TILE_MAP_SHADER})
+      _add_test("lua/tile_map_shader/${MAP_ID}" "bin/${TEST_TARGET}" -no-audio -turbo=yes -tile-map-shader=yes "-map=${MAP_ID}" "${CMAKE_CURRENT_SOURCE_DIR}/testing_quest")
+    endforeach()
+  elseif (${TEST_NAME} STREQUAL "texture-atlas")
+    # Texture atlas test: requires a window to use the GL renderer
+    _add_test("${TEST_NAME}" "bin/${TEST_TARGET}" -no-audio -turbo=yes -texture-atlas=yes "${CMAKE_CURRENT_SOURCE_DIR}/testing_quest")
   else()
     # Standard C++ test: for engine testing
     _add_test("${TEST_NAME}" "bin/${TEST_TARGET}" -no-audio -no-video -turbo=yes "${CMAKE_CURRENT_SOURCE_DIR}/testing_quest")
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/CurrentQuest.h"
+#include "solarus/core/Debug.h"
+#include "solarus/core/MapData.h"
+#include "solarus/core/QuestDatabase.h"
+#include "solarus/core/QuestFiles.h"
+#include "solarus/entities/TilesetData.h"
+#include "solarus/graphics/SpriteData.h"
+#include "solarus/lua/CompiledLuaData.h"
+#include "tools/TestEnvironment.h"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that a data file gives the same data when loaded
+ * from its compiled form.
+ */
+template<typename Data>
+void check_file(const std::string& file_name) {
+
+  const std::string& source = QuestFiles::data_file_read(file_name);
+
+  CompiledLuaData compiled;
+  bool success = compiled.compile(source, file_name);
+  Debug::check_assertion(success, "Compilation failed: " + file_name);
+  std::string compiled_buffer;
+  success = compiled.export_to_buffer(compiled_buffer);
+  Debug::check_assertion(success, "Compiled export failed: " + file_name);
+
+  Debug::check_assertion(CompiledLuaData::is_up_to_date(compiled_buffer, source),
+      "Compiled file should be up to date: " + file_name);
+  Debug::check_assertion(!CompiledLuaData::is_up_to_date(compiled_buffer, source + "\n"),
+      "Compiled file should be outdated: " + file_name);
+
+  CompiledLuaData imported_compiled;
+  success = imported_compiled.import_from_buffer(compiled_buffer, file_name + "c");
+  Debug::check_assertion(success, "Compiled import failed: " + file_name);
+  Debug::check_assertion(imported_compiled.get_source_hash() == compiled.get_source_hash(),
+      "Wrong source hash: " + file_name);
+
+  Data data;
+  success = data.import_from_buffer(source, file_name);
+  Debug::check_assertion(success, "Import failed: " + file_name);
+  Data compiled_data;
+  success = compiled_data.import_from_compiled(imported_compiled);
+  Debug::check_assertion(success, "Import from compiled data failed: " + file_name);
+
+  std::string exported_buffer;
+  std::string compiled_exported_buffer;
+  data.export_to_buffer(exported_buffer);
+  compiled_data.export_to_buffer(compiled_exported_buffer);
+  Debug::check_assertion(exported_buffer == compiled_exported_buffer,
+      "Compiled data differs: " + file_name);
+}
+
+/**
+ * \brief Checks all data files of a resource type.
+ */
+template<typename Data>
+void check_resources(ResourceType resource_type, const std::string& directory) {
+
+  const std::map<std::string, std::string>& elements =
+      CurrentQuest::get_database().get_resource_elements(resource_type);
+  Debug::check_assertion(!elements.empty(), "No " + directory);
+  for (const auto& kvp : elements) {
+    check_file<Data>(directory + "/" + kvp.first + ".dat");
+  }
+}
+
+/**
+ * \brief Appends a little-endian 32-bit value to a buffer.
+ */
+void append_uint32(std::string& buffer, uint32_t value) {
+
+  for (int i = 0; i < 4; ++i) {
+    buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xff));
+  }
+}
+
+/**
+ * \brief Creates a compiled file with one call whose argument is a chain
+ * of nested tables.
+ * \param header Magic, version and source hash of a valid compiled file.
+ * \param depth Number of nested tables.
+ */
+std::string make_nested_tables_file(const std::string& header, uint32_t depth) {
+
+  const uint32_t table_type = 5u << 28;
+  const uint32_t string_type = 4u << 28;
+
+  std::string buffer = header;
+  append_uint32(buffer, 2);  // Strings: the key and the function name.
+  append_uint32(buffer, 1);
+  buffer += 'k';
+  append_uint32(buffer, 1);
+  buffer += 'f';
+  append_uint32(buffer, 0);  // Numbers.
+
+  // Each table contains the previous one.
+  append_uint32(buffer, depth);
+  append_uint32(buffer, 0);
+  append_uint32(buffer, 0);
+  for (uint32_t i = 1; i < depth; ++i) {
+    append_uint32(buffer, (i - 1) * 2);
+    append_uint32(buffer, 1);
+  }
+  append_uint32(buffer, (depth - 1) * 2);
+  for (uint32_t i = 1; i < depth; ++i) {
+    append_uint32(buffer, string_type | 0);
+    append_uint32(buffer, table_type | (i - 1));
+  }
+
+  append_uint32(buffer, 1);  // Calls.
+  append_uint32(buffer, 1);
+  append_uint32(buffer, 0);
+  append_uint32(buffer, 1);
+  append_uint32(buffer, 1);  // Arguments.
+  append_uint32(buffer, table_type | (depth - 1));
+  return buffer;
+}
+
+/**
+ * \brief Checks that invalid compiled files are rejected.
+ */
+void check_invalid_files() {
+
+  const std::string& source = QuestFiles::data_file_read("maps/basic_test.dat");
+  CompiledLuaData compiled;
+  compiled.compile(source, "maps/basic_test.dat");
+  std::string buffer;
+  compiled.export_to_buffer(buffer);
+
+  Debug::set_die_on_error(false);
+  CompiledLuaData imported;
+  Debug::check_assertion(!imported.import_from_buffer(buffer.substr(0, buffer.size() - 1), "truncated"),
+      "Truncated compiled file was accepted");
+  Debug::check_assertion(!imported.import_from_buffer(buffer + '\0', "too long"),
+      "Compiled file with trailing bytes was accepted");
+  std::string wrong_version = buffer;
+  wrong_version[4] = 2;
+  Debug::check_assertion(!imported.import_from_buffer(wrong_version, "wrong version"),
+      "Compiled file with another version was accepted");
+  Debug::check_assertion(!compiled.compile("tile{ x = function() end }", "function"),
+      "Function value was compiled");
+  const std::string& header = buffer.substr(0, 16);
+  Debug::check_assertion(imported.import_from_buffer(make_nested_tables_file(header, 32), "deep"),
+      "Compiled file with nested tables was rejected");
+  Debug::check_assertion(!imported.import_from_buffer(make_nested_tables_file(header, 100000), "too deep"),
+      "Compiled file with too deep tables was accepted");
+  Debug::set_die_on_error(true);
+}
+
+/**
+ * \brief Measures the time to load a large map from Lua and from
+ * its compiled form.
+ */
+void benchmark() {
+
+  using Clock = std::chrono::steady_clock;
+  const int num_tiles = 5000;
+  const int num_rounds = 10;
+
+  std::ostringstream oss;
+  oss << "properties{\n  x = 0,\n  y = 0,\n  width = 1600,\n  height = 1600,\n"
+      << "  min_layer = 0,\n  max_layer = 2,\n  tileset = \"castle\",\n}\n\n";
+  for (int i = 0; i < num_tiles; ++i) {
+    oss << "tile{\n  layer = " << (i % 3) << ",\n  x = " << (i % 100) * 16
+        << ",\n  y = " << (i / 100) * 16 << ",\n  width = 16,\n  height = 16,\n"
+        << "  pattern = \"" << (i % 20) << "\",\n}\n\n";
+  }
+  const std::string& source = oss.str();
+
+  CompiledLuaData compiled;
+  compiled.compile(source, "benchmark");
+  std::string compiled_buffer;
+  compiled.export_to_buffer(compiled_buffer);
+
+  const Clock::time_point lua_start = Clock::now();
+  for (int round = 0; round < num_rounds; ++round) {
+    MapData map_data;
+    map_data.import_from_buffer(source, "benchmark");
+  }
+  const Clock::time_point compiled_start = Clock::now();
+  for (int round = 0; round < num_rounds; ++round) {
+    CompiledLuaData imported;
+    imported.import_from_buffer(compiled_buffer, "benchmark");
+    MapData map_data;
+    map_data.import_from_compiled(imported);
+  }
+  const Clock::time_point end = Clock::now();
+
+  const double lua_ms = std::chrono::duration<double, std::milli>(compiled_start - lua_start).count() / num_rounds;
+  const double compiled_ms = std::chrono::duration<double, std::milli>(end - compiled_start).count() / num_rounds;
+  std::cout << "Map with " << num_tiles << " tiles: " << compiled_ms
+            << " ms compiled (" << compiled_buffer.size() << " bytes), "
+            << lua_ms << " ms from Lua (" << source.size() << " bytes)" << std::endl;
+}
+
+}
+
+/**
+ * \brief Tests loading compiled data files.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  check_resources<MapData>(ResourceType::MAP, "maps");
+  check_resources<TilesetData>(ResourceType::TILESET, "tilesets");
+  check_resources<SpriteData>(ResourceType::SPRITE, "sprites");
+  check_invalid_files();
+  benchmark();
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/QuestFiles.h"
+#include "tools/TestEnvironment.h"
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that reading a file as a buffer gives the same content
+ * as reading it as a string.
+ */
+void check_file(const std::string& file_name) {
+
+  const std::string& expected = QuestFiles::data_file_read(file_name);
+  const DataFileBufferPtr& buffer = QuestFiles::data_file_read_buffer(file_name);
+  Debug::check_assertion(buffer != nullptr, "Missing buffer: " + file_name);
+  Debug::check_assertion(buffer->size() == expected.size(), "Wrong size: " + file_name);
+  Debug::check_assertion(buffer->to_string() == expected, "Wrong content: " + file_name);
+}
+
+/**
+ * \brief Checks buffers of small files, read into recycled memory,
+ * and of large files, mapped when the quest is a directory.
+ */
+void check_directory(const std::string& dir_name) {
+
+  for (const std::string& file_name : QuestFiles::data_file_list_dir(dir_name)) {
+    const std::string& path = dir_name + "/" + file_name;
+    if (!QuestFiles::data_file_is_dir(path)) {
+      check_file(path);
+    }
+  }
+}
+
+/**
+ * \brief Checks that a preloaded file is given back once as a buffer.
+ */
+void check_preloaded_file() {
+
+  const std::string file_name = "maps/basic_test.dat";
+  const std::string& expected = QuestFiles::data_file_read(file_name);
+  QuestFiles::data_file_preload(file_name, "preloaded");
+  Debug::check_assertion(QuestFiles::data_file_read_buffer(file_name)->to_string() == "preloaded",
+      "Preloaded content was not used");
+  Debug::check_assertion(QuestFiles::data_file_read_buffer(file_name)->to_string() == expected,
+      "Preloaded content was used twice");
+}
+
+}
+
+/**
+ * \brief Tests reading data files without copying them.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  check_directory("maps");
+  check_directory("sprites");
+  check_directory("tilesets");
+  check_preloaded_file();
+
+  const DataFileBufferPtr& buffer = DataFileBuffer::create("content");
+  Debug::check_assertion(buffer->size() == 7 && buffer->to_string() == "content",
+      "Wrong string buffer");
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/containers/FlatStringMap.h"
+#include "solarus/core/Debug.h"
+#include "tools/TestEnvironment.h"
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Creates keys that look like savegame variables and entity names:
+ * a few common prefixes followed by a number.
+ */
+std::vector<std::string> make_keys(int num_keys) {
+
+  const char* prefixes[] = { "dungeon_", "possession_", "enemy_", "door_", "chest_", "npc_" };
+  std::vector<std::string> keys;
+  for (int i = 0; i < num_keys; ++i) {
+    keys.push_back(std::string(prefixes[i % 6]) + std::to_string(i / 6));
+  }
+  return keys;
+}
+
+/**
+ * \brief Checks that the map has the same elements as a std::map.
+ */
+void check_same_elements(
+    const FlatStringMap<int>& map,
+    const std::map<std::string, int>& expected) {
+
+  Debug::check_assertion(map.size() == expected.size(), "Wrong size");
+  size_t num_elements = 0;
+  for (const auto& kvp: map) {
+    const auto& it = expected.find(kvp.first);
+    Debug::check_assertion(it != expected.end(), "Unexpected key: " + kvp.first);
+    Debug::check_assertion(kvp.second == it->second, "Wrong value: " + kvp.first);
+    ++num_elements;
+  }
+  Debug::check_assertion(num_elements == expected.size(), "Wrong number of elements");
+}
+
+/**
+ * \brief Checks insertions, lookups and erasures against std::map,
+ * including erasures in the middle of collision chains.
+ */
+void test_operations(std::mt19937& random) {
+
+  const std::vector<std::string>& keys = make_keys(1000);
+  FlatStringMap<int> map;
+  std::map<std::string, int> expected;
+
+  Debug::check_assertion(map.empty(), "Map should be empty");
+  Debug::check_assertion(map.find("dungeon_0") == map.end(), "Unexpected key");
+  Debug::check_assertion(map.erase("dungeon_0") == 0, "Unexpected erasure");
+
+  for (int i = 0; i < 100000; ++i) {
+    const std::string& key = keys[random() % keys.size()];
+    switch (random() % 3) {
+
+      case 0:
+        map[key] = i;
+        expected[key] = i;
+        break;
+
+      case 1:
+        Debug::check_assertion(map.erase(key) == expected.erase(key), "Wrong erasure: " + key);
+        break;
+
+      default:
+      {
+        const auto& it = map.find(key);
+        const auto& expected_it = expected.find(key);
+        Debug::check_assertion((it == map.end()) == (expected_it == expected.end()),
+            "Wrong lookup: " + key);
+        if (it != map.end()) {
+          Debug::check_assertion(it->second == expected_it->second, "Wrong value: " + key);
+        }
+        break;
+      }
+    }
+  }
+  check_same_elements(map, expected);
+
+  const FlatStringMap<int> copy = map;
+  check_same_elements(copy, expected);
+
+  map.clear();
+  Debug::check_assertion(map.empty(), "Map should be empty after clear");
+  Debug::check_assertion(map.find(keys[0]) == map.end(), "Unexpected key after clear");
+  map.reserve(keys.size());
+  for (const std::string& key: keys) {
+    map[key] = 1;
+  }
+  Debug::check_assertion(map.size() == keys.size(), "Wrong size after reserve");
+}
+
+/**
+ * \brief Measures lookups with std::map and with FlatStringMap.
+ */
+void benchmark_lookups(std::mt19937& random) {
+
+  using Clock = std::chrono::steady_clock;
+  const int num_keys = 2000;
+  const int num_lookups = 1000000;
+  const std::vector<std::string>& keys = make_keys(num_keys);
+
+  std::map<std::string, int> tree_map;
+  FlatStringMap<int> flat_map;
+  for (int i = 0; i < num_keys; ++i) {
+    tree_map[keys[i]] = i;
+    flat_map[keys[i]] = i;
+  }
+  std::vector<int> lookups(num_lookups);
+  for (int& lookup: lookups) {
+    lookup = random() % num_keys;
+  }
+
+  long tree_sum = 0;
+  const Clock::time_point tree_start = Clock::now();
+  for (int lookup: lookups) {
+    tree_sum += tree_map.find(keys[lookup])->second;
+  }
+  long flat_sum = 0;
+  const Clock::time_point flat_start = Clock::now();
+  for (int lookup: lookups) {
+    flat_sum += flat_map.find(keys[lookup])->second;
+  }
+  const Clock::time_point end = Clock::now();
+  Debug::check_assertion(tree_sum == flat_sum, "Lookups found different values");
+
+  const double tree_ns = std::chrono::duration<double, std::nano>(flat_start - tree_start).count() / num_lookups;
+  const double flat_ns = std::chrono::duration<double, std::nano>(end - flat_start).count() / num_lookups;
+  std::cout << "Lookup among " << num_keys << " keys: " << flat_ns
+            << " ns (std::map: " << tree_ns << " ns)" << std::endl;
+}
+
+/**
+ * \brief Measures prefix queries with a linear scan of all names and with
+ * a sorted index of names, like Entities::get_entities_with_prefix().
+ */
+void benchmark_prefixes() {
+
+  using Clock = std::chrono::steady_clock;
+  const int num_keys = 2000;
+  const int num_rounds = 1000;
+  const std::vector<std::string>& keys = make_keys(num_keys);
+  const std::set<std::string> sorted_keys(keys.begin(), keys.end());
+  const std::string prefix = "chest_1";
+
+  size_t scan_count = 0;
+  const Clock::time_point scan_start = Clock::now();
+  for (int round = 0; round < num_rounds; ++round) {
+    for (const std::string& key: keys) {
+      if (key.compare(0, prefix.size(), prefix) == 0) {
+        ++scan_count;
+      }
+    }
+  }
+  size_t index_count = 0;
+  const Clock::time_point index_start = Clock::now();
+  for (int round = 0; round < num_rounds; ++round) {
+    for (auto it = sorted_keys.lower_bound(prefix);
+         it != sorted_keys.end() && it->compare(0, prefix.size(), prefix) == 0;
+         ++it) {
+      ++index_count;
+    }
+  }
+  const Clock::time_point end = Clock::now();
+  Debug::check_assertion(scan_count == index_count, "Prefix queries found different keys");
+
+  const double scan_us = std::chrono::duration<double, std::micro>(index_start - scan_start).count() / num_rounds;
+  const double index_us = std::chrono::duration<double, std::micro>(end - index_start).count() / num_rounds;
+  std::cout << "Prefix query among " << num_keys << " names: " << index_us
+            << " us (linear scan: " << scan_us << " us)" << std::endl;
+}
+
+}
+
+/**
+ * Tests and benchmarks for the flat string map.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  std::mt19937 random(42);
+  test_operations(random);
+  benchmark_lookups(random);
+  benchmark_prefixes();
+
+  return 0;
+}
@@ -49,6 +49,32 @@ void test_path_to_hero(TestEnvironment& env, Entity& entity) {
       std::string("Unexpected path: '") + path + "', expected '" + expected_path + "'");
 }
 
+/**
+ * \brief Checks that no path is found when the node budget is too small.
+ */
+void node_budget_test(TestEnvironment& env) {
+
+  CustomEntity& entity = *env.make_entity<CustomEntity>();
+  Hero& hero = env.get_hero();
+
+  entity.set_top_left_xy(144, 104);
+  entity.notify_position_changed();
+  hero.set_top_left_xy(200, 144);
+  hero.notify_position_changed();
+
+  PathFinding path_finder(env.get_map(), entity, hero);
+  path_finder.set_max_nodes(3);
+  std::string path = path_finder.compute_path();
+  Debug::check_assertion(path.empty(),
+      std::string("Unexpected path with a node budget of 3: '") + path + "'");
+
+  // The same computation with the default budget must succeed,
+  // even though the nodes of the previous search were not cleared.
+  path_finder.set_max_nodes(PathFinding::default_max_nodes);
+  path = path_finder.compute_path();
+  Debug::check_assertion(!path.empty(), "No path found with the default node budget");
+}
+
 /**
  * \brief Checks path finding on a custom entity towards a hero.
  */
@@ -59,6 +85,44 @@ void custom_entity_test(TestEnvironment& env) {
   test_path_to_hero(env, entity);
 }
 
+/**
+ * \brief Checks that entities of the same type with different traversal
+ * rules do not share cached paths.
+ */
+void traversal_rules_test(TestEnvironment& env) {
+
+  // An NPC between the source and the target.
+  Npc& npc = *env.make_entity<Npc>();
+  npc.set_top_left_xy(64, 32);
+  npc.notify_position_changed();
+
+  CustomEntity& target = *env.make_entity<CustomEntity>();
+  target.set_top_left_xy(96, 32);
+  target.notify_position_changed();
+
+  CustomEntity& entity = *env.make_entity<CustomEntity>();
+  entity.set_top_left_xy(32, 32);
+  entity.notify_position_changed();
+  entity.set_can_traverse_entities(EntityType::NPC, true);
+
+  CustomEntity& other_entity = *env.make_entity<CustomEntity>();
+  other_entity.set_top_left_xy(32, 32);
+  other_entity.notify_position_changed();
+  other_entity.set_can_traverse_entities(EntityType::NPC, false);
+
+  PathFinding path_finder(env.get_map(), entity, target);
+  std::string path = path_finder.compute_path();
+  std::string expected_path = "00000000";
+  Debug::check_assertion(path == expected_path,
+      std::string("Unexpected path through the NPC: '") + path + "', expected '" + expected_path + "'");
+
+  PathFinding other_path_finder(env.get_map(), other_entity, target);
+  path = other_path_finder.compute_path();
+  expected_path = "11000077";
+  Debug::check_assertion(path == expected_path,
+      std::string("Unexpected path around the NPC: '") + path + "', expected '" + expected_path + "'");
+}
+
 /**
  * \brief Checks path finding on an NPC towards a hero.
  */
@@ -80,6 +144,8 @@ int main(int argc, char** argv) {
 
   custom_entity_test(env);
   npc_test(env);
+  node_budget_test(env);
+  traversal_rules_test(env);
 
   return 0;
 }
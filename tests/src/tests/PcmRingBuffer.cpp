@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/audio/PcmRingBuffer.h"
+#include "solarus/core/Debug.h"
+#include "tools/TestEnvironment.h"
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks pushing and popping from a single thread, with wrap-around.
+ */
+void test_single_thread() {
+
+  PcmRingBuffer buffer(100);
+  Debug::check_assertion(buffer.get_capacity() == 128, "Wrong capacity");
+  Debug::check_assertion(buffer.get_num_samples() == 0, "Buffer should be empty");
+
+  std::vector<int16_t> input(100);
+  for (size_t i = 0; i < input.size(); ++i) {
+    input[i] = static_cast<int16_t>(i);
+  }
+  std::vector<int16_t> output(100);
+
+  for (int round = 0; round < 10; ++round) {
+    Debug::check_assertion(buffer.push(input.data(), 100) == 100, "Wrong number of samples pushed");
+    Debug::check_assertion(buffer.push(input.data(), 100) == 28, "Full buffer should be truncated");
+    Debug::check_assertion(buffer.get_num_free_samples() == 0, "Buffer should be full");
+
+    Debug::check_assertion(buffer.pop(output.data(), 100) == 100, "Wrong number of samples popped");
+    Debug::check_assertion(output == input, "Wrong samples popped");
+    Debug::check_assertion(buffer.pop(output.data(), 100) == 28, "Wrong number of samples popped");
+    Debug::check_assertion(buffer.pop(output.data(), 100) == 0, "Buffer should be empty");
+  }
+}
+
+/**
+ * \brief Checks that a consumer thread receives the samples of a producer
+ * thread in order.
+ */
+void test_two_threads() {
+
+  const int num_samples = 1 << 20;
+  PcmRingBuffer buffer(4096);
+
+  std::thread producer([&buffer]() {
+    std::mt19937 random(1);
+    std::vector<int16_t> chunk;
+    int next = 0;
+    while (next < num_samples) {
+      chunk.resize(std::min<int>(1 + random() % 1000, num_samples - next));
+      for (int16_t& sample : chunk) {
+        sample = static_cast<int16_t>(next++);
+      }
+      size_t pushed = 0;
+      while (pushed < chunk.size()) {
+        pushed += buffer.push(chunk.data() + pushed, chunk.size() - pushed);
+      }
+    }
+  });
+
+  std::mt19937 random(2);
+  std::vector<int16_t> chunk(1000);
+  int expected = 0;
+  while (expected < num_samples) {
+    const size_t popped = buffer.pop(chunk.data(), 1 + random() % 1000);
+    for (size_t i = 0; i < popped; ++i) {
+      Debug::check_assertion(chunk[i] == static_cast<int16_t>(expected), "Samples out of order");
+      ++expected;
+    }
+  }
+
+  producer.join();
+  Debug::check_assertion(buffer.get_num_samples() == 0, "Unexpected samples left");
+}
+
+}
+
+/**
+ * Tests for the ring buffer of decoded music samples.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_single_thread();
+  test_two_threads();
+
+  return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/PixelBits.h"
+#include "solarus/core/Point.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/Surface.h"
+#include "tools/TestEnvironment.h"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief The previous implementation of aligned pixel collisions,
+ * kept as a reference for correctness and speed.
+ *
+ * Rows are stored as separate arrays of 32-bit masks.
+ */
+class LegacyPixelBits {
+
+  public:
+
+    LegacyPixelBits(const Surface& surface):
+      width(surface.get_width()),
+      height(surface.get_height()),
+      nb_integers_per_row((width + 31) >> 5),
+      bits(height, std::vector<uint32_t>(nb_integers_per_row, 0)) {
+
+      int pixel_index = 0;
+      for (int i = 0; i < height; ++i) {
+        for (int j = 0; j < width; ++j) {
+          if (!surface.is_pixel_transparent(pixel_index)) {
+            bits[i][j >> 5] |= 0x80000000 >> (j & 31);
+          }
+          ++pixel_index;
+        }
+      }
+    }
+
+    bool test_aligned_collision(const LegacyPixelBits& other,
+        const Point& location1, const Point& location2) const {
+
+      const Rectangle bounding_box1(location1.x, location1.y, width, height);
+      const Rectangle bounding_box2(location2.x, location2.y, other.width, other.height);
+      if (!bounding_box1.overlaps(bounding_box2)) {
+        return false;
+      }
+
+      const int intersection_x = std::max(bounding_box1.get_x(), bounding_box2.get_x());
+      const int intersection_y = std::max(bounding_box1.get_y(), bounding_box2.get_y());
+      const int intersection_width = std::min(bounding_box1.get_x() + bounding_box1.get_width(),
+          bounding_box2.get_x() + bounding_box2.get_width()) - intersection_x;
+      const int intersection_height = std::min(bounding_box1.get_y() + bounding_box1.get_height(),
+          bounding_box2.get_y() + bounding_box2.get_height()) - intersection_y;
+      const Point offset1(intersection_x - bounding_box1.get_x(), intersection_y - bounding_box1.get_y());
+      const Point offset2(intersection_x - bounding_box2.get_x(), intersection_y - bounding_box2.get_y());
+
+      std::vector<std::vector<uint32_t>>::const_iterator rows_a;
+      std::vector<std::vector<uint32_t>>::const_iterator rows_b;
+      int nb_unused_masks_row_b;
+      int nb_unused_bits_row_b;
+      if (bounding_box1.get_x() > bounding_box2.get_x()) {
+        rows_a = bits.begin() + offset1.y;
+        rows_b = other.bits.begin() + offset2.y;
+        nb_unused_masks_row_b = offset2.x >> 5;
+        nb_unused_bits_row_b = offset2.x & 31;
+      }
+      else {
+        rows_a = other.bits.begin() + offset2.y;
+        rows_b = bits.begin() + offset1.y;
+        nb_unused_masks_row_b = offset1.x >> 5;
+        nb_unused_bits_row_b = offset1.x & 31;
+      }
+      const int nb_used_bits_row_b = 32 - nb_unused_bits_row_b;
+      const int nb_masks_per_row_a = (intersection_width + 31) >> 5;
+      const int nb_masks_per_row_b = (intersection_width + nb_unused_bits_row_b + 31) >> 5;
+
+      for (int i = 0; i < intersection_height; ++i) {
+        const std::vector<uint32_t>& bits_a = *rows_a;
+        const std::vector<uint32_t>& bits_b = *rows_b;
+        ++rows_a;
+        ++rows_b;
+        for (int j = 0; j < nb_masks_per_row_a; ++j) {
+          const uint32_t mask_a = bits_a[j];
+          const uint32_t mask_b = bits_b[j + nb_unused_masks_row_b];
+          // Shifting a 32-bit value by 32 is undefined: use 64 bits.
+          const uint32_t mask_a_left = static_cast<uint32_t>(uint64_t(mask_a) >> nb_unused_bits_row_b);
+          uint32_t next_mask_b_left = 0x00000000;
+          if (j + 1 < nb_masks_per_row_a || nb_masks_per_row_b > nb_masks_per_row_a) {
+            next_mask_b_left = static_cast<uint32_t>(
+                uint64_t(bits_b[j + nb_unused_masks_row_b + 1]) >> nb_used_bits_row_b);
+          }
+          if (((mask_a_left & mask_b) | (mask_a & next_mask_b_left)) != 0x00000000) {
+            return true;
+          }
+        }
+      }
+      return false;
+    }
+
+  private:
+
+    int width;
+    int height;
+    int nb_integers_per_row;
+    std::vector<std::vector<uint32_t>> bits;
+};
+
+/**
+ * \brief An image with its pixel bits in both implementations.
+ */
+struct TestImage {
+  SurfacePtr surface;
+  std::unique_ptr<PixelBits> pixel_bits;
+  std::unique_ptr<LegacyPixelBits> legacy_pixel_bits;
+};
+
+/**
+ * \brief Creates an image looking like a sprite frame: an opaque ellipse
+ * with some transparent holes.
+ */
+TestImage make_image(std::mt19937& random, int width, int height) {
+
+  std::string pixels(width * height * 4, '\0');
+  const float center_x = width / 2.0f;
+  const float center_y = height / 2.0f;
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      const float dx = (x + 0.5f - center_x) / center_x;
+      const float dy = (y + 0.5f - center_y) / center_y;
+      const bool opaque = dx * dx + dy * dy <= 1.0f && random() % 8 != 0;
+      if (opaque) {
+        const int index = (y * width + x) * 4;
+        pixels[index] = '\xff';
+        pixels[index + 3] = '\xff';
+      }
+    }
+  }
+
+  TestImage image;
+  image.surface = Surface::create(width, height);
+  image.surface->set_pixels(pixels);
+  image.pixel_bits = std::unique_ptr<PixelBits>(
+      new PixelBits(*image.surface, Rectangle(0, 0, width, height))
+  );
+  image.legacy_pixel_bits = std::unique_ptr<LegacyPixelBits>(
+      new LegacyPixelBits(*image.surface)
+  );
+  return image;
+}
+
+/**
+ * \brief Creates images of typical sprite sizes.
+ */
+std::vector<TestImage> make_images(std::mt19937& random) {
+
+  const Size sizes[] = {
+      Size(16, 16), Size(24, 32), Size(32, 32), Size(8, 8),
+      Size(48, 48), Size(96, 16), Size(16, 96), Size(130, 70)
+  };
+  std::vector<TestImage> images;
+  for (const Size& size : sizes) {
+    images.push_back(make_image(random, size.width, size.height));
+  }
+  return images;
+}
+
+/**
+ * \brief A pair of images and their positions.
+ */
+struct TestCase {
+  int image1;
+  int image2;
+  Point location1;
+  Point location2;
+};
+
+/**
+ * \brief Generates pairs of images close to each other.
+ */
+std::vector<TestCase> make_test_cases(std::mt19937& random, int num_images, int num_cases) {
+
+  std::vector<TestCase> test_cases;
+  for (int i = 0; i < num_cases; ++i) {
+    TestCase test_case;
+    test_case.image1 = random() % num_images;
+    test_case.image2 = random() % num_images;
+    test_case.location1 = Point(random() % 160, random() % 120);
+    test_case.location2 = test_case.location1 + Point(
+        static_cast<int>(random() % 160) - 80,
+        static_cast<int>(random() % 120) - 60
+    );
+    test_cases.push_back(test_case);
+  }
+  return test_cases;
+}
+
+/**
+ * \brief Checks that both implementations detect the same collisions.
+ */
+void test_same_results(
+    const std::vector<TestImage>& images,
+    const std::vector<TestCase>& test_cases) {
+
+  int num_collisions = 0;
+  for (const TestCase& test_case : test_cases) {
+    const TestImage& image1 = images[test_case.image1];
+    const TestImage& image2 = images[test_case.image2];
+    const bool expected = image1.legacy_pixel_bits->test_aligned_collision(
+        *image2.legacy_pixel_bits, test_case.location1, test_case.location2);
+    const bool result = image1.pixel_bits->test_aligned_collision(
+        *image2.pixel_bits, test_case.location1, test_case.location2);
+    if (result != expected) {
+      std::ostringstream oss;
+      oss << "Wrong pixel collision result between images " << test_case.image1
+          << " at " << test_case.location1 << " and " << test_case.image2
+          << " at " << test_case.location2 << ": expected " << expected;
+      Debug::die(oss.str());
+    }
+    if (result) {
+      ++num_collisions;
+    }
+  }
+  Debug::check_assertion(num_collisions > 0, "No collision was tested");
+}
+
+/**
+ * \brief Measures the time of pixel collision tests with both implementations.
+ */
+void benchmark(
+    const std::vector<TestImage>& images,
+    const std::vector<TestCase>& test_cases) {
+
+  using Clock = std::chrono::steady_clock;
+  const int num_rounds = 20;
+  int num_collisions = 0;
+
+  const Clock::time_point legacy_start = Clock::now();
+  for (int round = 0; round < num_rounds; ++round) {
+    for (const TestCase& test_case : test_cases) {
+      num_collisions += images[test_case.image1].legacy_pixel_bits->test_aligned_collision(
+          *images[test_case.image2].legacy_pixel_bits, test_case.location1, test_case.location2);
+    }
+  }
+  const Clock::time_point start = Clock::now();
+  for (int round = 0; round < num_rounds; ++round) {
+    for (const TestCase& test_case : test_cases) {
+      num_collisions += images[test_case.image1].pixel_bits->test_aligned_collision(
+          *images[test_case.image2].pixel_bits, test_case.location1, test_case.location2);
+    }
+  }
+  const Clock::time_point end = Clock::now();
+
+  const double num_tests = static_cast<double>(num_rounds) * test_cases.size();
+  const double legacy_ns = std::chrono::duration<double, std::nano>(start - legacy_start).count() / num_tests;
+  const double ns = std::chrono::duration<double, std::nano>(end - start).count() / num_tests;
+  std::cout << "Pixel collisions: " << ns << " ns per test (previous implementation: "
+            << legacy_ns << " ns, " << num_collisions << " collisions)" << std::endl;
+}
+
+}
+
+/**
+ * Tests and benchmark for pixel-precise collisions.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  std::mt19937 random(42);
+  const std::vector<TestImage> images = make_images(random);
+  const std::vector<TestCase> test_cases = make_test_cases(random, images.size(), 20000);
+
+  test_same_results(images, test_cases);
+  benchmark(images, test_cases);
+
+  return 0;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/Hq4xFilter.h"
+#include "solarus/graphics/Scale2xFilter.h"
+#include "solarus/third_party/hqx/hqx.h"
+#include "tools/TestEnvironment.h"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief The previous single-threaded scalar implementation of Scale2x,
+ * kept as a reference for correctness and speed.
+ */
+void legacy_scale2x(const uint32_t* src, int src_width, int src_height, uint32_t* dst) {
+
+  const int dst_width = src_width * 2;
+
+  int e1 = 0;
+  int e2, e3, e4;
+  int b, d, e = 0, f,  h;
+  for (int row = 0; row < src_height; row++) {
+    for (int col = 0; col < src_width; col++) {
+      b = e - src_width;
+      d = e - 1;
+      f = e + 1;
+      h = e + src_width;
+
+      if (row == 0) {
+        b = e;
+      }
+      if (row == src_height - 1) {
+        h = e;
+      }
+      if (col == 0) {
+        d = e;
+      }
+      if (col == src_width - 1) {
+        f = e;
+      }
+
+      e2 = e1 + 1;
+      e3 = e1 + dst_width;
+      e4 = e3 + 1;
+
+      if (src[b] != src[h] && src[d] != src[f]) {
+        dst[e1] = src[(src[d] == src[b]) ? d : e];
+        dst[e2] = src[(src[b] == src[f]) ? f : e];
+        dst[e3] = src[(src[d] == src[h]) ? d : e];
+        dst[e4] = src[(src[h] == src[f]) ? f : e];
+      }
+      else {
+        dst[e1] = dst[e2] = dst[e3] = dst[e4] = src[e];
+      }
+      e1 += 2;
+      e++;
+    }
+    e1 += dst_width;
+  }
+}
+
+/**
+ * \brief Creates an image with few colors, so that neighbors are often equal
+ * like in pixel art.
+ */
+std::vector<uint32_t> make_image(std::mt19937& random, int width, int height) {
+
+  const uint32_t colors[] = { 0xff000000, 0xffffffff, 0xff0000ff, 0x00000000 };
+  std::vector<uint32_t> pixels(width * height);
+  for (uint32_t& pixel : pixels) {
+    pixel = colors[random() % 4];
+  }
+  return pixels;
+}
+
+/**
+ * \brief Checks that Scale2x gives the same result as the previous
+ * implementation, including on images too narrow for vectorized columns.
+ */
+void test_scale2x(std::mt19937& random) {
+
+  const Scale2xFilter filter;
+  const int sizes[][2] = { { 320, 240 }, { 1, 1 }, { 5, 3 }, { 7, 9 }, { 17, 1 } };
+  for (const auto& size : sizes) {
+    const int width = size[0];
+    const int height = size[1];
+    const std::vector<uint32_t> src = make_image(random, width, height);
+    std::vector<uint32_t> expected(width * height * 4);
+    std::vector<uint32_t> result(width * height * 4);
+    legacy_scale2x(src.data(), width, height, expected.data());
+    filter.filter(src.data(), width, height, result.data());
+    Debug::check_assertion(result == expected, "Wrong Scale2x result");
+  }
+}
+
+/**
+ * \brief Checks that hq4x split into bands gives the same result as hq4x
+ * applied to the whole image, also when running in background.
+ */
+void test_hq4x(std::mt19937& random) {
+
+  const Hq4xFilter filter;
+  Hq4xFilter::initialize_hqx();
+  const int width = 320;
+  const int height = 240;
+  std::vector<uint32_t> src = make_image(random, width, height);
+  std::vector<uint32_t> expected(width * height * 16);
+  std::vector<uint32_t> result(width * height * 16);
+
+  hq4x_32(src.data(), expected.data(), width, height);
+  filter.filter(src.data(), width, height, result.data());
+  Debug::check_assertion(result == expected, "Wrong hq4x result");
+
+  std::fill(result.begin(), result.end(), 0);
+  filter.start_filter(src.data(), width, height, result.data());
+  SoftwarePixelFilter::finish_filter();
+  Debug::check_assertion(result == expected, "Wrong hq4x result in background");
+}
+
+/**
+ * \brief Measures the time of Scale2x with both implementations.
+ */
+void benchmark(std::mt19937& random) {
+
+  using Clock = std::chrono::steady_clock;
+  const Scale2xFilter filter;
+  const int width = 320;
+  const int height = 240;
+  const int num_rounds = 100;
+  const std::vector<uint32_t> src = make_image(random, width, height);
+  std::vector<uint32_t> dst(width * height * 4);
+
+  const Clock::time_point legacy_start = Clock::now();
+  for (int round = 0; round < num_rounds; ++round) {
+    legacy_scale2x(src.data(), width, height, dst.data());
+  }
+  const Clock::time_point start = Clock::now();
+  for (int round = 0; round < num_rounds; ++round) {
+    filter.filter(src.data(), width, height, dst.data());
+  }
+  const Clock::time_point end = Clock::now();
+
+  const double legacy_us = std::chrono::duration<double, std::micro>(start - legacy_start).count() / num_rounds;
+  const double us = std::chrono::duration<double, std::micro>(end - start).count() / num_rounds;
+  std::cout << "Scale2x: " << us << " us per frame (previous implementation: "
+            << legacy_us << " us)" << std::endl;
+}
+
+}
+
+/**
+ * Tests and benchmark for software pixel filters.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  std::mt19937 random(42);
+  test_scale2x(random);
+  test_hq4x(random);
+  benchmark(random);
+
+  SoftwarePixelFilter::quit();
+
+  return 0;
+}
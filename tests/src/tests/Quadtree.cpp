@@ -154,6 +154,37 @@ void test_add(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
   check_found(found_elements, added_elements[4]);
 }
 
+/**
+ * \brief Tests queries that fill a buffer, including a query on several
+ * rectangles at once.
+ */
+void test_queries(TestEnvironment& /* env */, Quadtree<ElementPtr>& quadtree) {
+
+  // The buffer version gives the same result as the simple one,
+  // even if the buffer is not empty.
+  Box region(220, 10, 100, 100);
+  std::vector<ElementPtr> found_elements = quadtree.get_elements(region);
+  std::vector<ElementPtr> buffer = quadtree.get_elements(quadtree.get_space());
+  quadtree.get_elements(region, buffer);
+  Debug::check_assertion(buffer == found_elements, "Buffered query gave a different result");
+
+  // Query two rectangles with a common element.
+  const Box regions[] = {
+      Box(220, 10, 100, 100),
+      Box(310, 40, 100, 30)
+  };
+  std::vector<Quadtree<ElementPtr>::Match> matches;
+  quadtree.get_elements(regions, 2, matches);
+  Debug::check_assertion(matches.size() == 3, "Expected 3 elements found");
+  for (const Quadtree<ElementPtr>::Match& match : matches) {
+    const Box& box = match.first->get_bounding_box();
+    const uint32_t expected_mask =
+        (box.overlaps(regions[0]) ? 1 : 0) |
+        (box.overlaps(regions[1]) ? 2 : 0);
+    Debug::check_assertion(match.second == expected_mask, "Wrong mask in batched query");
+  }
+}
+
 /**
  * \brief Tests removing elements from a quadtree.
  */
@@ -249,6 +280,7 @@ int main(int argc, char** argv) {
 
   test_empty(env, quadtree);
   test_add(env, quadtree);
+  test_queries(env, quadtree);
   test_add_big_size(env, quadtree);
   test_add_limit(env, quadtree);
   test_add_center_outside(env, quadtree);
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/core/Rectangle.h"
+#include "solarus/graphics/SkylinePacker.h"
+#include "tools/TestEnvironment.h"
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that placed rectangles are inside the area and
+ * do not overlap.
+ */
+void check_placements(const SkylinePacker& packer, const std::vector<Rectangle>& placed) {
+
+  const Rectangle area(Point(), packer.get_size());
+  int used_area = 0;
+  for (size_t i = 0; i < placed.size(); ++i) {
+    const Rectangle& rectangle = placed[i];
+    Debug::check_assertion(area.contains(rectangle), "Rectangle outside the area");
+    for (size_t j = i + 1; j < placed.size(); ++j) {
+      if (rectangle.overlaps(placed[j])) {
+        std::ostringstream oss;
+        oss << "Rectangles " << rectangle << " and " << placed[j] << " overlap";
+        Debug::die(oss.str());
+      }
+    }
+    used_area += rectangle.get_width() * rectangle.get_height();
+  }
+  Debug::check_assertion(used_area == packer.get_used_area(), "Wrong used area");
+}
+
+/**
+ * \brief Checks that an area exactly covered by identical rectangles
+ * can be filled completely.
+ */
+void test_exact_fit() {
+
+  SkylinePacker packer(Size(64, 64));
+  std::vector<Rectangle> placed;
+  Point position;
+  for (int i = 0; i < 16; ++i) {
+    Debug::check_assertion(packer.insert(Size(16, 16), position), "Tile does not fit");
+    placed.emplace_back(position, Size(16, 16));
+  }
+  check_placements(packer, placed);
+  Debug::check_assertion(!packer.insert(Size(1, 1), position), "Full area accepted a rectangle");
+  Debug::check_assertion(!packer.insert(Size(0, 8), position), "Empty rectangle accepted");
+}
+
+/**
+ * \brief Packs rectangles of typical image sizes until the area is full
+ * and checks that the space is reasonably used.
+ */
+void test_random_sizes() {
+
+  std::mt19937 random(42);
+  const Size sizes[] = {
+      Size(16, 16), Size(32, 32), Size(24, 32), Size(64, 16),
+      Size(96, 128), Size(128, 64), Size(16, 96), Size(8, 8)
+  };
+
+  SkylinePacker packer(Size(512, 512));
+  std::vector<Rectangle> placed;
+  Point position;
+  int num_failures = 0;
+  while (num_failures < 20) {
+    const Size& size = sizes[random() % (sizeof(sizes) / sizeof(sizes[0]))];
+    if (packer.insert(size, position)) {
+      placed.emplace_back(position, size);
+    }
+    else {
+      ++num_failures;
+    }
+  }
+  check_placements(packer, placed);
+
+  const double occupancy = packer.get_used_area() / (512.0 * 512.0);
+  std::cout << "Skyline packer: " << placed.size() << " rectangles, "
+            << static_cast<int>(occupancy * 100) << "% of the area used" << std::endl;
+  Debug::check_assertion(occupancy > 0.8, "Too much space lost");
+}
+
+}
+
+/**
+ * Tests for the rectangle packer of texture atlases.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  test_exact_fit();
+  test_random_sizes();
+
+  return 0;
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/core/Debug.h"
+#include "solarus/graphics/Surface.h"
+#include "solarus/graphics/Video.h"
+#include "solarus/graphics/glrenderer/GlTexture.h"
+#include "tools/TestEnvironment.h"
+#include <iostream>
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Checks that the opaque pixels of a region of an image were copied
+ * to a surface.
+ */
+void check_opaque_pixels(
+    const std::string& image_pixels,
+    const Size& image_size,
+    const Rectangle& region,
+    const std::string& dst_pixels) {
+
+  for (int y = region.get_y(); y < region.get_y() + region.get_height(); ++y) {
+    for (int x = region.get_x(); x < region.get_x() + region.get_width(); ++x) {
+      const size_t index = (y * image_size.width + x) * 4;
+      if (static_cast<uint8_t>(image_pixels[index + 3]) != 255) {
+        continue;
+      }
+      Debug::check_assertion(image_pixels.compare(index, 4, dst_pixels, index, 4) == 0,
+          "Wrong pixel drawn from the atlas");
+    }
+  }
+}
+
+/**
+ * \brief Checks that drawing an image packed in an atlas, entirely or
+ * partially, samples the atlas and keeps the image there.
+ */
+void test_draw_atlased_image() {
+
+  SurfacePtr image = Surface::create("sprites/16x16.png", Surface::DIR_DATA);
+  Debug::check_assertion(image != nullptr, "Missing image");
+  const GlTexture& texture = image->get_impl().as<GlTexture>();
+  Debug::check_assertion(texture.is_in_atlas(), "Image should be in an atlas");
+
+  const Size& size = image->get_size();
+  const std::string& image_pixels = image->get_pixels();
+  SurfacePtr dst_surface = Surface::create(size);
+  image->set_blend_mode(BlendMode::NONE);
+
+  image->draw(dst_surface);
+  Debug::check_assertion(texture.is_in_atlas(), "Image left its atlas when drawn entirely");
+  check_opaque_pixels(image_pixels, size, Rectangle(Point(), size), dst_surface->get_pixels());
+
+  const Rectangle region(8, 8, size.width / 2, size.height / 2);
+  dst_surface->clear();
+  image->draw_region(region, dst_surface, region.get_xy());
+  Debug::check_assertion(texture.is_in_atlas(), "Image left its atlas when drawn partially");
+  check_opaque_pixels(image_pixels, size, region, dst_surface->get_pixels());
+}
+
+}
+
+/**
+ * Tests for images packed into texture atlases by the GL renderer.
+ */
+int main(int argc, char** argv) {
+
+  TestEnvironment env(argc, argv);
+
+  if (Video::get_renderer().get_name() != "GlRenderer") {
+    std::cout << "No GL renderer, texture atlases are not used" << std::endl;
+    return 0;
+  }
+
+  test_draw_atlased_image();
+
+  return 0;
+}
@@ -0,0 +1,66 @@
+local map = ...
+
+-- Checks that entities beyond their optimization distance are neither
+-- updated nor checked for collisions, and that they wake up when the
+-- camera gets close or when their distance is set to 0.
+
+local hero = map:get_hero()
+local num_updates = 0
+local num_collisions = 0
+
+function sleeper:on_update()
+  num_updates = num_updates + 1
+end
+
+sleeper:add_collision_test("overlapping", function(_, other)
+  if other == probe then
+    num_collisions = num_collisions + 1
+  end
+end)
+
+function map:on_started()
+
+  assert_equal(probe:get_optimization_distance(), 0)
+  sleeper:set_optimization_distance(32)
+  assert_equal(sleeper:get_optimization_distance(), 32)
+end
+
+function map:on_opening_transition_finished()
+
+  sol.timer.start(map, 100, function()
+    -- The sleeper is far from the camera: it is sleeping.
+    local sleeping_updates = num_updates
+    probe:set_position(sleeper:get_position())
+
+    sol.timer.start(map, 100, function()
+      assert_equal(num_updates, sleeping_updates)
+      assert_equal(num_collisions, 0)
+
+      -- A distance of 0 wakes it up immediately.
+      sleeper:set_optimization_distance(0)
+      assert(num_collisions > 0)
+
+      sol.timer.start(map, 100, function()
+        assert(num_updates > sleeping_updates)
+
+        -- Let it sleep again, then bring the camera closer.
+        probe:set_position(1000, 125)
+        sleeper:set_optimization_distance(32)
+
+        sol.timer.start(map, 100, function()
+          sleeping_updates = num_updates
+
+          sol.timer.start(map, 100, function()
+            assert_equal(num_updates, sleeping_updates)
+            hero:set_position(1100, 125)
+
+            sol.timer.start(map, 100, function()
+              assert(num_updates > sleeping_updates)
+              sol.main.exit()
+            end)
+          end)
+        end)
+      end)
+    end)
+  end)
+end
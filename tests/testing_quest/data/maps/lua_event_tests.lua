@@ -0,0 +1,59 @@
+local map = ...
+
+-- Checks that callbacks like on_update() are called after they are
+-- defined on a userdata or on a metatable, and no longer after they are
+-- removed.
+
+local custom_entity_meta = sol.main.get_metatable("custom_entity")
+local own_updates = 0
+local meta_updates = 0
+local map_updates = 0
+
+function map:on_update()
+  map_updates = map_updates + 1
+end
+
+function entity_1:on_update()
+  own_updates = own_updates + 1
+end
+
+function map:on_opening_transition_finished()
+
+  sol.timer.start(map, 100, function()
+    assert(map_updates > 0)
+    assert(own_updates > 0)
+    assert(meta_updates == 0)
+
+    -- Remove the callback of the entity, define one in the metatable.
+    entity_1.on_update = nil
+    own_updates = 0
+    function custom_entity_meta:on_update()
+      meta_updates = meta_updates + 1
+    end
+
+    sol.timer.start(map, 100, function()
+      assert(own_updates == 0)
+      assert(meta_updates > 0)
+
+      -- Removing it from the metatable also stops the calls.
+      custom_entity_meta.on_update = nil
+      meta_updates = 0
+
+      sol.timer.start(map, 100, function()
+        assert(meta_updates == 0)
+
+        -- Events are still detected if the metatable gets its own metatable.
+        assert(getmetatable(custom_entity_meta) == nil)
+        setmetatable(custom_entity_meta, {})
+        function custom_entity_meta:on_update()
+          meta_updates = meta_updates + 1
+        end
+
+        sol.timer.start(map, 100, function()
+          assert(meta_updates > 0)
+          sol.main.exit()
+        end)
+      end)
+    end)
+  end)
+end
@@ -0,0 +1,37 @@
+local map = ...
+
+-- Checks that games are saved in background, that bursts of saves
+-- give the last values and that callbacks are called.
+
+function map:on_opening_transition_finished()
+
+  local file_name = "savegame_tests.dat"
+  if sol.game.exists(file_name) then
+    sol.game.delete(file_name)
+  end
+
+  local savegame = sol.game.load(file_name)
+  local results = {}
+  for i = 1, 3 do
+    savegame:set_value("savegame_test_value", i)
+    savegame:save(function(success)
+      results[#results + 1] = success
+    end)
+  end
+
+  -- Callbacks are called later from the main loop.
+  assert_equal(#results, 0)
+
+  -- Accessing the file waits until it is written.
+  assert(sol.game.exists(file_name))
+  assert_equal(sol.game.load(file_name):get_value("savegame_test_value"), 3)
+
+  later(function()
+    assert_equal(#results, 3)
+    for i = 1, 3 do
+      assert(results[i])
+    end
+    sol.game.delete(file_name)
+    sol.main.exit()
+  end)
+end
@@ -14,6 +14,41 @@ local function test_get_pixels()
   assert_equal(a, 255)
 end
 
+-- Test for sol.surface.get_pixels() with a region.
+local function test_get_pixels_region()
+  local surface = sol.surface.create(16, 16)
+  surface:fill_color({128, 64, 0, 255})
+  surface:fill_color({0, 32, 255, 255}, 4, 2, 3, 5)
+
+  local pixels = surface:get_pixels(4, 2, 3, 5)
+  assert_equal(#pixels, 3 * 5 * 4)
+  local r, g, b, a = pixels:byte(#pixels - 3, #pixels)
+  assert_equal(r, 0)
+  assert_equal(g, 32)
+  assert_equal(b, 255)
+  assert_equal(a, 255)
+
+  pixels = surface:get_pixels(3, 2, 2, 1)
+  r, g, b, a = pixels:byte(1, 4)
+  assert_equal(r, 128)
+  assert_equal(g, 64)
+  assert_equal(b, 0)
+  assert_equal(a, 255)
+  r, g, b, a = pixels:byte(5, 8)
+  assert_equal(r, 0)
+  assert_equal(g, 32)
+  assert_equal(b, 255)
+  assert_equal(a, 255)
+
+  -- The rest of the surface is still synchronized.
+  pixels = surface:get_pixels()
+  r, g, b, a = pixels:byte(16 * 16 * 4 - 3, 16 * 16 * 4)
+  assert_equal(r, 128)
+  assert_equal(g, 64)
+  assert_equal(b, 0)
+  assert_equal(a, 255)
+end
+
 -- Test for sol.surface.set_pixels().
 local function test_set_pixels()
 
@@ -32,6 +67,7 @@ local function test_set_pixels()
 end
 
 test_get_pixels()
+test_get_pixels_region()
 test_set_pixels()
 
 sol.main.exit()
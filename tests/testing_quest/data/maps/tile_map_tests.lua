@@ -0,0 +1,27 @@
+local map = ...
+
+-- Checks that two regions of a surface have the same pixels.
+local function check_same_pixels(surface, x, y, reference_x, reference_y, width, height)
+
+  local pixels = surface:get_pixels(x, y, width, height)
+  local reference_pixels = surface:get_pixels(reference_x, reference_y, width, height)
+  assert(pixels == reference_pixels, "Wrong pixels at " .. x .. "," .. y)
+end
+
+-- Tiles bigger than their pattern repeat it, also when drawn with
+-- the tile map shader.
+function map:on_draw(dst_surface)
+
+  -- Animated tile twice as big as its pattern: four copies of the reference tile.
+  for y = 0, 8, 8 do
+    for x = 0, 16, 16 do
+      check_same_pixels(dst_surface, x, y, 0, 32, 16, 8)
+    end
+  end
+
+  -- Static tile over animated squares, twice as wide as its pattern.
+  check_same_pixels(dst_surface, 0, 64, 120, 64, 40, 40)
+  check_same_pixels(dst_surface, 40, 64, 120, 64, 40, 40)
+
+  sol.main.exit()
+end
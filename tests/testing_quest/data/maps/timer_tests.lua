@@ -0,0 +1,44 @@
+local map = ...
+
+-- Checks the order of timers, their suspension and their repetition.
+
+local fired = {}
+
+local function record(name)
+  return function()
+    fired[#fired + 1] = name
+  end
+end
+
+function map:on_opening_transition_finished()
+
+  sol.timer.start(map, 100, record("b"))
+  sol.timer.start(map, 50, record("a"))
+  sol.timer.start(map, 200, record("c"))
+
+  local suspended_timer = sol.timer.start(map, 20, record("suspended"))
+  suspended_timer:set_suspended(true)
+
+  local num_repeats = 0
+  sol.timer.start(map, 30, function()
+    num_repeats = num_repeats + 1
+    return num_repeats < 3
+  end)
+
+  sol.timer.start(map, 300, function()
+    assert(#fired == 3)
+    assert(fired[1] == "a")
+    assert(fired[2] == "b")
+    assert(fired[3] == "c")
+    assert(num_repeats == 3)
+
+    -- Resume the suspended timer and make it expire earlier.
+    suspended_timer:set_suspended(false)
+    suspended_timer:set_remaining_time(10)
+
+    sol.timer.start(map, 50, function()
+      assert(fired[4] == "suspended")
+      sol.main.exit()
+    end)
+  end)
+end
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2006-2019 Christopho, Solarus - http://www.solarus-games.org
+ *
+ * Solarus is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Solarus is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "solarus/lua/CompiledLuaData.h"
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace Solarus;
+
+namespace {
+
+/**
+ * \brief Compiles a data file and writes the compiled file next to it.
+ * \param file_name Path of a Lua data file.
+ * \return \c true in case of success.
+ */
+bool compile_file(const std::string& file_name) {
+
+  std::ifstream in(file_name, std::ios::binary);
+  if (!in) {
+    std::cerr << "Cannot open file '" << file_name << "'" << std::endl;
+    return false;
+  }
+  std::ostringstream source;
+  source << in.rdbuf();
+
+  CompiledLuaData compiled;
+  if (!compiled.compile(source.str(), file_name)) {
+    std::cerr << "Cannot compile file '" << file_name << "'" << std::endl;
+    return false;
+  }
+  std::string buffer;
+  compiled.export_to_buffer(buffer);
+
+  const std::string& compiled_file_name = CompiledLuaData::get_compiled_file_name(file_name);
+  std::ofstream out(compiled_file_name, std::ios::binary);
+  if (!out.write(buffer.data(), buffer.size())) {
+    std::cerr << "Cannot write file '" << compiled_file_name << "'" << std::endl;
+    return false;
+  }
+  std::cout << compiled_file_name << ": " << compiled.get_num_calls() << " calls, "
+            << buffer.size() << " bytes (source: " << source.str().size() << " bytes)"
+            << std::endl;
+  return true;
+}
+
+}
+
+/**
+ * \brief Compiles Lua data files of a quest like maps, tilesets and sprites.
+ *
+ * Each file "x.dat" given on the command line produces "x.datc".
+ * The engine loads the compiled file instead of the data file as long as
+ * the data file is not modified.
+ *
+ * Example: find data -name "*.dat" | xargs solarus-data-compiler
+ */
+int main(int argc, char** argv) {
+
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0] << " data_file.dat..." << std::endl;
+    return 1;
+  }
+
+  int result = 0;
+  for (int i = 1; i < argc; ++i) {
+    if (!compile_file(argv[i])) {
+      result = 1;
+    }
+  }
+  return result;
+}
@@ -406,6 +406,7 @@ Similarly, you can even remove (by assigning `nil`) or modify (by assigning a ne
 
 Remarks
     If you are a Lua expert, you know that metatables are a very powerful mechanism. They are where the magic happens. Solarus uses metatables internally to do a lot of things, like allowing you to access userdata as tables. Therefore, you should never touch any metamethod (fields whose name starts with two underscores) in the metatable of a userdata type, in particular `__index`, `__newindex` and `__gc`.
+    Events are detected when they are assigned to the metatable. Don't define them with `rawset()`: the engine would not call them.
 ]],
           args = "type_name: string",
           returns = "table",
@@ -13588,6 +13589,8 @@ Returns the optimization threshold hint of this map entity.
 
 Above this distance from the camera, the engine may decide to skip updates or drawings. This is only a hint: the engine is responsible of the final decision. A value of `0` means an infinite distance (the entity is never optimized away).
 
+If no distance was set, the default value of the entity type is returned.
+
   * Return value (number): The optimization distance hint in pixels.
 
 
@@ -13604,7 +13607,9 @@ Sets the optimization threshold hint of this map entity.
 
 Above this distance from the camera, the engine may decide to skip updates or drawings. This is only a hint: the engine is responsible of the final decision.
 
-A value of `0` means an infinite distance (the entity is never optimized away). The default value is `0`.
+A value of `0` means an infinite distance (the entity is never optimized away). The default value is `320` for destructibles, dynamic tiles and pickable treasures, and `0` for other entity types.
+
+An entity beyond this distance from the visible area is neither updated nor checked for collisions, and its sprites and movement are suspended until the camera gets closer. Setting `0` makes it active again immediately.
 
   * `optimization_distance` (number): The optimization distance hint to set in pixels.
 